@@ -36,7 +36,10 @@
 
 #pragma once
 
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
 #include <string>
 #include <boost/thread.hpp>
 #include <boost/function.hpp>
@@ -52,9 +55,14 @@ namespace tools
 {
 /** \brief This class provides simple API for executing background
     jobs. A queue of jobs is created and the specified jobs are
-    executed in order, one at a time. */
+    executed by a pool of worker threads (one by default). Jobs with
+    a higher priority are executed first; jobs of equal priority are
+    executed in the order they were added. With a single worker, jobs
+    therefore never run concurrently. */
 class BackgroundProcessing : private boost::noncopyable
 {
+  struct Job;
+
 public:
   /** \brief Events for jobs */
   enum JobEvent
@@ -74,21 +82,101 @@ public:
   /** \brief The signature for job callbacks */
   typedef boost::function<void()> JobCallback;
 
-  /** \brief Constructor. The background thread is activated automatically. */
-  BackgroundProcessing();
+  /** \brief Handle to a job returned by addJob(), used to cancel it and to query its state */
+  class JobHandle
+  {
+  public:
+    JobHandle() = default;
+
+    bool isValid() const
+    {
+      return static_cast<bool>(job_);
+    }
+
+    /** \brief True if cancelJob() was called for the job */
+    bool isCanceled() const;
+
+    /** \brief True once the job completed or was removed from the queue */
+    bool isFinished() const;
+
+  private:
+    friend class BackgroundProcessing;
+
+    explicit JobHandle(const std::shared_ptr<Job>& job) : job_(job)
+    {
+    }
+
+    std::shared_ptr<Job> job_;
+  };
+
+  /** \brief Timing statistics of the jobs processed so far */
+  struct JobStatistics
+  {
+    /** \brief Number of jobs that were executed */
+    std::size_t completed_count = 0;
+
+    /** \brief Number of jobs removed from the queue without execution (cleared, canceled or coalesced) */
+    std::size_t removed_count = 0;
 
-  /** \brief Finishes currently executing job, clears the remaining queue. */
+    /** \brief Total and maximum time executed jobs spent waiting in the queue (seconds) */
+    double total_queue_time = 0.0;
+    double max_queue_time = 0.0;
+
+    /** \brief Total and maximum time spent executing jobs (seconds) */
+    double total_execution_time = 0.0;
+    double max_execution_time = 0.0;
+
+    double getAverageQueueTime() const
+    {
+      return completed_count ? total_queue_time / completed_count : 0.0;
+    }
+
+    double getAverageExecutionTime() const
+    {
+      return completed_count ? total_execution_time / completed_count : 0.0;
+    }
+  };
+
+  /** \brief Priority used by addJob() unless specified otherwise */
+  static const int DEFAULT_PRIORITY = 0;
+
+  /** \brief Constructor. The \e worker_count background threads are activated automatically. */
+  explicit BackgroundProcessing(std::size_t worker_count = 1);
+
+  /** \brief Finishes currently executing jobs, clears the remaining queue. */
   ~BackgroundProcessing();
 
-  /** \brief Add a job to the queue of jobs to execute. A name is also specifies for the job */
-  void addJob(const JobCallback& job, const std::string& name);
+  /** \brief Add a job to the queue of jobs to execute. A name is also specifies for the job. Jobs with a higher
+      \e priority are executed first. If \e coalesce is true, jobs with the same name that have not started yet are
+      removed from the queue, since they are superseded by this one. */
+  JobHandle addJob(const JobCallback& job, const std::string& name, int priority = DEFAULT_PRIORITY,
+                   bool coalesce = false);
+
+  /** \brief Cancel a job. A job that has not started yet is removed from the queue and true is returned. A job that is
+      executing is only flagged, which it can check with isCurrentJobCanceled(). */
+  bool cancelJob(const JobHandle& handle);
 
-  /** \brief Get the size of the queue of jobs (includes currently processed job). */
+  /** \brief Check, from within a job, whether cancelJob() was called for it. Returns false outside of jobs. */
+  static bool isCurrentJobCanceled();
+
+  /** \brief Get the size of the queue of jobs (includes currently processed jobs). */
   std::size_t getJobCount() const;
 
+  /** \brief Get the number of worker threads */
+  std::size_t getWorkerCount() const
+  {
+    return worker_count_;
+  }
+
   /** \brief Clear the queue of jobs */
   void clear();
 
+  /** \brief Get the timing statistics of the jobs processed so far */
+  JobStatistics getStatistics() const;
+
+  /** \brief Reset the timing statistics */
+  void resetStatistics();
+
   /** \brief Set the callback to be triggered when events in JobEvent take place */
   void setJobUpdateEvent(const JobUpdateCallback& event);
 
@@ -96,18 +184,33 @@ public:
   void clearJobUpdateEvent();
 
 private:
-  std::unique_ptr<boost::thread> processing_thread_;
+  typedef std::chrono::steady_clock Clock;
+
+  struct Job
+  {
+    JobCallback callback;
+    std::string name;
+    Clock::time_point added;
+    std::atomic<bool> canceled{ false };
+    std::atomic<bool> finished{ false };
+  };
+
+  /** \brief Queue order: descending priority, then ascending insertion sequence */
+  typedef std::pair<int, std::uint64_t> QueueKey;
+
+  boost::thread_group processing_threads_;
+  std::size_t worker_count_;
   bool run_processing_thread_;
 
   mutable boost::mutex action_lock_;
   boost::condition_variable new_action_condition_;
-  std::deque<JobCallback> actions_;
-  std::deque<std::string> action_names_;
+  std::map<QueueKey, std::shared_ptr<Job>> actions_;
+  std::uint64_t next_sequence_;
+  std::size_t processing_count_;
+  JobStatistics statistics_;
 
   JobUpdateCallback queue_change_event_;
 
-  bool processing_;
-
   void processingThread();
 };
 }  // namespace tools
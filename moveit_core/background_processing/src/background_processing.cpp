@@ -36,6 +36,8 @@
 
 #include <moveit/background_processing/background_processing.h>
 #include "rclcpp/rclcpp.hpp"
+#include <algorithm>
+#include <vector>
 
 namespace moveit
 {
@@ -44,19 +46,44 @@ namespace tools
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_background_processing.background_processing");
 
-BackgroundProcessing::BackgroundProcessing()
+namespace
 {
-  // spin a thread that will process user events
+// cancellation flag of the job executed by the calling thread
+thread_local const std::atomic<bool>* CURRENT_JOB_CANCELED = nullptr;
+}  // namespace
+
+const int BackgroundProcessing::DEFAULT_PRIORITY;
+
+bool BackgroundProcessing::JobHandle::isCanceled() const
+{
+  return job_ && job_->canceled;
+}
+
+bool BackgroundProcessing::JobHandle::isFinished() const
+{
+  return job_ && job_->finished;
+}
+
+BackgroundProcessing::BackgroundProcessing(std::size_t worker_count)
+  : worker_count_(std::max<std::size_t>(worker_count, 1)), next_sequence_(0), processing_count_(0)
+{
+  // spin the threads that will process user events
   run_processing_thread_ = true;
-  processing_ = false;
-  processing_thread_.reset(new boost::thread(boost::bind(&BackgroundProcessing::processingThread, this)));
+  for (std::size_t i = 0; i < worker_count_; ++i)
+    processing_threads_.create_thread(boost::bind(&BackgroundProcessing::processingThread, this));
 }
 
 BackgroundProcessing::~BackgroundProcessing()
 {
-  run_processing_thread_ = false;
+  {
+    boost::mutex::scoped_lock _(action_lock_);
+    run_processing_thread_ = false;
+    for (std::pair<const QueueKey, std::shared_ptr<Job>>& action : actions_)
+      action.second->finished = true;
+    actions_.clear();
+  }
   new_action_condition_.notify_all();
-  processing_thread_->join();
+  processing_threads_.join_all();
 }
 
 void BackgroundProcessing::processingThread()
@@ -68,65 +95,152 @@ void BackgroundProcessing::processingThread()
     while (actions_.empty() && run_processing_thread_)
       new_action_condition_.wait(ulock);
 
-    while (!actions_.empty())
+    while (!actions_.empty() && run_processing_thread_)
     {
-      JobCallback fn = actions_.front();
-      std::string action_name = action_names_.front();
-      actions_.pop_front();
-      action_names_.pop_front();
-      processing_ = true;
+      std::shared_ptr<Job> job = actions_.begin()->second;
+      actions_.erase(actions_.begin());
+      ++processing_count_;
+      JobUpdateCallback queue_change_event = queue_change_event_;
 
       // make sure we are unlocked while we process the event
-      action_lock_.unlock();
+      ulock.unlock();
+      const Clock::time_point start = Clock::now();
+      CURRENT_JOB_CANCELED = &job->canceled;
       try
       {
-        RCLCPP_DEBUG(LOGGER, "Begin executing '%s'", action_name.c_str());
-        fn();
-        RCLCPP_DEBUG(LOGGER, "Done executing '%s'", action_name.c_str());
+        RCLCPP_DEBUG(LOGGER, "Begin executing '%s'", job->name.c_str());
+        job->callback();
+        RCLCPP_DEBUG(LOGGER, "Done executing '%s'", job->name.c_str());
       }
       catch (std::exception& ex)
       {
-        RCLCPP_ERROR(LOGGER, "Exception caught while processing action '%s': %s", action_name.c_str(), ex.what());
+        RCLCPP_ERROR(LOGGER, "Exception caught while processing action '%s': %s", job->name.c_str(), ex.what());
       }
-      processing_ = false;
-      if (queue_change_event_)
-        queue_change_event_(COMPLETE, action_name);
-      action_lock_.lock();
+      CURRENT_JOB_CANCELED = nullptr;
+      const Clock::time_point end = Clock::now();
+      job->finished = true;
+
+      ulock.lock();
+      const double queue_time = std::chrono::duration<double>(start - job->added).count();
+      const double execution_time = std::chrono::duration<double>(end - start).count();
+      ++statistics_.completed_count;
+      statistics_.total_queue_time += queue_time;
+      statistics_.max_queue_time = std::max(statistics_.max_queue_time, queue_time);
+      statistics_.total_execution_time += execution_time;
+      statistics_.max_execution_time = std::max(statistics_.max_execution_time, execution_time);
+      --processing_count_;
+      ulock.unlock();
+
+      if (queue_change_event)
+        queue_change_event(COMPLETE, job->name);
+      ulock.lock();
     }
   }
 }
 
-void BackgroundProcessing::addJob(const boost::function<void()>& job, const std::string& name)
+BackgroundProcessing::JobHandle BackgroundProcessing::addJob(const JobCallback& job, const std::string& name,
+                                                             int priority, bool coalesce)
 {
+  std::shared_ptr<Job> new_job = std::make_shared<Job>();
+  new_job->callback = job;
+  new_job->name = name;
+
+  std::vector<std::string> removed;
+  JobUpdateCallback queue_change_event;
   {
     boost::mutex::scoped_lock _(action_lock_);
-    actions_.push_back(job);
-    action_names_.push_back(name);
-    new_action_condition_.notify_all();
+    if (coalesce)
+    {
+      for (std::map<QueueKey, std::shared_ptr<Job>>::iterator it = actions_.begin(); it != actions_.end();)
+        if (it->second->name == name)
+        {
+          it->second->finished = true;
+          removed.push_back(name);
+          it = actions_.erase(it);
+        }
+        else
+          ++it;
+      statistics_.removed_count += removed.size();
+    }
+    new_job->added = Clock::now();
+    actions_[QueueKey(-priority, next_sequence_++)] = new_job;
+    queue_change_event = queue_change_event_;
+    new_action_condition_.notify_one();
+  }
+  if (queue_change_event)
+  {
+    for (const std::string& it : removed)
+      queue_change_event(REMOVE, it);
+    queue_change_event(ADD, name);
   }
-  if (queue_change_event_)
-    queue_change_event_(ADD, name);
+  return JobHandle(new_job);
+}
+
+bool BackgroundProcessing::cancelJob(const JobHandle& handle)
+{
+  if (!handle.job_)
+    return false;
+  handle.job_->canceled = true;
+
+  JobUpdateCallback queue_change_event;
+  {
+    boost::mutex::scoped_lock _(action_lock_);
+    std::map<QueueKey, std::shared_ptr<Job>>::iterator it = actions_.begin();
+    while (it != actions_.end() && it->second != handle.job_)
+      ++it;
+    if (it == actions_.end())
+      return false;
+    actions_.erase(it);
+    handle.job_->finished = true;
+    ++statistics_.removed_count;
+    queue_change_event = queue_change_event_;
+  }
+  if (queue_change_event)
+    queue_change_event(REMOVE, handle.job_->name);
+  return true;
+}
+
+bool BackgroundProcessing::isCurrentJobCanceled()
+{
+  return CURRENT_JOB_CANCELED && *CURRENT_JOB_CANCELED;
 }
 
 void BackgroundProcessing::clear()
 {
-  bool update = false;
-  std::deque<std::string> removed;
+  std::vector<std::string> removed;
+  JobUpdateCallback queue_change_event;
   {
     boost::mutex::scoped_lock _(action_lock_);
-    update = !actions_.empty();
+    for (std::pair<const QueueKey, std::shared_ptr<Job>>& action : actions_)
+    {
+      action.second->finished = true;
+      removed.push_back(action.second->name);
+    }
     actions_.clear();
-    action_names_.swap(removed);
+    statistics_.removed_count += removed.size();
+    queue_change_event = queue_change_event_;
   }
-  if (update && queue_change_event_)
+  if (queue_change_event)
     for (const std::string& it : removed)
-      queue_change_event_(REMOVE, it);
+      queue_change_event(REMOVE, it);
 }
 
 std::size_t BackgroundProcessing::getJobCount() const
 {
   boost::mutex::scoped_lock _(action_lock_);
-  return actions_.size() + (processing_ ? 1 : 0);
+  return actions_.size() + processing_count_;
+}
+
+BackgroundProcessing::JobStatistics BackgroundProcessing::getStatistics() const
+{
+  boost::mutex::scoped_lock _(action_lock_);
+  return statistics_;
+}
+
+void BackgroundProcessing::resetStatistics()
+{
+  boost::mutex::scoped_lock _(action_lock_);
+  statistics_ = JobStatistics();
 }
 
 void BackgroundProcessing::setJobUpdateEvent(const JobUpdateCallback& event)
@@ -0,0 +1,177 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/background_processing/background_processing.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using moveit::tools::BackgroundProcessing;
+
+namespace
+{
+// Blocks the worker executing it until release() is called
+class Gate
+{
+public:
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    entered_ = true;
+    condition_.notify_all();
+    condition_.wait(lock, [this] { return open_; });
+  }
+
+  void waitEntered()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return entered_; });
+  }
+
+  void release()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    condition_.notify_all();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool entered_ = false;
+  bool open_ = false;
+};
+
+void waitForJobs(const BackgroundProcessing& processing)
+{
+  while (processing.getJobCount() > 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+}  // namespace
+
+TEST(BackgroundProcessing, Priorities)
+{
+  BackgroundProcessing processing;
+  Gate gate;
+  std::mutex order_mutex;
+  std::vector<int> order;
+  auto record = [&](int value) {
+    std::lock_guard<std::mutex> lock(order_mutex);
+    order.push_back(value);
+  };
+
+  processing.addJob([&] { gate.wait(); }, "block");
+  gate.waitEntered();
+  processing.addJob([&] { record(1); }, "low", -1);
+  processing.addJob([&] { record(2); }, "default");
+  processing.addJob([&] { record(3); }, "high", 1);
+  processing.addJob([&] { record(4); }, "default");
+  EXPECT_EQ(processing.getJobCount(), 5u);
+  gate.release();
+  waitForJobs(processing);
+
+  EXPECT_EQ(order, std::vector<int>({ 3, 2, 4, 1 }));
+  BackgroundProcessing::JobStatistics statistics = processing.getStatistics();
+  EXPECT_EQ(statistics.completed_count, 5u);
+  EXPECT_GT(statistics.max_queue_time, 0.0);
+}
+
+TEST(BackgroundProcessing, CancelAndCoalesce)
+{
+  BackgroundProcessing processing;
+  Gate gate;
+  std::atomic<int> executed(0);
+  std::vector<std::pair<BackgroundProcessing::JobEvent, std::string>> events;
+  processing.setJobUpdateEvent([&](BackgroundProcessing::JobEvent event, const std::string& name) {
+    if (event == BackgroundProcessing::REMOVE)
+      events.emplace_back(event, name);
+  });
+
+  BackgroundProcessing::JobHandle running = processing.addJob(
+      [&] {
+        gate.wait();
+        if (BackgroundProcessing::isCurrentJobCanceled())
+          ++executed;
+      },
+      "running");
+  gate.waitEntered();
+  BackgroundProcessing::JobHandle canceled = processing.addJob([&] { executed += 10; }, "canceled");
+  processing.addJob([&] { executed += 100; }, "ik", BackgroundProcessing::DEFAULT_PRIORITY, true);
+  processing.addJob([&] { executed += 1000; }, "ik", BackgroundProcessing::DEFAULT_PRIORITY, true);
+
+  EXPECT_TRUE(processing.cancelJob(canceled));
+  EXPECT_TRUE(canceled.isCanceled());
+  EXPECT_TRUE(canceled.isFinished());
+  EXPECT_FALSE(processing.cancelJob(running));
+  EXPECT_TRUE(running.isCanceled());
+  EXPECT_FALSE(running.isFinished());
+
+  gate.release();
+  waitForJobs(processing);
+  processing.clearJobUpdateEvent();
+
+  EXPECT_TRUE(running.isFinished());
+  EXPECT_EQ(executed, 1001);
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].second, "ik");
+  EXPECT_EQ(events[1].second, "canceled");
+  EXPECT_EQ(processing.getStatistics().removed_count, 2u);
+}
+
+TEST(BackgroundProcessing, MultipleWorkers)
+{
+  BackgroundProcessing processing(2);
+  EXPECT_EQ(processing.getWorkerCount(), 2u);
+
+  // a blocked job must not keep the second worker from executing other jobs
+  Gate gate;
+  std::atomic<bool> done(false);
+  processing.addJob([&] { gate.wait(); }, "block");
+  gate.waitEntered();
+  processing.addJob([&] { done = true; }, "other");
+  while (processing.getJobCount() > 1)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_TRUE(done);
+  gate.release();
+  waitForJobs(processing);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
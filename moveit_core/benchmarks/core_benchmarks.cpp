@@ -0,0 +1,381 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Standalone benchmark of moveit_core hot paths. Runs without a ROS graph on a robot from moveit_resources and
+   reports per-operation timings as JSON, e.g.
+
+     moveit_core_benchmarks --robot panda --group panda_arm --seed 42 --output results.json
+
+   All inputs (robot states, obstacles, trajectories) are generated from the given seed, so results of two runs
+   with the same arguments are directly comparable. */
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/collision_detection/collision_matrix.h>
+#include <moveit/collision_detection_fcl/collision_env_fcl.h>
+#include <moveit/collision_distance_field/collision_env_distance_field.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <random_numbers/random_numbers.h>
+#include <tf2_eigen/tf2_eigen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+  std::string robot = "panda";
+  std::string group = "panda_arm";
+  std::string output;
+  std::string filter;
+  unsigned int seed = 42;
+  unsigned int iterations = 1000;
+  unsigned int repetitions = 5;
+  unsigned int num_states = 256;
+  unsigned int num_obstacles = 20;
+};
+
+struct Result
+{
+  std::string name;
+  unsigned int iterations;
+  double min_ns;
+  double median_ns;
+  double mean_ns;
+  double max_ns;
+};
+
+void printUsage(const char* name)
+{
+  std::cerr << "Usage: " << name << " [options]\n"
+            << "  --robot NAME         robot from moveit_resources (default: panda)\n"
+            << "  --group NAME         joint model group used for IK-free group operations (default: panda_arm)\n"
+            << "  --seed N             seed for all generated inputs (default: 42)\n"
+            << "  --iterations N       operations per repetition (default: 1000)\n"
+            << "  --repetitions N      timed repetitions per benchmark (default: 5)\n"
+            << "  --states N           number of pre-sampled robot states (default: 256)\n"
+            << "  --obstacles N        number of random boxes in the world (default: 20)\n"
+            << "  --filter STRING      only run benchmarks whose name contains STRING\n"
+            << "  --output FILE        write JSON to FILE instead of stdout\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h")
+      return false;
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for option '" << arg << "'" << std::endl;
+      return false;
+    }
+    const char* value = argv[++i];
+    if (arg == "--robot")
+      opt.robot = value;
+    else if (arg == "--group")
+      opt.group = value;
+    else if (arg == "--output")
+      opt.output = value;
+    else if (arg == "--filter")
+      opt.filter = value;
+    else if (arg == "--seed")
+      opt.seed = std::strtoul(value, nullptr, 10);
+    else if (arg == "--iterations")
+      opt.iterations = std::max(1ul, std::strtoul(value, nullptr, 10));
+    else if (arg == "--repetitions")
+      opt.repetitions = std::max(1ul, std::strtoul(value, nullptr, 10));
+    else if (arg == "--states")
+      opt.num_states = std::max(2ul, std::strtoul(value, nullptr, 10));
+    else if (arg == "--obstacles")
+      opt.num_obstacles = std::strtoul(value, nullptr, 10);
+    else
+    {
+      std::cerr << "Unknown option '" << arg << "'" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+class BenchmarkRunner
+{
+public:
+  BenchmarkRunner(const Options& opt) : opt_(opt)
+  {
+  }
+
+  /** \brief Time \e opt_.repetitions batches of \e opt_.iterations calls of \e fn. The argument passed to \e fn is the
+      running call index, so benchmarks can cycle through their pre-generated inputs. */
+  void run(const std::string& name, const std::function<void(std::size_t)>& fn)
+  {
+    if (!opt_.filter.empty() && name.find(opt_.filter) == std::string::npos)
+      return;
+
+    // warm up caches and lazily initialized data structures
+    for (std::size_t i = 0; i < std::min<std::size_t>(opt_.iterations, 10); ++i)
+      fn(i);
+
+    std::vector<double> per_op_ns;
+    per_op_ns.reserve(opt_.repetitions);
+    std::size_t index = 0;
+    for (unsigned int r = 0; r < opt_.repetitions; ++r)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned int i = 0; i < opt_.iterations; ++i)
+        fn(index++);
+      const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+      per_op_ns.push_back(elapsed.count() / opt_.iterations);
+    }
+    std::sort(per_op_ns.begin(), per_op_ns.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = opt_.iterations;
+    result.min_ns = per_op_ns.front();
+    result.max_ns = per_op_ns.back();
+    result.median_ns = per_op_ns[per_op_ns.size() / 2];
+    result.mean_ns = 0.0;
+    for (double t : per_op_ns)
+      result.mean_ns += t;
+    result.mean_ns /= per_op_ns.size();
+    results_.push_back(result);
+    std::cerr << std::left << std::setw(40) << name << std::right << std::setw(14) << std::fixed
+              << std::setprecision(1) << result.median_ns << " ns/op" << std::endl;
+  }
+
+  void writeJSON(std::ostream& out) const
+  {
+    out << std::setprecision(3) << std::fixed;
+    out << "{\n"
+        << "  \"robot\": \"" << opt_.robot << "\",\n"
+        << "  \"group\": \"" << opt_.group << "\",\n"
+        << "  \"seed\": " << opt_.seed << ",\n"
+        << "  \"iterations\": " << opt_.iterations << ",\n"
+        << "  \"repetitions\": " << opt_.repetitions << ",\n"
+        << "  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results_.size(); ++i)
+    {
+      const Result& r = results_[i];
+      out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+          << ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns << ", \"mean_ns\": " << r.mean_ns
+          << ", \"max_ns\": " << r.max_ns << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+
+private:
+  const Options& opt_;
+  std::vector<Result> results_;
+};
+
+collision_detection::AllowedCollisionMatrix createACM(const robot_model::RobotModelConstPtr& model)
+{
+  collision_detection::AllowedCollisionMatrix acm(model->getLinkModelNamesWithCollisionGeometry(), false);
+  for (const srdf::Model::DisabledCollision& dc : model->getSRDF()->getDisabledCollisionPairs())
+    acm.setEntry(dc.link1_, dc.link2_, true);
+  return acm;
+}
+
+void addRandomObstacles(const collision_detection::WorldPtr& world, unsigned int count,
+                        random_numbers::RandomNumberGenerator& rng)
+{
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    pose.translation() = Eigen::Vector3d(rng.uniformReal(-1.0, 1.0), rng.uniformReal(-1.0, 1.0),
+                                         rng.uniformReal(0.0, 1.5));
+    world->addToObject("box_" + std::to_string(i),
+                       shapes::ShapeConstPtr(new shapes::Box(rng.uniformReal(0.05, 0.2), rng.uniformReal(0.05, 0.2),
+                                                             rng.uniformReal(0.05, 0.2))),
+                       pose);
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  if (!parseOptions(argc, argv, opt))
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  robot_model::RobotModelPtr model = moveit::core::loadTestingRobotModel(opt.robot);
+  if (!model)
+  {
+    std::cerr << "Unable to load robot '" << opt.robot << "'" << std::endl;
+    return 1;
+  }
+  const robot_model::JointModelGroup* jmg = model->getJointModelGroup(opt.group);
+  if (!jmg || jmg->getLinkModels().empty())
+  {
+    std::cerr << "Robot '" << opt.robot << "' has no group '" << opt.group << "' with links" << std::endl;
+    return 1;
+  }
+  const robot_model::LinkModel* tip = jmg->getLinkModels().back();
+
+  // pre-sample all states, so the random number generator is not part of any measurement
+  random_numbers::RandomNumberGenerator rng(opt.seed);
+  std::vector<std::vector<double>> positions(opt.num_states);
+  for (std::vector<double>& p : positions)
+    model->getVariableRandomPositions(rng, p);
+  std::vector<robot_state::RobotState> states(opt.num_states, robot_state::RobotState(model));
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    states[i].setVariablePositions(positions[i]);
+    states[i].update();
+  }
+  const std::size_t n = states.size();
+
+  BenchmarkRunner runner(opt);
+  robot_state::RobotState state(model);
+
+  // forward kinematics and Jacobian
+  runner.run("robot_state_update", [&](std::size_t i) {
+    state.setVariablePositions(positions[i % n]);
+    state.update();
+  });
+  Eigen::MatrixXd jacobian;
+  runner.run("robot_state_jacobian", [&](std::size_t i) {
+    states[i % n].getJacobian(jmg, tip, Eigen::Vector3d::Zero(), jacobian);
+  });
+
+  // collision checking
+  const collision_detection::AllowedCollisionMatrix acm = createACM(model);
+  collision_detection::WorldPtr world(new collision_detection::World());
+  addRandomObstacles(world, opt.num_obstacles, rng);
+  collision_detection::CollisionRequest req;
+
+  collision_detection::CollisionEnvFCL fcl_env(model, world);
+  runner.run("fcl_self_collision", [&](std::size_t i) {
+    collision_detection::CollisionResult res;
+    fcl_env.checkSelfCollision(req, res, states[i % n], acm);
+  });
+  runner.run("fcl_world_collision", [&](std::size_t i) {
+    collision_detection::CollisionResult res;
+    fcl_env.checkRobotCollision(req, res, states[i % n], acm);
+  });
+
+  collision_detection::CollisionEnvDistanceField df_env(model, world);
+  runner.run("distance_field_self_collision", [&](std::size_t i) {
+    collision_detection::CollisionResult res;
+    df_env.checkSelfCollision(req, res, states[i % n], acm);
+  });
+  runner.run("distance_field_world_collision", [&](std::size_t i) {
+    collision_detection::CollisionResult res;
+    df_env.checkRobotCollision(req, res, states[i % n], acm);
+  });
+
+  // kinematic constraints: joint, position and orientation constraints around a sampled goal
+  robot_state::Transforms tf(model->getModelFrame());
+  kinematic_constraints::KinematicConstraintSet constraints(model);
+  constraints.add(kinematic_constraints::constructGoalConstraints(states[0], jmg, 0.5), tf);
+  geometry_msgs::msg::PoseStamped goal_pose;
+  goal_pose.header.frame_id = model->getModelFrame();
+  goal_pose.pose = tf2::toMsg(states[0].getGlobalLinkTransform(tip));
+  constraints.add(kinematic_constraints::constructGoalConstraints(tip->getName(), goal_pose, 0.1, 0.5), tf);
+  runner.run("kinematic_constraint_set_decide",
+             [&](std::size_t i) { constraints.decide(states[i % n]); });
+
+  // time parameterization of a path through pre-sampled group configurations
+  robot_trajectory::RobotTrajectory path(model, jmg);
+  {
+    robot_state::RobotState waypoint(states[0]);
+    std::vector<double> from, to, values;
+    states[0].copyJointGroupPositions(jmg, from);
+    states[1].copyJointGroupPositions(jmg, to);
+    values.resize(from.size());
+    const std::size_t num_waypoints = 50;
+    for (std::size_t w = 0; w < num_waypoints; ++w)
+    {
+      const double t = static_cast<double>(w) / (num_waypoints - 1);
+      for (std::size_t j = 0; j < values.size(); ++j)
+        values[j] = from[j] + t * (to[j] - from[j]);
+      waypoint.setJointGroupPositions(jmg, values);
+      path.addSuffixWayPoint(waypoint, 0.0);
+    }
+  }
+  // the copies share the waypoint states of path; retiming only writes their velocities and accelerations
+  trajectory_processing::IterativeParabolicTimeParameterization iptp;
+  runner.run("iterative_parabolic_time_parameterization", [&](std::size_t) {
+    robot_trajectory::RobotTrajectory traj(path);
+    iptp.computeTimeStamps(traj);
+  });
+  trajectory_processing::TimeOptimalTrajectoryGeneration totg;
+  runner.run("time_optimal_trajectory_generation", [&](std::size_t) {
+    robot_trajectory::RobotTrajectory traj(path);
+    totg.computeTimeStamps(traj);
+  });
+
+  // message conversion
+  moveit_msgs::msg::RobotState state_msg;
+  runner.run("robot_state_to_msg",
+             [&](std::size_t i) { robot_state::robotStateToRobotStateMsg(states[i % n], state_msg); });
+  robot_state::robotStateToRobotStateMsg(states[0], state_msg);
+  runner.run("msg_to_robot_state", [&](std::size_t) { robot_state::robotStateMsgToRobotState(state_msg, state); });
+  moveit_msgs::msg::RobotTrajectory trajectory_msg;
+  runner.run("robot_trajectory_to_msg", [&](std::size_t) { path.getRobotTrajectoryMsg(trajectory_msg); });
+
+  if (opt.output.empty())
+    runner.writeJSON(std::cout);
+  else
+  {
+    std::ofstream out(opt.output);
+    if (!out)
+    {
+      std::cerr << "Unable to write '" << opt.output << "'" << std::endl;
+      return 1;
+    }
+    runner.writeJSON(out);
+  }
+  return 0;
+}
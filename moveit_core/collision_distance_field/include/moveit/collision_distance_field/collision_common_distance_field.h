@@ -58,7 +58,9 @@ struct GroupStateRepresentation
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   GroupStateRepresentation(){};
-  GroupStateRepresentation(const GroupStateRepresentation& gsr)
+  /** Deep copy: the posed decompositions and link distance fields are copied, so the copy can be posed independently
+   * (e.g. in another thread). The underlying distance data of the link distance fields is shared. */
+  GroupStateRepresentation(const GroupStateRepresentation& gsr) : dfce_(gsr.dfce_)
   {
     link_body_decompositions_.resize(gsr.link_body_decompositions_.size());
     for (unsigned int i = 0; i < gsr.link_body_decompositions_.size(); i++)
@@ -69,12 +71,23 @@ struct GroupStateRepresentation
       }
     }
 
-    link_distance_fields_.assign(gsr.link_distance_fields_.begin(), gsr.link_distance_fields_.end());
+    link_distance_fields_.resize(gsr.link_distance_fields_.size());
+    for (unsigned int i = 0; i < gsr.link_distance_fields_.size(); i++)
+    {
+      if (gsr.link_distance_fields_[i])
+      {
+        link_distance_fields_[i].reset(new PosedDistanceField(*gsr.link_distance_fields_[i]));
+      }
+    }
 
     attached_body_decompositions_.resize(gsr.attached_body_decompositions_.size());
     for (unsigned int i = 0; i < gsr.attached_body_decompositions_.size(); i++)
     {
-      (*attached_body_decompositions_[i]) = (*gsr.attached_body_decompositions_[i]);
+      if (gsr.attached_body_decompositions_[i])
+      {
+        attached_body_decompositions_[i].reset(
+            new PosedBodySphereDecompositionVector(*gsr.attached_body_decompositions_[i]));
+      }
     }
     gradients_ = gsr.gradients_;
   }
@@ -83,6 +83,105 @@ struct CollisionSphere
   double radius_;
 };
 
+/**
+ * @brief Hierarchy of bounding spheres over a list of collision spheres.
+ *
+ * Leaves bound up to BRANCHING_FACTOR consecutive collision spheres and every
+ * inner node bounds up to BRANCHING_FACTOR consecutive nodes of the level
+ * below, up to a single root. Nodes are stored level by level starting with
+ * the leaves, and their centers and radii are kept in flat arrays so that a
+ * whole level can be tested at once. Visiting children in order reaches the
+ * collision spheres in their original order, so queries pruned through the
+ * tree report the same spheres as a linear scan.
+ */
+class CollisionSphereTree
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static const unsigned int BRANCHING_FACTOR = 4;
+
+  CollisionSphereTree()
+  {
+  }
+
+  /** @brief Builds the hierarchy over the spheres, in the frame of their relative vectors */
+  CollisionSphereTree(const std::vector<CollisionSphere>& spheres);
+
+  /** @brief Recomputes all node spheres around the given sphere centers, keeping the structure */
+  void refit(const std::vector<CollisionSphere>& spheres, const EigenSTL::vector_Vector3d& sphere_centers);
+
+  /** @brief Sets the node centers to the given relative centers moved by a rigid transform */
+  void transform(const Eigen::Matrix3Xd& relative_centers, const Eigen::Isometry3d& pose)
+  {
+    centers_.noalias() = pose.linear() * relative_centers;
+    centers_.colwise() += pose.translation();
+  }
+
+  bool empty() const
+  {
+    return begin_.empty();
+  }
+
+  unsigned int getNodeCount() const
+  {
+    return begin_.size();
+  }
+
+  unsigned int getLeafCount() const
+  {
+    return leaf_count_;
+  }
+
+  bool isLeaf(unsigned int node) const
+  {
+    return node < leaf_count_;
+  }
+
+  /** @brief The root is the last node; only valid for a non-empty tree */
+  unsigned int getRoot() const
+  {
+    return begin_.size() - 1;
+  }
+
+  /** @brief First child of the node, or first collision sphere for a leaf */
+  unsigned int getNodeBegin(unsigned int node) const
+  {
+    return begin_[node];
+  }
+
+  /** @brief One past the last child of the node, or past the last collision sphere for a leaf */
+  unsigned int getNodeEnd(unsigned int node) const
+  {
+    return end_[node];
+  }
+
+  const Eigen::Matrix3Xd& getCenters() const
+  {
+    return centers_;
+  }
+
+  const Eigen::ArrayXd& getRadii() const
+  {
+    return radii_;
+  }
+
+private:
+  unsigned int leaf_count_ = 0;
+  std::vector<unsigned int> begin_;
+  std::vector<unsigned int> end_;
+  Eigen::Matrix3Xd centers_;
+  Eigen::ArrayXd radii_;
+};
+
+/**
+ * @brief Collects, in order, the leaves of @e tree_2 whose bounding spheres
+ * overlap leaf @e leaf_1 of @e tree_1. Both trees must be posed in the same
+ * frame.
+ */
+void getOverlappingLeaves(const CollisionSphereTree& tree_1, unsigned int leaf_1, const CollisionSphereTree& tree_2,
+                          std::vector<unsigned int>& leaves_2);
+
 struct GradientInfo
 {
   GradientInfo() : closest_distance(DBL_MAX), collision(false)
@@ -222,6 +321,27 @@ bool getCollisionSphereCollision(const distance_field::DistanceField* distance_f
                                  const EigenSTL::vector_Vector3d& sphere_centers, double maximum_value,
                                  double tolerance, unsigned int num_coll, std::vector<unsigned int>& colls);
 
+// same as above, but the posed sphere tree is used to skip every group of
+// spheres whose bounding sphere is far enough from the obstacles that none of
+// its spheres can contribute, so most queries end at the coarse levels
+bool getCollisionSphereGradients(const distance_field::DistanceField* distance_field,
+                                 const std::vector<CollisionSphere>& sphere_list,
+                                 const EigenSTL::vector_Vector3d& sphere_centers,
+                                 const CollisionSphereTree& sphere_tree, GradientInfo& gradient,
+                                 const CollisionType& type, double tolerance, bool subtract_radii,
+                                 double maximum_value, bool stop_at_first_collision);
+
+bool getCollisionSphereCollision(const distance_field::DistanceField* distance_field,
+                                 const std::vector<CollisionSphere>& sphere_list,
+                                 const EigenSTL::vector_Vector3d& sphere_centers,
+                                 const CollisionSphereTree& sphere_tree, double maximum_value, double tolerance);
+
+bool getCollisionSphereCollision(const distance_field::DistanceField* distance_field,
+                                 const std::vector<CollisionSphere>& sphere_list,
+                                 const EigenSTL::vector_Vector3d& sphere_centers,
+                                 const CollisionSphereTree& sphere_tree, double maximum_value, double tolerance,
+                                 unsigned int num_coll, std::vector<unsigned int>& colls);
+
 // forward declaration required for friending apparently
 class BodyDecompositionVector;
 
@@ -248,6 +368,7 @@ public:
     // new_collision_spheres.size() << std::endl;
     collision_spheres_ = new_collision_spheres;
     relative_cylinder_pose_ = new_relative_cylinder_pose;
+    sphere_tree_ = CollisionSphereTree(collision_spheres_);
   }
 
   const std::vector<CollisionSphere>& getCollisionSpheres() const
@@ -260,6 +381,11 @@ public:
     return sphere_radii_;
   }
 
+  const CollisionSphereTree& getSphereTree() const
+  {
+    return sphere_tree_;
+  }
+
   const EigenSTL::vector_Vector3d& getCollisionPoints() const
   {
     return relative_collision_points_;
@@ -295,6 +421,7 @@ protected:
   bodies::BoundingSphere relative_bounding_sphere_;
   std::vector<double> sphere_radii_;
   std::vector<CollisionSphere> collision_spheres_;
+  CollisionSphereTree sphere_tree_;
   EigenSTL::vector_Vector3d relative_collision_points_;
 };
 
@@ -324,6 +451,13 @@ public:
   {
     return body_decomposition_->getSphereRadii();
   }
+
+  // bounding sphere hierarchy over the collision spheres, posed with them
+  const CollisionSphereTree& getSphereTree() const
+  {
+    return sphere_tree_;
+  }
+
   const Eigen::Vector3d& getBoundingSphereCenter() const
   {
     return posed_bounding_sphere_center_;
@@ -343,6 +477,7 @@ protected:
   Eigen::Vector3d posed_bounding_sphere_center_;
   EigenSTL::vector_Vector3d posed_collision_points_;
   EigenSTL::vector_Vector3d sphere_centers_;
+  CollisionSphereTree sphere_tree_;
 };
 
 class PosedBodyPointDecomposition
@@ -392,6 +527,13 @@ public:
     return sphere_radii_;
   }
 
+  // spans all decompositions; it is refit after every pose update since the
+  // decompositions move independently
+  const CollisionSphereTree& getSphereTree() const
+  {
+    return sphere_tree_;
+  }
+
   void addToVector(PosedBodySphereDecompositionPtr& bd)
   {
     sphere_index_map_[decomp_vector_.size()] = collision_spheres_.size();
@@ -401,6 +543,8 @@ public:
     posed_collision_spheres_.insert(posed_collision_spheres_.end(), bd->getSphereCenters().begin(),
                                     bd->getSphereCenters().end());
     sphere_radii_.insert(sphere_radii_.end(), bd->getSphereRadii().begin(), bd->getSphereRadii().end());
+    sphere_tree_ = CollisionSphereTree(collision_spheres_);
+    sphere_tree_.refit(collision_spheres_, posed_collision_spheres_);
   }
 
   unsigned int getSize() const
@@ -430,6 +574,7 @@ public:
     {
       posed_collision_spheres_[sphere_index_map_[ind] + i] = decomp_vector_[ind]->getSphereCenters()[i];
     }
+    sphere_tree_.refit(collision_spheres_, posed_collision_spheres_);
   }
 
 private:
@@ -439,6 +584,7 @@ private:
   std::vector<CollisionSphere> collision_spheres_;
   EigenSTL::vector_Vector3d posed_collision_spheres_;
   std::vector<double> sphere_radii_;
+  CollisionSphereTree sphere_tree_;
   std::map<unsigned int, unsigned int> sphere_index_map_;
 };
 
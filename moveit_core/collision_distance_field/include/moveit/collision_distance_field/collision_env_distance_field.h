@@ -209,6 +209,7 @@ public:
 
   collision_detection::GroupStateRepresentationConstPtr getLastGroupStateRepresentation() const
   {
+    boost::mutex::scoped_lock slock(last_gsr_lock_);
     return last_gsr_;
   }
 
@@ -237,6 +238,8 @@ protected:
   void updateGroupStateRepresentationState(const moveit::core::RobotState& state,
                                            GroupStateRepresentationPtr& gsr) const;
 
+  void setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const;
+
   void generateCollisionCheckingStructures(const std::string& group_name, const moveit::core::RobotState& state,
                                            const collision_detection::AllowedCollisionMatrix* acm,
                                            GroupStateRepresentationPtr& gsr, bool generate_distance_field) const;
@@ -307,6 +310,8 @@ protected:
 
   mutable boost::mutex update_cache_lock_world_;
   DistanceFieldCacheEntryWorldPtr distance_field_cache_entry_world_;
+  // the collision checking functions may run concurrently with separate group state representations
+  mutable boost::mutex last_gsr_lock_;
   GroupStateRepresentationPtr last_gsr_;
   World::ObserverHandle observer_handle_;
 };
@@ -38,6 +38,8 @@
 #include <geometric_shapes/body_operations.h>
 #include <moveit/distance_field/distance_field.h>
 #include <moveit/distance_field/find_internal_points.h>
+#include <moveit/utils/geometry_cache.h>
+#include <cstring>
 #include <memory>
 
 const static double EPSILON = 0.0001;
@@ -68,6 +70,183 @@ std::vector<CollisionSphere> determineCollisionSpheres(const bodies::Body* body,
   return css;
 }
 
+CollisionSphereTree::CollisionSphereTree(const std::vector<CollisionSphere>& spheres)
+{
+  // leaves over consecutive spheres first, then one level at a time over
+  // consecutive nodes until a single node is left
+  unsigned int level_begin = 0;
+  unsigned int level_end = spheres.size();
+  bool leaves = true;
+  while (leaves ? level_end > 0 : level_end - level_begin > 1)
+  {
+    const unsigned int next_level_begin = begin_.size();
+    for (unsigned int i = level_begin; i < level_end; i += BRANCHING_FACTOR)
+    {
+      begin_.push_back(i);
+      end_.push_back(std::min(i + BRANCHING_FACTOR, level_end));
+    }
+    if (leaves)
+      leaf_count_ = begin_.size();
+    leaves = false;
+    level_begin = next_level_begin;
+    level_end = begin_.size();
+  }
+
+  EigenSTL::vector_Vector3d relative_centers;
+  relative_centers.reserve(spheres.size());
+  for (const CollisionSphere& sphere : spheres)
+    relative_centers.push_back(sphere.relative_vec_);
+  refit(spheres, relative_centers);
+}
+
+void CollisionSphereTree::refit(const std::vector<CollisionSphere>& spheres,
+                                const EigenSTL::vector_Vector3d& sphere_centers)
+{
+  centers_.resize(3, begin_.size());
+  radii_.resize(begin_.size());
+
+  // children are stored before their parents, so one pass bounds every level
+  for (unsigned int node = 0; node < begin_.size(); ++node)
+  {
+    const bool leaf = isLeaf(node);
+    auto child_center = [&](unsigned int i) -> Eigen::Vector3d {
+      return leaf ? sphere_centers[i] : Eigen::Vector3d(centers_.col(i));
+    };
+    auto child_radius = [&](unsigned int i) { return leaf ? spheres[i].radius_ : radii_[i]; };
+
+    Eigen::AlignedBox3d box;
+    for (unsigned int i = begin_[node]; i < end_[node]; ++i)
+    {
+      const Eigen::Vector3d extent = Eigen::Vector3d::Constant(child_radius(i));
+      box.extend(child_center(i) - extent);
+      box.extend(child_center(i) + extent);
+    }
+
+    const Eigen::Vector3d center = box.center();
+    double radius = 0.0;
+    for (unsigned int i = begin_[node]; i < end_[node]; ++i)
+      radius = std::max(radius, (child_center(i) - center).norm() + child_radius(i));
+    centers_.col(node) = center;
+    radii_[node] = radius;
+  }
+}
+
+void getOverlappingLeaves(const CollisionSphereTree& tree_1, unsigned int leaf_1, const CollisionSphereTree& tree_2,
+                          std::vector<unsigned int>& leaves_2)
+{
+  leaves_2.clear();
+  const unsigned int leaf_count = tree_2.getLeafCount();
+  if (leaf_count == 0)
+    return;
+
+  // the leaves are the first nodes, so they are tested in one pass over contiguous arrays
+  const Eigen::Vector3d center = tree_1.getCenters().col(leaf_1);
+  const double radius = tree_1.getRadii()[leaf_1];
+  const Eigen::Array<bool, Eigen::Dynamic, 1> overlap =
+      (tree_2.getCenters().leftCols(leaf_count).colwise() - center).colwise().squaredNorm().transpose().array() <
+      (tree_2.getRadii().head(leaf_count) + radius).square();
+  for (unsigned int i = 0; i < leaf_count; ++i)
+  {
+    if (overlap[i])
+      leaves_2.push_back(i);
+  }
+}
+
+namespace
+{
+const std::string DECOMPOSITION_CACHE_KIND = "body_decomposition";
+
+// Node distances are read in the cell holding the node center while its spheres
+// read their own cells, so bounds derived from the node distance are loosened
+// by the distance between two cell centers beyond that of the points (sqrt(3)
+// cells), rounded up to absorb the error of the propagated distances
+const double NODE_DISTANCE_PADDING_CELLS = 2.0;
+
+// Visits the spheres below a node in their original order. The distance at
+// the center of each node is handed to skip_node with the node radius, and the
+// node is skipped when that proves none of its spheres matters; a node outside
+// the field is always descended. Returns true as soon as visit_sphere does.
+template <typename SkipNode, typename VisitSphere>
+bool walkSphereTree(const distance_field::DistanceField* distance_field, const CollisionSphereTree& tree,
+                    unsigned int node, const SkipNode& skip_node, const VisitSphere& visit_sphere)
+{
+  const Eigen::Vector3d center = tree.getCenters().col(node);
+  int x, y, z;
+  if (distance_field->worldToGrid(center.x(), center.y(), center.z(), x, y, z) &&
+      skip_node(distance_field->getDistance(x, y, z), tree.getRadii()[node]))
+    return false;
+
+  for (unsigned int i = tree.getNodeBegin(node); i < tree.getNodeEnd(node); ++i)
+  {
+    if (tree.isLeaf(node) ? visit_sphere(i) : walkSphereTree(distance_field, tree, i, skip_node, visit_sphere))
+      return true;
+  }
+  return false;
+}
+
+// Layout: relative cylinder pose (16 doubles), sphere count, spheres (center, radius), point count, points
+std::string serializeBodyDecomposition(const Eigen::Isometry3d& relative_cylinder_pose,
+                                       const std::vector<CollisionSphere>& spheres,
+                                       const EigenSTL::vector_Vector3d& points)
+{
+  std::string out;
+  out.append(reinterpret_cast<const char*>(relative_cylinder_pose.matrix().data()), 16 * sizeof(double));
+  std::uint64_t count = spheres.size();
+  out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (const CollisionSphere& sphere : spheres)
+  {
+    out.append(reinterpret_cast<const char*>(sphere.relative_vec_.data()), 3 * sizeof(double));
+    out.append(reinterpret_cast<const char*>(&sphere.radius_), sizeof(double));
+  }
+  count = points.size();
+  out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (const Eigen::Vector3d& point : points)
+    out.append(reinterpret_cast<const char*>(point.data()), 3 * sizeof(double));
+  return out;
+}
+
+bool deserializeBodyDecomposition(const char* data, std::size_t size, Eigen::Isometry3d& relative_cylinder_pose,
+                                  std::vector<CollisionSphere>& spheres, EigenSTL::vector_Vector3d& points)
+{
+  const char* end = data + size;
+  std::uint64_t count;
+  if (size < 16 * sizeof(double) + sizeof(count))
+    return false;
+  std::memcpy(relative_cylinder_pose.matrix().data(), data, 16 * sizeof(double));
+  data += 16 * sizeof(double);
+
+  std::memcpy(&count, data, sizeof(count));
+  data += sizeof(count);
+  // the spheres have to be followed by the point count; compare by division, count comes from the file and the
+  // product could overflow
+  std::size_t remaining = end - data;
+  if (remaining < sizeof(count) || count > (remaining - sizeof(count)) / (4 * sizeof(double)))
+    return false;
+  spheres.clear();
+  spheres.reserve(count);
+  for (std::uint64_t i = 0; i < count; ++i)
+  {
+    double values[4];
+    std::memcpy(values, data, sizeof(values));
+    data += sizeof(values);
+    spheres.emplace_back(Eigen::Vector3d(values[0], values[1], values[2]), values[3]);
+  }
+
+  std::memcpy(&count, data, sizeof(count));
+  data += sizeof(count);
+  remaining = end - data;
+  if (remaining % (3 * sizeof(double)) != 0 || count != remaining / (3 * sizeof(double)))
+    return false;
+  points.resize(count);
+  for (std::uint64_t i = 0; i < count; ++i)
+  {
+    std::memcpy(points[i].data(), data, 3 * sizeof(double));
+    data += 3 * sizeof(double);
+  }
+  return true;
+}
+}  // namespace
+
 bool PosedDistanceField::getCollisionSphereGradients(const std::vector<CollisionSphere>& sphere_list,
                                                      const EigenSTL::vector_Vector3d& sphere_centers,
                                                      GradientInfo& gradient, const CollisionType& type,
@@ -254,6 +433,130 @@ bool getCollisionSphereCollision(const distance_field::DistanceField* distance_f
   return !colls.empty();
 }
 
+bool getCollisionSphereGradients(const distance_field::DistanceField* distance_field,
+                                 const std::vector<CollisionSphere>& sphere_list,
+                                 const EigenSTL::vector_Vector3d& sphere_centers,
+                                 const CollisionSphereTree& sphere_tree, GradientInfo& gradient,
+                                 const CollisionType& type, double tolerance, bool subtract_radii,
+                                 double maximum_value, bool stop_at_first_collision)
+{
+  // assumes gradient is properly initialized
+
+  if (sphere_tree.empty())
+    return false;
+
+  // spheres no closer than maximum_value are neither recorded nor in collision
+  const double padding = NODE_DISTANCE_PADDING_CELLS * distance_field->getResolution();
+  auto skip_node = [&](double dist, double radius) { return dist - radius - padding >= maximum_value; };
+
+  bool in_collision = false;
+  auto visit_sphere = [&](unsigned int i) {
+    const Eigen::Vector3d& p = sphere_centers[i];
+    Eigen::Vector3d grad;
+    bool in_bounds;
+    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
+    if (!in_bounds && grad.norm() > EPSILON)
+    {
+      RCLCPP_DEBUG(LOGGER, "Collision sphere point is out of bounds %lf, %lf, %lf", p.x(), p.y(), p.z());
+      return true;
+    }
+
+    if (dist < maximum_value)
+    {
+      if (subtract_radii)
+      {
+        dist -= sphere_list[i].radius_;
+
+        if ((dist < 0) && (-dist >= tolerance))
+        {
+          in_collision = true;
+        }
+      }
+      else
+      {
+        if (sphere_list[i].radius_ - dist > tolerance)
+        {
+          in_collision = true;
+        }
+      }
+
+      if (dist < gradient.closest_distance)
+      {
+        gradient.closest_distance = dist;
+      }
+
+      if (dist < gradient.distances[i])
+      {
+        gradient.types[i] = type;
+        gradient.distances[i] = dist;
+        gradient.gradients[i] = grad;
+      }
+    }
+
+    return stop_at_first_collision && in_collision;
+  };
+
+  if (walkSphereTree(distance_field, sphere_tree, sphere_tree.getRoot(), skip_node, visit_sphere))
+    return true;
+  return in_collision;
+}
+
+bool getCollisionSphereCollision(const distance_field::DistanceField* distance_field,
+                                 const std::vector<CollisionSphere>& sphere_list,
+                                 const EigenSTL::vector_Vector3d& sphere_centers,
+                                 const CollisionSphereTree& sphere_tree, double maximum_value, double tolerance)
+{
+  std::vector<unsigned int> colls;
+  return getCollisionSphereCollision(distance_field, sphere_list, sphere_centers, sphere_tree, maximum_value,
+                                     tolerance, 0, colls);
+}
+
+bool getCollisionSphereCollision(const distance_field::DistanceField* distance_field,
+                                 const std::vector<CollisionSphere>& sphere_list,
+                                 const EigenSTL::vector_Vector3d& sphere_centers,
+                                 const CollisionSphereTree& sphere_tree, double maximum_value, double tolerance,
+                                 unsigned int num_coll, std::vector<unsigned int>& colls)
+{
+  colls.clear();
+  if (sphere_tree.empty())
+    return false;
+
+  // a sphere collides when its radius exceeds its distance by more than the
+  // tolerance, which the node radius bounds for all spheres below it
+  const double padding = NODE_DISTANCE_PADDING_CELLS * distance_field->getResolution();
+  auto skip_node = [&](double dist, double radius) { return radius + padding - dist <= tolerance; };
+
+  auto visit_sphere = [&](unsigned int i) {
+    const Eigen::Vector3d& p = sphere_centers[i];
+    Eigen::Vector3d grad;
+    bool in_bounds = true;
+    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
+    if (!in_bounds && (grad.norm() > 0))
+    {
+      RCLCPP_DEBUG(LOGGER, "Collision sphere point is out of bounds");
+      return true;
+    }
+    if (maximum_value > dist && (sphere_list[i].radius_ - dist > tolerance))
+    {
+      if (num_coll == 0)
+      {
+        return true;
+      }
+
+      colls.push_back(i);
+      if (colls.size() >= num_coll)
+      {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  if (walkSphereTree(distance_field, sphere_tree, sphere_tree.getRoot(), skip_node, visit_sphere))
+    return true;
+  return !colls.empty();
+}
+
 ///
 /// BodyDecomposition
 ///
@@ -292,10 +595,33 @@ void BodyDecomposition::init(const std::vector<shapes::ShapeConstPtr>& shapes, c
     body_spheres.clear();
     body_collision_points.clear();
 
-    body_spheres = determineCollisionSpheres(bodies_.getBody(i), relative_cylinder_pose_);
-    collision_spheres_.insert(collision_spheres_.end(), body_spheres.begin(), body_spheres.end());
+    // the decomposition only depends on the shape, its pose and the sampling parameters, so it can be reused
+    // across processes through the geometry cache
+    const moveit::core::GeometryCache& cache = moveit::core::GeometryCache::getGlobal();
+    moveit::core::GeometryHasher hasher;
+    const bool cacheable = cache.isEnabled() && hasher.add(*shapes[i]);
+    bool loaded = false;
+    if (cacheable)
+    {
+      hasher.add(poses[i].matrix().data(), 16 * sizeof(double));
+      hasher.add(resolution);
+      hasher.add(padding);
+      moveit::core::GeometryCache::EntryConstPtr entry = cache.load(DECOMPOSITION_CACHE_KIND, hasher.get());
+      loaded = entry && deserializeBodyDecomposition(entry->data(), entry->size(), relative_cylinder_pose_,
+                                                     body_spheres, body_collision_points);
+    }
+
+    if (!loaded)
+    {
+      body_collision_points.clear();
+      body_spheres = determineCollisionSpheres(bodies_.getBody(i), relative_cylinder_pose_);
+      distance_field::findInternalPointsConvex(*bodies_.getBody(i), resolution, body_collision_points);
+      if (cacheable)
+        cache.store(DECOMPOSITION_CACHE_KIND, hasher.get(),
+                    serializeBodyDecomposition(relative_cylinder_pose_, body_spheres, body_collision_points));
+    }
 
-    distance_field::findInternalPointsConvex(*bodies_.getBody(i), resolution, body_collision_points);
+    collision_spheres_.insert(collision_spheres_.end(), body_spheres.begin(), body_spheres.end());
     relative_collision_points_.insert(relative_collision_points_.end(), body_collision_points.begin(),
                                       body_collision_points.end());
   }
@@ -305,6 +631,7 @@ void BodyDecomposition::init(const std::vector<shapes::ShapeConstPtr>& shapes, c
   {
     sphere_radii_[i] = collision_spheres_[i].radius_;
   }
+  sphere_tree_ = CollisionSphereTree(collision_spheres_);
 
   // computing bounding sphere
   std::vector<bodies::BoundingSphere> bounding_spheres(bodies_.getCount());
@@ -362,7 +689,7 @@ void PosedBodyPointDecomposition::updatePose(const Eigen::Isometry3d& trans)
 }
 
 PosedBodySphereDecomposition::PosedBodySphereDecomposition(const BodyDecompositionConstPtr& body_decomposition)
-  : body_decomposition_(body_decomposition)
+  : body_decomposition_(body_decomposition), sphere_tree_(body_decomposition->getSphereTree())
 {
   posed_bounding_sphere_center_ = body_decomposition_->getRelativeBoundingSphere().center;
   sphere_centers_.resize(body_decomposition_->getCollisionSpheres().size());
@@ -377,6 +704,7 @@ void PosedBodySphereDecomposition::updatePose(const Eigen::Isometry3d& trans)
   {
     sphere_centers_[i] = trans * body_decomposition_->getCollisionSpheres()[i].relative_vec_;
   }
+  sphere_tree_.transform(body_decomposition_->getSphereTree().getCenters(), trans);
 
   // updating collision points
   if (!body_decomposition_->getCollisionPoints().empty())
@@ -392,13 +720,20 @@ void PosedBodySphereDecomposition::updatePose(const Eigen::Isometry3d& trans)
 bool doBoundingSpheresIntersect(const PosedBodySphereDecompositionConstPtr& p1,
                                 const PosedBodySphereDecompositionConstPtr& p2)
 {
-  Eigen::Vector3d p1_sphere_center = p1->getBoundingSphereCenter();
-  Eigen::Vector3d p2_sphere_center = p2->getBoundingSphereCenter();
-  double p1_radius = p1->getBoundingSphereRadius();
-  double p2_radius = p2->getBoundingSphereRadius();
+  // the roots of the sphere trees bound the collision spheres that are
+  // actually tested, which the bounding spheres of the bodies may not
+  const CollisionSphereTree& tree_1 = p1->getSphereTree();
+  const CollisionSphereTree& tree_2 = p2->getSphereTree();
+  if (tree_1.empty() || tree_2.empty())
+    return false;
+
+  Eigen::Vector3d p1_sphere_center = tree_1.getCenters().col(tree_1.getRoot());
+  Eigen::Vector3d p2_sphere_center = tree_2.getCenters().col(tree_2.getRoot());
+  double p1_radius = tree_1.getRadii()[tree_1.getRoot()];
+  double p2_radius = tree_2.getRadii()[tree_2.getRoot()];
 
   double dist = (p1_sphere_center - p2_sphere_center).squaredNorm();
-  return dist < (p1_radius + p2_radius);
+  return dist < (p1_radius + p2_radius) * (p1_radius + p2_radius);
 }
 
 void getCollisionSphereMarkers(const std_msgs::msg::ColorRGBA& color, const std::string& frame_id,
@@ -274,25 +274,29 @@ bool CollisionEnvDistanceField::getSelfCollisions(const collision_detection::Col
       continue;
     const std::vector<CollisionSphere>* collision_spheres_1;
     const EigenSTL::vector_Vector3d* sphere_centers_1;
+    const CollisionSphereTree* sphere_tree_1;
 
     if (is_link)
     {
       collision_spheres_1 = &(gsr->link_body_decompositions_[i]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->link_body_decompositions_[i]->getSphereCenters());
+      sphere_tree_1 = &(gsr->link_body_decompositions_[i]->getSphereTree());
     }
     else
     {
       collision_spheres_1 =
           &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereCenters());
+      sphere_tree_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereTree());
     }
 
     if (req.contacts)
     {
       std::vector<unsigned int> colls;
       bool coll = getCollisionSphereCollision(
-          gsr->dfce_->distance_field_.get(), *collision_spheres_1, *sphere_centers_1, max_propogation_distance_,
-          collision_tolerance_, std::min(req.max_contacts_per_pair, req.max_contacts - res.contact_count), colls);
+          gsr->dfce_->distance_field_.get(), *collision_spheres_1, *sphere_centers_1, *sphere_tree_1,
+          max_propogation_distance_, collision_tolerance_,
+          std::min(req.max_contacts_per_pair, req.max_contacts - res.contact_count), colls);
       if (coll)
       {
         res.collision = true;
@@ -330,8 +334,9 @@ bool CollisionEnvDistanceField::getSelfCollisions(const collision_detection::Col
     }
     else
     {
-      bool coll = getCollisionSphereCollision(gsr->dfce_->distance_field_.get(), *collision_spheres_1,
-                                              *sphere_centers_1, max_propogation_distance_, collision_tolerance_);
+      bool coll =
+          getCollisionSphereCollision(gsr->dfce_->distance_field_.get(), *collision_spheres_1, *sphere_centers_1,
+                                      *sphere_tree_1, max_propogation_distance_, collision_tolerance_);
       if (coll)
       {
         RCLCPP_DEBUG(LOGGER, "Link %s in self collision", gsr->dfce_->link_names_[i].c_str());
@@ -358,16 +363,19 @@ bool CollisionEnvDistanceField::getSelfProximityGradients(GroupStateRepresentati
 
     const std::vector<CollisionSphere>* collision_spheres_1;
     const EigenSTL::vector_Vector3d* sphere_centers_1;
+    const CollisionSphereTree* sphere_tree_1;
     if (is_link)
     {
       collision_spheres_1 = &(gsr->link_body_decompositions_[i]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->link_body_decompositions_[i]->getSphereCenters());
+      sphere_tree_1 = &(gsr->link_body_decompositions_[i]->getSphereTree());
     }
     else
     {
       collision_spheres_1 =
           &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereCenters());
+      sphere_tree_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereTree());
     }
 
     // computing distance gradients by checking collisions against other mobile
@@ -406,8 +414,8 @@ bool CollisionEnvDistanceField::getSelfProximityGradients(GroupStateRepresentati
     }
 
     coll = getCollisionSphereGradients(gsr->dfce_->distance_field_.get(), *collision_spheres_1, *sphere_centers_1,
-                                       gsr->gradients_[i], collision_detection::SELF, collision_tolerance_, false,
-                                       max_propogation_distance_, false);
+                                       *sphere_tree_1, gsr->gradients_[i], collision_detection::SELF,
+                                       collision_tolerance_, false, max_propogation_distance_, false);
 
     if (coll)
     {
@@ -424,6 +432,7 @@ bool CollisionEnvDistanceField::getIntraGroupCollisions(const collision_detectio
 {
   unsigned int num_links = gsr->dfce_->link_names_.size();
   unsigned int num_attached_bodies = gsr->dfce_->attached_body_names_.size();
+  std::vector<unsigned int> overlapping_leaves;
 
   for (unsigned int i = 0; i < num_links + num_attached_bodies; i++)
   {
@@ -538,90 +547,108 @@ bool CollisionEnvDistanceField::getIntraGroupCollisions(const collision_detectio
       const std::vector<CollisionSphere>* collision_spheres_2;
       const EigenSTL::vector_Vector3d* sphere_centers_1;
       const EigenSTL::vector_Vector3d* sphere_centers_2;
+      const CollisionSphereTree* sphere_tree_1;
+      const CollisionSphereTree* sphere_tree_2;
       if (i_is_link)
       {
         collision_spheres_1 = &(gsr->link_body_decompositions_[i]->getCollisionSpheres());
         sphere_centers_1 = &(gsr->link_body_decompositions_[i]->getSphereCenters());
+        sphere_tree_1 = &(gsr->link_body_decompositions_[i]->getSphereTree());
       }
       else
       {
         collision_spheres_1 = &(gsr->attached_body_decompositions_[i - num_links]->getCollisionSpheres());
         sphere_centers_1 = &(gsr->attached_body_decompositions_[i - num_links]->getSphereCenters());
+        sphere_tree_1 = &(gsr->attached_body_decompositions_[i - num_links]->getSphereTree());
       }
       if (j_is_link)
       {
         collision_spheres_2 = &(gsr->link_body_decompositions_[j]->getCollisionSpheres());
         sphere_centers_2 = &(gsr->link_body_decompositions_[j]->getSphereCenters());
+        sphere_tree_2 = &(gsr->link_body_decompositions_[j]->getSphereTree());
       }
       else
       {
         collision_spheres_2 = &(gsr->attached_body_decompositions_[j - num_links]->getCollisionSpheres());
         sphere_centers_2 = &(gsr->attached_body_decompositions_[j - num_links]->getSphereCenters());
+        sphere_tree_2 = &(gsr->attached_body_decompositions_[j - num_links]->getSphereTree());
       }
 
-      for (unsigned int k = 0; k < collision_spheres_1->size() && num_pair < (int)req.max_contacts_per_pair; k++)
+      // sphere pairs are only tested between overlapping leaves of the two
+      // sphere trees; pairs are still visited in the order of the spheres
+      for (unsigned int leaf_1 = 0;
+           leaf_1 < sphere_tree_1->getLeafCount() && num_pair < (int)req.max_contacts_per_pair; leaf_1++)
       {
-        for (unsigned int l = 0; l < collision_spheres_2->size() && num_pair < (int)req.max_contacts_per_pair; l++)
+        getOverlappingLeaves(*sphere_tree_1, leaf_1, *sphere_tree_2, overlapping_leaves);
+        for (unsigned int k = sphere_tree_1->getNodeBegin(leaf_1);
+             k < sphere_tree_1->getNodeEnd(leaf_1) && num_pair < (int)req.max_contacts_per_pair; k++)
         {
-          Eigen::Vector3d gradient = (*sphere_centers_1)[k] - (*sphere_centers_2)[l];
-          double dist = gradient.norm();
-          // std::cerr << "Dist is " << dist << " rad " <<
-          // (*collision_spheres_1)[k].radius_+(*collision_spheres_2)[l].radius_
-          // << std::endl;
-
-          if (dist < (*collision_spheres_1)[k].radius_ + (*collision_spheres_2)[l].radius_)
+          for (unsigned int leaf_2 : overlapping_leaves)
           {
-            //            RCLCPP_DEBUG(LOGGER,"Intra-group contact between %s and %s, d =
-            //            %f <  r1 = %f + r2 = %f", name_1.c_str(),
-            //            name_2.c_str(),
-            //                      dist ,(*collision_spheres_1)[k].radius_
-            //                      ,(*collision_spheres_2)[l].radius_);
-            //            Eigen::Vector3d sc1 = (*sphere_centers_1)[k];
-            //            Eigen::Vector3d sc2 = (*sphere_centers_2)[l];
-            //            RCLCPP_DEBUG(LOGGER,"sphere center 1:[ %f, %f, %f ], sphere
-            //            center 2: [%f, %f,%f ], lbdc size =
-            //            %i",sc1[0],sc1[1],sc1[2],
-            //                      sc2[0],sc2[1],sc2[2],int(gsr->link_body_decompositions_.size()));
-            res.collision = true;
-
-            if (req.contacts)
+            for (unsigned int l = sphere_tree_2->getNodeBegin(leaf_2);
+                 l < sphere_tree_2->getNodeEnd(leaf_2) && num_pair < (int)req.max_contacts_per_pair; l++)
             {
-              collision_detection::Contact con;
-              con.pos = gsr->link_body_decompositions_[i]->getSphereCenters()[k];
-              con.body_name_1 = name_1;
-              con.body_name_2 = name_2;
-              if (i_is_link)
-              {
-                con.body_type_1 = collision_detection::BodyTypes::ROBOT_LINK;
-              }
-              else
-              {
-                con.body_type_1 = collision_detection::BodyTypes::ROBOT_ATTACHED;
-              }
-              if (j_is_link)
-              {
-                con.body_type_2 = collision_detection::BodyTypes::ROBOT_LINK;
-              }
-              else
-              {
-                con.body_type_2 = collision_detection::BodyTypes::ROBOT_ATTACHED;
-              }
-              res.contact_count++;
-              res.contacts[std::pair<std::string, std::string>(con.body_name_1, con.body_name_2)].push_back(con);
-              num_pair++;
-              gsr->gradients_[i].types[k] = INTRA;
-              gsr->gradients_[i].collision = true;
-              gsr->gradients_[j].types[l] = INTRA;
-              gsr->gradients_[j].collision = true;
-              if (res.contact_count >= req.max_contacts)
+              Eigen::Vector3d gradient = (*sphere_centers_1)[k] - (*sphere_centers_2)[l];
+              double dist = gradient.norm();
+              // std::cerr << "Dist is " << dist << " rad " <<
+              // (*collision_spheres_1)[k].radius_+(*collision_spheres_2)[l].radius_
+              // << std::endl;
+
+              if (dist < (*collision_spheres_1)[k].radius_ + (*collision_spheres_2)[l].radius_)
               {
-                return true;
+                //            RCLCPP_DEBUG(LOGGER,"Intra-group contact between %s and %s, d =
+                //            %f <  r1 = %f + r2 = %f", name_1.c_str(),
+                //            name_2.c_str(),
+                //                      dist ,(*collision_spheres_1)[k].radius_
+                //                      ,(*collision_spheres_2)[l].radius_);
+                //            Eigen::Vector3d sc1 = (*sphere_centers_1)[k];
+                //            Eigen::Vector3d sc2 = (*sphere_centers_2)[l];
+                //            RCLCPP_DEBUG(LOGGER,"sphere center 1:[ %f, %f, %f ], sphere
+                //            center 2: [%f, %f,%f ], lbdc size =
+                //            %i",sc1[0],sc1[1],sc1[2],
+                //                      sc2[0],sc2[1],sc2[2],int(gsr->link_body_decompositions_.size()));
+                res.collision = true;
+
+                if (req.contacts)
+                {
+                  collision_detection::Contact con;
+                  con.pos = gsr->link_body_decompositions_[i]->getSphereCenters()[k];
+                  con.body_name_1 = name_1;
+                  con.body_name_2 = name_2;
+                  if (i_is_link)
+                  {
+                    con.body_type_1 = collision_detection::BodyTypes::ROBOT_LINK;
+                  }
+                  else
+                  {
+                    con.body_type_1 = collision_detection::BodyTypes::ROBOT_ATTACHED;
+                  }
+                  if (j_is_link)
+                  {
+                    con.body_type_2 = collision_detection::BodyTypes::ROBOT_LINK;
+                  }
+                  else
+                  {
+                    con.body_type_2 = collision_detection::BodyTypes::ROBOT_ATTACHED;
+                  }
+                  res.contact_count++;
+                  res.contacts[std::pair<std::string, std::string>(con.body_name_1, con.body_name_2)].push_back(con);
+                  num_pair++;
+                  gsr->gradients_[i].types[k] = INTRA;
+                  gsr->gradients_[i].collision = true;
+                  gsr->gradients_[j].types[l] = INTRA;
+                  gsr->gradients_[j].collision = true;
+                  if (res.contact_count >= req.max_contacts)
+                  {
+                    return true;
+                  }
+                }
+                else
+                {
+                  return true;
+                }
               }
             }
-            else
-            {
-              return true;
-            }
           }
         }
       }
@@ -1088,6 +1115,12 @@ CollisionEnvDistanceField::getPosedLinkBodyPointDecomposition(const moveit::core
   return ret;
 }
 
+void CollisionEnvDistanceField::setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const
+{
+  boost::mutex::scoped_lock slock(last_gsr_lock_);
+  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+}
+
 void CollisionEnvDistanceField::updateGroupStateRepresentationState(const moveit::core::RobotState& state,
                                                                     GroupStateRepresentationPtr& gsr) const
 {
@@ -1396,7 +1429,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1429,7 +1462,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1453,7 +1486,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1482,7 +1515,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1522,7 +1555,7 @@ void CollisionEnvDistanceField::getCollisionGradients(const CollisionRequest& re
   getIntraGroupProximityGradients(gsr);
   getEnvironmentProximityGradients(env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1543,7 +1576,7 @@ void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, Co
   distance_field::DistanceFieldConstPtr env_distance_field = distance_field_cache_entry_world_->distance_field_;
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 bool CollisionEnvDistanceField::getEnvironmentCollisions(
@@ -1561,24 +1594,27 @@ bool CollisionEnvDistanceField::getEnvironmentCollisions(
 
     const std::vector<CollisionSphere>* collision_spheres_1;
     const EigenSTL::vector_Vector3d* sphere_centers_1;
+    const CollisionSphereTree* sphere_tree_1;
 
     if (is_link)
     {
       collision_spheres_1 = &(gsr->link_body_decompositions_[i]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->link_body_decompositions_[i]->getSphereCenters());
+      sphere_tree_1 = &(gsr->link_body_decompositions_[i]->getSphereTree());
     }
     else
     {
       collision_spheres_1 =
           &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereCenters());
+      sphere_tree_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereTree());
     }
 
     if (req.contacts)
     {
       std::vector<unsigned int> colls;
       bool coll = getCollisionSphereCollision(
-          env_distance_field.get(), *collision_spheres_1, *sphere_centers_1, max_propogation_distance_,
+          env_distance_field.get(), *collision_spheres_1, *sphere_centers_1, *sphere_tree_1, max_propogation_distance_,
           collision_tolerance_, std::min(req.max_contacts_per_pair, req.max_contacts - res.contact_count), colls);
       if (coll)
       {
@@ -1618,7 +1654,7 @@ bool CollisionEnvDistanceField::getEnvironmentCollisions(
     else
     {
       bool coll = getCollisionSphereCollision(env_distance_field.get(), *collision_spheres_1, *sphere_centers_1,
-                                              max_propogation_distance_, collision_tolerance_);
+                                              *sphere_tree_1, max_propogation_distance_, collision_tolerance_);
       if (coll)
       {
         res.collision = true;
@@ -1644,21 +1680,24 @@ bool CollisionEnvDistanceField::getEnvironmentProximityGradients(
 
     const std::vector<CollisionSphere>* collision_spheres_1;
     const EigenSTL::vector_Vector3d* sphere_centers_1;
+    const CollisionSphereTree* sphere_tree_1;
     if (is_link)
     {
       collision_spheres_1 = &(gsr->link_body_decompositions_[i]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->link_body_decompositions_[i]->getSphereCenters());
+      sphere_tree_1 = &(gsr->link_body_decompositions_[i]->getSphereTree());
     }
     else
     {
       collision_spheres_1 =
           &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getCollisionSpheres());
       sphere_centers_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereCenters());
+      sphere_tree_1 = &(gsr->attached_body_decompositions_[i - gsr->dfce_->link_names_.size()]->getSphereTree());
     }
 
     bool coll = getCollisionSphereGradients(env_distance_field.get(), *collision_spheres_1, *sphere_centers_1,
-                                            gsr->gradients_[i], ENVIRONMENT, collision_tolerance_, false,
-                                            max_propogation_distance_, false);
+                                            *sphere_tree_1, gsr->gradients_[i], ENVIRONMENT, collision_tolerance_,
+                                            false, max_propogation_distance_, false);
     if (coll)
     {
       in_collision = true;
@@ -0,0 +1,152 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_distance_field/collision_distance_field_types.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/utils/geometry_cache.h>
+#include <geometric_shapes/shapes.h>
+#include <urdf_parser/urdf_parser.h>
+#include <ament_index_cpp/get_package_share_directory.hpp>
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Geometry loaded through the global geometry cache has to be the same whether it was computed or loaded from the
+// cache. main() points the global cache to an empty directory, so the first load of each item computes it.
+
+namespace
+{
+boost::filesystem::path cache_directory;
+
+std::size_t countCacheEntries(const std::string& kind)
+{
+  std::size_t count = 0;
+  for (boost::filesystem::directory_iterator it(cache_directory), end; it != end; ++it)
+    if (it->path().filename().string().compare(0, kind.size() + 1, kind + "_") == 0)
+      ++count;
+  return count;
+}
+
+moveit::core::RobotModelPtr loadPR2()
+{
+  const std::string description = ament_index_cpp::get_package_share_directory("moveit_resources") + "/pr2_description";
+  std::ifstream urdf_file(description + "/urdf/robot.xml");
+  std::stringstream urdf;
+  urdf << urdf_file.rdbuf();
+  urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(urdf.str());
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  if (!urdf_model || !srdf_model->initFile(*urdf_model, description + "/srdf/robot.xml"))
+    return moveit::core::RobotModelPtr();
+  return std::make_shared<moveit::core::RobotModel>(urdf_model, srdf_model);
+}
+}  // namespace
+
+TEST(CachedGeometry, BodyDecomposition)
+{
+  ASSERT_TRUE(moveit::core::GeometryCache::getGlobal().isEnabled());
+  std::vector<shapes::ShapeConstPtr> shapes = { std::make_shared<shapes::Cylinder>(0.1, 0.4),
+                                                std::make_shared<shapes::Box>(0.2, 0.1, 0.3) };
+  EigenSTL::vector_Isometry3d poses(2, Eigen::Isometry3d::Identity());
+  poses[0].translation() = Eigen::Vector3d(0.1, 0.0, 0.2);
+  poses[1].linear() = Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+
+  const std::size_t entries = countCacheEntries("body_decomposition");
+  collision_detection::BodyDecomposition computed(shapes, poses, 0.02, 0.01);
+  ASSERT_EQ(countCacheEntries("body_decomposition"), entries + shapes.size());
+  collision_detection::BodyDecomposition cached(shapes, poses, 0.02, 0.01);
+  EXPECT_EQ(countCacheEntries("body_decomposition"), entries + shapes.size());
+
+  ASSERT_EQ(cached.getCollisionSpheres().size(), computed.getCollisionSpheres().size());
+  for (std::size_t i = 0; i < computed.getCollisionSpheres().size(); ++i)
+  {
+    EXPECT_EQ(cached.getCollisionSpheres()[i].relative_vec_, computed.getCollisionSpheres()[i].relative_vec_);
+    EXPECT_EQ(cached.getCollisionSpheres()[i].radius_, computed.getCollisionSpheres()[i].radius_);
+  }
+  ASSERT_EQ(cached.getCollisionPoints().size(), computed.getCollisionPoints().size());
+  for (std::size_t i = 0; i < computed.getCollisionPoints().size(); ++i)
+    EXPECT_EQ(cached.getCollisionPoints()[i], computed.getCollisionPoints()[i]);
+  EXPECT_TRUE(cached.getRelativeCylinderPose().matrix() == computed.getRelativeCylinderPose().matrix());
+}
+
+TEST(CachedGeometry, Meshes)
+{
+  const std::size_t entries = countCacheEntries("mesh");
+  moveit::core::RobotModelPtr computed = loadPR2();
+  ASSERT_TRUE(computed);
+  ASSERT_GT(countCacheEntries("mesh"), entries);
+  moveit::core::RobotModelPtr cached = loadPR2();
+  ASSERT_TRUE(cached);
+
+  std::size_t meshes = 0;
+  for (const moveit::core::LinkModel* link : computed->getLinkModels())
+  {
+    const std::vector<shapes::ShapeConstPtr>& computed_shapes = link->getShapes();
+    const std::vector<shapes::ShapeConstPtr>& cached_shapes = cached->getLinkModel(link->getName())->getShapes();
+    ASSERT_EQ(cached_shapes.size(), computed_shapes.size()) << link->getName();
+    for (std::size_t i = 0; i < computed_shapes.size(); ++i)
+    {
+      if (computed_shapes[i]->type != shapes::MESH)
+        continue;
+      ASSERT_EQ(cached_shapes[i]->type, shapes::MESH) << link->getName();
+      const shapes::Mesh& computed_mesh = static_cast<const shapes::Mesh&>(*computed_shapes[i]);
+      const shapes::Mesh& cached_mesh = static_cast<const shapes::Mesh&>(*cached_shapes[i]);
+      ASSERT_EQ(cached_mesh.vertex_count, computed_mesh.vertex_count) << link->getName();
+      ASSERT_EQ(cached_mesh.triangle_count, computed_mesh.triangle_count) << link->getName();
+      EXPECT_TRUE(std::equal(computed_mesh.vertices, computed_mesh.vertices + 3 * computed_mesh.vertex_count,
+                             cached_mesh.vertices))
+          << link->getName();
+      EXPECT_TRUE(std::equal(computed_mesh.triangles, computed_mesh.triangles + 3 * computed_mesh.triangle_count,
+                             cached_mesh.triangles))
+          << link->getName();
+      ++meshes;
+    }
+  }
+  EXPECT_GT(meshes, 0u);
+}
+
+int main(int argc, char** argv)
+{
+  // The global cache reads its directory once, before the first use
+  cache_directory =
+      boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("cached_geometry_%%%%%%%%");
+  boost::filesystem::create_directories(cache_directory);
+  setenv("MOVEIT_GEOMETRY_CACHE_DIR", cache_directory.c_str(), 1);
+  testing::InitGoogleTest(&argc, argv);
+  int result = RUN_ALL_TESTS();
+  boost::filesystem::remove_all(cache_directory);
+  return result;
+}
@@ -363,6 +363,70 @@ TEST_F(DistanceFieldCollisionDetectionTester, AttachedBodyTester)
   ASSERT_TRUE(res.collision);
 }
 
+TEST(CollisionSphereTree, MatchesLinearQueries)
+{
+  using collision_detection::CollisionSphere;
+  using collision_detection::CollisionSphereTree;
+
+  // a chain of spheres sweeping past a few obstacle points, as along a link
+  std::vector<CollisionSphere> spheres;
+  EigenSTL::vector_Vector3d centers;
+  for (unsigned int i = 0; i < 23; ++i)
+  {
+    spheres.emplace_back(Eigen::Vector3d(-0.5 + 0.045 * i, 0.1, 0.02 * (i % 3)), 0.03 + 0.01 * (i % 4));
+    centers.push_back(spheres.back().relative_vec_);
+  }
+  CollisionSphereTree tree(spheres);
+  ASSERT_FALSE(tree.empty());
+  EXPECT_EQ(tree.getLeafCount(), 6u);
+
+  // every node encloses the spheres below it
+  for (unsigned int node = tree.getLeafCount(); node < tree.getNodeCount(); ++node)
+    for (unsigned int child = tree.getNodeBegin(node); child < tree.getNodeEnd(node); ++child)
+      EXPECT_LE((tree.getCenters().col(child) - tree.getCenters().col(node)).norm() + tree.getRadii()[child],
+                tree.getRadii()[node] + 1e-9);
+  for (unsigned int leaf = 0; leaf < tree.getLeafCount(); ++leaf)
+    for (unsigned int i = tree.getNodeBegin(leaf); i < tree.getNodeEnd(leaf); ++i)
+      EXPECT_LE((centers[i] - tree.getCenters().col(leaf)).norm() + spheres[i].radius_, tree.getRadii()[leaf] + 1e-9);
+
+  distance_field::PropagationDistanceField df(2.0, 2.0, 2.0, 0.02, -1.0, -1.0, -1.0, 0.4);
+  EigenSTL::vector_Vector3d obstacles;
+  obstacles.push_back(Eigen::Vector3d(0.3, 0.12, 0.0));
+  obstacles.push_back(Eigen::Vector3d(-0.2, -0.5, 0.4));
+  df.addPointsToField(obstacles);
+
+  for (double offset : { 0.0, 0.05, 0.3 })
+  {
+    EigenSTL::vector_Vector3d posed_centers;
+    for (const Eigen::Vector3d& center : centers)
+      posed_centers.push_back(center + Eigen::Vector3d(0.0, offset, 0.0));
+    CollisionSphereTree posed_tree = tree;
+    posed_tree.refit(spheres, posed_centers);
+
+    std::vector<unsigned int> linear_colls, tree_colls;
+    bool linear_collision =
+        collision_detection::getCollisionSphereCollision(&df, spheres, posed_centers, 0.4, 0.0, 100, linear_colls);
+    bool tree_collision = collision_detection::getCollisionSphereCollision(&df, spheres, posed_centers, posed_tree,
+                                                                           0.4, 0.0, 100, tree_colls);
+    EXPECT_EQ(linear_collision, tree_collision);
+    EXPECT_EQ(linear_colls, tree_colls);
+
+    collision_detection::GradientInfo linear_gradient, tree_gradient;
+    linear_gradient.distances.assign(spheres.size(), DBL_MAX);
+    linear_gradient.gradients.resize(spheres.size());
+    linear_gradient.types.assign(spheres.size(), collision_detection::NONE);
+    tree_gradient = linear_gradient;
+    linear_collision = collision_detection::getCollisionSphereGradients(
+        &df, spheres, posed_centers, linear_gradient, collision_detection::ENVIRONMENT, 0.0, false, 0.1, false);
+    tree_collision = collision_detection::getCollisionSphereGradients(&df, spheres, posed_centers, posed_tree,
+                                                                      tree_gradient, collision_detection::ENVIRONMENT,
+                                                                      0.0, false, 0.1, false);
+    EXPECT_EQ(linear_collision, tree_collision);
+    EXPECT_EQ(linear_gradient.distances, tree_gradient.distances);
+    EXPECT_EQ(linear_gradient.closest_distance, tree_gradient.closest_distance);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -304,7 +304,7 @@ public:
    *
    */
   IKConstraintSampler(const planning_scene::PlanningSceneConstPtr& scene, const std::string& group_name)
-    : ConstraintSampler(scene, group_name)
+    : ConstraintSampler(scene, group_name), sampling_threads_(1)
   {
   }
 
@@ -381,6 +381,36 @@ public:
     ik_timeout_ = timeout;
   }
 
+  /**
+   * \brief Gets the number of threads \ref sample uses for its attempts
+   *
+   * @return The number of threads, 0 meaning one per hardware core
+   */
+  unsigned int getSamplingThreads() const
+  {
+    return sampling_threads_;
+  }
+
+  /**
+   * \brief Sets the number of threads \ref sample uses for its attempts
+   *
+   * With more than one thread, the attempts of \ref sample are run
+   * through \ref sampleValidStates. Every thread then solves IK with
+   * its own solver instance taken from the group's solver allocator,
+   * and the group state validity callback is called concurrently. The
+   * result is deterministic for a given seed of the sampler, but
+   * differs from the one of the sequential loop. \ref project always
+   * runs sequentially, as its first attempt is seeded with the state
+   * to project.
+   *
+   * @param num_threads The number of threads, 0 meaning one per hardware core; 1 (the default) keeps the
+   * sequential loop
+   */
+  void setSamplingThreads(unsigned int num_threads)
+  {
+    sampling_threads_ = num_threads;
+  }
+
   /**
    * \brief Gets the position constraint associated with this sampler.
    *
@@ -510,8 +540,20 @@ protected:
   bool callIK(const geometry_msgs::msg::Pose& ik_query,
               const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback, double timeout,
               robot_state::RobotState& state, bool use_as_seed);
+  bool callIK(const geometry_msgs::msg::Pose& ik_query,
+              const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback, double timeout,
+              robot_state::RobotState& state, bool use_as_seed, const kinematics::KinematicsBase& solver,
+              random_numbers::RandomNumberGenerator& rng);
+  bool samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const robot_state::RobotState& ks,
+                  unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng);
+  /** \brief Samples a pose and transforms it into the query for the IK solver */
+  bool sampleIKQuery(geometry_msgs::msg::Pose& ik_query, const robot_state::RobotState& reference_state,
+                     unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng);
   bool sampleHelper(robot_state::RobotState& state, const robot_state::RobotState& reference_state,
                     unsigned int max_attempts, bool project);
+  /** \brief Runs the attempts of \ref sample on sampling_threads_ threads */
+  bool sampleConcurrently(robot_state::RobotState& state, const robot_state::RobotState& reference_state,
+                          unsigned int max_attempts);
   bool validate(robot_state::RobotState& state) const;
 
   random_numbers::RandomNumberGenerator random_number_generator_; /**< \brief Random generator used by the sampler */
@@ -524,5 +566,8 @@ protected:
   bool need_eef_to_ik_tip_transform_; /**< \brief True if the tip frame of the inverse kinematic is different than the
                                         frame of the end effector */
   Eigen::Isometry3d eef_to_ik_tip_transform_; /**< \brief Holds the transformation from end effector to IK tip frame */
+  unsigned int sampling_threads_;             /**< \brief Number of threads used by \ref sample */
+  std::vector<kinematics::KinematicsBaseConstPtr> thread_solvers_; /**< \brief Solver instances of the additional
+                                                                      sampling threads */
 };
 }
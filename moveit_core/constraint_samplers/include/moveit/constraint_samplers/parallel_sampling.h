@@ -0,0 +1,74 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_state/robot_state.h>
+#include <random_numbers/random_numbers.h>
+#include <boost/function.hpp>
+#include <vector>
+
+namespace constraint_samplers
+{
+/** \brief Signature of the functions that generate a single candidate for sampleValidStates().
+
+    The candidate is written into \e state, which is a thread-local copy of the reference state that still holds the
+    previous candidate of that thread. The function therefore has to set every variable it samples and must only draw
+    random numbers from \e rng. It returns true if the candidate is valid. As it is called concurrently from several
+    threads, the function must not modify shared data. In particular, the kinematics solver of a JointModelGroup is a
+    single instance shared by all states and must not be called concurrently; candidates that need IK have to use a
+    solver instance per thread, allocated through the group's solver allocator. */
+typedef boost::function<bool(robot_state::RobotState& state, random_numbers::RandomNumberGenerator& rng)>
+    StateCandidateFn;
+
+/** \brief Generate up to \e max_attempts candidates with \e candidate_fn on \e num_threads threads until \e count valid
+    states are found.
+
+    Attempt \e i draws its random numbers from a generator seeded with \e seed + \e i, and the valid states of the
+    \e count lowest attempt indices are returned in attempt order. The result is hence identical to a sequential loop
+    and independent of the number of threads and their scheduling. Attempts with an index above the last returned one
+    are skipped as soon as this is known.
+    @param reference_state The state every thread-local scratch state is copied from
+    @param candidate_fn The function generating and validating a single candidate
+    @param max_attempts The maximum number of candidates to generate
+    @param count The number of valid states to look for
+    @param states The valid states found, at most \e count
+    @param seed The base seed for the per-attempt random number generators
+    @param num_threads The number of threads to use; 0 uses one thread per hardware core
+    @return The number of valid states found */
+std::size_t sampleValidStates(const robot_state::RobotState& reference_state, const StateCandidateFn& candidate_fn,
+                              unsigned int max_attempts, unsigned int count,
+                              std::vector<robot_state::RobotStatePtr>& states, unsigned int seed,
+                              unsigned int num_threads = 1);
+}  // namespace constraint_samplers
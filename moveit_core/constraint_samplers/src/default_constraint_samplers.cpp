@@ -35,8 +35,13 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/constraint_samplers/default_constraint_samplers.h>
+#include <moveit/constraint_samplers/parallel_sampling.h>
+#include <algorithm>
 #include <set>
 #include <cassert>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <boost/bind.hpp>
 
 namespace constraint_samplers
@@ -231,6 +236,7 @@ void IKConstraintSampler::clear()
 {
   ConstraintSampler::clear();
   kb_.reset();
+  thread_solvers_.clear();
   ik_frame_ = "";
   transform_ik_ = false;
   eef_to_ik_tip_transform_ = Eigen::Isometry3d::Identity();
@@ -412,6 +418,12 @@ bool IKConstraintSampler::loadIKSolver()
 
 bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const robot_state::RobotState& ks,
                                      unsigned int max_attempts)
+{
+  return samplePose(pos, quat, ks, max_attempts, random_number_generator_);
+}
+
+bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const robot_state::RobotState& ks,
+                                     unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng)
 {
   if (ks.dirtyLinkTransforms())
   {
@@ -427,9 +439,9 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
     if (!b.empty())
     {
       bool found = false;
-      std::size_t k = random_number_generator_.uniformInteger(0, b.size() - 1);
+      std::size_t k = rng.uniformInteger(0, b.size() - 1);
       for (std::size_t i = 0; i < b.size(); ++i)
-        if (b[(i + k) % b.size()]->samplePointInside(random_number_generator_, max_attempts, pos))
+        if (b[(i + k) % b.size()]->samplePointInside(rng, max_attempts, pos))
         {
           found = true;
           break;
@@ -456,7 +468,7 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // do FK for rand state
     robot_state::RobotState temp_state(ks);
-    temp_state.setToRandomPositions(jmg_);
+    temp_state.setToRandomPositions(jmg_, rng);
     pos = temp_state.getGlobalLinkTransform(sampling_pose_.orientation_constraint_->getLinkModel()).translation();
   }
 
@@ -464,13 +476,13 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // sample a rotation matrix within the allowed bounds
     double angle_x =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getXAxisTolerance() - std::numeric_limits<double>::epsilon());
     double angle_y =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getYAxisTolerance() - std::numeric_limits<double>::epsilon());
     double angle_z =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getZAxisTolerance() - std::numeric_limits<double>::epsilon());
     Eigen::Isometry3d diff(Eigen::AngleAxisd(angle_x, Eigen::Vector3d::UnitX()) *
                            Eigen::AngleAxisd(angle_y, Eigen::Vector3d::UnitY()) *
@@ -491,7 +503,7 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // sample a random orientation
     double q[4];
-    random_number_generator_.quaternion(q);
+    rng.quaternion(q);
     quat = Eigen::Quaterniond(q[3], q[0], q[1], q[2]);
   }
 
@@ -536,6 +548,10 @@ bool IKConstraintSampler::sampleHelper(robot_state::RobotState& state, const rob
     return false;
   }
 
+  // the attempts are independent unless the state to project seeds the first one
+  if (sampling_threads_ != 1 && !project && max_attempts > 1)
+    return sampleConcurrently(state, reference_state, max_attempts);
+
   kinematics::KinematicsBase::IKCallbackFn adapted_ik_validity_callback;
   if (group_state_validity_callback_)
     adapted_ik_validity_callback =
@@ -543,49 +559,118 @@ bool IKConstraintSampler::sampleHelper(robot_state::RobotState& state, const rob
 
   for (unsigned int a = 0; a < max_attempts; ++a)
   {
-    // sample a point in the constraint region
-    Eigen::Vector3d point;
-    Eigen::Quaterniond quat;
-    if (!samplePose(point, quat, reference_state, max_attempts))
+    geometry_msgs::msg::Pose ik_query;
+    if (!sampleIKQuery(ik_query, reference_state, max_attempts, random_number_generator_))
     {
       if (verbose_)
         RCLCPP_INFO(LOGGER, "IK constraint sampler was unable to produce a pose to run IK for");
       return false;
     }
 
-    // we now have the transform we wish to perform IK for, in the planning frame
-    if (transform_ik_)
-    {
-      // we need to convert this transform to the frame expected by the IK solver
-      // both the planning frame and the frame for the IK are assumed to be robot links
-      Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);
-      ikq = reference_state.getFrameTransform(ik_frame_).inverse() * ikq;
-      point = ikq.translation();
-      quat = Eigen::Quaterniond(ikq.rotation());
-    }
+    if (callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, state, project && a == 0))
+      return true;
+  }
+  return false;
+}
+
+bool IKConstraintSampler::sampleConcurrently(robot_state::RobotState& state,
+                                             const robot_state::RobotState& reference_state, unsigned int max_attempts)
+{
+  unsigned int num_threads =
+      sampling_threads_ == 0 ? std::max(1u, std::thread::hardware_concurrency()) : sampling_threads_;
+  num_threads = std::min(num_threads, max_attempts);
+
+  // kb_ is the group's own instance; the other threads get instances from the group's solver allocator, which are
+  // kept for later calls. An allocator handing out a shared instance limits the sampling to a single thread.
+  const robot_model::SolverAllocatorFn& allocator = jmg_->getGroupKinematics().first.allocator_;
+  while (allocator && thread_solvers_.size() + 1 < num_threads)
+  {
+    kinematics::KinematicsBaseConstPtr solver = allocator(jmg_);
+    if (!solver || solver == kb_ ||
+        std::find(thread_solvers_.begin(), thread_solvers_.end(), solver) != thread_solvers_.end())
+      break;
+    thread_solvers_.push_back(solver);
+  }
+  num_threads = std::min<std::size_t>(num_threads, thread_solvers_.size() + 1);
+
+  // at most num_threads candidates are evaluated at the same time, so there always is an idle solver
+  std::mutex solvers_lock;
+  std::vector<const kinematics::KinematicsBase*> idle_solvers(1, kb_.get());
+  for (unsigned int i = 1; i < num_threads; ++i)
+    idle_solvers.push_back(thread_solvers_[i - 1].get());
 
-    if (need_eef_to_ik_tip_transform_)
+  auto candidate = [&](robot_state::RobotState& candidate_state, random_numbers::RandomNumberGenerator& rng) {
+    geometry_msgs::msg::Pose ik_query;
+    if (!sampleIKQuery(ik_query, reference_state, max_attempts, rng))
+      return false;
+
+    kinematics::KinematicsBase::IKCallbackFn adapted_ik_validity_callback;
+    if (group_state_validity_callback_)
+      adapted_ik_validity_callback = boost::bind(&samplingIkCallbackFnAdapter, &candidate_state, jmg_,
+                                                 group_state_validity_callback_, _1, _2, _3);
+
+    const kinematics::KinematicsBase* solver;
     {
-      // After sampling the pose needs to be transformed to the ik chain tip
-      Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);
-      ikq = ikq * eef_to_ik_tip_transform_;
-      point = ikq.translation();
-      quat = Eigen::Quaterniond(ikq.rotation());
+      std::lock_guard<std::mutex> slock(solvers_lock);
+      solver = idle_solvers.back();
+      idle_solvers.pop_back();
     }
+    bool valid = callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, candidate_state, false, *solver, rng);
+    std::lock_guard<std::mutex> slock(solvers_lock);
+    idle_solvers.push_back(solver);
+    return valid;
+  };
+
+  std::vector<robot_state::RobotStatePtr> valid_states;
+  if (sampleValidStates(state, candidate, max_attempts, 1, valid_states,
+                        random_number_generator_.uniformInteger(0, std::numeric_limits<int>::max()), num_threads) == 0)
+  {
+    if (verbose_)
+      RCLCPP_INFO(LOGGER, "IK constraint sampler found no valid sample in %u attempts", max_attempts);
+    return false;
+  }
+  state = *valid_states.front();
+  return true;
+}
 
-    geometry_msgs::msg::Pose ik_query;
-    ik_query.position.x = point.x();
-    ik_query.position.y = point.y();
-    ik_query.position.z = point.z();
-    ik_query.orientation.x = quat.x();
-    ik_query.orientation.y = quat.y();
-    ik_query.orientation.z = quat.z();
-    ik_query.orientation.w = quat.w();
+bool IKConstraintSampler::sampleIKQuery(geometry_msgs::msg::Pose& ik_query,
+                                        const robot_state::RobotState& reference_state, unsigned int max_attempts,
+                                        random_numbers::RandomNumberGenerator& rng)
+{
+  // sample a point in the constraint region
+  Eigen::Vector3d point;
+  Eigen::Quaterniond quat;
+  if (!samplePose(point, quat, reference_state, max_attempts, rng))
+    return false;
 
-    if (callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, state, project && a == 0))
-      return true;
+  // we now have the transform we wish to perform IK for, in the planning frame
+  if (transform_ik_)
+  {
+    // we need to convert this transform to the frame expected by the IK solver
+    // both the planning frame and the frame for the IK are assumed to be robot links
+    Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);
+    ikq = reference_state.getFrameTransform(ik_frame_).inverse() * ikq;
+    point = ikq.translation();
+    quat = Eigen::Quaterniond(ikq.rotation());
   }
-  return false;
+
+  if (need_eef_to_ik_tip_transform_)
+  {
+    // After sampling the pose needs to be transformed to the ik chain tip
+    Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);
+    ikq = ikq * eef_to_ik_tip_transform_;
+    point = ikq.translation();
+    quat = Eigen::Quaterniond(ikq.rotation());
+  }
+
+  ik_query.position.x = point.x();
+  ik_query.position.y = point.y();
+  ik_query.position.z = point.z();
+  ik_query.orientation.x = quat.x();
+  ik_query.orientation.y = quat.y();
+  ik_query.orientation.z = quat.z();
+  ik_query.orientation.w = quat.w();
+  return true;
 }
 
 bool IKConstraintSampler::project(robot_state::RobotState& state, unsigned int max_attempts)
@@ -605,6 +690,14 @@ bool IKConstraintSampler::validate(robot_state::RobotState& state) const
 bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
                                  const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback,
                                  double timeout, robot_state::RobotState& state, bool use_as_seed)
+{
+  return callIK(ik_query, adapted_ik_validity_callback, timeout, state, use_as_seed, *kb_, random_number_generator_);
+}
+
+bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
+                                 const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback,
+                                 double timeout, robot_state::RobotState& state, bool use_as_seed,
+                                 const kinematics::KinematicsBase& solver, random_numbers::RandomNumberGenerator& rng)
 {
   const std::vector<unsigned int>& ik_joint_bijection = jmg_->getKinematicsSolverJointBijection();
   std::vector<double> seed(ik_joint_bijection.size(), 0.0);
@@ -614,7 +707,7 @@ bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
     state.copyJointGroupPositions(jmg_, vals);
   else
     // sample a seed value
-    jmg_->getVariableRandomPositions(random_number_generator_, vals);
+    jmg_->getVariableRandomPositions(rng, vals);
 
   assert(vals.size() == ik_joint_bijection.size());
   for (std::size_t i = 0; i < ik_joint_bijection.size(); ++i)
@@ -624,8 +717,8 @@ bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
   moveit_msgs::msg::MoveItErrorCodes error;
 
   if (adapted_ik_validity_callback ?
-          kb_->searchPositionIK(ik_query, seed, timeout, ik_sol, adapted_ik_validity_callback, error) :
-          kb_->searchPositionIK(ik_query, seed, timeout, ik_sol, error))
+          solver.searchPositionIK(ik_query, seed, timeout, ik_sol, adapted_ik_validity_callback, error) :
+          solver.searchPositionIK(ik_query, seed, timeout, ik_sol, error))
   {
     assert(ik_sol.size() == ik_joint_bijection.size());
     std::vector<double> solution(ik_joint_bijection.size());
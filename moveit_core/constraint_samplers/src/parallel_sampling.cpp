@@ -0,0 +1,106 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/constraint_samplers/parallel_sampling.h>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace constraint_samplers
+{
+std::size_t sampleValidStates(const robot_state::RobotState& reference_state, const StateCandidateFn& candidate_fn,
+                              unsigned int max_attempts, unsigned int count,
+                              std::vector<robot_state::RobotStatePtr>& states, unsigned int seed,
+                              unsigned int num_threads)
+{
+  states.clear();
+  if (max_attempts == 0 || count == 0)
+    return 0;
+
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = std::min(num_threads, max_attempts);
+
+  std::atomic<unsigned int> next_attempt(0);
+  std::mutex valid_lock;
+  std::map<unsigned int, robot_state::RobotStatePtr> valid;  // valid states, ordered by attempt index
+
+  auto worker = [&]() {
+    robot_state::RobotState state(reference_state);
+    while (true)
+    {
+      const unsigned int attempt = next_attempt++;
+      if (attempt >= max_attempts)
+        break;
+      {
+        // once count valid states with lower attempt indices are known, they form the result
+        std::lock_guard<std::mutex> slock(valid_lock);
+        if (valid.size() >= count && std::next(valid.begin(), count - 1)->first < attempt)
+          break;
+      }
+      random_numbers::RandomNumberGenerator rng(seed + attempt);
+      if (candidate_fn(state, rng))
+      {
+        robot_state::RobotStatePtr found = std::make_shared<robot_state::RobotState>(state);
+        std::lock_guard<std::mutex> slock(valid_lock);
+        valid[attempt] = found;
+      }
+    }
+  };
+
+  if (num_threads == 1)
+    worker();
+  else
+  {
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i)
+      threads.emplace_back(worker);
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
+  for (const std::pair<const unsigned int, robot_state::RobotStatePtr>& v : valid)
+  {
+    if (states.size() >= count)
+      break;
+    states.push_back(v.second);
+  }
+  return states.size();
+}
+}  // namespace constraint_samplers
@@ -40,6 +40,7 @@
 #include <moveit/constraint_samplers/union_constraint_sampler.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/constraint_samplers/constraint_sampler_tools.h>
+#include <moveit/constraint_samplers/parallel_sampling.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
@@ -1113,6 +1114,108 @@ TEST_F(LoadPlanningModelsPr2, SubgroupPoseConstraintsSampler)
               (double)succ / (double)NT);
 }
 
+TEST_F(LoadPlanningModelsPr2, ParallelSampleValidStates)
+{
+  robot_state::RobotState ks(robot_model_);
+  ks.setToDefaultValues();
+  ks.update();
+
+  // jiggle the right arm around the default state and keep states without self-collisions
+  const robot_model::JointModelGroup* jmg = robot_model_->getJointModelGroup("right_arm");
+  std::vector<double> near;
+  ks.copyJointGroupPositions(jmg, near);
+  collision_detection::CollisionRequest req;
+  req.group_name = "right_arm";
+  auto candidate = [&](robot_state::RobotState& state, random_numbers::RandomNumberGenerator& rng) {
+    std::vector<double> values(near.size());
+    jmg->getVariableRandomPositionsNearBy(rng, values, near, 0.5);
+    state.setJointGroupPositions(jmg, values);
+    state.update();
+    collision_detection::CollisionResult res;
+    ps_->checkSelfCollision(req, res, state);
+    return !res.collision;
+  };
+
+  std::vector<robot_state::RobotStatePtr> sequential, parallel;
+  EXPECT_EQ(constraint_samplers::sampleValidStates(ks, candidate, 1000, 10, sequential, 42, 1), 10u);
+  EXPECT_EQ(constraint_samplers::sampleValidStates(ks, candidate, 1000, 10, parallel, 42, 4), 10u);
+  ASSERT_EQ(sequential.size(), parallel.size());
+  for (std::size_t i = 0; i < sequential.size(); ++i)
+    EXPECT_LT(sequential[i]->distance(*parallel[i]), 1e-12);
+
+  // a different seed yields different states, no attempts yield none
+  std::vector<robot_state::RobotStatePtr> states;
+  ASSERT_EQ(constraint_samplers::sampleValidStates(ks, candidate, 1000, 1, states, 43, 4), 1u);
+  EXPECT_GT(states[0]->distance(*sequential[0]), 0.0);
+  EXPECT_EQ(constraint_samplers::sampleValidStates(ks, candidate, 0, 1, states, 42, 4), 0u);
+  EXPECT_TRUE(states.empty());
+}
+
+TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerConcurrent)
+{
+  // hand out a new solver instance on every call, so that every sampling thread gets its own
+  std::map<std::string, robot_model::SolverAllocatorFn> allocators;
+  allocators["left_arm"] = [this](const robot_model::JointModelGroup* /*jmg*/) -> kinematics::KinematicsBasePtr {
+    pr2_arm_kinematics::PR2ArmKinematicsPluginPtr solver(new pr2_arm_kinematics::PR2ArmKinematicsPlugin);
+    solver->initialize(node_, *robot_model_, "left_arm", "torso_lift_link", { "l_wrist_roll_link" }, .01);
+    return solver;
+  };
+  robot_model_->setKinematicsAllocators(allocators);
+
+  robot_state::RobotState ks(robot_model_);
+  ks.setToDefaultValues();
+  ks.update();
+  robot_state::RobotState ks_const(robot_model_);
+  ks_const.setToDefaultValues();
+  ks_const.update();
+
+  robot_state::Transforms& tf = ps_->getTransformsNonConst();
+
+  kinematic_constraints::PositionConstraint pc(robot_model_);
+  moveit_msgs::msg::PositionConstraint pcm;
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[0].dimensions.resize(1);
+  pcm.constraint_region.primitives[0].dimensions[0] = 0.001;
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0].position.x = 0.55;
+  pcm.constraint_region.primitive_poses[0].position.y = 0.2;
+  pcm.constraint_region.primitive_poses[0].position.z = 1.25;
+  pcm.constraint_region.primitive_poses[0].orientation.w = 1.0;
+  pcm.weight = 1.0;
+  EXPECT_TRUE(pc.configure(pcm, tf));
+
+  kinematic_constraints::OrientationConstraint oc(robot_model_);
+  moveit_msgs::msg::OrientationConstraint ocm;
+  ocm.link_name = "l_wrist_roll_link";
+  ocm.header.frame_id = robot_model_->getModelFrame();
+  ocm.orientation.w = 1.0;
+  ocm.absolute_x_axis_tolerance = 0.2;
+  ocm.absolute_y_axis_tolerance = 0.1;
+  ocm.absolute_z_axis_tolerance = 0.4;
+  ocm.weight = 1.0;
+  EXPECT_TRUE(oc.configure(ocm, tf));
+
+  constraint_samplers::IKConstraintSampler iks(ps_, "left_arm");
+  EXPECT_TRUE(iks.configure(constraint_samplers::IKSamplingPose(pc, oc)));
+  iks.setSamplingThreads(4);
+  for (int t = 0; t < 20; ++t)
+  {
+    EXPECT_TRUE(iks.sample(ks, ks_const, 100));
+    EXPECT_TRUE(pc.decide(ks).satisfied);
+    EXPECT_TRUE(oc.decide(ks).satisfied);
+  }
+
+  // no attempt succeeds if every IK solution is rejected
+  iks.setGroupStateValidityCallback(
+      [](robot_state::RobotState* /*state*/, const robot_model::JointModelGroup* /*jmg*/,
+         const double* /*joint_group_variable_values*/) { return false; });
+  iks.setIKTimeout(0.01);
+  EXPECT_FALSE(iks.sample(ks, ks_const, 8));
+}
+
 int main(int argc, char** argv)
 {
   rclcpp::init(argc, argv);
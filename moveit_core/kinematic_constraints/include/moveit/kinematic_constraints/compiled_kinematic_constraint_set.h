@@ -0,0 +1,168 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <eigen_stl_containers/eigen_stl_containers.h>
+
+namespace kinematic_constraints
+{
+MOVEIT_CLASS_FORWARD(CompiledKinematicConstraintSet)
+
+/**
+ * \brief A flattened, read-only copy of a KinematicConstraintSet for fast repeated evaluation
+ *
+ * Joint constraints are stored as arrays of variable indices and bounds, box and sphere regions of position
+ * constraints as arrays of centers, axes and extents, and orientation constraints with their precomputed inverse
+ * target rotations. decide() evaluates all of them in one pass without virtual calls or body clones. Constraint
+ * types without a flat representation (visibility constraints, mesh or cylinder regions and regions in mobile
+ * frames) are evaluated by the original constraint objects, which are shared with the source set.
+ *
+ * Constraints are evaluated in the order of the source set, so decide() returns the same satisfaction flag and
+ * distance as KinematicConstraintSet::decide().
+ */
+class CompiledKinematicConstraintSet
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * \brief Compile the constraints of a set
+   *
+   * @param [in] set The constraints to compile. Later changes to \e set are not reflected.
+   */
+  CompiledKinematicConstraintSet(const KinematicConstraintSet& set);
+
+  /**
+   * \brief Determines whether all constraints are satisfied by state
+   *
+   * @param [in] state The state to test
+   *
+   * @return A single constraint evaluation result, where it will
+   * report satisfied only if all constraints are satisfied, and with
+   * a distance that is the sum of all individual distances.
+   */
+  ConstraintEvaluationResult decide(const robot_state::RobotState& state) const;
+
+  /**
+   * \brief Evaluate a batch of states
+   *
+   * The constraints are evaluated one after the other for all states, which keeps each constraint's data in cache
+   * and turns the joint and region tests into loops over flat arrays.
+   *
+   * @param [in] states The states to test
+   * @param [out] results The result for each state, as returned by decide()
+   */
+  void decide(const std::vector<const robot_state::RobotState*>& states,
+              std::vector<ConstraintEvaluationResult>& results) const;
+
+  /// \brief The number of constraints that are evaluated by their original objects
+  std::size_t getFallbackConstraintCount() const
+  {
+    return fallback_.size();
+  }
+
+  /// \brief Returns whether or not there are any enabled constraints
+  bool empty() const
+  {
+    return program_.empty();
+  }
+
+private:
+  enum OpType
+  {
+    JOINT,
+    POSITION,
+    ORIENTATION,
+    FALLBACK
+  };
+
+  /// \brief Type of a constraint and its index into the arrays of that type, in evaluation order
+  struct Op
+  {
+    OpType type;
+    std::size_t index;
+  };
+
+  enum RegionType
+  {
+    BOX,
+    SPHERE
+  };
+
+  void compileJointConstraint(const JointConstraint& jc);
+  bool compilePositionConstraint(const PositionConstraint& pc);
+  bool compileOrientationConstraint(const OrientationConstraint& oc);
+
+  /// \brief Difference of a variable value to the target of joint constraint \e i, wrapped for continuous joints
+  double jointDifference(std::size_t i, double current) const;
+  bool regionContains(std::size_t r, const Eigen::Vector3d& pt) const;
+  double regionDistance(std::size_t r, const Eigen::Vector3d& pt) const;
+  /// \brief Absolute XYZ Euler angle deviation of the link of orientation constraint \e i from its target
+  Eigen::Vector3d orientationDeviation(std::size_t i, const robot_state::RobotState& state) const;
+  bool orientationWithinTolerance(std::size_t i, const Eigen::Vector3d& xyz) const;
+
+  std::vector<Op> program_;
+
+  // joint constraints
+  std::vector<int> joint_index_;
+  std::vector<double> joint_position_;
+  std::vector<double> joint_tolerance_above_;
+  std::vector<double> joint_tolerance_below_;
+  std::vector<double> joint_weight_;
+  std::vector<bool> joint_continuous_;
+
+  // position constraints; the regions of constraint i are [region_begin_[i], region_begin_[i + 1])
+  std::vector<const robot_model::LinkModel*> position_link_;
+  EigenSTL::vector_Vector3d position_offset_;
+  std::vector<double> position_weight_;
+  std::vector<std::size_t> region_begin_;
+
+  // position constraint regions
+  std::vector<RegionType> region_type_;
+  EigenSTL::vector_Vector3d region_center_;
+  std::vector<Eigen::Matrix3d> region_axes_;
+  EigenSTL::vector_Vector3d region_extents_;  // half extents of boxes, squared radius of spheres in x()
+
+  // orientation constraints
+  std::vector<const robot_model::LinkModel*> orientation_link_;
+  std::vector<Eigen::Matrix3d> orientation_target_;  // inverse target rotation, or target rotation for mobile frames
+  std::vector<std::string> orientation_frame_;       // empty unless the reference frame is mobile
+  EigenSTL::vector_Vector3d orientation_tolerance_;
+  std::vector<double> orientation_weight_;
+
+  std::vector<KinematicConstraintConstPtr> fallback_;
+};
+}  // namespace kinematic_constraints
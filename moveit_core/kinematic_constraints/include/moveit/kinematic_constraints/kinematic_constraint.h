@@ -831,6 +831,40 @@ protected:
    */
   bool decideContact(const collision_detection::Contact& contact) const;
 
+  /**
+   * \brief Build the trimesh for a visibility cone from already transformed poses
+   *
+   * @param [in] sp The pose of the sensor
+   * @param [in] tp The pose of the target
+   * @param [in] points The points along the base of the cone, expressed in the same frame as sp and tp
+   *
+   * @return The shape associated with the cone
+   */
+  shapes::Mesh* createVisibilityCone(const Eigen::Isometry3d& sp, const Eigen::Isometry3d& tp,
+                                     const EigenSTL::vector_Vector3d& points) const;
+
+  /**
+   * \brief Cheap conservative test of the visibility cone against the bounding spheres of the robot links
+   *
+   * Links the cone is allowed to touch (see decideContact()) are not considered.
+   *
+   * @param [in] state The state for which the link transforms are taken
+   * @param [in] sensor The position of the sensor (the apex of the cone)
+   * @param [in] target The position of the target (the center of the base of the cone)
+   *
+   * @return True if no link can possibly touch the cone, false if the result is inconclusive
+   */
+  bool coneClearOfLinkSpheres(const robot_state::RobotState& state, const Eigen::Vector3d& sensor,
+                              const Eigen::Vector3d& target) const;
+
+  /** \brief Bounding sphere of the collision geometry of a link, expressed in the link frame */
+  struct LinkBoundingSphere
+  {
+    const robot_model::LinkModel* link;
+    Eigen::Vector3d center;
+    double radius;
+  };
+
   collision_detection::CollisionEnvPtr collision_env_; /**< \brief A copy of the collision robot maintained for
                                                               collision checking the cone against robot links */
   bool mobile_sensor_frame_;      /**< \brief True if the sensor is a non-fixed frame relative to the transform frame */
@@ -845,6 +879,12 @@ protected:
   double target_radius_;             /**< \brief Storage for the target radius */
   double max_view_angle_;            /**< \brief Storage for the max view angle */
   double max_range_angle_;           /**< \brief Storage for the max range angle */
+
+  /** \brief Cone mesh kept in the collision world between calls to decide(), if its shape does not depend on the
+   * state. Empty when the cone has to be rebuilt for every state. */
+  shapes::ShapeConstPtr cached_cone_;
+  std::string cached_cone_frame_id_; /**< \brief Frame the cached cone moves with; empty if it is fixed */
+  std::vector<LinkBoundingSphere> link_spheres_; /**< \brief Links the cone must not touch, for the pre-test */
 };
 
 MOVEIT_CLASS_FORWARD(KinematicConstraintSet)
@@ -1041,6 +1081,17 @@ public:
     return all_constraints_;
   }
 
+  /**
+   * \brief Get the constraint objects of the set, in the order they were added
+   *
+   *
+   * @return All constraints, including invalid ones
+   */
+  const std::vector<KinematicConstraintPtr>& getKinematicConstraints() const
+  {
+    return kinematic_constraints_;
+  }
+
   /**
    * \brief Returns whether or not there are any constraints in the set
    *
@@ -0,0 +1,368 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/kinematic_constraints/compiled_kinematic_constraint_set.h>
+#include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace kinematic_constraints
+{
+namespace
+{
+// same as the normalization used by JointConstraint
+double normalizeAngle(double angle)
+{
+  double v = fmod(angle, 2.0 * boost::math::constants::pi<double>());
+  if (v < -boost::math::constants::pi<double>())
+    v += 2.0 * boost::math::constants::pi<double>();
+  else if (v > boost::math::constants::pi<double>())
+    v -= 2.0 * boost::math::constants::pi<double>();
+  return v;
+}
+}  // namespace
+
+CompiledKinematicConstraintSet::CompiledKinematicConstraintSet(const KinematicConstraintSet& set)
+{
+  region_begin_.push_back(0);
+  for (const KinematicConstraintPtr& kc : set.getKinematicConstraints())
+  {
+    // disabled constraints are always satisfied with zero distance and do not contribute to the result
+    if (!kc->enabled())
+      continue;
+
+    bool compiled = false;
+    switch (kc->getType())
+    {
+      case KinematicConstraint::JOINT_CONSTRAINT:
+        compileJointConstraint(static_cast<const JointConstraint&>(*kc));
+        compiled = true;
+        break;
+      case KinematicConstraint::POSITION_CONSTRAINT:
+        compiled = compilePositionConstraint(static_cast<const PositionConstraint&>(*kc));
+        break;
+      case KinematicConstraint::ORIENTATION_CONSTRAINT:
+        compiled = compileOrientationConstraint(static_cast<const OrientationConstraint&>(*kc));
+        break;
+      default:
+        break;
+    }
+    if (!compiled)
+    {
+      program_.push_back({ FALLBACK, fallback_.size() });
+      fallback_.push_back(kc);
+    }
+  }
+}
+
+void CompiledKinematicConstraintSet::compileJointConstraint(const JointConstraint& jc)
+{
+  // the same rules JointConstraint::configure() uses to decide whether angles need to be wrapped
+  bool continuous = false;
+  const robot_model::JointModel* jm = jc.getJointModel();
+  if (jm->getType() == robot_model::JointModel::REVOLUTE)
+    continuous = static_cast<const robot_model::RevoluteJointModel*>(jm)->isContinuous();
+  else if (jm->getType() == robot_model::JointModel::PLANAR)
+    continuous = jc.getLocalVariableName() == "theta";
+
+  program_.push_back({ JOINT, joint_index_.size() });
+  joint_index_.push_back(jc.getJointVariableIndex());
+  joint_position_.push_back(jc.getDesiredJointPosition());
+  joint_tolerance_above_.push_back(jc.getJointToleranceAbove() + 2.0 * std::numeric_limits<double>::epsilon());
+  joint_tolerance_below_.push_back(-jc.getJointToleranceBelow() - 2.0 * std::numeric_limits<double>::epsilon());
+  joint_weight_.push_back(jc.getConstraintWeight());
+  joint_continuous_.push_back(continuous);
+}
+
+bool CompiledKinematicConstraintSet::compilePositionConstraint(const PositionConstraint& pc)
+{
+  const std::vector<bodies::BodyPtr>& regions = pc.getConstraintRegions();
+  if (regions.empty() || pc.mobileReferenceFrame())
+    return false;
+  for (const bodies::BodyPtr& region : regions)
+    if (region->getType() != shapes::BOX && region->getType() != shapes::SPHERE)
+      return false;
+
+  for (const bodies::BodyPtr& region : regions)
+  {
+    // mirror the internal data bodies::Box and bodies::Sphere compute from their pose, scale and padding
+    const Eigen::Isometry3d& pose = region->getPose();
+    const std::vector<double> dims = region->getDimensions();
+    region_center_.push_back(pose.translation());
+    region_axes_.push_back(pose.linear());
+    if (region->getType() == shapes::BOX)
+    {
+      const double s2 = region->getScale() / 2.0;
+      region_type_.push_back(BOX);
+      region_extents_.push_back(Eigen::Vector3d(dims[0] * s2 + region->getPadding(),
+                                                dims[1] * s2 + region->getPadding(),
+                                                dims[2] * s2 + region->getPadding()));
+    }
+    else
+    {
+      const double radius = dims[0] * region->getScale() + region->getPadding();
+      region_type_.push_back(SPHERE);
+      region_extents_.push_back(Eigen::Vector3d(radius * radius, 0.0, 0.0));
+    }
+  }
+
+  program_.push_back({ POSITION, position_link_.size() });
+  position_link_.push_back(pc.getLinkModel());
+  position_offset_.push_back(pc.getLinkOffset());
+  position_weight_.push_back(pc.getConstraintWeight());
+  region_begin_.push_back(region_center_.size());
+  return true;
+}
+
+bool CompiledKinematicConstraintSet::compileOrientationConstraint(const OrientationConstraint& oc)
+{
+  program_.push_back({ ORIENTATION, orientation_link_.size() });
+  orientation_link_.push_back(oc.getLinkModel());
+  if (oc.mobileReferenceFrame())
+  {
+    orientation_target_.push_back(oc.getDesiredRotationMatrix());
+    orientation_frame_.push_back(oc.getReferenceFrame());
+  }
+  else
+  {
+    orientation_target_.push_back(oc.getDesiredRotationMatrix().transpose());
+    orientation_frame_.push_back(std::string());
+  }
+  orientation_tolerance_.push_back(Eigen::Vector3d(oc.getXAxisTolerance(), oc.getYAxisTolerance(),
+                                                   oc.getZAxisTolerance()) +
+                                   Eigen::Vector3d::Constant(std::numeric_limits<double>::epsilon()));
+  orientation_weight_.push_back(oc.getConstraintWeight());
+  return true;
+}
+
+double CompiledKinematicConstraintSet::jointDifference(std::size_t i, double current) const
+{
+  if (!joint_continuous_[i])
+    return current - joint_position_[i];
+  double dif = normalizeAngle(current) - joint_position_[i];
+  if (dif > boost::math::constants::pi<double>())
+    dif = 2.0 * boost::math::constants::pi<double>() - dif;
+  else if (dif < -boost::math::constants::pi<double>())
+    dif += 2.0 * boost::math::constants::pi<double>();
+  return dif;
+}
+
+bool CompiledKinematicConstraintSet::regionContains(std::size_t r, const Eigen::Vector3d& pt) const
+{
+  const Eigen::Vector3d v = pt - region_center_[r];
+  if (region_type_[r] == SPHERE)
+    return v.squaredNorm() < region_extents_[r].x();
+  const Eigen::Matrix3d& axes = region_axes_[r];
+  const Eigen::Vector3d& half = region_extents_[r];
+  const Eigen::Vector3d axis_x = axes.col(0), axis_y = axes.col(1), axis_z = axes.col(2);
+  return fabs(v.dot(axis_x)) <= half.x() && fabs(v.dot(axis_y)) <= half.y() && fabs(v.dot(axis_z)) <= half.z();
+}
+
+double CompiledKinematicConstraintSet::regionDistance(std::size_t r, const Eigen::Vector3d& pt) const
+{
+  const double dx = region_center_[r].x() - pt.x();
+  const double dy = region_center_[r].y() - pt.y();
+  const double dz = region_center_[r].z() - pt.z();
+  return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+Eigen::Vector3d CompiledKinematicConstraintSet::orientationDeviation(std::size_t i,
+                                                                     const robot_state::RobotState& state) const
+{
+  const Eigen::Matrix3d& link_rotation = state.getGlobalLinkTransform(orientation_link_[i]).linear();
+  Eigen::Vector3d xyz;
+  if (orientation_frame_[i].empty())
+    xyz = (orientation_target_[i] * link_rotation).eulerAngles(0, 1, 2);
+  else
+  {
+    Eigen::Matrix3d target = state.getFrameTransform(orientation_frame_[i]).linear() * orientation_target_[i];
+    xyz = (target.transpose() * link_rotation).eulerAngles(0, 1, 2);
+  }
+  for (int k = 0; k < 3; ++k)
+    xyz(k) = std::min(fabs(xyz(k)), boost::math::constants::pi<double>() - fabs(xyz(k)));
+  return xyz;
+}
+
+bool CompiledKinematicConstraintSet::orientationWithinTolerance(std::size_t i, const Eigen::Vector3d& xyz) const
+{
+  return xyz(2) < orientation_tolerance_[i].z() && xyz(1) < orientation_tolerance_[i].y() &&
+         xyz(0) < orientation_tolerance_[i].x();
+}
+
+ConstraintEvaluationResult CompiledKinematicConstraintSet::decide(const robot_state::RobotState& state) const
+{
+  ConstraintEvaluationResult res(true, 0.0);
+  for (const Op& op : program_)
+  {
+    const std::size_t i = op.index;
+    switch (op.type)
+    {
+      case JOINT:
+      {
+        const double dif = jointDifference(i, state.getVariablePosition(joint_index_[i]));
+        if (!(dif <= joint_tolerance_above_[i] && dif >= joint_tolerance_below_[i]))
+          res.satisfied = false;
+        res.distance += joint_weight_[i] * fabs(dif);
+        break;
+      }
+      case POSITION:
+      {
+        // like PositionConstraint, the distance is measured to the first region containing the point,
+        // or to the last region if none does
+        const Eigen::Vector3d pt = state.getGlobalLinkTransform(position_link_[i]) * position_offset_[i];
+        const std::size_t end = region_begin_[i + 1];
+        std::size_t r = region_begin_[i];
+        while (r < end && !regionContains(r, pt))
+          ++r;
+        if (r == end)
+        {
+          res.satisfied = false;
+          r = end - 1;
+        }
+        res.distance += position_weight_[i] * regionDistance(r, pt);
+        break;
+      }
+      case ORIENTATION:
+      {
+        const Eigen::Vector3d xyz = orientationDeviation(i, state);
+        if (!orientationWithinTolerance(i, xyz))
+          res.satisfied = false;
+        res.distance += orientation_weight_[i] * (xyz(0) + xyz(1) + xyz(2));
+        break;
+      }
+      case FALLBACK:
+      {
+        ConstraintEvaluationResult r = fallback_[i]->decide(state);
+        if (!r.satisfied)
+          res.satisfied = false;
+        res.distance += r.distance;
+        break;
+      }
+    }
+  }
+  return res;
+}
+
+void CompiledKinematicConstraintSet::decide(const std::vector<const robot_state::RobotState*>& states,
+                                            std::vector<ConstraintEvaluationResult>& results) const
+{
+  // constraint by constraint over all states, so that the data of a constraint is loaded once and the per-state work
+  // runs in tight loops over flat arrays; every state accumulates its distance in the same order as decide() does
+  const std::size_t n = states.size();
+  std::vector<char> satisfied(n, 1);
+  std::vector<double> distance(n, 0.0);
+  std::vector<double> dif(n);
+  EigenSTL::vector_Vector3d pts(n);
+  std::vector<std::size_t> region(n);
+
+  for (const Op& op : program_)
+  {
+    const std::size_t i = op.index;
+    switch (op.type)
+    {
+      case JOINT:
+      {
+        const int index = joint_index_[i];
+        for (std::size_t k = 0; k < n; ++k)
+          dif[k] = states[k]->getVariablePosition(index);
+        if (joint_continuous_[i])
+          for (std::size_t k = 0; k < n; ++k)
+            dif[k] = jointDifference(i, dif[k]);
+        else
+        {
+          const double position = joint_position_[i];
+          for (std::size_t k = 0; k < n; ++k)
+            dif[k] = dif[k] - position;
+        }
+        const double above = joint_tolerance_above_[i], below = joint_tolerance_below_[i], weight = joint_weight_[i];
+        for (std::size_t k = 0; k < n; ++k)
+        {
+          satisfied[k] &= dif[k] <= above && dif[k] >= below;
+          distance[k] += weight * fabs(dif[k]);
+        }
+        break;
+      }
+      case POSITION:
+      {
+        for (std::size_t k = 0; k < n; ++k)
+          pts[k] = states[k]->getGlobalLinkTransform(position_link_[i]) * position_offset_[i];
+        // region by region, each state keeps the first region that contains its point
+        const std::size_t end = region_begin_[i + 1];
+        std::fill(region.begin(), region.end(), end);
+        for (std::size_t r = region_begin_[i]; r < end; ++r)
+          for (std::size_t k = 0; k < n; ++k)
+            if (region[k] == end && regionContains(r, pts[k]))
+              region[k] = r;
+        const double weight = position_weight_[i];
+        for (std::size_t k = 0; k < n; ++k)
+        {
+          if (region[k] == end)
+          {
+            satisfied[k] = 0;
+            region[k] = end - 1;
+          }
+          distance[k] += weight * regionDistance(region[k], pts[k]);
+        }
+        break;
+      }
+      case ORIENTATION:
+      {
+        const double weight = orientation_weight_[i];
+        for (std::size_t k = 0; k < n; ++k)
+        {
+          const Eigen::Vector3d xyz = orientationDeviation(i, *states[k]);
+          satisfied[k] &= orientationWithinTolerance(i, xyz);
+          distance[k] += weight * (xyz(0) + xyz(1) + xyz(2));
+        }
+        break;
+      }
+      case FALLBACK:
+      {
+        for (std::size_t k = 0; k < n; ++k)
+        {
+          ConstraintEvaluationResult r = fallback_[i]->decide(*states[k]);
+          satisfied[k] &= r.satisfied;
+          distance[k] += r.distance;
+        }
+        break;
+      }
+    }
+  }
+
+  results.resize(n);
+  for (std::size_t k = 0; k < n; ++k)
+    results[k] = ConstraintEvaluationResult(satisfied[k], distance[k]);
+}
+}  // namespace kinematic_constraints
@@ -664,6 +664,11 @@ void VisibilityConstraint::clear()
   target_radius_ = -1.0;
   max_view_angle_ = 0.0;
   max_range_angle_ = 0.0;
+  if (cached_cone_)
+    collision_env_->getWorld()->removeObject("cone");
+  cached_cone_.reset();
+  cached_cone_frame_id_ = "";
+  link_spheres_.clear();
 }
 
 bool VisibilityConstraint::configure(const moveit_msgs::msg::VisibilityConstraint& vc,
@@ -739,7 +744,39 @@ bool VisibilityConstraint::configure(const moveit_msgs::msg::VisibilityConstrain
   max_range_angle_ = vc.max_range_angle;
   sensor_view_direction_ = vc.sensor_view_direction;
 
-  return target_radius_ > std::numeric_limits<double>::epsilon();
+  if (target_radius_ <= std::numeric_limits<double>::epsilon())
+    return false;
+
+  // the cone only depends on the state through the sensor and target frames; if both are fixed, or both move with
+  // the same frame, the mesh never changes and is kept in the world, only updating its pose when needed
+  if (!mobile_sensor_frame_ && !mobile_target_frame_)
+    cached_cone_.reset(createVisibilityCone(sensor_pose_, target_pose_, points_));
+  else if (mobile_sensor_frame_ && mobile_target_frame_ &&
+           robot_state::Transforms::sameFrame(sensor_frame_id_, target_frame_id_))
+  {
+    EigenSTL::vector_Vector3d points(points_.size());
+    for (std::size_t i = 0; i < points_.size(); ++i)
+      points[i] = target_pose_ * points_[i];
+    cached_cone_.reset(createVisibilityCone(sensor_pose_, target_pose_, points));
+    cached_cone_frame_id_ = sensor_frame_id_;
+  }
+  if (cached_cone_)
+    collision_env_->getWorld()->addToObject("cone", cached_cone_, Eigen::Isometry3d::Identity());
+
+  // bounding spheres of all the links the cone is not allowed to touch
+  for (const robot_model::LinkModel* link : robot_model_->getLinkModelsWithCollisionGeometry())
+  {
+    if (robot_state::Transforms::sameFrame(link->getName(), sensor_frame_id_) ||
+        robot_state::Transforms::sameFrame(link->getName(), target_frame_id_))
+      continue;
+    LinkBoundingSphere sphere;
+    sphere.link = link;
+    sphere.center = link->getCenteredBoundingBoxOffset();
+    sphere.radius = 0.5 * link->getShapeExtentsAtOrigin().norm();
+    link_spheres_.push_back(sphere);
+  }
+
+  return true;
 }
 
 bool VisibilityConstraint::equal(const KinematicConstraint& other, double margin) const
@@ -784,16 +821,19 @@ shapes::Mesh* VisibilityConstraint::getVisibilityCone(const robot_state::RobotSt
       mobile_target_frame_ ? state.getFrameTransform(target_frame_id_) * target_pose_ : target_pose_;
 
   // transform the points on the disc to the desired target frame
-  const EigenSTL::vector_Vector3d* points = &points_;
-  std::unique_ptr<EigenSTL::vector_Vector3d> temp_points;
   if (mobile_target_frame_)
   {
-    temp_points.reset(new EigenSTL::vector_Vector3d(points_.size()));
+    EigenSTL::vector_Vector3d points(points_.size());
     for (std::size_t i = 0; i < points_.size(); ++i)
-      temp_points->at(i) = tp * points_[i];
-    points = temp_points.get();
+      points[i] = tp * points_[i];
+    return createVisibilityCone(sp, tp, points);
   }
+  return createVisibilityCone(sp, tp, points_);
+}
 
+shapes::Mesh* VisibilityConstraint::createVisibilityCone(const Eigen::Isometry3d& sp, const Eigen::Isometry3d& tp,
+                                                         const EigenSTL::vector_Vector3d& points) const
+{
   // allocate memory for a mesh to represent the visibility cone
   shapes::Mesh* m = new shapes::Mesh();
   m->vertex_count = cone_sides_ + 2;
@@ -813,16 +853,16 @@ shapes::Mesh* VisibilityConstraint::getVisibilityCone(const robot_state::RobotSt
   m->vertices[5] = tp.translation().z();
 
   // the points that approximate the base disc
-  for (std::size_t i = 0; i < points->size(); ++i)
+  for (std::size_t i = 0; i < points.size(); ++i)
   {
-    m->vertices[i * 3 + 6] = points->at(i).x();
-    m->vertices[i * 3 + 7] = points->at(i).y();
-    m->vertices[i * 3 + 8] = points->at(i).z();
+    m->vertices[i * 3 + 6] = points[i].x();
+    m->vertices[i * 3 + 7] = points[i].y();
+    m->vertices[i * 3 + 8] = points[i].z();
   }
 
   // add the triangles
-  std::size_t p3 = points->size() * 3;
-  for (std::size_t i = 1; i < points->size(); ++i)
+  std::size_t p3 = points.size() * 3;
+  for (std::size_t i = 1; i < points.size(); ++i)
   {
     // triangle forming a side of the cone, using the sensor origin
     std::size_t i3 = (i - 1) * 3;
@@ -837,11 +877,11 @@ shapes::Mesh* VisibilityConstraint::getVisibilityCone(const robot_state::RobotSt
   }
 
   // last triangles
-  m->triangles[p3 - 3] = points->size() + 1;
+  m->triangles[p3 - 3] = points.size() + 1;
   m->triangles[p3 - 2] = 0;
   m->triangles[p3 - 1] = 2;
   p3 *= 2;
-  m->triangles[p3 - 3] = points->size() + 1;
+  m->triangles[p3 - 3] = points.size() + 1;
   m->triangles[p3 - 2] = 1;
   m->triangles[p3 - 1] = 2;
 
@@ -925,13 +965,13 @@ ConstraintEvaluationResult VisibilityConstraint::decide(const robot_state::Robot
   if (target_radius_ <= std::numeric_limits<double>::epsilon())
     return ConstraintEvaluationResult(true, 0.0);
 
+  const Eigen::Isometry3d& sp =
+      mobile_sensor_frame_ ? state.getFrameTransform(sensor_frame_id_) * sensor_pose_ : sensor_pose_;
+  const Eigen::Isometry3d& tp =
+      mobile_target_frame_ ? state.getFrameTransform(target_frame_id_) * target_pose_ : target_pose_;
+
   if (max_view_angle_ > 0.0 || max_range_angle_ > 0.0)
   {
-    const Eigen::Isometry3d& sp =
-        mobile_sensor_frame_ ? state.getFrameTransform(sensor_frame_id_) * sensor_pose_ : sensor_pose_;
-    const Eigen::Isometry3d& tp =
-        mobile_target_frame_ ? state.getFrameTransform(target_frame_id_) * target_pose_ : target_pose_;
-
     // necessary to do subtraction as SENSOR_Z is 0 and SENSOR_X is 2
     const Eigen::Vector3d& normal2 = sp.rotation().col(2 - sensor_view_direction_);
 
@@ -980,12 +1020,30 @@ ConstraintEvaluationResult VisibilityConstraint::decide(const robot_state::Robot
     }
   }
 
-  shapes::Mesh* m = getVisibilityCone(state);
-  if (!m)
-    return ConstraintEvaluationResult(false, 0.0);
+  // if no link can reach the cone there is no need for the mesh check
+  if (coneClearOfLinkSpheres(state, sp.translation(), tp.translation()))
+  {
+    if (verbose)
+      RCLCPP_INFO(LOGGER, "Visibility constraint satisfied. No link bounding sphere intersects the visibility cone");
+    return ConstraintEvaluationResult(true, 0.0);
+  }
+
+  shapes::ShapeConstPtr cone = cached_cone_;
+  if (cone)
+  {
+    // the cached cone is already in the world, it only needs to follow the frame it is attached to
+    if (!cached_cone_frame_id_.empty())
+      collision_env_->getWorld()->moveShapeInObject("cone", cone, state.getFrameTransform(cached_cone_frame_id_));
+  }
+  else
+  {
+    cone.reset(getVisibilityCone(state));
+    if (!cone)
+      return ConstraintEvaluationResult(false, 0.0);
 
-  // add the visibility cone as an object
-  collision_env_->getWorld()->addToObject("cone", shapes::ShapeConstPtr(m), Eigen::Isometry3d::Identity());
+    // add the visibility cone as an object
+    collision_env_->getWorld()->addToObject("cone", cone, Eigen::Isometry3d::Identity());
+  }
 
   // check for collisions between the robot and the cone
   collision_detection::CollisionRequest req;
@@ -1003,16 +1061,49 @@ ConstraintEvaluationResult VisibilityConstraint::decide(const robot_state::Robot
   if (verbose)
   {
     std::stringstream ss;
-    m->print(ss);
+    cone->print(ss);
     RCLCPP_INFO(LOGGER, "Visibility constraint %ssatisfied. Visibility cone approximation:\n %s",
                 res.collision ? "not " : "", ss.str().c_str());
   }
 
-  collision_env_->getWorld()->removeObject("cone");
+  if (!cached_cone_)
+    collision_env_->getWorld()->removeObject("cone");
 
   return ConstraintEvaluationResult(!res.collision, res.collision ? res.contacts.begin()->second.front().depth : 0.0);
 }
 
+bool VisibilityConstraint::coneClearOfLinkSpheres(const robot_state::RobotState& state, const Eigen::Vector3d& sensor,
+                                                  const Eigen::Vector3d& target) const
+{
+  // Every point of the cone is (1 - l) * sensor + l * d, with d on the target disc and l in [0, 1], so it lies
+  // within l * target_radius_ of the point at arc length s = l * length on the axis segment. Whatever the orientation
+  // of the disc, the cone is thus contained in the union of the balls of radius k * s centered along that segment,
+  // and a sphere that does not reach this union cannot touch the mesh either.
+  const Eigen::Vector3d axis = target - sensor;
+  const double length = axis.norm();
+  if (length <= std::numeric_limits<double>::epsilon())
+    return false;
+  const Eigen::Vector3d dir = axis / length;
+  const double k = target_radius_ / length;
+
+  for (const LinkBoundingSphere& sphere : link_spheres_)
+  {
+    const Eigen::Vector3d center = state.getGlobalLinkTransform(sphere.link) * sphere.center;
+    const Eigen::Vector3d w = center - sensor;
+    const double a = w.dot(dir);
+    const double d = (w - a * dir).norm();
+
+    // minimize |center - x(s)| - k * s over s in [0, length]; the function is convex, so clamping the unconstrained
+    // minimum gives the constrained one
+    double s = k < 1.0 ? a + d * k / sqrt(1.0 - k * k) : length;
+    s = std::min(std::max(s, 0.0), length);
+    const double distance = sqrt((s - a) * (s - a) + d * d) - k * s;
+    if (distance <= sphere.radius)
+      return false;
+  }
+  return true;
+}
+
 bool VisibilityConstraint::decideContact(const collision_detection::Contact& contact) const
 {
   if (contact.body_type_1 == collision_detection::BodyTypes::ROBOT_ATTACHED ||
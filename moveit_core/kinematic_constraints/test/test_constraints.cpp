@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan, E. Gil Jones */
 
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/kinematic_constraints/compiled_kinematic_constraint_set.h>
 #include <gtest/gtest.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
@@ -782,6 +783,52 @@ TEST_F(LoadPlanningModelsPr2, VisibilityConstraintsPR2)
   EXPECT_FALSE(vc.decide(robot_state, true).satisfied);
 }
 
+TEST_F(LoadPlanningModelsPr2, VisibilityConstraintsFixedCone)
+{
+  robot_state::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+  robot_state::Transforms tf(robot_model_->getModelFrame());
+
+  kinematic_constraints::VisibilityConstraint vc(robot_model_);
+  moveit_msgs::msg::VisibilityConstraint vcm;
+
+  // a cone that passes straight through the torso, with both ends fixed
+  vcm.sensor_pose.header.frame_id = "base_footprint";
+  vcm.sensor_pose.pose.position.x = -0.05;
+  vcm.sensor_pose.pose.position.y = -1.0;
+  vcm.sensor_pose.pose.position.z = 0.8;
+  vcm.sensor_pose.pose.orientation.w = 1.0;
+
+  vcm.target_pose.header.frame_id = "base_footprint";
+  vcm.target_pose.pose.position.x = -0.05;
+  vcm.target_pose.pose.position.y = 1.0;
+  vcm.target_pose.pose.position.z = 0.8;
+  vcm.target_pose.pose.orientation.w = 1.0;
+
+  vcm.target_radius = .05;
+  vcm.cone_sides = 10;
+  vcm.sensor_view_direction = moveit_msgs::msg::VisibilityConstraint::SENSOR_Z;
+  vcm.weight = 1.0;
+
+  EXPECT_TRUE(vc.configure(vcm, tf));
+  // the cone is kept between evaluations, so repeated checks must agree
+  EXPECT_FALSE(vc.decide(robot_state).satisfied);
+  EXPECT_FALSE(vc.decide(robot_state).satisfied);
+
+  // far away from the robot, decided without any mesh check
+  vcm.sensor_pose.pose.position.x = 5.0;
+  vcm.target_pose.pose.position.x = 5.0;
+  EXPECT_TRUE(vc.configure(vcm, tf));
+  EXPECT_TRUE(vc.decide(robot_state).satisfied);
+
+  // reconfiguring must replace the previously cached cone
+  vcm.sensor_pose.pose.position.x = -0.05;
+  vcm.target_pose.pose.position.x = -0.05;
+  EXPECT_TRUE(vc.configure(vcm, tf));
+  EXPECT_FALSE(vc.decide(robot_state).satisfied);
+}
+
 TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
 {
   robot_state::RobotState robot_state(robot_model_);
@@ -927,6 +974,135 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetEquality)
   EXPECT_TRUE(kcs2.equal(kcs, .1));
 }
 
+TEST_F(LoadPlanningModelsPr2, CompiledKinematicConstraintSet)
+{
+  // the constraints are derived from a random state, so that states close to it satisfy all of them
+  random_numbers::RandomNumberGenerator rng(42);
+  std::vector<double> center;
+  robot_model_->getVariableRandomPositions(rng, center);
+  robot_state::RobotState robot_state(robot_model_);
+  robot_state.setVariablePositions(center);
+  robot_state.update();
+  robot_state::Transforms tf(robot_model_->getModelFrame());
+
+  moveit_msgs::msg::Constraints constraints;
+  moveit_msgs::msg::JointConstraint jcm;
+  jcm.joint_name = "head_pan_joint";
+  jcm.position = robot_state.getVariablePosition(jcm.joint_name);
+  jcm.tolerance_above = 0.5;
+  jcm.tolerance_below = 0.5;
+  jcm.weight = 1.0;
+  constraints.joint_constraints.push_back(jcm);
+  jcm.joint_name = "r_forearm_roll_joint";  // continuous
+  jcm.position = robot_state.getVariablePosition(jcm.joint_name);
+  jcm.tolerance_above = 1.0;
+  jcm.tolerance_below = 1.0;
+  constraints.joint_constraints.push_back(jcm);
+
+  // a position constraint with a box around the link and a sphere next to it, in a fixed frame
+  const Eigen::Isometry3d& r_wrist = robot_state.getGlobalLinkTransform("r_wrist_roll_link");
+  moveit_msgs::msg::PositionConstraint pcm;
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.link_name = "r_wrist_roll_link";
+  pcm.constraint_region.primitives.resize(2);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  pcm.constraint_region.primitives[0].dimensions = { 0.6, 0.8, 0.6 };
+  pcm.constraint_region.primitives[1].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[1].dimensions = { 0.4 };
+  pcm.constraint_region.primitive_poses.resize(2);
+  pcm.constraint_region.primitive_poses[0].position.x = r_wrist.translation().x() + 0.05;
+  pcm.constraint_region.primitive_poses[0].position.y = r_wrist.translation().y();
+  pcm.constraint_region.primitive_poses[0].position.z = r_wrist.translation().z();
+  pcm.constraint_region.primitive_poses[0].orientation.z = sin(0.3);
+  pcm.constraint_region.primitive_poses[0].orientation.w = cos(0.3);
+  pcm.constraint_region.primitive_poses[1].position.x = r_wrist.translation().x() - 0.5;
+  pcm.constraint_region.primitive_poses[1].position.y = r_wrist.translation().y();
+  pcm.constraint_region.primitive_poses[1].position.z = r_wrist.translation().z();
+  pcm.constraint_region.primitive_poses[1].orientation.w = 1.0;
+  pcm.weight = 1.0;
+  constraints.position_constraints.push_back(pcm);
+
+  // the same regions around the other wrist relative to a mobile frame are evaluated by the original constraint
+  const Eigen::Isometry3d l_wrist = robot_state.getGlobalLinkTransform("torso_lift_link").inverse() *
+                                    robot_state.getGlobalLinkTransform("l_wrist_roll_link");
+  pcm.header.frame_id = "torso_lift_link";
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.constraint_region.primitive_poses[0].position.x = l_wrist.translation().x() + 0.05;
+  pcm.constraint_region.primitive_poses[0].position.y = l_wrist.translation().y();
+  pcm.constraint_region.primitive_poses[0].position.z = l_wrist.translation().z();
+  pcm.constraint_region.primitive_poses[1].position.x = l_wrist.translation().x() - 0.5;
+  pcm.constraint_region.primitive_poses[1].position.y = l_wrist.translation().y();
+  pcm.constraint_region.primitive_poses[1].position.z = l_wrist.translation().z();
+  constraints.position_constraints.push_back(pcm);
+
+  // orientation constraints in a fixed and a mobile frame
+  moveit_msgs::msg::OrientationConstraint ocm;
+  ocm.header.frame_id = robot_model_->getModelFrame();
+  ocm.link_name = "r_wrist_roll_link";
+  ocm.orientation = tf2::toMsg(Eigen::Quaterniond(r_wrist.linear()));
+  ocm.absolute_x_axis_tolerance = 1.0;
+  ocm.absolute_y_axis_tolerance = 1.0;
+  ocm.absolute_z_axis_tolerance = 1.0;
+  ocm.weight = 1.0;
+  constraints.orientation_constraints.push_back(ocm);
+  ocm.header.frame_id = "torso_lift_link";
+  ocm.link_name = "l_wrist_roll_link";
+  ocm.orientation = tf2::toMsg(Eigen::Quaterniond(l_wrist.linear()));
+  constraints.orientation_constraints.push_back(ocm);
+
+  kinematic_constraints::KinematicConstraintSet kcs(robot_model_);
+  EXPECT_TRUE(kcs.add(constraints, tf));
+  kinematic_constraints::CompiledKinematicConstraintSet compiled(kcs);
+  EXPECT_FALSE(compiled.empty());
+  EXPECT_EQ(compiled.getFallbackConstraintCount(), 1u);
+
+  // every other state is a small perturbation of the state the constraints were derived from, the others are random
+  std::vector<robot_state::RobotState> states(500, robot_state);
+  std::vector<const robot_state::RobotState*> batch;
+  std::vector<double> values;
+  std::size_t satisfied = 0;
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    robot_state::RobotState& state = states[i];
+    if (i % 2 == 0)
+    {
+      values = center;
+      for (double& value : values)
+        value += rng.uniformReal(-0.02, 0.02);
+    }
+    else
+      robot_model_->getVariableRandomPositions(rng, values);
+    state.setVariablePositions(values);
+    state.enforceBounds();
+    state.update();
+    batch.push_back(&state);
+
+    kinematic_constraints::ConstraintEvaluationResult expected = kcs.decide(state);
+    kinematic_constraints::ConstraintEvaluationResult actual = compiled.decide(state);
+    EXPECT_EQ(expected.satisfied, actual.satisfied);
+    EXPECT_EQ(expected.distance, actual.distance);
+    satisfied += expected.satisfied;
+  }
+  // make sure both outcomes are covered
+  EXPECT_GT(satisfied, 0u);
+  EXPECT_LT(satisfied, states.size());
+
+  std::vector<kinematic_constraints::ConstraintEvaluationResult> results;
+  compiled.decide(batch, results);
+  ASSERT_EQ(results.size(), states.size());
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    EXPECT_EQ(results[i].satisfied, kcs.decide(states[i]).satisfied);
+    EXPECT_EQ(results[i].distance, kcs.decide(states[i]).distance);
+  }
+
+  // an empty set compiles to an empty program
+  kinematic_constraints::KinematicConstraintSet empty_set(robot_model_);
+  kinematic_constraints::CompiledKinematicConstraintSet empty_compiled(empty_set);
+  EXPECT_TRUE(empty_compiled.empty());
+  EXPECT_TRUE(empty_compiled.decide(robot_state).satisfied);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/profiler/instrumentation.h>
 #include <boost/bind.hpp>
 #include <algorithm>
 #include "rclcpp/rclcpp.hpp"
@@ -52,6 +53,7 @@ bool callPlannerInterfaceSolve(const planning_interface::PlannerManager* planner
                                const planning_interface::MotionPlanRequest& req,
                                planning_interface::MotionPlanResponse& res)
 {
+  MOVEIT_INSTRUMENT_SCOPE("planning_request_adapter/planner_solve");
   planning_interface::PlanningContextPtr context = planner->getPlanningContext(planning_scene, req, res.error_code_);
   if (context)
     return context->solve(res);
@@ -135,6 +137,7 @@ bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::Planner
                                                planning_interface::MotionPlanResponse& res,
                                                std::vector<std::size_t>& added_path_index) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("planning_request_adapter/chain");
   // if there are no adapters, run the planner directly
   if (adapters_.empty())
   {
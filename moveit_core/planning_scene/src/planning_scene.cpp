@@ -44,6 +44,7 @@
 #include <moveit/exceptions/exceptions.h>
 #include <moveit/robot_state/attached_body.h>
 #include <moveit/utils/message_checks.h>
+#include <moveit/profiler/instrumentation.h>
 #include <octomap_msgs/conversions.h>
 #include <tf2_eigen/tf2_eigen.h>
 #include <memory>
@@ -487,6 +488,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
                                    collision_detection::CollisionResult& res,
                                    const robot_state::RobotState& robot_state) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("planning_scene/check_collision");
   // check collision with the world using the padded version
   getCollisionEnv()->checkRobotCollision(req, res, robot_state, getAllowedCollisionMatrix());
 
@@ -511,6 +513,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
                                    const robot_state::RobotState& robot_state,
                                    const collision_detection::AllowedCollisionMatrix& acm) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("planning_scene/check_collision");
   // check collision with the world using the padded version
   getCollisionEnv()->checkRobotCollision(req, res, robot_state, acm);
 
@@ -2123,6 +2126,7 @@ bool PlanningScene::isStateValid(const robot_state::RobotState& state,
                                  const kinematic_constraints::KinematicConstraintSet& constr, const std::string& group,
                                  bool verbose) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("planning_scene/is_state_valid");
   if (isStateColliding(state, group, verbose))
     return false;
   if (!isStateFeasible(state, verbose))
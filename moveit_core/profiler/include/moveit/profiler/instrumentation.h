@@ -0,0 +1,197 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace tools
+{
+/** \brief Low overhead latency and event recording for hot code paths.
+
+    Unlike Profiler, recording does not take any lock: every thread records into its own counters and histograms,
+    which are only merged when statistics are requested. Code paths are identified by probes, registered once by name
+    (typically through the MOVEIT_INSTRUMENT_SCOPE macro). Latencies are kept in log-linear histograms with a relative
+    bucket width of 1/8, from which percentiles are computed. Recording is disabled by default; when disabled, a probe
+    costs a single relaxed atomic load. It can be enabled at runtime with setEnabled() or at startup by setting the
+    environment variable MOVEIT_INSTRUMENTATION=1. */
+class Instrumentation
+{
+public:
+  /// Maximum number of probes that can be registered
+  static constexpr std::size_t MAX_PROBES = 256;
+  /// Number of histogram buckets per power of two
+  static constexpr std::size_t SUB_BUCKETS = 8;
+  /// Number of histogram buckets; durations longer than 2^40 ns (about 18 minutes) are counted in the last one
+  static constexpr std::size_t BUCKETS = 41 * SUB_BUCKETS;
+
+  /// Identifies a registered probe
+  typedef std::size_t ProbeId;
+
+  /// Merged statistics of a probe over all threads
+  struct ProbeStatistics
+  {
+    std::string name;
+    /// Number of events counted with count()
+    std::uint64_t events = 0;
+    /// Number of latencies recorded
+    std::uint64_t samples = 0;
+    double total_ns = 0.0;
+    double min_ns = 0.0;
+    double max_ns = 0.0;
+    double mean_ns = 0.0;
+    double p50_ns = 0.0;
+    double p90_ns = 0.0;
+    double p99_ns = 0.0;
+    double p999_ns = 0.0;
+    /// Number of latencies per histogram bucket, see bucketLowerBound()
+    std::vector<std::uint64_t> histogram;
+  };
+
+  /** \brief Return the instance used by MOVEIT_INSTRUMENT_SCOPE */
+  static Instrumentation& instance();
+
+  Instrumentation();
+  ~Instrumentation();
+  Instrumentation(const Instrumentation&) = delete;
+  Instrumentation& operator=(const Instrumentation&) = delete;
+
+  /** \brief Enable or disable recording */
+  void setEnabled(bool enabled)
+  {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  bool isEnabled() const
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /** \brief Get the id of the probe named \e name, registering it if needed. This takes a lock, so the id should be
+      stored rather than looked up for every recording. Returns MAX_PROBES if too many probes are registered; recording
+      for that id is ignored. */
+  ProbeId registerProbe(const std::string& name);
+
+  /** \brief Record a latency of \e nanoseconds for \e probe in the calling thread */
+  void recordLatency(ProbeId probe, std::uint64_t nanoseconds);
+
+  /** \brief Count \e times events for \e probe in the calling thread */
+  void count(ProbeId probe, std::uint64_t times = 1);
+
+  /** \brief Get the statistics of all probes with at least one event or sample, merged over all threads */
+  std::vector<ProbeStatistics> getStatistics() const;
+
+  /** \brief Reset all counters and histograms. Recordings that happen concurrently may be lost. */
+  void reset();
+
+  /** \brief Write the statistics as a JSON array of objects, one per probe */
+  void writeJSON(std::ostream& out, bool include_histograms = false) const;
+
+  /** \brief Write the statistics as a human readable table */
+  void writeTable(std::ostream& out) const;
+
+  /** \brief The smallest duration in nanoseconds counted in histogram bucket \e bucket */
+  static std::uint64_t bucketLowerBound(std::size_t bucket);
+
+  /** \brief The histogram bucket counting a duration of \e nanoseconds */
+  static std::size_t bucketIndex(std::uint64_t nanoseconds);
+
+  struct ThreadData;
+  struct Impl;
+
+private:
+  ThreadData& threadData();
+
+  std::shared_ptr<Impl> impl_;
+  std::atomic<bool> enabled_;
+};
+
+/** \brief Records the time between construction and destruction for a probe, if instrumentation is enabled */
+class ScopedLatency
+{
+public:
+  ScopedLatency(Instrumentation::ProbeId probe, Instrumentation& instrumentation = Instrumentation::instance())
+    : instrumentation_(instrumentation), probe_(probe), enabled_(instrumentation.isEnabled())
+  {
+    if (enabled_)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedLatency()
+  {
+    if (enabled_)
+      instrumentation_.recordLatency(probe_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::steady_clock::now() - start_)
+                                                 .count());
+  }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+  Instrumentation& instrumentation_;
+  Instrumentation::ProbeId probe_;
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_;
+};
+}  // namespace tools
+}  // namespace moveit
+
+#define MOVEIT_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define MOVEIT_INSTRUMENT_CONCAT(a, b) MOVEIT_INSTRUMENT_CONCAT_IMPL(a, b)
+
+/** \brief Record the latency of the enclosing scope under the probe \e name (a string literal) */
+#define MOVEIT_INSTRUMENT_SCOPE(name)                                                                                  \
+  static const moveit::tools::Instrumentation::ProbeId MOVEIT_INSTRUMENT_CONCAT(moveit_instrument_probe_, __LINE__) =  \
+      moveit::tools::Instrumentation::instance().registerProbe(name);                                                  \
+  moveit::tools::ScopedLatency MOVEIT_INSTRUMENT_CONCAT(moveit_instrument_scope_, __LINE__)(                           \
+      MOVEIT_INSTRUMENT_CONCAT(moveit_instrument_probe_, __LINE__))
+
+/** \brief Count an event under the probe \e name (a string literal), if instrumentation is enabled */
+#define MOVEIT_INSTRUMENT_COUNT(name)                                                                                  \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    static const moveit::tools::Instrumentation::ProbeId moveit_instrument_probe =                                     \
+        moveit::tools::Instrumentation::instance().registerProbe(name);                                                \
+    if (moveit::tools::Instrumentation::instance().isEnabled())                                                        \
+      moveit::tools::Instrumentation::instance().count(moveit_instrument_probe);                                       \
+  } while (false)
@@ -0,0 +1,389 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/profiler/instrumentation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+namespace moveit
+{
+namespace tools
+{
+namespace
+{
+/// Counters of a probe in a single thread. Only the owning thread writes them, so plain loads and stores suffice.
+struct ProbeData
+{
+  std::atomic<std::uint64_t> events{ 0 };
+  std::atomic<std::uint64_t> samples{ 0 };
+  std::atomic<std::uint64_t> total{ 0 };
+  std::atomic<std::uint64_t> min{ std::numeric_limits<std::uint64_t>::max() };
+  std::atomic<std::uint64_t> max{ 0 };
+  std::atomic<std::uint64_t> buckets[Instrumentation::BUCKETS] = {};
+
+  void clear()
+  {
+    events.store(0, std::memory_order_relaxed);
+    samples.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+    for (std::atomic<std::uint64_t>& bucket : buckets)
+      bucket.store(0, std::memory_order_relaxed);
+  }
+};
+
+inline void increment(std::atomic<std::uint64_t>& value, std::uint64_t amount)
+{
+  value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+}  // namespace
+
+/// The probes recorded by one thread; ProbeData is only allocated for the probes the thread actually uses
+struct Instrumentation::ThreadData
+{
+  std::atomic<ProbeData*> probes[MAX_PROBES] = {};
+
+  ~ThreadData()
+  {
+    for (std::atomic<ProbeData*>& probe : probes)
+      delete probe.load();
+  }
+
+  ProbeData& probe(ProbeId id)
+  {
+    ProbeData* data = probes[id].load(std::memory_order_relaxed);
+    if (!data)
+    {
+      data = new ProbeData();
+      probes[id].store(data, std::memory_order_release);
+    }
+    return *data;
+  }
+};
+
+struct Instrumentation::Impl
+{
+  mutable std::mutex lock;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, ProbeId> ids;
+  std::vector<std::shared_ptr<ThreadData>> threads;
+  // Statistics of threads that exited
+  std::vector<ProbeStatistics> retired;
+};
+
+namespace
+{
+/// Releases the data of a thread when it exits, keeping its statistics
+struct ThreadRegistration
+{
+  std::weak_ptr<Instrumentation::Impl> impl;
+  std::shared_ptr<Instrumentation::ThreadData> data;
+};
+
+void mergeInto(const Instrumentation::ThreadData& data, std::vector<Instrumentation::ProbeStatistics>& statistics)
+{
+  for (std::size_t id = 0; id < statistics.size(); ++id)
+  {
+    const ProbeData* probe = data.probes[id].load(std::memory_order_acquire);
+    if (!probe)
+      continue;
+    Instrumentation::ProbeStatistics& s = statistics[id];
+    s.histogram.resize(Instrumentation::BUCKETS, 0);
+    s.events += probe->events.load(std::memory_order_relaxed);
+    std::uint64_t samples = probe->samples.load(std::memory_order_relaxed);
+    if (samples == 0)
+      continue;
+    double min = probe->min.load(std::memory_order_relaxed);
+    double max = probe->max.load(std::memory_order_relaxed);
+    s.min_ns = s.samples == 0 ? min : std::min(s.min_ns, min);
+    s.max_ns = s.samples == 0 ? max : std::max(s.max_ns, max);
+    s.samples += samples;
+    s.total_ns += probe->total.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < Instrumentation::BUCKETS; ++i)
+      s.histogram[i] += probe->buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+void mergeInto(const std::vector<Instrumentation::ProbeStatistics>& source,
+               std::vector<Instrumentation::ProbeStatistics>& statistics)
+{
+  for (std::size_t id = 0; id < source.size() && id < statistics.size(); ++id)
+  {
+    const Instrumentation::ProbeStatistics& r = source[id];
+    Instrumentation::ProbeStatistics& s = statistics[id];
+    s.histogram.resize(Instrumentation::BUCKETS, 0);
+    s.events += r.events;
+    if (r.samples == 0)
+      continue;
+    s.min_ns = s.samples == 0 ? r.min_ns : std::min(s.min_ns, r.min_ns);
+    s.max_ns = s.samples == 0 ? r.max_ns : std::max(s.max_ns, r.max_ns);
+    s.samples += r.samples;
+    s.total_ns += r.total_ns;
+    for (std::size_t i = 0; i < r.histogram.size(); ++i)
+      s.histogram[i] += r.histogram[i];
+  }
+}
+
+/// Duration below which a fraction \e q of the samples fall, interpolated within the bucket and clamped to min/max
+double percentile(const Instrumentation::ProbeStatistics& s, double q)
+{
+  double target = q * s.samples;
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < s.histogram.size(); ++i)
+  {
+    if (s.histogram[i] == 0 || seen + s.histogram[i] < target)
+    {
+      seen += s.histogram[i];
+      continue;
+    }
+    double lower = Instrumentation::bucketLowerBound(i);
+    double upper = i + 1 < Instrumentation::BUCKETS ? Instrumentation::bucketLowerBound(i + 1) : s.max_ns;
+    double value = lower + (upper - lower) * (target - seen) / s.histogram[i];
+    return std::max(s.min_ns, std::min(s.max_ns, value));
+  }
+  return s.max_ns;
+}
+}  // namespace
+
+constexpr std::size_t Instrumentation::MAX_PROBES;
+constexpr std::size_t Instrumentation::SUB_BUCKETS;
+constexpr std::size_t Instrumentation::BUCKETS;
+
+Instrumentation& Instrumentation::instance()
+{
+  static Instrumentation instrumentation;
+  return instrumentation;
+}
+
+Instrumentation::Instrumentation() : impl_(std::make_shared<Impl>()), enabled_(false)
+{
+  const char* env = std::getenv("MOVEIT_INSTRUMENTATION");
+  if (env && std::string(env) == "1")
+    setEnabled(true);
+}
+
+Instrumentation::~Instrumentation() = default;
+
+Instrumentation::ProbeId Instrumentation::registerProbe(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(impl_->lock);
+  auto it = impl_->ids.find(name);
+  if (it != impl_->ids.end())
+    return it->second;
+  if (impl_->names.size() >= MAX_PROBES)
+    return MAX_PROBES;
+  ProbeId id = impl_->names.size();
+  impl_->names.push_back(name);
+  impl_->ids[name] = id;
+  return id;
+}
+
+Instrumentation::ThreadData& Instrumentation::threadData()
+{
+  // The registrations of a thread are released when it exits, which moves its statistics to the retired ones
+  struct Registrations
+  {
+    std::vector<ThreadRegistration> entries;
+    ~Registrations()
+    {
+      for (ThreadRegistration& entry : entries)
+        if (std::shared_ptr<Impl> impl = entry.impl.lock())
+        {
+          std::lock_guard<std::mutex> lock(impl->lock);
+          impl->retired.resize(impl->names.size());
+          mergeInto(*entry.data, impl->retired);
+          impl->threads.erase(std::remove(impl->threads.begin(), impl->threads.end(), entry.data),
+                              impl->threads.end());
+        }
+    }
+  };
+  static thread_local Registrations registrations;
+  static thread_local const Impl* last_impl = nullptr;
+  static thread_local ThreadData* last_data = nullptr;
+
+  if (last_impl == impl_.get())
+    return *last_data;
+  for (ThreadRegistration& entry : registrations.entries)
+    if (entry.impl.lock() == impl_)
+    {
+      last_impl = impl_.get();
+      last_data = entry.data.get();
+      return *last_data;
+    }
+
+  ThreadRegistration entry;
+  entry.impl = impl_;
+  entry.data = std::make_shared<ThreadData>();
+  {
+    std::lock_guard<std::mutex> lock(impl_->lock);
+    impl_->threads.push_back(entry.data);
+  }
+  registrations.entries.push_back(entry);
+  last_impl = impl_.get();
+  last_data = entry.data.get();
+  return *last_data;
+}
+
+void Instrumentation::recordLatency(ProbeId probe, std::uint64_t nanoseconds)
+{
+  if (probe >= MAX_PROBES)
+    return;
+  ProbeData& data = threadData().probe(probe);
+  increment(data.samples, 1);
+  increment(data.total, nanoseconds);
+  if (nanoseconds < data.min.load(std::memory_order_relaxed))
+    data.min.store(nanoseconds, std::memory_order_relaxed);
+  if (nanoseconds > data.max.load(std::memory_order_relaxed))
+    data.max.store(nanoseconds, std::memory_order_relaxed);
+  increment(data.buckets[bucketIndex(nanoseconds)], 1);
+}
+
+void Instrumentation::count(ProbeId probe, std::uint64_t times)
+{
+  if (probe >= MAX_PROBES)
+    return;
+  increment(threadData().probe(probe).events, times);
+}
+
+std::vector<Instrumentation::ProbeStatistics> Instrumentation::getStatistics() const
+{
+  std::vector<ProbeStatistics> statistics;
+  {
+    std::lock_guard<std::mutex> lock(impl_->lock);
+    statistics.resize(impl_->names.size());
+    for (std::size_t id = 0; id < statistics.size(); ++id)
+      statistics[id].name = impl_->names[id];
+    for (const std::shared_ptr<ThreadData>& data : impl_->threads)
+      mergeInto(*data, statistics);
+    mergeInto(impl_->retired, statistics);
+  }
+
+  std::vector<ProbeStatistics> result;
+  for (ProbeStatistics& s : statistics)
+  {
+    if (s.events == 0 && s.samples == 0)
+      continue;
+    if (s.samples > 0)
+    {
+      s.mean_ns = s.total_ns / s.samples;
+      s.p50_ns = percentile(s, 0.5);
+      s.p90_ns = percentile(s, 0.9);
+      s.p99_ns = percentile(s, 0.99);
+      s.p999_ns = percentile(s, 0.999);
+    }
+    result.push_back(std::move(s));
+  }
+  return result;
+}
+
+void Instrumentation::reset()
+{
+  std::lock_guard<std::mutex> lock(impl_->lock);
+  for (const std::shared_ptr<ThreadData>& data : impl_->threads)
+    for (std::atomic<ProbeData*>& probe : data->probes)
+      if (ProbeData* probe_data = probe.load(std::memory_order_acquire))
+        probe_data->clear();
+  impl_->retired.clear();
+}
+
+void Instrumentation::writeJSON(std::ostream& out, bool include_histograms) const
+{
+  std::streamsize precision = out.precision(15);
+  out << "[";
+  bool first = true;
+  for (const ProbeStatistics& s : getStatistics())
+  {
+    out << (first ? "" : ",") << "\n  {\"name\": \"" << s.name << "\", \"events\": " << s.events
+        << ", \"samples\": " << s.samples << ", \"total_ns\": " << s.total_ns << ", \"min_ns\": " << s.min_ns
+        << ", \"max_ns\": " << s.max_ns << ", \"mean_ns\": " << s.mean_ns << ", \"p50_ns\": " << s.p50_ns
+        << ", \"p90_ns\": " << s.p90_ns << ", \"p99_ns\": " << s.p99_ns << ", \"p999_ns\": " << s.p999_ns;
+    if (include_histograms)
+    {
+      // Only the non-empty buckets, as [lower bound in ns, count] pairs
+      out << ", \"histogram\": [";
+      bool first_bucket = true;
+      for (std::size_t i = 0; i < s.histogram.size(); ++i)
+        if (s.histogram[i] > 0)
+        {
+          out << (first_bucket ? "" : ", ") << "[" << bucketLowerBound(i) << ", " << s.histogram[i] << "]";
+          first_bucket = false;
+        }
+      out << "]";
+    }
+    out << "}";
+    first = false;
+  }
+  out << "\n]\n";
+  out.precision(precision);
+}
+
+void Instrumentation::writeTable(std::ostream& out) const
+{
+  out << std::left << std::setw(48) << "probe" << std::right << std::setw(12) << "events" << std::setw(12)
+      << "samples" << std::setw(12) << "mean [us]" << std::setw(12) << "p50 [us]" << std::setw(12) << "p99 [us]"
+      << std::setw(12) << "max [us]" << std::endl;
+  for (const ProbeStatistics& s : getStatistics())
+    out << std::left << std::setw(48) << s.name << std::right << std::setw(12) << s.events << std::setw(12)
+        << s.samples << std::fixed << std::setprecision(2) << std::setw(12) << s.mean_ns / 1000.0 << std::setw(12)
+        << s.p50_ns / 1000.0 << std::setw(12) << s.p99_ns / 1000.0 << std::setw(12) << s.max_ns / 1000.0
+        << std::defaultfloat << std::endl;
+}
+
+std::uint64_t Instrumentation::bucketLowerBound(std::size_t bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+  std::size_t shift = bucket / SUB_BUCKETS - 1;
+  return static_cast<std::uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+std::size_t Instrumentation::bucketIndex(std::uint64_t nanoseconds)
+{
+  if (nanoseconds < SUB_BUCKETS)
+    return nanoseconds;
+  // Position of the highest bit; SUB_BUCKETS is 2^3, so values in [2^e, 2^(e+1)) are split into 8 buckets
+  std::size_t exponent = 63 - __builtin_clzll(nanoseconds);
+  std::size_t shift = exponent - 3;
+  std::size_t bucket = (shift + 1) * SUB_BUCKETS + ((nanoseconds >> shift) & (SUB_BUCKETS - 1));
+  return std::min(bucket, BUCKETS - 1);
+}
+}  // namespace tools
+}  // namespace moveit
@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/profiler/instrumentation.h>
+#include <gtest/gtest.h>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+using moveit::tools::Instrumentation;
+
+TEST(Instrumentation, BucketBounds)
+{
+  for (std::size_t bucket = 0; bucket < Instrumentation::BUCKETS; ++bucket)
+    EXPECT_EQ(Instrumentation::bucketIndex(Instrumentation::bucketLowerBound(bucket)), bucket);
+  for (std::uint64_t ns : { 1ull, 9ull, 1000ull, 123456ull, 1000000000ull })
+  {
+    std::size_t bucket = Instrumentation::bucketIndex(ns);
+    EXPECT_LE(Instrumentation::bucketLowerBound(bucket), ns);
+    EXPECT_GT(Instrumentation::bucketLowerBound(bucket + 1), ns);
+  }
+  EXPECT_EQ(Instrumentation::bucketIndex(std::numeric_limits<std::uint64_t>::max()), Instrumentation::BUCKETS - 1);
+}
+
+TEST(Instrumentation, RegisterProbe)
+{
+  Instrumentation instrumentation;
+  Instrumentation::ProbeId a = instrumentation.registerProbe("a");
+  EXPECT_EQ(instrumentation.registerProbe("b"), a + 1);
+  EXPECT_EQ(instrumentation.registerProbe("a"), a);
+  for (std::size_t i = 2; i < Instrumentation::MAX_PROBES; ++i)
+    EXPECT_LT(instrumentation.registerProbe(std::to_string(i)), Instrumentation::MAX_PROBES);
+  EXPECT_EQ(instrumentation.registerProbe("full"), Instrumentation::MAX_PROBES);
+  // recording for an invalid probe is ignored
+  instrumentation.recordLatency(Instrumentation::MAX_PROBES, 10);
+  EXPECT_TRUE(instrumentation.getStatistics().empty());
+}
+
+TEST(Instrumentation, Statistics)
+{
+  Instrumentation instrumentation;
+  Instrumentation::ProbeId probe = instrumentation.registerProbe("probe");
+  for (std::uint64_t i = 1; i <= 1000; ++i)
+    instrumentation.recordLatency(probe, i * 1000);
+  instrumentation.count(probe, 3);
+
+  std::vector<Instrumentation::ProbeStatistics> statistics = instrumentation.getStatistics();
+  ASSERT_EQ(statistics.size(), 1u);
+  const Instrumentation::ProbeStatistics& s = statistics[0];
+  EXPECT_EQ(s.name, "probe");
+  EXPECT_EQ(s.events, 3u);
+  EXPECT_EQ(s.samples, 1000u);
+  EXPECT_DOUBLE_EQ(s.min_ns, 1000.0);
+  EXPECT_DOUBLE_EQ(s.max_ns, 1000000.0);
+  EXPECT_DOUBLE_EQ(s.mean_ns, 500500.0);
+  // percentiles are accurate up to the bucket width
+  EXPECT_NEAR(s.p50_ns, 500000.0, 500000.0 / Instrumentation::SUB_BUCKETS);
+  EXPECT_NEAR(s.p90_ns, 900000.0, 900000.0 / Instrumentation::SUB_BUCKETS);
+  EXPECT_NEAR(s.p99_ns, 990000.0, 990000.0 / Instrumentation::SUB_BUCKETS);
+
+  instrumentation.reset();
+  EXPECT_TRUE(instrumentation.getStatistics().empty());
+}
+
+TEST(Instrumentation, Threads)
+{
+  Instrumentation instrumentation;
+  Instrumentation::ProbeId probe = instrumentation.registerProbe("probe");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&instrumentation, probe] {
+      for (int i = 0; i < 1000; ++i)
+        instrumentation.recordLatency(probe, 100);
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // the statistics of exited threads are kept
+  std::vector<Instrumentation::ProbeStatistics> statistics = instrumentation.getStatistics();
+  ASSERT_EQ(statistics.size(), 1u);
+  EXPECT_EQ(statistics[0].samples, 4000u);
+  EXPECT_DOUBLE_EQ(statistics[0].total_ns, 400000.0);
+}
+
+TEST(Instrumentation, ScopedLatency)
+{
+  Instrumentation instrumentation;
+  Instrumentation::ProbeId probe = instrumentation.registerProbe("scope");
+  {
+    moveit::tools::ScopedLatency latency(probe, instrumentation);
+  }
+  EXPECT_TRUE(instrumentation.getStatistics().empty());
+
+  instrumentation.setEnabled(true);
+  {
+    moveit::tools::ScopedLatency latency(probe, instrumentation);
+  }
+  ASSERT_EQ(instrumentation.getStatistics().size(), 1u);
+  EXPECT_EQ(instrumentation.getStatistics()[0].samples, 1u);
+
+  std::stringstream json;
+  instrumentation.writeJSON(json, true);
+  EXPECT_NE(json.str().find("\"name\": \"scope\""), std::string::npos);
+  EXPECT_NE(json.str().find("\"histogram\""), std::string::npos);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
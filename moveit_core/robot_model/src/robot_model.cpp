@@ -39,6 +39,8 @@
 #include <geometric_shapes/shape_operations.h>
 #include <boost/math/constants/constants.hpp>
 #include <moveit/profiler/profiler.h>
+#include <moveit/utils/geometry_cache.h>
+#include <resource_retriever/retriever.hpp>
 #include <algorithm>
 #include <limits>
 #include <queue>
@@ -53,6 +55,64 @@ namespace core
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_model.robot_model");
 
+namespace
+{
+const std::string MESH_CACHE_KIND = "mesh";
+
+// Load a mesh resource, reusing the result of a previous import of identical data from the geometry cache.
+// The resource is still retrieved to compute the key, but parsing it with assimp is skipped on a cache hit.
+shapes::Mesh* createMeshFromResourceCached(const std::string& resource, const Eigen::Vector3d& scale)
+{
+  const GeometryCache& cache = GeometryCache::getGlobal();
+  if (!cache.isEnabled())
+    return shapes::createMeshFromResource(resource, scale);
+
+  resource_retriever::Retriever retriever;
+  resource_retriever::MemoryResource res;
+  try
+  {
+    res = retriever.get(resource);
+  }
+  catch (resource_retriever::Exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "%s", e.what());
+    return nullptr;
+  }
+  if (res.size == 0)
+  {
+    RCLCPP_WARN(LOGGER, "Retrieved empty mesh for resource '%s'", resource.c_str());
+    return nullptr;
+  }
+
+  // same format hint as shapes::createMeshFromResource()
+  std::string hint;
+  std::size_t pos = resource.find_last_of('.');
+  if (pos != std::string::npos)
+  {
+    hint = resource.substr(pos + 1);
+    std::transform(hint.begin(), hint.end(), hint.begin(), ::tolower);
+    if (hint.find("stl") != std::string::npos)
+      hint = "stl";
+  }
+
+  GeometryHasher hasher;
+  hasher.add(res.data.get(), res.size);
+  hasher.add(hint);
+  hasher.add(scale.data(), 3 * sizeof(double));
+  const std::uint64_t key = hasher.get();
+
+  if (GeometryCache::EntryConstPtr entry = cache.load(MESH_CACHE_KIND, key))
+    if (shapes::Mesh* mesh = deserializeMesh(entry->data(), entry->size()))
+      return mesh;
+
+  shapes::Mesh* mesh =
+      shapes::createMeshFromBinary(reinterpret_cast<const char*>(res.data.get()), res.size, scale, hint);
+  if (mesh)
+    cache.store(MESH_CACHE_KIND, key, serializeMesh(*mesh));
+  return mesh;
+}
+}  // namespace
+
 RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model)
 {
   root_joint_ = nullptr;
@@ -1071,7 +1131,7 @@ shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
       if (!mesh->filename.empty())
       {
         Eigen::Vector3d scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
-        shapes::Mesh* m = shapes::createMeshFromResource(mesh->filename, scale);
+        shapes::Mesh* m = createMeshFromResourceCached(mesh->filename, scale);
         new_shape = m;
       }
     }
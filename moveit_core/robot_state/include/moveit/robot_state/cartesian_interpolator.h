@@ -157,6 +157,34 @@ public:
                        const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
 
+  /** \brief Compute the joint values of a general Cartesian path, solving IK for blocks of consecutive poses in
+     parallel.
+
+     The path is specified and interpolated as for computeCartesianPath() with \e waypoints. All intermediate poses are
+     computed upfront and split into \e num_threads contiguous blocks (the hardware concurrency if 0). Each block is
+     solved by its own thread with the usual single IK attempt per pose, seeded with the previous solution in the block.
+     The first block starts from \e start_state; every other block starts from a solution for the last pose of the
+     previous block, found beforehand by chaining IK over the block boundaries. The blocks are then stitched in order:
+     a block whose first solution is not continuous with the end of the path accepted so far (or that failed part way)
+     is solved again sequentially from there. Joint space jumps are checked on the stitched path afterwards, as in
+     checkJointSpaceJump().
+
+     Instead of one RobotState per point, \e traj receives the values of the variables of \e group, with
+     group->getVariableCount() values per point, starting with the values of \e start_state. At the end of the call,
+     \e start_state is set to the last point of the path.
+
+     Every thread uses its own kinematics solver instance, allocated with the solver allocator of the group; if that
+     is not possible, the path is solved sequentially. \e validCallback is called from several threads at once and
+     needs to be thread-safe.
+
+     @return The fraction of the path that was computed, as for computeCartesianPath() */
+  static double computeCartesianPathParallel(
+      RobotState* start_state, const JointModelGroup* group, std::vector<double>& traj, const LinkModel* link,
+      const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame, const MaxEEFStep& max_step,
+      const JumpThreshold& jump_threshold, unsigned int num_threads = 0,
+      const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+
   /** \brief Tests joint space jumps of a trajectory.
 
      If \e jump_threshold_factor is non-zero, we test for relative jumps.
@@ -988,6 +988,16 @@ as the new values that correspond to the group */
                  double timeout = 0.0, const GroupStateValidityCallbackFn& constraint = GroupStateValidityCallbackFn(),
                  const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
 
+  /** \brief Same as above, but solve with \e solver instead of the solver instance of \e group. The solver instance
+      of a group is shared by all states and must not be used by several threads at once; concurrent callers can
+      instead pass their own instance, allocated with the solver allocator of the group.
+      @param solver A solver allocated for \e group; the joint order of the solver instance of \e group is assumed */
+  bool setFromIK(const JointModelGroup* group, const kinematics::KinematicsBaseConstPtr& solver,
+                 const EigenSTL::vector_Isometry3d& poses, const std::vector<std::string>& tips,
+                 const std::vector<std::vector<double> >& consistency_limits, double timeout = 0.0,
+                 const GroupStateValidityCallbackFn& constraint = GroupStateValidityCallbackFn(),
+                 const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+
   /**
       \brief setFromIK for multiple poses and tips (end effectors) when no solver exists for the jmg that can solver for
       non-chain kinematics. In this case, we divide the group into subgroups and do IK solving individually
@@ -1225,9 +1235,20 @@ as the new values that correspond to the group */
   void updateCollisionBodyTransforms();
 
   /** \brief Update the reference frame transforms for links. This call is needed before using the transforms of links
-   * for coordinate transforms. */
+   * for coordinate transforms. Only links downstream of joints that changed since the last update are recomputed. */
   void updateLinkTransforms();
 
+  /** \brief Update the reference frame transforms of \e links only, together with the ancestors they depend on.
+      Dirty links in other branches are left for a later update, so the state remains dirty; the transforms of the
+      given links can then be read through the const getGlobalLinkTransform(). */
+  void updateLinkTransforms(const std::vector<const LinkModel*>& links);
+
+  /** \brief Update the reference frame transforms of the links of \e group only (e.g. up to its end-effector). */
+  void updateLinkTransforms(const JointModelGroup* group)
+  {
+    updateLinkTransforms(group->getLinkModels());
+  }
+
   /** \brief Update all transforms. */
   void update(bool force = false);
 
@@ -1293,7 +1314,7 @@ as the new values that correspond to the group */
 
   const Eigen::Isometry3d& getGlobalLinkTransform(const LinkModel* link) const
   {
-    BOOST_VERIFY(checkLinkTransforms());
+    BOOST_VERIFY(checkLinkTransform(link));
     return global_link_transforms_[link->getLinkIndex()];
   }
 
@@ -1662,6 +1683,7 @@ private:
   void markDirtyJointTransforms(const JointModel* joint)
   {
     dirty_joint_transforms_[joint->getJointIndex()] = 1;
+    dirty_link_flags_[joint->getChildLinkModel()->getLinkIndex()] = 1;
     dirty_link_transforms_ =
         dirty_link_transforms_ == NULL ? joint : robot_model_->getCommonRoot(dirty_link_transforms_, joint);
   }
@@ -1670,12 +1692,18 @@ private:
   {
     const std::vector<const JointModel*>& jm = group->getActiveJointModels();
     for (std::size_t i = 0; i < jm.size(); ++i)
+    {
       dirty_joint_transforms_[jm[i]->getJointIndex()] = 1;
+      dirty_link_flags_[jm[i]->getChildLinkModel()->getLinkIndex()] = 1;
+    }
     dirty_link_transforms_ = dirty_link_transforms_ == NULL ?
                                  group->getCommonRoot() :
                                  robot_model_->getCommonRoot(dirty_link_transforms_, group->getCommonRoot());
   }
 
+  /** \brief Mark all joint and link transforms dirty, e.g. after all variables changed */
+  void markAllTransformsDirty();
+
   void markVelocity();
   void markAcceleration();
   void markEffort();
@@ -1700,10 +1728,11 @@ private:
       const int fvi = mim[i]->getFirstVariableIndex();
       position_[fvi] =
           mim[i]->getMimicFactor() * position_[mim[i]->getMimic()->getFirstVariableIndex()] + mim[i]->getMimicOffset();
-      // Only mark joint transform dirty, but not the associated link transform
+      // Only flag the joint and its child link, but do not extend dirty_link_transforms_
       // as this function is always used in combination of
       // updateMimicJoint(group->getMimicJointModels()) + markDirtyJointTransforms(group);
       dirty_joint_transforms_[mim[i]->getJointIndex()] = 1;
+      dirty_link_flags_[mim[i]->getChildLinkModel()->getLinkIndex()] = 1;
     }
   }
 
@@ -1721,6 +1750,15 @@ private:
 
   void updateLinkTransformsInternal(const JointModel* start);
 
+  /** \brief Recompute the global transform of \e link from the one of its parent link */
+  void updateGlobalLinkTransform(const LinkModel* link);
+
+  /** \brief Recompute the descendant links of \e start that are flagged dirty or whose parent was recomputed */
+  void updateDirtyLinkTransforms(const JointModel* start);
+
+  /** \brief Bring \e link and its ancestors up to date; returns true if the transform of \e link was recomputed */
+  bool updateLinkTransformChain(const LinkModel* link);
+
   void getMissingKeys(const std::map<std::string, double>& variable_map,
                       std::vector<std::string>& missing_variables) const;
   void getStateTreeJointString(std::ostream& ss, const JointModel* jm, const std::string& pfx0, bool last) const;
@@ -1731,6 +1769,9 @@ private:
   /** \brief This function is only called in debug mode */
   bool checkLinkTransforms() const;
 
+  /** \brief This function is only called in debug mode */
+  bool checkLinkTransform(const LinkModel* link) const;
+
   /** \brief This function is only called in debug mode */
   bool checkCollisionTransforms() const;
 
@@ -1753,6 +1794,12 @@ private:
   Eigen::Isometry3d* global_collision_body_transforms_;  // this points to an element in transforms_, so it is aligned
   unsigned char* dirty_joint_transforms_;
 
+  // per link, indexed by link index: whether the global transform (resp. the collision body transforms) of the link
+  // must be recomputed; all flagged links are descendants of dirty_link_transforms_
+  // (resp. dirty_collision_body_transforms_)
+  unsigned char* dirty_link_flags_;
+  unsigned char* dirty_collision_body_flags_;
+
   /** \brief All attached bodies that are part of this state, indexed by their name */
   std::map<std::string, AttachedBody*> attached_body_map_;
 
@@ -38,6 +38,9 @@
 
 #include <moveit/robot_state/cartesian_interpolator.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace moveit
 {
 namespace core
@@ -48,8 +51,57 @@ namespace core
  * valid paths from paths with large joint space jumps. */
 static const std::size_t MIN_STEPS_FOR_JUMP_THRESH = 10;
 
+/** \brief When stitching blocks of a Cartesian path solved in parallel, the step between two blocks may be at most
+ * this many times larger than the largest step within them for the blocks to be considered continuous. */
+static const double STITCH_JUMP_FACTOR = 2.0;
+
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.cartesian_interpolator");
 
+static std::size_t computeSteps(double translation_distance, double rotation_distance, const MaxEEFStep& max_step,
+                                const JumpThreshold& jump_threshold)
+{
+  // decide how many steps we will need for this trajectory
+  std::size_t translation_steps = 0;
+  if (max_step.translation > 0.0)
+    translation_steps = floor(translation_distance / max_step.translation);
+
+  std::size_t rotation_steps = 0;
+  if (max_step.rotation > 0.0)
+    rotation_steps = floor(rotation_distance / max_step.rotation);
+
+  // If we are testing for relative jumps, we always want at least MIN_STEPS_FOR_JUMP_THRESH steps
+  std::size_t steps = std::max(translation_steps, rotation_steps) + 1;
+  if (jump_threshold.factor > 0 && steps < MIN_STEPS_FOR_JUMP_THRESH)
+    steps = MIN_STEPS_FOR_JUMP_THRESH;
+  return steps;
+}
+
+static std::vector<double> computeConsistencyLimits(const JointModelGroup* group, const JumpThreshold& jump_threshold)
+{
+  // To limit absolute joint-space jumps, we pass consistency limits to the IK solver
+  std::vector<double> consistency_limits;
+  if (jump_threshold.prismatic > 0 || jump_threshold.revolute > 0)
+    for (const JointModel* jm : group->getActiveJointModels())
+    {
+      double limit;
+      switch (jm->getType())
+      {
+        case JointModel::REVOLUTE:
+          limit = jump_threshold.revolute;
+          break;
+        case JointModel::PRISMATIC:
+          limit = jump_threshold.prismatic;
+          break;
+        default:
+          limit = 0.0;
+      }
+      if (limit == 0.0)
+        limit = jm->getMaximumExtent();
+      consistency_limits.push_back(limit);
+    }
+  return consistency_limits;
+}
+
 double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
                                                    std::vector<RobotStatePtr>& traj, const LinkModel* link,
                                                    const Eigen::Vector3d& direction, bool global_reference_frame,
@@ -105,41 +157,8 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
   double rotation_distance = start_quaternion.angularDistance(target_quaternion);
   double translation_distance = (rotated_target.translation() - start_pose.translation()).norm();
 
-  // decide how many steps we will need for this trajectory
-  std::size_t translation_steps = 0;
-  if (max_step.translation > 0.0)
-    translation_steps = floor(translation_distance / max_step.translation);
-
-  std::size_t rotation_steps = 0;
-  if (max_step.rotation > 0.0)
-    rotation_steps = floor(rotation_distance / max_step.rotation);
-
-  // If we are testing for relative jumps, we always want at least MIN_STEPS_FOR_JUMP_THRESH steps
-  std::size_t steps = std::max(translation_steps, rotation_steps) + 1;
-  if (jump_threshold.factor > 0 && steps < MIN_STEPS_FOR_JUMP_THRESH)
-    steps = MIN_STEPS_FOR_JUMP_THRESH;
-
-  // To limit absolute joint-space jumps, we pass consistency limits to the IK solver
-  std::vector<double> consistency_limits;
-  if (jump_threshold.prismatic > 0 || jump_threshold.revolute > 0)
-    for (const JointModel* jm : group->getActiveJointModels())
-    {
-      double limit;
-      switch (jm->getType())
-      {
-        case JointModel::REVOLUTE:
-          limit = jump_threshold.revolute;
-          break;
-        case JointModel::PRISMATIC:
-          limit = jump_threshold.prismatic;
-          break;
-        default:
-          limit = 0.0;
-      }
-      if (limit == 0.0)
-        limit = jm->getMaximumExtent();
-      consistency_limits.push_back(limit);
-    }
+  std::size_t steps = computeSteps(translation_distance, rotation_distance, max_step, jump_threshold);
+  std::vector<double> consistency_limits = computeConsistencyLimits(group, jump_threshold);
 
   traj.clear();
   traj.push_back(RobotStatePtr(new robot_state::RobotState(*start_state)));
@@ -208,6 +227,255 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
   return percentage_solved;
 }
 
+/** \brief Offset of the values of each active joint of \e group within the group's variable values */
+static std::vector<std::size_t> computeActiveJointOffsets(const JointModelGroup* group)
+{
+  std::vector<std::size_t> offsets;
+  for (const JointModel* jm : group->getActiveJointModels())
+    offsets.push_back(group->getVariableGroupIndex(jm->getVariableNames()[0]));
+  return offsets;
+}
+
+/** \brief Same as the jump tests of CartesianInterpolator::checkJointSpaceJump(), for a path given as rows of group
+ * variable values. Returns the number of rows that passed. */
+static std::size_t checkJointSpaceJumpValues(const JointModelGroup* group, const std::vector<double>& traj,
+                                             std::size_t rows, const JumpThreshold& jump_threshold)
+{
+  const std::size_t n = group->getVariableCount();
+  if (rows <= 1)
+    return rows;
+
+  if (jump_threshold.factor > 0.0)
+  {
+    if (rows < MIN_STEPS_FOR_JUMP_THRESH)
+      RCLCPP_WARN(LOGGER, "The computed trajectory is too short to detect jumps in joint-space "
+                          "Need at least %zu steps, only got %zu. Try a lower max_step.",
+                  MIN_STEPS_FOR_JUMP_THRESH, rows);
+
+    std::vector<double> dist_vector(rows - 1);
+    double total_dist = 0.0;
+    for (std::size_t i = 1; i < rows; ++i)
+    {
+      dist_vector[i - 1] = group->distance(&traj[i * n], &traj[(i - 1) * n]);
+      total_dist += dist_vector[i - 1];
+    }
+    double thres = jump_threshold.factor * (total_dist / (double)dist_vector.size());
+    for (std::size_t i = 0; i < dist_vector.size(); ++i)
+      if (dist_vector[i] > thres)
+      {
+        RCLCPP_DEBUG(LOGGER, "Truncating Cartesian path due to detected jump in joint-space distance");
+        rows = i + 1;
+        break;
+      }
+  }
+
+  if (jump_threshold.revolute > 0.0 || jump_threshold.prismatic > 0.0)
+  {
+    const std::vector<const JointModel*>& joints = group->getActiveJointModels();
+    const std::vector<std::size_t> offsets = computeActiveJointOffsets(group);
+    for (std::size_t i = 1; i < rows; ++i)
+      for (std::size_t j = 0; j < joints.size(); ++j)
+      {
+        double joint_threshold = 0.0;
+        if (joints[j]->getType() == JointModel::REVOLUTE)
+          joint_threshold = jump_threshold.revolute;
+        else if (joints[j]->getType() == JointModel::PRISMATIC)
+          joint_threshold = jump_threshold.prismatic;
+        if (joint_threshold <= 0.0)
+          continue;
+        double distance = joints[j]->distance(&traj[(i - 1) * n + offsets[j]], &traj[i * n + offsets[j]]);
+        if (distance > joint_threshold)
+        {
+          RCLCPP_DEBUG(LOGGER, "Truncating Cartesian path due to detected jump of %.4f > %.4f in joint %s", distance,
+                       joint_threshold, joints[j]->getName().c_str());
+          return i;
+        }
+      }
+  }
+  return rows;
+}
+
+double CartesianInterpolator::computeCartesianPathParallel(RobotState* start_state, const JointModelGroup* group,
+                                                           std::vector<double>& traj, const LinkModel* link,
+                                                           const EigenSTL::vector_Isometry3d& waypoints,
+                                                           bool global_reference_frame, const MaxEEFStep& max_step,
+                                                           const JumpThreshold& jump_threshold,
+                                                           unsigned int num_threads,
+                                                           const GroupStateValidityCallbackFn& validCallback,
+                                                           const kinematics::KinematicsQueryOptions& options)
+{
+  if (max_step.translation <= 0.0 && max_step.rotation <= 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "Invalid MaxEEFStep passed into computeCartesianPathParallel. Both the MaxEEFStep.rotation "
+                         "and MaxEEFStep.translation components must be non-negative and at least one component must "
+                         "be greater than zero");
+    return 0.0;
+  }
+
+  // make sure that continuous joints wrap
+  for (const JointModel* joint : group->getContinuousJointModels())
+    start_state->enforceBounds(joint);
+
+  // compute all the poses along the path upfront; segment_end[k] is the number of poses up to waypoint k
+  EigenSTL::vector_Isometry3d poses;
+  std::vector<std::size_t> segment_end;
+  Eigen::Isometry3d segment_start = start_state->getGlobalLinkTransform(link);
+  for (const Eigen::Isometry3d& waypoint : waypoints)
+  {
+    Eigen::Isometry3d target = global_reference_frame ? waypoint : segment_start * waypoint;
+    Eigen::Quaterniond start_quaternion(segment_start.rotation());
+    Eigen::Quaterniond target_quaternion(target.rotation());
+    std::size_t steps = computeSteps((target.translation() - segment_start.translation()).norm(),
+                                     start_quaternion.angularDistance(target_quaternion), max_step, jump_threshold);
+    for (std::size_t i = 1; i <= steps; ++i)
+    {
+      double percentage = (double)i / (double)steps;
+      Eigen::Isometry3d pose(start_quaternion.slerp(percentage, target_quaternion));
+      pose.translation() = percentage * target.translation() + (1 - percentage) * segment_start.translation();
+      poses.push_back(pose);
+    }
+    segment_end.push_back(poses.size());
+    segment_start = target;
+  }
+
+  const std::vector<double> consistency_limits = computeConsistencyLimits(group, jump_threshold);
+  static const std::vector<double> NO_CONSISTENCY_LIMITS;
+
+  // row 0 of traj is the start state, row i + 1 the solution for poses[i]
+  const std::size_t n = group->getVariableCount();
+  traj.resize((poses.size() + 1) * n);
+  start_state->copyJointGroupPositions(group, &traj[0]);
+
+  // solve poses [first, last) with solver starting from state, returning how many were solved before the first
+  // failure
+  const std::vector<std::string> tips(1, link->getName());
+  auto solve = [&](const kinematics::KinematicsBaseConstPtr& solver, RobotState& state, std::size_t first,
+                   std::size_t last, bool seeded) -> std::size_t {
+    for (std::size_t i = first; i < last; ++i)
+    {
+      // Explicitly use a single IK attempt only, as in computeCartesianPath(). Without a nearby seed, consistency
+      // limits would only make the first solve fail.
+      const std::vector<double>& limits = (i == first && !seeded) ? NO_CONSISTENCY_LIMITS : consistency_limits;
+      if (!state.setFromIK(group, solver, EigenSTL::vector_Isometry3d(1, poses[i]), tips,
+                           std::vector<std::vector<double>>(1, limits), 0.0, validCallback, options))
+        return i - first;
+      state.copyJointGroupPositions(group, &traj[(i + 1) * n]);
+    }
+    return last - first;
+  };
+
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t block_count = std::max<std::size_t>(1, std::min<std::size_t>(num_threads, poses.size()));
+
+  // the solver instance of the group is not thread-safe: the first block uses it, every other block gets its own
+  // instance from the solver allocator of the group (groups solved through subgroups are solved sequentially)
+  std::vector<kinematics::KinematicsBaseConstPtr> solvers(1, group->getSolverInstance());
+  const SolverAllocatorFn& allocator = group->getGroupKinematics().first.allocator_;
+  for (std::size_t k = 1; k < block_count; ++k)
+  {
+    kinematics::KinematicsBasePtr solver = solvers[0] && allocator ? allocator(group) : kinematics::KinematicsBasePtr();
+    if (!solver)
+    {
+      RCLCPP_DEBUG(LOGGER, "Cannot allocate kinematics solvers for group '%s', solving the Cartesian path sequentially",
+                   group->getName().c_str());
+      block_count = 1;
+      break;
+    }
+    solver->setDefaultTimeout(group->getDefaultIKTimeout());
+    solvers.push_back(solver);
+  }
+
+  std::vector<std::size_t> block_begin(block_count + 1);
+  for (std::size_t k = 0; k <= block_count; ++k)
+    block_begin[k] = poses.size() * k / block_count;
+  std::vector<std::size_t> block_solved(block_count, 0);
+
+  // seed every block with a solution for the last pose of the previous block, found by chaining IK over the block
+  // boundaries from the start state; these few solves are sequential
+  std::vector<std::vector<double>> block_seed(block_count);
+  {
+    RobotState state(*start_state);
+    for (std::size_t k = 1; k < block_count; ++k)
+      if (state.setFromIK(group, solvers[0], EigenSTL::vector_Isometry3d(1, poses[block_begin[k] - 1]), tips,
+                          std::vector<std::vector<double>>(1, NO_CONSISTENCY_LIMITS), 0.0, validCallback, options))
+        state.copyJointGroupPositions(group, block_seed[k]);
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t k = 1; k < block_count; ++k)
+    threads.emplace_back([&, k]() {
+      RobotState state(*start_state);
+      if (!block_seed[k].empty())
+        state.setJointGroupPositions(group, block_seed[k]);
+      block_solved[k] = solve(solvers[k], state, block_begin[k], block_begin[k + 1], !block_seed[k].empty());
+    });
+  {
+    RobotState state(*start_state);
+    block_solved[0] = solve(solvers[0], state, block_begin[0], block_begin[1], true);
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // largest joint-space step between consecutive rows in (first_row, last_row]
+  auto max_step_distance = [&](std::size_t first_row, std::size_t last_row) {
+    double result = 0.0;
+    for (std::size_t r = first_row + 1; r <= last_row; ++r)
+      result = std::max(result, group->distance(&traj[(r - 1) * n], &traj[r * n]));
+    return result;
+  };
+  const std::vector<const JointModel*>& active_joints = group->getActiveJointModels();
+  const std::vector<std::size_t> offsets = computeActiveJointOffsets(group);
+
+  // stitch the blocks in order, solving again the ones that do not continue the path accepted so far
+  std::size_t solved = block_solved[0];
+  for (std::size_t k = 1; k < block_count && solved == block_begin[k]; ++k)
+  {
+    bool continuous = block_solved[k] > 0;
+    if (continuous)
+    {
+      const double* last = &traj[solved * n];
+      const double* next = &traj[(solved + 1) * n];
+      double reference = std::max(max_step_distance(block_begin[k - 1], solved),
+                                  max_step_distance(solved + 1, solved + block_solved[k]));
+      continuous = group->distance(last, next) <= STITCH_JUMP_FACTOR * reference;
+      for (std::size_t j = 0; continuous && j < consistency_limits.size(); ++j)
+        continuous = active_joints[j]->distance(last + offsets[j], next + offsets[j]) <= consistency_limits[j];
+    }
+    if (!continuous)
+    {
+      RCLCPP_DEBUG(LOGGER, "Solving block %zu of the Cartesian path again, seeded from the previous block", k);
+      RobotState state(*start_state);
+      state.setJointGroupPositions(group, &traj[solved * n]);
+      block_solved[k] = solve(solvers[0], state, block_begin[k], block_begin[k + 1], true);
+    }
+    solved += block_solved[k];
+  }
+
+  std::size_t rows = checkJointSpaceJumpValues(group, traj, solved + 1, jump_threshold);
+  traj.resize(rows * n);
+  start_state->setJointGroupPositions(group, &traj[(rows - 1) * n]);
+  start_state->update();
+
+  // every waypoint counts for the same fraction of the path, as in computeCartesianPath()
+  const std::size_t valid_poses = rows - 1;
+  double percentage_solved = 0.0;
+  std::size_t previous_end = 0;
+  for (std::size_t end : segment_end)
+  {
+    if (valid_poses >= end)
+      percentage_solved += 1.0;
+    else
+    {
+      if (valid_poses > previous_end)
+        percentage_solved += (double)(valid_poses - previous_end) / (double)(end - previous_end);
+      break;
+    }
+    previous_end = end;
+  }
+  return waypoints.empty() ? 0.0 : percentage_solved / (double)waypoints.size();
+}
+
 double CartesianInterpolator::checkJointSpaceJump(const JointModelGroup* group, std::vector<RobotStatePtr>& traj,
                                                   const JumpThreshold& jump_threshold)
 {
@@ -89,13 +89,14 @@ void RobotState::allocMemory()
                 "sizeof(Eigen::Isometry3d) should be a multiple of EIGEN_MAX_ALIGN_BYTES");
 
   constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
-  // memory for the dirty joint transforms
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+  // memory for the dirty joint transforms and the dirty link / collision body flags
+  const int nr_doubles_for_dirty_flags =
+      1 + (robot_model_->getJointModelCount() + 2 * robot_model_->getLinkModelCount()) /
+              (sizeof(double) / sizeof(unsigned char));
   const size_t bytes =
       sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
                                    robot_model_->getLinkGeometryCount()) +
-      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
+      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_flags) +
       extra_alignment_bytes;
   memory_ = malloc(bytes);
 
@@ -107,7 +108,9 @@ void RobotState::allocMemory()
   global_collision_body_transforms_ = global_link_transforms_ + robot_model_->getLinkModelCount();
   dirty_joint_transforms_ =
       reinterpret_cast<unsigned char*>(global_collision_body_transforms_ + robot_model_->getLinkGeometryCount());
-  position_ = reinterpret_cast<double*>(dirty_joint_transforms_) + nr_doubles_for_dirty_joint_transforms;
+  dirty_link_flags_ = dirty_joint_transforms_ + robot_model_->getJointModelCount();
+  dirty_collision_body_flags_ = dirty_link_flags_ + robot_model_->getLinkModelCount();
+  position_ = reinterpret_cast<double*>(dirty_joint_transforms_) + nr_doubles_for_dirty_flags;
   velocity_ = position_ + robot_model_->getVariableCount();
   // acceleration and effort share the memory (not both can be specified)
   effort_ = acceleration_ = velocity_ + robot_model_->getVariableCount();
@@ -116,9 +119,10 @@ void RobotState::allocMemory()
 void RobotState::initTransforms()
 {
   // mark all transforms as dirty
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_joint_transforms);
+  const int nr_doubles_for_dirty_flags =
+      1 + (robot_model_->getJointModelCount() + 2 * robot_model_->getLinkModelCount()) /
+              (sizeof(double) / sizeof(unsigned char));
+  memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_flags);
 
   // initialize last row of transformation matrices, which will not be modified by transform updates anymore
   for (size_t i = 0, end = robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
@@ -155,15 +159,16 @@ void RobotState::copyFrom(const RobotState& other)
   else
   {
     // copy all the memory; maybe avoid copying velocity and acceleration if possible
-    const int nr_doubles_for_dirty_joint_transforms =
-        1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+    const int nr_doubles_for_dirty_flags =
+        1 + (robot_model_->getJointModelCount() + 2 * robot_model_->getLinkModelCount()) /
+                (sizeof(double) / sizeof(unsigned char));
     const size_t bytes =
         sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
                                      robot_model_->getLinkGeometryCount()) +
         sizeof(double) *
             (robot_model_->getVariableCount() * (1 + ((has_velocity_ || has_acceleration_ || has_effort_) ? 1 : 0) +
                                                  ((has_acceleration_ || has_effort_) ? 1 : 0)) +
-             nr_doubles_for_dirty_joint_transforms);
+             nr_doubles_for_dirty_flags);
     memcpy(variable_joint_transforms_, other.variable_joint_transforms_, bytes);
   }
 
@@ -195,6 +200,19 @@ bool RobotState::checkLinkTransforms() const
   return true;
 }
 
+bool RobotState::checkLinkTransform(const LinkModel* link) const
+{
+  // after a partial update, a link is up to date if neither it nor any of its ancestors is flagged
+  if (dirtyLinkTransforms())
+    for (const LinkModel* l = link; l; l = l->getParentLinkModel())
+      if (dirty_link_flags_[l->getLinkIndex()])
+      {
+        RCLCPP_WARN(LOGGER, "Returning dirty link transform for link '%s'", link->getName().c_str());
+        return false;
+      }
+  return true;
+}
+
 bool RobotState::checkCollisionTransforms() const
 {
   if (dirtyCollisionBodyTransforms())
@@ -205,6 +223,13 @@ bool RobotState::checkCollisionTransforms() const
   return true;
 }
 
+void RobotState::markAllTransformsDirty()
+{
+  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
+  memset(dirty_link_flags_, 1, robot_model_->getLinkModelCount() * sizeof(unsigned char));
+  dirty_link_transforms_ = robot_model_->getRootJoint();
+}
+
 void RobotState::markVelocity()
 {
   if (!has_velocity_)
@@ -238,8 +263,7 @@ void RobotState::setToRandomPositions()
 {
   random_numbers::RandomNumberGenerator& rng = getRandomNumberGenerator();
   robot_model_->getVariableRandomPositions(rng, position_);
-  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllTransformsDirty();
   // mimic values are correctly set in RobotModel
 }
 
@@ -303,8 +327,7 @@ void RobotState::setToDefaultValues()
   robot_model_->getVariableDefaultPositions(position_);  // mimic values are updated
   // set velocity & acceleration to 0
   memset(velocity_, 0, sizeof(double) * 2 * robot_model_->getVariableCount());
-  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllTransformsDirty();
 }
 
 void RobotState::setVariablePositions(const double* position)
@@ -315,8 +338,7 @@ void RobotState::setVariablePositions(const double* position)
   // the full state includes mimic joint values, so no need to update mimic here
 
   // Since all joint values have potentially changed, we will need to recompute all transforms
-  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markAllTransformsDirty();
 }
 
 void RobotState::setVariablePositions(const std::map<std::string, double>& variable_map)
@@ -574,8 +596,7 @@ void RobotState::update(bool force)
   // make sure we do everything from scratch if needed
   if (force)
   {
-    memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-    dirty_link_transforms_ = robot_model_->getRootJoint();
+    markAllTransformsDirty();
   }
 
   // this actually triggers all needed updates
@@ -594,6 +615,11 @@ void RobotState::updateCollisionBodyTransforms()
 
     for (const LinkModel* link : links)
     {
+      unsigned char& dirty = dirty_collision_body_flags_[link->getLinkIndex()];
+      if (!dirty)
+        continue;
+      dirty = 0;
+
       const EigenSTL::vector_Isometry3d& ot = link->getCollisionOriginTransforms();
       const std::vector<int>& ot_id = link->areCollisionOriginTransformsIdentity();
       const int index_co = link->getFirstCollisionBodyTransformIndex();
@@ -614,7 +640,7 @@ void RobotState::updateLinkTransforms()
 {
   if (dirty_link_transforms_ != nullptr)
   {
-    updateLinkTransformsInternal(dirty_link_transforms_);
+    updateDirtyLinkTransforms(dirty_link_transforms_);
     if (dirty_collision_body_transforms_)
       dirty_collision_body_transforms_ =
           robot_model_->getCommonRoot(dirty_collision_body_transforms_, dirty_link_transforms_);
@@ -624,43 +650,109 @@ void RobotState::updateLinkTransforms()
   }
 }
 
-void RobotState::updateLinkTransformsInternal(const JointModel* start)
+void RobotState::updateLinkTransforms(const std::vector<const LinkModel*>& links)
 {
-  for (const LinkModel* link : start->getDescendantLinkModels())
+  if (dirty_link_transforms_ == nullptr)
+    return;
+
+  for (const LinkModel* link : links)
+    updateLinkTransformChain(link);
+
+  // the recomputed links are descendants of dirty_link_transforms_, which stays set for the remaining dirty links
+  if (dirty_collision_body_transforms_)
+    dirty_collision_body_transforms_ =
+        robot_model_->getCommonRoot(dirty_collision_body_transforms_, dirty_link_transforms_);
+  else
+    dirty_collision_body_transforms_ = dirty_link_transforms_;
+}
+
+bool RobotState::updateLinkTransformChain(const LinkModel* link)
+{
+  // flags are pushed down lazily, so a link is stale if it or any of its ancestors is flagged
+  const LinkModel* parent = link->getParentLinkModel();
+  const bool parent_updated = parent && updateLinkTransformChain(parent);
+  const int idx_link = link->getLinkIndex();
+  if (!parent_updated && !dirty_link_flags_[idx_link])
+    return false;
+
+  updateGlobalLinkTransform(link);
+  dirty_link_flags_[idx_link] = 0;
+  dirty_collision_body_flags_[idx_link] = 1;
+
+  // the other branches below this link are now out of date
+  for (const JointModel* child : link->getChildJointModels())
+    dirty_link_flags_[child->getChildLinkModel()->getLinkIndex()] = 1;
+  return true;
+}
+
+void RobotState::updateDirtyLinkTransforms(const JointModel* start)
+{
+  // descendants are sorted by link index, which follows a depth-first traversal of the tree, so parents are visited
+  // before their children; a flag still set on a visited parent means it was recomputed during this pass
+  const std::vector<const LinkModel*>& links = start->getDescendantLinkModels();
+  for (const LinkModel* link : links)
   {
-    int idx_link = link->getLinkIndex();
+    const int idx_link = link->getLinkIndex();
     const LinkModel* parent = link->getParentLinkModel();
-    if (parent)  // root JointModel will not have a parent
+    if (dirty_link_flags_[idx_link] || (parent && dirty_link_flags_[parent->getLinkIndex()]))
     {
-      int idx_parent = parent->getLinkIndex();
-      if (link->parentJointIsFixed())
-        global_link_transforms_[idx_link].affine().noalias() =
-            global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix();
-      else
-      {
-        if (link->jointOriginTransformIsIdentity())
-          global_link_transforms_[idx_link].affine().noalias() =
-              global_link_transforms_[idx_parent].affine() * getJointTransform(link->getParentJointModel()).matrix();
-        else
-          global_link_transforms_[idx_link].affine().noalias() =
-              global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix() *
-              getJointTransform(link->getParentJointModel()).matrix();
-      }
+      updateGlobalLinkTransform(link);
+      dirty_link_flags_[idx_link] = 1;
+      dirty_collision_body_flags_[idx_link] = 1;
     }
+  }
+  for (const LinkModel* link : links)
+    dirty_link_flags_[link->getLinkIndex()] = 0;
+
+  // update attached bodies tf; these are usually very few, so we update them all
+  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
+       it != attached_body_map_.end(); ++it)
+    it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
+}
+
+void RobotState::updateLinkTransformsInternal(const JointModel* start)
+{
+  for (const LinkModel* link : start->getDescendantLinkModels())
+  {
+    updateGlobalLinkTransform(link);
+    dirty_collision_body_flags_[link->getLinkIndex()] = 1;
+  }
+
+  // update attached bodies tf; these are usually very few, so we update them all
+  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
+       it != attached_body_map_.end(); ++it)
+    it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
+}
+
+void RobotState::updateGlobalLinkTransform(const LinkModel* link)
+{
+  int idx_link = link->getLinkIndex();
+  const LinkModel* parent = link->getParentLinkModel();
+  if (parent)  // root JointModel will not have a parent
+  {
+    int idx_parent = parent->getLinkIndex();
+    if (link->parentJointIsFixed())
+      global_link_transforms_[idx_link].affine().noalias() =
+          global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix();
     else
     {
       if (link->jointOriginTransformIsIdentity())
-        global_link_transforms_[idx_link] = getJointTransform(link->getParentJointModel());
+        global_link_transforms_[idx_link].affine().noalias() =
+            global_link_transforms_[idx_parent].affine() * getJointTransform(link->getParentJointModel()).matrix();
       else
         global_link_transforms_[idx_link].affine().noalias() =
-            link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
+            global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix() *
+            getJointTransform(link->getParentJointModel()).matrix();
     }
   }
-
-  // update attached bodies tf; these are usually very few, so we update them all
-  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
-       it != attached_body_map_.end(); ++it)
-    it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
+  else
+  {
+    if (link->jointOriginTransformIsIdentity())
+      global_link_transforms_[idx_link] = getJointTransform(link->getParentJointModel());
+    else
+      global_link_transforms_[idx_link].affine().noalias() =
+          link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
+  }
 }
 
 void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isometry3d& transform, bool backward)
@@ -675,6 +767,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
     dirty_collision_body_transforms_ = link->getParentJointModel();
 
   global_link_transforms_[link->getLinkIndex()] = transform;
+  dirty_collision_body_flags_[link->getLinkIndex()] = 1;
 
   // update link transforms for descendant links only (leaving the transform for the current link untouched)
   const std::vector<const JointModel*>& cj = link->getChildJointModels();
@@ -697,6 +790,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
           (child_link->getJointOriginTransform() *
            variable_joint_transforms_[child_link->getParentJointModel()->getJointIndex()])
               .inverse();
+      dirty_collision_body_flags_[parent_link->getLinkIndex()] = 1;
 
       // update link transforms for descendant links only (leaving the transform for the current link untouched)
       // with the exception of the child link we are coming backwards from
@@ -842,8 +936,7 @@ void RobotState::interpolate(const RobotState& to, double t, RobotState& state)
 {
   robot_model_->interpolate(getVariablePositions(), to.getVariablePositions(), t, state.getVariablePositions());
 
-  memset(state.dirty_joint_transforms_, 1, state.robot_model_->getJointModelCount() * sizeof(unsigned char));
-  state.dirty_link_transforms_ = state.robot_model_->getRootJoint();
+  state.markAllTransformsDirty();
 }
 
 void RobotState::interpolate(const RobotState& to, double t, RobotState& state,
@@ -1482,6 +1575,16 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Is
                            const std::vector<std::vector<double> >& consistency_limit_sets, double timeout,
                            const GroupStateValidityCallbackFn& constraint,
                            const kinematics::KinematicsQueryOptions& options)
+{
+  return setFromIK(jmg, jmg->getSolverInstance(), poses_in, tips_in, consistency_limit_sets, timeout, constraint,
+                   options);
+}
+
+bool RobotState::setFromIK(const JointModelGroup* jmg, const kinematics::KinematicsBaseConstPtr& solver,
+                           const EigenSTL::vector_Isometry3d& poses_in, const std::vector<std::string>& tips_in,
+                           const std::vector<std::vector<double> >& consistency_limit_sets, double timeout,
+                           const GroupStateValidityCallbackFn& constraint,
+                           const kinematics::KinematicsQueryOptions& options)
 {
   // Error check
   if (poses_in.size() != tips_in.size())
@@ -1490,9 +1593,6 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Is
     return false;
   }
 
-  // Load solver
-  const kinematics::KinematicsBaseConstPtr& solver = jmg->getSolverInstance();
-
   // Check if this jmg has a solver
   bool valid_solver = true;
   if (!solver)
@@ -2054,6 +2154,10 @@ void RobotState::printDirtyInfo(std::ostream& out) const
       out << "    " << joint->getName() << std::endl;
   out << "  * Dirty Link Transforms: " << (dirty_link_transforms_ ? dirty_link_transforms_->getName() : "NULL")
       << std::endl;
+  const std::vector<const LinkModel*>& lm = robot_model_->getLinkModels();
+  for (const LinkModel* link : lm)
+    if (dirty_link_flags_[link->getLinkIndex()])
+      out << "    " << link->getName() << std::endl;
   out << "  * Dirty Collision Body Transforms: "
       << (dirty_collision_body_transforms_ ? dirty_collision_body_transforms_->getName() : "NULL") << std::endl;
 }
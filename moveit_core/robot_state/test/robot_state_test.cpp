@@ -539,6 +539,58 @@ TEST_F(OneRobot, FK)
   EXPECT_NEAR_TRACED(state.getGlobalLinkTransform("link_e").translation(), Eigen::Vector3d(2.8, 0.6, 0));
 }
 
+TEST_F(OneRobot, PartialLinkTransformUpdates)
+{
+  const moveit::core::JointModelGroup* g_mim = robot_model_->getJointModelGroup("mim_joints");
+  const moveit::core::JointModelGroup* g_tip = robot_model_->getJointModelGroup("base_from_base_to_tip");
+  ASSERT_TRUE(g_mim != nullptr);
+  ASSERT_TRUE(g_tip != nullptr);
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  std::map<std::string, double> joint_values;
+  joint_values["base_joint/x"] = 1.0;
+  joint_values["base_joint/theta"] = 0.5;
+  joint_values["joint_a"] = -0.5;
+  joint_values["joint_c"] = 0.08;
+  joint_values["joint_f"] = 0.1;
+  state.setVariablePositions(joint_values);
+
+  moveit::core::RobotState reference(state);
+  reference.updateLinkTransforms();
+
+  // only the links of the group and their ancestors are brought up to date
+  state.updateLinkTransforms(g_mim);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  const moveit::core::RobotState& const_state = state;
+  for (const moveit::core::LinkModel* link : g_mim->getLinkModels())
+    EXPECT_TRUE(const_state.getGlobalLinkTransform(link).isApprox(reference.getGlobalLinkTransform(link)))
+        << link->getName();
+  EXPECT_TRUE(const_state.getGlobalLinkTransform("link_c").isApprox(reference.getGlobalLinkTransform("link_c")));
+
+  // the remaining links are computed by the next full update
+  state.updateLinkTransforms();
+  EXPECT_FALSE(state.dirtyLinkTransforms());
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(reference.getGlobalLinkTransform(link))) << link->getName();
+
+  // changing a single joint leaves the links outside of its subtree untouched
+  state.setVariablePosition("joint_f", 0.15);
+  reference.setVariablePosition("joint_f", 0.15);
+  reference.updateLinkTransforms();
+  state.updateLinkTransforms(g_tip);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  state.updateLinkTransforms(g_mim);
+  state.updateCollisionBodyTransforms();
+  EXPECT_FALSE(state.dirtyLinkTransforms());
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(reference.getGlobalLinkTransform(link))) << link->getName();
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      EXPECT_TRUE(state.getCollisionBodyTransform(link, i).isApprox(reference.getCollisionBodyTransform(link, i)))
+          << link->getName();
+}
+
 TEST_F(OneRobot, testPrintCurrentPositionWithJointLimits)
 {
   moveit::core::RobotState state(robot_model_);
@@ -38,12 +38,17 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/cartesian_interpolator.h>
+#include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
 #include <urdf_parser/urdf_parser.h>
 #include <gtest/gtest.h>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
 #include <ctype.h>
 
 class OneRobot : public testing::Test
@@ -385,6 +390,209 @@ TEST_F(OneRobot, checkRelativeJointSpaceJump)
   EXPECT_NEAR(1.0, fraction, 0.01);
 }
 
+// set when an instance of GantryKinematics is called from two threads at once
+static std::atomic<bool> gantry_concurrent_use(false);
+
+// Analytic IK for a gantry of three prismatic joints along x, y and z: the joint values are the position of the tip
+class GantryKinematics : public kinematics::KinematicsBase
+{
+public:
+  GantryKinematics(const moveit::core::RobotModel& robot_model)
+    : joint_names_({ "x_joint", "y_joint", "z_joint" }), link_names_({ "tip" }), calls_(0)
+  {
+    storeValues(robot_model, "arm", "base_link", link_names_, 0.1);
+  }
+
+  bool getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& /*ik_seed_state*/,
+                     std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                     const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    return solve(ik_pose, solution, IKCallbackFn(), error_code);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& /*ik_seed_state*/,
+                        double /*timeout*/, std::vector<double>& solution,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    return solve(ik_pose, solution, IKCallbackFn(), error_code);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& /*ik_seed_state*/,
+                        double /*timeout*/, const std::vector<double>& /*consistency_limits*/,
+                        std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    return solve(ik_pose, solution, IKCallbackFn(), error_code);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& /*ik_seed_state*/,
+                        double /*timeout*/, std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    return solve(ik_pose, solution, solution_callback, error_code);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& /*ik_seed_state*/,
+                        double /*timeout*/, const std::vector<double>& /*consistency_limits*/,
+                        std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    return solve(ik_pose, solution, solution_callback, error_code);
+  }
+
+  bool getPositionFK(const std::vector<std::string>& /*link_names*/, const std::vector<double>& joint_angles,
+                     std::vector<geometry_msgs::msg::Pose>& poses) const override
+  {
+    poses.resize(1);
+    poses[0].position.x = joint_angles[0];
+    poses[0].position.y = joint_angles[1];
+    poses[0].position.z = joint_angles[2];
+    poses[0].orientation.w = 1.0;
+    return true;
+  }
+
+  const std::vector<std::string>& getJointNames() const override
+  {
+    return joint_names_;
+  }
+
+  const std::vector<std::string>& getLinkNames() const override
+  {
+    return link_names_;
+  }
+
+private:
+  bool solve(const geometry_msgs::msg::Pose& ik_pose, std::vector<double>& solution,
+             const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code) const
+  {
+    if (calls_++ > 0)
+      gantry_concurrent_use = true;
+    // give other threads the chance to call this instance at the same time
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    solution = { ik_pose.position.x, ik_pose.position.y, ik_pose.position.z };
+    error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+    for (double value : solution)
+      if (std::fabs(value) > 1.0)
+        error_code.val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
+    if (error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS && solution_callback)
+      solution_callback(ik_pose, solution, error_code);
+    --calls_;
+    return error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  }
+
+  std::vector<std::string> joint_names_;
+  std::vector<std::string> link_names_;
+  mutable std::atomic<int> calls_;
+};
+
+class GantryRobot : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    static const std::string URDF =
+        "<?xml version=\"1.0\" ?>"
+        "<robot name=\"gantry\">"
+        "<link name=\"base_link\"/>"
+        "<link name=\"link_x\"/>"
+        "<link name=\"link_y\"/>"
+        "<link name=\"tip\"/>"
+        "<joint name=\"x_joint\" type=\"prismatic\">"
+        "  <axis xyz=\"1 0 0\"/>"
+        "  <parent link=\"base_link\"/>"
+        "  <child link=\"link_x\"/>"
+        "  <limit effort=\"100.0\" lower=\"-1\" upper=\"1\" velocity=\"1\"/>"
+        "</joint>"
+        "<joint name=\"y_joint\" type=\"prismatic\">"
+        "  <axis xyz=\"0 1 0\"/>"
+        "  <parent link=\"link_x\"/>"
+        "  <child link=\"link_y\"/>"
+        "  <limit effort=\"100.0\" lower=\"-1\" upper=\"1\" velocity=\"1\"/>"
+        "</joint>"
+        "<joint name=\"z_joint\" type=\"prismatic\">"
+        "  <axis xyz=\"0 0 1\"/>"
+        "  <parent link=\"link_y\"/>"
+        "  <child link=\"tip\"/>"
+        "  <limit effort=\"100.0\" lower=\"-1\" upper=\"1\" velocity=\"1\"/>"
+        "</joint>"
+        "</robot>";
+    static const std::string SRDF =
+        "<?xml version=\"1.0\" ?>"
+        "<robot name=\"gantry\">"
+        "<group name=\"arm\">"
+        "<chain base_link=\"base_link\" tip_link=\"tip\"/>"
+        "</group>"
+        "</robot>";
+
+    urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(URDF);
+    srdf::ModelSharedPtr srdf_model(new srdf::Model());
+    srdf_model->initString(*urdf_model, SRDF);
+    moveit::core::RobotModelPtr robot_model(new moveit::core::RobotModel(urdf_model, srdf_model));
+    robot_model->getJointModelGroup("arm")->setSolverAllocators([](const moveit::core::JointModelGroup* jmg) {
+      return kinematics::KinematicsBasePtr(new GantryKinematics(jmg->getParentModel()));
+    });
+    robot_model_ = robot_model;
+  }
+
+  // compare computeCartesianPathParallel() with computeCartesianPath() along waypoints
+  void compareWithSequential(const EigenSTL::vector_Isometry3d& waypoints)
+  {
+    const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("arm");
+    const moveit::core::LinkModel* tip = robot_model_->getLinkModel("tip");
+    ASSERT_TRUE(group->getSolverInstance());
+    const moveit::core::MaxEEFStep max_step(0.01);
+    const moveit::core::JumpThreshold jump_threshold(10.0);
+
+    moveit::core::RobotState sequential_state(robot_model_);
+    sequential_state.setToDefaultValues();
+    moveit::core::RobotState parallel_state(sequential_state);
+
+    std::vector<moveit::core::RobotStatePtr> sequential_traj;
+    double sequential_fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
+        &sequential_state, group, sequential_traj, tip, waypoints, true, max_step, jump_threshold);
+
+    gantry_concurrent_use = false;
+    std::vector<double> parallel_traj;
+    double parallel_fraction = moveit::core::CartesianInterpolator::computeCartesianPathParallel(
+        &parallel_state, group, parallel_traj, tip, waypoints, true, max_step, jump_threshold, 4);
+    EXPECT_FALSE(gantry_concurrent_use);
+
+    EXPECT_NEAR(sequential_fraction, parallel_fraction, 1e-9);
+    const std::size_t n = group->getVariableCount();
+    ASSERT_EQ(sequential_traj.size() * n, parallel_traj.size());
+    for (std::size_t i = 0; i < sequential_traj.size(); ++i)
+    {
+      std::vector<double> values;
+      sequential_traj[i]->copyJointGroupPositions(group, values);
+      for (std::size_t j = 0; j < n; ++j)
+        EXPECT_NEAR(values[j], parallel_traj[i * n + j], 1e-6) << "point " << i << ", variable " << j;
+    }
+    EXPECT_TRUE(sequential_state.getGlobalLinkTransform(tip).isApprox(parallel_state.getGlobalLinkTransform(tip)));
+  }
+
+  moveit::core::RobotModelConstPtr robot_model_;
+};
+
+TEST_F(GantryRobot, parallelCartesianPathMatchesSequential)
+{
+  EigenSTL::vector_Isometry3d waypoints(2, Eigen::Isometry3d::Identity());
+  waypoints[0].translation() = Eigen::Vector3d(0.5, 0.5, 0.2);
+  waypoints[1].translation() = Eigen::Vector3d(0.9, -0.5, 0.2);
+  compareWithSequential(waypoints);
+}
+
+TEST_F(GantryRobot, parallelCartesianPathStopsLikeSequential)
+{
+  // the second waypoint leaves the joint limits, so the path ends part way
+  EigenSTL::vector_Isometry3d waypoints(2, Eigen::Isometry3d::Identity());
+  waypoints[0].translation() = Eigen::Vector3d(0.5, 0.5, 0.2);
+  waypoints[1].translation() = Eigen::Vector3d(1.5, 0.5, 0.2);
+  compareWithSequential(waypoints);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -37,6 +37,7 @@
 #include <moveit/trajectory_processing/iterative_spline_parameterization.h>
 #include <moveit_msgs/msg/joint_limits.hpp>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/profiler/instrumentation.h>
 #include <vector>
 
 static const double VLIMIT = 1.0;  // default if not specified in model
@@ -87,6 +88,7 @@ bool IterativeSplineParameterization::computeTimeStamps(robot_trajectory::RobotT
                                                         const double max_velocity_scaling_factor,
                                                         const double max_acceleration_scaling_factor) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("trajectory_processing/iterative_spline_parameterization");
   if (trajectory.empty())
     return true;
 
@@ -37,6 +37,7 @@
 #include <moveit/trajectory_processing/iterative_time_parameterization.h>
 #include <moveit_msgs/msg/joint_limits.hpp>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/profiler/instrumentation.h>
 
 namespace trajectory_processing
 {
@@ -462,6 +463,7 @@ bool IterativeParabolicTimeParameterization::computeTimeStamps(robot_trajectory:
                                                                const double max_velocity_scaling_factor,
                                                                const double max_acceleration_scaling_factor) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("trajectory_processing/iterative_time_parameterization");
   if (trajectory.empty())
     return true;
 
@@ -41,6 +41,7 @@
 #include <algorithm>
 #include <cmath>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/profiler/instrumentation.h>
 #include <vector>
 #include "rclcpp/rclcpp.hpp"
 #include <iostream>
@@ -878,6 +879,7 @@ bool TimeOptimalTrajectoryGeneration::computeTimeStamps(robot_trajectory::RobotT
                                                         const double max_velocity_scaling_factor,
                                                         const double max_acceleration_scaling_factor) const
 {
+  MOVEIT_INSTRUMENT_SCOPE("trajectory_processing/time_optimal_trajectory_generation");
   if (trajectory.empty())
     return true;
 
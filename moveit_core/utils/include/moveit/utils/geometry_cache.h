@@ -0,0 +1,161 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <geometric_shapes/shapes.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Content-hashed on-disk cache for geometry that is expensive to compute at startup, such as parsed meshes
+    and sphere decompositions.
+
+    Each entry is a file in the cache directory named after its kind and the hash of everything it was computed
+    from, so stale entries are never returned: if a mesh file or a parameter changes, so does the key. Entries are
+    memory mapped read-only when loaded. They are written to a temporary file first and then renamed, so processes
+    sharing a cache directory never see partially written entries.
+
+    The cache is disabled if no directory is given. The global instance is configured through the
+    MOVEIT_GEOMETRY_CACHE_DIR environment variable. */
+class GeometryCache
+{
+public:
+  /** \brief A read-only memory mapped cache entry */
+  class Entry
+  {
+  public:
+    Entry(void* mapping, std::size_t mapping_size, std::size_t payload_offset);
+    ~Entry();
+    Entry(const Entry&) = delete;
+    Entry& operator=(const Entry&) = delete;
+
+    /** \brief The stored data, without the entry header */
+    const char* data() const
+    {
+      return static_cast<const char*>(mapping_) + payload_offset_;
+    }
+
+    std::size_t size() const
+    {
+      return mapping_size_ - payload_offset_;
+    }
+
+  private:
+    void* mapping_;
+    std::size_t mapping_size_;
+    std::size_t payload_offset_;
+  };
+  using EntryConstPtr = std::shared_ptr<const Entry>;
+
+  /** \brief Create a cache storing its entries in \e directory, which is created if needed. An empty directory
+      disables the cache. */
+  explicit GeometryCache(const std::string& directory = std::string());
+
+  bool isEnabled() const
+  {
+    return !directory_.empty();
+  }
+
+  const std::string& getDirectory() const
+  {
+    return directory_;
+  }
+
+  /** \brief Map the entry of type \e kind stored for \e key. Returns nullptr if there is none or it is invalid. */
+  EntryConstPtr load(const std::string& kind, std::uint64_t key) const;
+
+  /** \brief Store \e data as the entry of type \e kind for \e key. Returns false if the cache is disabled or the
+      entry could not be written. */
+  bool store(const std::string& kind, std::uint64_t key, const std::string& data) const;
+
+  /** \brief The process wide cache, configured from the MOVEIT_GEOMETRY_CACHE_DIR environment variable */
+  static const GeometryCache& getGlobal();
+
+private:
+  std::string getEntryPath(const std::string& kind, std::uint64_t key) const;
+
+  std::string directory_;
+};
+
+/** \brief Incremental 64 bit FNV-1a hash used to compute cache keys */
+class GeometryHasher
+{
+public:
+  GeometryHasher() : hash_(0xcbf29ce484222325ULL)
+  {
+  }
+
+  void add(const void* data, std::size_t size);
+
+  void add(double value)
+  {
+    add(&value, sizeof(value));
+  }
+
+  void add(std::uint64_t value)
+  {
+    add(&value, sizeof(value));
+  }
+
+  void add(const std::string& value)
+  {
+    add(static_cast<std::uint64_t>(value.size()));
+    add(value.data(), value.size());
+  }
+
+  /** \brief Add the type and dimensions of \e shape. Returns false for shapes that can't be hashed (octrees). */
+  bool add(const shapes::Shape& shape);
+
+  std::uint64_t get() const
+  {
+    return hash_;
+  }
+
+private:
+  std::uint64_t hash_;
+};
+
+/** \brief Serialize the vertices, triangles and normals of \e mesh for storage in a GeometryCache */
+std::string serializeMesh(const shapes::Mesh& mesh);
+
+/** \brief Reconstruct a mesh stored with serializeMesh(). Returns nullptr if the data is malformed. */
+shapes::Mesh* deserializeMesh(const char* data, std::size_t size);
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,309 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/geometry_cache.h>
+#include <rclcpp/logging.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moveit
+{
+namespace core
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_utils.geometry_cache");
+
+namespace
+{
+const std::uint32_t CACHE_MAGIC = 0x4347564d;  // "MVGC"
+const std::uint32_t CACHE_VERSION = 1;
+
+struct EntryHeader
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint64_t payload_size;
+};
+
+const std::uint8_t MESH_HAS_TRIANGLE_NORMALS = 1;
+const std::uint8_t MESH_HAS_VERTEX_NORMALS = 2;
+
+template <typename T>
+void append(std::string& out, const T& value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read(const char*& data, const char* end, T* out, std::size_t count = 1)
+{
+  const std::size_t bytes = sizeof(T) * count;
+  if (static_cast<std::size_t>(end - data) < bytes)
+    return false;
+  std::memcpy(out, data, bytes);
+  data += bytes;
+  return true;
+}
+}  // namespace
+
+GeometryCache::Entry::Entry(void* mapping, std::size_t mapping_size, std::size_t payload_offset)
+  : mapping_(mapping), mapping_size_(mapping_size), payload_offset_(payload_offset)
+{
+}
+
+GeometryCache::Entry::~Entry()
+{
+  munmap(mapping_, mapping_size_);
+}
+
+GeometryCache::GeometryCache(const std::string& directory)
+{
+  if (directory.empty())
+    return;
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory, ec);
+  if (ec || !boost::filesystem::is_directory(directory))
+  {
+    RCLCPP_WARN(LOGGER, "Unable to use '%s' as geometry cache directory; caching is disabled", directory.c_str());
+    return;
+  }
+  directory_ = directory;
+}
+
+std::string GeometryCache::getEntryPath(const std::string& kind, std::uint64_t key) const
+{
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+  return (boost::filesystem::path(directory_) / (kind + "_" + name + ".bin")).string();
+}
+
+GeometryCache::EntryConstPtr GeometryCache::load(const std::string& kind, std::uint64_t key) const
+{
+  if (!isEnabled())
+    return EntryConstPtr();
+
+  const std::string path = getEntryPath(kind, key);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return EntryConstPtr();
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(EntryHeader))
+  {
+    close(fd);
+    return EntryConstPtr();
+  }
+
+  const std::size_t size = st.st_size;
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return EntryConstPtr();
+
+  auto entry = std::make_shared<const Entry>(mapping, size, sizeof(EntryHeader));
+  const EntryHeader* header = static_cast<const EntryHeader*>(mapping);
+  if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION || header->key != key ||
+      header->payload_size != size - sizeof(EntryHeader))
+  {
+    RCLCPP_DEBUG(LOGGER, "Ignoring invalid geometry cache entry '%s'", path.c_str());
+    return EntryConstPtr();
+  }
+  return entry;
+}
+
+bool GeometryCache::store(const std::string& kind, std::uint64_t key, const std::string& data) const
+{
+  if (!isEnabled())
+    return false;
+
+  const std::string path = getEntryPath(kind, key);
+  const std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+
+  EntryHeader header;
+  header.magic = CACHE_MAGIC;
+  header.version = CACHE_VERSION;
+  header.key = key;
+  header.payload_size = data.size();
+
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (!file)
+  {
+    RCLCPP_DEBUG(LOGGER, "Unable to write geometry cache entry '%s'", tmp_path.c_str());
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            (data.empty() || fwrite(data.data(), data.size(), 1, file) == 1);
+  ok = (fclose(file) == 0) && ok;
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    RCLCPP_DEBUG(LOGGER, "Unable to write geometry cache entry '%s'", path.c_str());
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+const GeometryCache& GeometryCache::getGlobal()
+{
+  static const GeometryCache CACHE([] {
+    const char* directory = std::getenv("MOVEIT_GEOMETRY_CACHE_DIR");
+    return std::string(directory ? directory : "");
+  }());
+  return CACHE;
+}
+
+void GeometryHasher::add(const void* data, std::size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash_ ^= bytes[i];
+    hash_ *= 0x100000001b3ULL;
+  }
+}
+
+bool GeometryHasher::add(const shapes::Shape& shape)
+{
+  add(static_cast<std::uint64_t>(shape.type));
+  switch (shape.type)
+  {
+    case shapes::SPHERE:
+      add(static_cast<const shapes::Sphere&>(shape).radius);
+      return true;
+    case shapes::CYLINDER:
+      add(static_cast<const shapes::Cylinder&>(shape).radius);
+      add(static_cast<const shapes::Cylinder&>(shape).length);
+      return true;
+    case shapes::CONE:
+      add(static_cast<const shapes::Cone&>(shape).radius);
+      add(static_cast<const shapes::Cone&>(shape).length);
+      return true;
+    case shapes::BOX:
+      add(static_cast<const shapes::Box&>(shape).size, 3 * sizeof(double));
+      return true;
+    case shapes::PLANE:
+    {
+      const shapes::Plane& plane = static_cast<const shapes::Plane&>(shape);
+      add(plane.a);
+      add(plane.b);
+      add(plane.c);
+      add(plane.d);
+      return true;
+    }
+    case shapes::MESH:
+    {
+      const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(shape);
+      add(static_cast<std::uint64_t>(mesh.vertex_count));
+      add(static_cast<std::uint64_t>(mesh.triangle_count));
+      add(mesh.vertices, 3 * sizeof(double) * mesh.vertex_count);
+      add(mesh.triangles, 3 * sizeof(unsigned int) * mesh.triangle_count);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+std::string serializeMesh(const shapes::Mesh& mesh)
+{
+  std::string out;
+  out.reserve(2 * sizeof(std::uint32_t) + 1 + 6 * sizeof(double) * mesh.vertex_count +
+              3 * (sizeof(std::uint32_t) + sizeof(double)) * mesh.triangle_count);
+
+  append(out, static_cast<std::uint32_t>(mesh.vertex_count));
+  append(out, static_cast<std::uint32_t>(mesh.triangle_count));
+  std::uint8_t flags = 0;
+  if (mesh.triangle_normals)
+    flags |= MESH_HAS_TRIANGLE_NORMALS;
+  if (mesh.vertex_normals)
+    flags |= MESH_HAS_VERTEX_NORMALS;
+  append(out, flags);
+
+  out.append(reinterpret_cast<const char*>(mesh.vertices), 3 * sizeof(double) * mesh.vertex_count);
+  for (unsigned int i = 0; i < 3 * mesh.triangle_count; ++i)
+    append(out, static_cast<std::uint32_t>(mesh.triangles[i]));
+  if (mesh.triangle_normals)
+    out.append(reinterpret_cast<const char*>(mesh.triangle_normals), 3 * sizeof(double) * mesh.triangle_count);
+  if (mesh.vertex_normals)
+    out.append(reinterpret_cast<const char*>(mesh.vertex_normals), 3 * sizeof(double) * mesh.vertex_count);
+  return out;
+}
+
+shapes::Mesh* deserializeMesh(const char* data, std::size_t size)
+{
+  const char* end = data + size;
+  std::uint32_t vertex_count, triangle_count;
+  std::uint8_t flags;
+  if (!read(data, end, &vertex_count) || !read(data, end, &triangle_count) || !read(data, end, &flags))
+    return nullptr;
+
+  std::size_t expected = 3 * sizeof(double) * vertex_count + 3 * sizeof(std::uint32_t) * triangle_count;
+  if (flags & MESH_HAS_TRIANGLE_NORMALS)
+    expected += 3 * sizeof(double) * triangle_count;
+  if (flags & MESH_HAS_VERTEX_NORMALS)
+    expected += 3 * sizeof(double) * vertex_count;
+  if (static_cast<std::size_t>(end - data) != expected)
+    return nullptr;
+
+  std::unique_ptr<shapes::Mesh> mesh(new shapes::Mesh(vertex_count, triangle_count));
+  read(data, end, mesh->vertices, 3 * vertex_count);
+  for (unsigned int i = 0; i < 3 * triangle_count; ++i)
+  {
+    std::uint32_t index;
+    read(data, end, &index);
+    if (index >= vertex_count)
+      return nullptr;
+    mesh->triangles[i] = index;
+  }
+  if (flags & MESH_HAS_TRIANGLE_NORMALS)
+  {
+    mesh->triangle_normals = new double[3 * triangle_count];
+    read(data, end, mesh->triangle_normals, 3 * triangle_count);
+  }
+  if (flags & MESH_HAS_VERTEX_NORMALS)
+  {
+    mesh->vertex_normals = new double[3 * vertex_count];
+    read(data, end, mesh->vertex_normals, 3 * vertex_count);
+  }
+  return mesh.release();
+}
+}  // namespace core
+}  // namespace moveit
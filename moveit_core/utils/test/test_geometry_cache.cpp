@@ -0,0 +1,124 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/geometry_cache.h>
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+
+using moveit::core::GeometryCache;
+using moveit::core::GeometryHasher;
+
+class GeometryCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    directory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("geometry_cache_%%%%%%%%");
+  }
+
+  void TearDown() override
+  {
+    boost::filesystem::remove_all(directory_);
+  }
+
+  boost::filesystem::path directory_;
+};
+
+TEST_F(GeometryCacheTest, StoreAndLoad)
+{
+  GeometryCache cache(directory_.string());
+  ASSERT_TRUE(cache.isEnabled());
+  EXPECT_FALSE(cache.load("test", 42));
+
+  ASSERT_TRUE(cache.store("test", 42, "payload"));
+  GeometryCache::EntryConstPtr entry = cache.load("test", 42);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(std::string(entry->data(), entry->size()), "payload");
+
+  EXPECT_FALSE(cache.load("test", 43));
+  EXPECT_FALSE(cache.load("other", 42));
+}
+
+TEST_F(GeometryCacheTest, Disabled)
+{
+  GeometryCache cache;
+  EXPECT_FALSE(cache.isEnabled());
+  EXPECT_FALSE(cache.store("test", 42, "payload"));
+  EXPECT_FALSE(cache.load("test", 42));
+}
+
+TEST(GeometryHasher, Shapes)
+{
+  GeometryHasher box_a, box_b, box_c, sphere;
+  EXPECT_TRUE(box_a.add(shapes::Box(1.0, 2.0, 3.0)));
+  EXPECT_TRUE(box_b.add(shapes::Box(1.0, 2.0, 3.0)));
+  EXPECT_TRUE(box_c.add(shapes::Box(1.0, 2.0, 3.5)));
+  EXPECT_TRUE(sphere.add(shapes::Sphere(1.0)));
+  EXPECT_EQ(box_a.get(), box_b.get());
+  EXPECT_NE(box_a.get(), box_c.get());
+  EXPECT_NE(box_a.get(), sphere.get());
+}
+
+TEST(GeometryCache, MeshSerialization)
+{
+  shapes::Mesh mesh(4, 2);
+  for (unsigned int i = 0; i < 12; ++i)
+    mesh.vertices[i] = 0.5 * i;
+  const unsigned int triangles[] = { 0, 1, 2, 0, 2, 3 };
+  std::copy(triangles, triangles + 6, mesh.triangles);
+  mesh.computeTriangleNormals();
+
+  const std::string data = moveit::core::serializeMesh(mesh);
+  std::unique_ptr<shapes::Mesh> copy(moveit::core::deserializeMesh(data.data(), data.size()));
+  ASSERT_TRUE(copy);
+  ASSERT_EQ(copy->vertex_count, mesh.vertex_count);
+  ASSERT_EQ(copy->triangle_count, mesh.triangle_count);
+  for (unsigned int i = 0; i < 12; ++i)
+    EXPECT_EQ(copy->vertices[i], mesh.vertices[i]);
+  for (unsigned int i = 0; i < 6; ++i)
+  {
+    EXPECT_EQ(copy->triangles[i], mesh.triangles[i]);
+    EXPECT_EQ(copy->triangle_normals[i], mesh.triangle_normals[i]);
+  }
+  EXPECT_EQ(copy->vertex_normals, nullptr);
+
+  EXPECT_EQ(moveit::core::deserializeMesh(data.data(), data.size() - 1), nullptr);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
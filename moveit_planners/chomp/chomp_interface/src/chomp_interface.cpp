@@ -73,5 +73,8 @@ void CHOMPInterface::loadParams()
             std::string("quintic-spline"));
   nh_.param("enable_failure_recovery", params_.enable_failure_recovery_, false);
   nh_.param("max_recovery_attempts", params_.max_recovery_attempts_, 5);
+  nh_.param("max_threads", params_.max_threads_, 1);
+  nh_.param("parallel_starts", params_.parallel_starts_, 1);
+  nh_.param("parallel_start_cost_threshold", params_.parallel_start_cost_threshold_, 0.0);
 }
 }  // namespace chomp_interface
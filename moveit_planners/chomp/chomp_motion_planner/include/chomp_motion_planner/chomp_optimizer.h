@@ -46,6 +46,10 @@
 
 #include <Eigen/Core>
 #include <Eigen/StdVector>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace chomp
@@ -65,10 +69,8 @@ public:
    */
   bool optimize();
 
-  inline void destroy()
-  {
-    // Nothing for now.
-  }
+  /** \brief Stop the threads computing the collision gradients */
+  void destroy();
 
   bool isInitialized() const
   {
@@ -80,6 +82,18 @@ public:
     return is_collision_free_;
   }
 
+  /** \brief Cost of the best trajectory found by the last call to optimize() */
+  double getBestTrajectoryCost() const
+  {
+    return best_group_trajectory_cost_;
+  }
+
+  /** \brief Stop optimize() early, keeping the best trajectory found so far, once \e terminate becomes true */
+  void setTerminationFlag(const std::atomic<bool>* terminate)
+  {
+    terminate_ = terminate;
+  }
+
 private:
   inline double getPotential(double field_distance, double radius, double clearence)
   {
@@ -101,14 +115,32 @@ private:
     }
   }
   template <typename Derived>
-  void getJacobian(int trajectoryPoint, Eigen::Vector3d& collision_point_pos, std::string& jointName,
-                   Eigen::MatrixBase<Derived>& jacobian) const;
+  void getJacobian(int trajectory_point, int collision_point, Eigen::MatrixBase<Derived>& jacobian) const;
 
   // void getRandomState(const moveit::core::RobotState& currentState,
   //                     const std::string& group_name,
   //                     Eigen::VectorXd& state_vec);
 
-  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i);
+  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i, moveit::core::RobotState& state) const;
+
+  /// Index of collision point \e collision_point of trajectory point \e trajectory_point in the collision point buffers
+  inline int getCollisionPointIndex(int trajectory_point, int collision_point) const
+  {
+    return trajectory_point * num_collision_points_ + collision_point;
+  }
+
+  /// Scratch data used to compute the collision gradients of trajectory points in one thread
+  struct CollisionGradientWorker
+  {
+    CollisionGradientWorker(const moveit::core::RobotState& start_state,
+                            const collision_detection::GroupStateRepresentation& gsr)
+      : state(start_state), gsr(new collision_detection::GroupStateRepresentation(gsr))
+    {
+    }
+
+    moveit::core::RobotState state;
+    collision_detection::GroupStateRepresentationPtr gsr;
+  };
 
   // collision_proximity::CollisionProximitySpace::TrajectorySafety checkCurrentIterValidity();
 
@@ -131,20 +163,39 @@ private:
   moveit::core::RobotState start_state_;
   const moveit::core::JointModelGroup* joint_model_group_;
   const collision_detection::CollisionEnvHybrid* hy_env_;
+  const std::atomic<bool>* terminate_;
 
   std::vector<ChompCost> joint_costs_;
   collision_detection::GroupStateRepresentationPtr gsr_;
   bool initialized_;
 
-  std::vector<std::vector<std::string> > collision_point_joint_names_;
-  std::vector<EigenSTL::vector_Vector3d> collision_point_pos_eigen_;
-  std::vector<EigenSTL::vector_Vector3d> collision_point_vel_eigen_;
-  std::vector<EigenSTL::vector_Vector3d> collision_point_acc_eigen_;
-  std::vector<std::vector<double> > collision_point_potential_;
-  std::vector<std::vector<double> > collision_point_vel_mag_;
-  std::vector<EigenSTL::vector_Vector3d> collision_point_potential_gradient_;
-  std::vector<EigenSTL::vector_Vector3d> joint_axes_;
-  std::vector<EigenSTL::vector_Vector3d> joint_positions_;
+  std::vector<CollisionGradientWorker> collision_gradient_workers_;
+
+  /** Threads of the workers after the first, started with the workers and kept until the optimizer is destroyed;
+      performForwardKinematics() hands them a batch of trajectory points by incrementing collision_gradient_batch_ */
+  std::vector<std::thread> collision_gradient_threads_;
+  std::mutex collision_gradient_mutex_;
+  std::condition_variable collision_gradient_start_condition_;
+  std::condition_variable collision_gradient_done_condition_;
+  unsigned int collision_gradient_batch_;
+  int collision_gradient_start_;
+  int collision_gradient_points_;
+  int collision_gradient_active_workers_;
+  int collision_gradient_pending_workers_;
+  bool stop_collision_gradient_threads_;
+
+  // Collision point data of all trajectory points, stored contiguously; the entry of collision point j of trajectory
+  // point i is at getCollisionPointIndex(i, j). Positions, velocities, accelerations and gradients are matrix columns.
+  std::vector<std::string> collision_point_joint_names_;
+  Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> collision_point_joint_parents_;  // collision point x joint
+  Eigen::Matrix3Xd collision_point_pos_eigen_;
+  Eigen::Matrix3Xd collision_point_vel_eigen_;
+  Eigen::Matrix3Xd collision_point_acc_eigen_;
+  Eigen::VectorXd collision_point_potential_;
+  Eigen::VectorXd collision_point_vel_mag_;
+  Eigen::Matrix3Xd collision_point_potential_gradient_;
+  Eigen::Matrix3Xd joint_axes_;       // column i * num_joints_ + j is the axis of joint j at trajectory point i
+  Eigen::Matrix3Xd joint_positions_;  // column i * num_joints_ + j is the position of joint j at trajectory point i
   Eigen::MatrixXd group_trajectory_backup_;
   Eigen::MatrixXd best_group_trajectory_;
   double best_group_trajectory_cost_;
@@ -160,7 +211,7 @@ private:
 
   std::vector<int> state_is_in_collision_; /**< Array containing a boolean about collision info for each point in the
                                               trajectory */
-  std::vector<std::vector<int> > point_is_in_collision_;
+  std::vector<int> point_is_in_collision_;
   bool is_collision_free_;
   double worst_collision_cost_state_;
 
@@ -201,6 +252,9 @@ private:
   void calculateCollisionIncrements();
   void calculateTotalIncrements();
   void performForwardKinematics();
+  void computeCollisionPoints(int trajectory_point, CollisionGradientWorker& worker);
+  void computeCollisionPointBlock(int start, int num_points, int num_workers, int worker_index);
+  void collisionGradientThread(int worker_index);
   void addIncrementsToTrajectory();
   void updateFullTrajectory();
   void debugCost();
@@ -213,7 +267,7 @@ private:
   void updateMomentum();
   void updatePositionFromMomentum();
   void calculatePseudoInverse();
-  void computeJointProperties(int trajectoryPoint);
+  void computeJointProperties(int trajectory_point, const moveit::core::RobotState& state);
   bool isCurrentTrajectoryMeshToMeshCollisionFree() const;
 };
 }
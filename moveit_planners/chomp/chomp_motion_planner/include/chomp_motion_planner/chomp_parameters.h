@@ -94,6 +94,12 @@ public:
                                   /// an initial path is not found with the specified chomp parameters
   int max_recovery_attempts_;     /// this the maximum recovery attempts to find a collision free path after an initial
                                   /// failure to find a solution
+  int max_threads_;  /// maximum number of threads used to compute the collision gradients of the trajectory points,
+                     /// 1 by default, 0 uses one thread per hardware core
+  int parallel_starts_;  /// number of differently initialized optimizations run concurrently, the best result is kept
+  double parallel_start_cost_threshold_;  /// once a start is collision free with a cost below this value, the other
+                                          /// starts are stopped; a value <= 0 stops them at the first collision free
+                                          /// result
 };
 
 }  // namespace chomp
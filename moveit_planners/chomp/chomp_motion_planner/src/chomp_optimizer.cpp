@@ -43,7 +43,9 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <eigen3/Eigen/LU>
 #include <eigen3/Eigen/Core>
+#include <algorithm>
 #include <random>
+#include <thread>
 
 namespace chomp
 {
@@ -65,7 +67,14 @@ ChompOptimizer::ChompOptimizer(ChompTrajectory* trajectory, const planning_scene
   , planning_scene_(planning_scene)
   , state_(start_state)
   , start_state_(start_state)
+  , terminate_(nullptr)
   , initialized_(false)
+  , collision_gradient_batch_(0)
+  , collision_gradient_start_(0)
+  , collision_gradient_points_(0)
+  , collision_gradient_active_workers_(0)
+  , collision_gradient_pending_workers_(0)
+  , stop_collision_gradient_threads_(false)
 {
   std::vector<std::string> cd_names;
   planning_scene->getCollisionDetectorNames(cd_names);
@@ -153,21 +162,35 @@ void ChompOptimizer::initialize()
   group_trajectory_backup_ = group_trajectory_.getTrajectory();
   best_group_trajectory_ = group_trajectory_.getTrajectory();
 
-  collision_point_joint_names_.resize(num_vars_all_, std::vector<std::string>(num_collision_points_));
-  collision_point_pos_eigen_.resize(num_vars_all_, EigenSTL::vector_Vector3d(num_collision_points_));
-  collision_point_vel_eigen_.resize(num_vars_all_, EigenSTL::vector_Vector3d(num_collision_points_));
-  collision_point_acc_eigen_.resize(num_vars_all_, EigenSTL::vector_Vector3d(num_collision_points_));
-  joint_axes_.resize(num_vars_all_, EigenSTL::vector_Vector3d(num_joints_));
-  joint_positions_.resize(num_vars_all_, EigenSTL::vector_Vector3d(num_joints_));
+  const int num_collision_point_entries = num_vars_all_ * num_collision_points_;
+  collision_point_joint_names_.resize(num_collision_points_);
+  collision_point_joint_parents_.setZero(num_collision_points_, num_joints_);
+  collision_point_pos_eigen_.setZero(3, num_collision_point_entries);
+  collision_point_vel_eigen_.setZero(3, num_collision_point_entries);
+  collision_point_acc_eigen_.setZero(3, num_collision_point_entries);
+  joint_axes_.setZero(3, num_vars_all_ * num_joints_);
+  joint_positions_.setZero(3, num_vars_all_ * num_joints_);
 
-  collision_point_potential_.resize(num_vars_all_, std::vector<double>(num_collision_points_));
-  collision_point_vel_mag_.resize(num_vars_all_, std::vector<double>(num_collision_points_));
-  collision_point_potential_gradient_.resize(num_vars_all_, EigenSTL::vector_Vector3d(num_collision_points_));
+  collision_point_potential_.setZero(num_collision_point_entries);
+  collision_point_vel_mag_.setZero(num_collision_point_entries);
+  collision_point_potential_gradient_.setZero(3, num_collision_point_entries);
 
   collision_free_iteration_ = 0;
   is_collision_free_ = false;
   state_is_in_collision_.resize(num_vars_all_);
-  point_is_in_collision_.resize(num_vars_all_, std::vector<int>(num_collision_points_));
+  point_is_in_collision_.resize(num_collision_point_entries);
+
+  // each thread computing collision gradients needs its own robot state and group state representation
+  int num_threads = parameters_->max_threads_ > 0 ? parameters_->max_threads_ :
+                                                    std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  num_threads = std::max(1, std::min(num_threads, num_vars_all_));
+  collision_gradient_workers_.clear();
+  collision_gradient_workers_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i)
+    collision_gradient_workers_.emplace_back(state_, *gsr_);
+  // the first worker runs in the optimizing thread, the others in threads kept for all iterations
+  for (int i = 1; i < num_threads; ++i)
+    collision_gradient_threads_.emplace_back(&ChompOptimizer::collisionGradientThread, this, i);
 
   last_improvement_iteration_ = -1;
 
@@ -233,27 +256,28 @@ void ChompOptimizer::initialize()
     }
   }
 
-  int start = free_vars_start_;
-  int end = free_vars_end_;
-  for (int i = start; i <= end; ++i)
+  // the joint moving a collision point is the same for all trajectory points
+  size_t collision_point = 0;
+  for (const collision_detection::GradientInfo& info : gsr_->gradients_)
   {
-    size_t j = 0;
-    for (const collision_detection::GradientInfo& info : gsr_->gradients_)
+    for (size_t k = 0; k < info.sphere_locations.size(); k++)
     {
-      for (size_t k = 0; k < info.sphere_locations.size(); k++)
+      if (fixed_link_resolution_map.find(info.joint_name) != fixed_link_resolution_map.end())
       {
-        if (fixed_link_resolution_map.find(info.joint_name) != fixed_link_resolution_map.end())
-        {
-          collision_point_joint_names_[i][j] = fixed_link_resolution_map[info.joint_name];
-        }
-        else
-        {
-          ROS_ERROR("Couldn't find joint %s!", info.joint_name.c_str());
-        }
-        j++;
+        collision_point_joint_names_[collision_point] = fixed_link_resolution_map[info.joint_name];
       }
+      else
+      {
+        ROS_ERROR("Couldn't find joint %s!", info.joint_name.c_str());
+      }
+      collision_point++;
     }
   }
+
+  // cache which joints move each collision point, so the Jacobians don't need joint name lookups
+  for (int j = 0; j < num_collision_points_; j++)
+    for (int k = 0; k < num_joints_; k++)
+      collision_point_joint_parents_(j, k) = isParent(collision_point_joint_names_[j], joint_names_[k]);
   initialized_ = true;
 }
 
@@ -262,6 +286,18 @@ ChompOptimizer::~ChompOptimizer()
   destroy();
 }
 
+void ChompOptimizer::destroy()
+{
+  {
+    std::lock_guard<std::mutex> lock(collision_gradient_mutex_);
+    stop_collision_gradient_threads_ = true;
+  }
+  collision_gradient_start_condition_.notify_all();
+  for (std::thread& thread : collision_gradient_threads_)
+    thread.join();
+  collision_gradient_threads_.clear();
+}
+
 void ChompOptimizer::registerParents(const moveit::core::JointModel* model)
 {
   const moveit::core::JointModel* parent_model = nullptr;
@@ -439,6 +475,12 @@ bool ChompOptimizer::optimize()
       break;
     }
 
+    if (terminate_ && terminate_->load())
+    {
+      ROS_INFO("Breaking out early, the optimization was terminated.");
+      break;
+    }
+
     /// TODO: HMC BASED COMMENTED CODE BELOW, Need to uncomment and perform extensive testing by varying the HMC
     /// parameters values in the chomp_planning.yaml file so that CHOMP can find optimal paths
 
@@ -626,25 +668,26 @@ void ChompOptimizer::calculateCollisionIncrements()
   {
     for (int j = 0; j < num_collision_points_; j++)
     {
-      potential = collision_point_potential_[i][j];
+      const int index = getCollisionPointIndex(i, j);
+      potential = collision_point_potential_[index];
 
       if (potential < 0.0001)
         continue;
 
-      potential_gradient = -collision_point_potential_gradient_[i][j];
+      potential_gradient = -collision_point_potential_gradient_.col(index);
 
-      vel_mag = collision_point_vel_mag_[i][j];
+      vel_mag = collision_point_vel_mag_[index];
       vel_mag_sq = vel_mag * vel_mag;
 
       // all math from the CHOMP paper:
 
-      normalized_velocity = collision_point_vel_eigen_[i][j] / vel_mag;
+      normalized_velocity = collision_point_vel_eigen_.col(index) / vel_mag;
       orthogonal_projector = Eigen::Matrix3d::Identity() - (normalized_velocity * normalized_velocity.transpose());
-      curvature_vector = (orthogonal_projector * collision_point_acc_eigen_[i][j]) / vel_mag_sq;
+      curvature_vector = (orthogonal_projector * collision_point_acc_eigen_.col(index)) / vel_mag_sq;
       cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
 
       // pass it through the jacobian transpose to get the increments
-      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian_);
+      getJacobian(i, j, jacobian_);
 
       if (parameters_->use_pseudo_inverse_)
       {
@@ -657,7 +700,7 @@ void ChompOptimizer::calculateCollisionIncrements()
       }
 
       /*
-        if(point_is_in_collision_[i][j])
+        if(point_is_in_collision_[index])
         {
         break;
         }
@@ -743,11 +786,9 @@ double ChompOptimizer::getCollisionCost()
   // collision costs:
   for (int i = free_vars_start_; i <= free_vars_end_; i++)
   {
-    double state_collision_cost = 0.0;
-    for (int j = 0; j < num_collision_points_; j++)
-    {
-      state_collision_cost += collision_point_potential_[i][j] * collision_point_vel_mag_[i][j];
-    }
+    const int index = getCollisionPointIndex(i, 0);
+    double state_collision_cost = collision_point_potential_.segment(index, num_collision_points_)
+                                      .dot(collision_point_vel_mag_.segment(index, num_collision_points_));
     collision_cost += state_collision_cost;
     if (state_collision_cost > worst_collision_cost)
     {
@@ -759,11 +800,11 @@ double ChompOptimizer::getCollisionCost()
   return parameters_->obstacle_cost_weight_ * collision_cost;
 }
 
-void ChompOptimizer::computeJointProperties(int trajectory_point)
+void ChompOptimizer::computeJointProperties(int trajectory_point, const moveit::core::RobotState& state)
 {
   for (int j = 0; j < num_joints_; j++)
   {
-    const moveit::core::JointModel* joint_model = state_.getJointModel(joint_names_[j]);
+    const moveit::core::JointModel* joint_model = state.getJointModel(joint_names_[j]);
     const moveit::core::RevoluteJointModel* revolute_joint =
         dynamic_cast<const moveit::core::RevoluteJointModel*>(joint_model);
     const moveit::core::PrismaticJointModel* prismatic_joint =
@@ -771,9 +812,9 @@ void ChompOptimizer::computeJointProperties(int trajectory_point)
 
     std::string parent_link_name = joint_model->getParentLinkModel()->getName();
     std::string child_link_name = joint_model->getChildLinkModel()->getName();
-    Eigen::Isometry3d joint_transform = state_.getGlobalLinkTransform(parent_link_name) *
+    Eigen::Isometry3d joint_transform = state.getGlobalLinkTransform(parent_link_name) *
                                         (robot_model_->getLinkModel(child_link_name)->getJointOriginTransform() *
-                                         (state_.getJointTransform(joint_model)));
+                                         (state.getJointTransform(joint_model)));
 
     // joint_transform = inverseWorldTransform * jointTransform;
     Eigen::Vector3d axis;
@@ -793,22 +834,23 @@ void ChompOptimizer::computeJointProperties(int trajectory_point)
 
     axis = joint_transform * axis;
 
-    joint_axes_[trajectory_point][j] = axis;
-    joint_positions_[trajectory_point][j] = joint_transform.translation();
+    joint_axes_.col(trajectory_point * num_joints_ + j) = axis;
+    joint_positions_.col(trajectory_point * num_joints_ + j) = joint_transform.translation();
   }
 }
 
 template <typename Derived>
-void ChompOptimizer::getJacobian(int trajectory_point, Eigen::Vector3d& collision_point_pos, std::string& joint_name,
-                                 Eigen::MatrixBase<Derived>& jacobian) const
+void ChompOptimizer::getJacobian(int trajectory_point, int collision_point, Eigen::MatrixBase<Derived>& jacobian) const
 {
+  const Eigen::Vector3d collision_point_pos =
+      collision_point_pos_eigen_.col(getCollisionPointIndex(trajectory_point, collision_point));
   for (int j = 0; j < num_joints_; j++)
   {
-    if (isParent(joint_name, joint_names_[j]))
+    if (collision_point_joint_parents_(collision_point, j))
     {
-      Eigen::Vector3d column = joint_axes_[trajectory_point][j].cross(
-          Eigen::Vector3d(collision_point_pos(0), collision_point_pos(1), collision_point_pos(2)) -
-          joint_positions_[trajectory_point][j]);
+      const int joint_index = trajectory_point * num_joints_ + j;
+      Eigen::Vector3d column =
+          joint_axes_.col(joint_index).cross(collision_point_pos - joint_positions_.col(joint_index));
 
       jacobian.col(j)[0] = column.x();
       jacobian.col(j)[1] = column.y();
@@ -918,89 +960,119 @@ void ChompOptimizer::performForwardKinematics()
     end = num_vars_all_ - 1;
   }
 
-  is_collision_free_ = true;
-
-  ros::WallDuration total_dur(0.0);
+  // the trajectory points are independent, so split them into contiguous blocks computed in parallel; the first
+  // block is computed here while the collision gradient threads compute the others
+  const int num_points = end - start + 1;
+  const int num_workers = std::min<int>(collision_gradient_workers_.size(), num_points);
+  if (num_workers <= 1)
+  {
+    computeCollisionPointBlock(start, num_points, 1, 0);
+  }
+  else
+  {
+    {
+      std::lock_guard<std::mutex> lock(collision_gradient_mutex_);
+      collision_gradient_start_ = start;
+      collision_gradient_points_ = num_points;
+      collision_gradient_active_workers_ = num_workers;
+      collision_gradient_pending_workers_ = num_workers - 1;
+      collision_gradient_batch_++;
+    }
+    collision_gradient_start_condition_.notify_all();
+    computeCollisionPointBlock(start, num_points, num_workers, 0);
+    std::unique_lock<std::mutex> lock(collision_gradient_mutex_);
+    collision_gradient_done_condition_.wait(lock, [this] { return collision_gradient_pending_workers_ == 0; });
+  }
 
-  // for each point in the trajectory
+  is_collision_free_ = true;
   for (int i = start; i <= end; ++i)
+    if (state_is_in_collision_[i])
+      is_collision_free_ = false;
+
+  // now, get the vel and acc for each collision point (using finite differencing)
+  for (int i = free_vars_start_; i <= free_vars_end_; i++)
   {
-    // Set Robot state from trajectory point...
-    collision_detection::CollisionRequest req;
-    collision_detection::CollisionResult res;
-    req.group_name = planning_group_;
-    setRobotStateFromPoint(group_trajectory_, i);
-    ros::WallTime grad = ros::WallTime::now();
-
-    hy_env_->getCollisionGradients(req, res, state_, nullptr, gsr_);
-    total_dur += (ros::WallTime::now() - grad);
-    computeJointProperties(i);
-    state_is_in_collision_[i] = false;
-
-    // Keep vars in scope
+    const int index = getCollisionPointIndex(i, 0);
+    auto vel = collision_point_vel_eigen_.middleCols(index, num_collision_points_);
+    auto acc = collision_point_acc_eigen_.middleCols(index, num_collision_points_);
+    vel.setZero();
+    acc.setZero();
+    for (int k = -DIFF_RULE_LENGTH / 2; k <= DIFF_RULE_LENGTH / 2; k++)
     {
-      size_t j = 0;
-      for (const collision_detection::GradientInfo& info : gsr_->gradients_)
-      {
-        for (size_t k = 0; k < info.sphere_locations.size(); k++)
-        {
-          collision_point_pos_eigen_[i][j][0] = info.sphere_locations[k].x();
-          collision_point_pos_eigen_[i][j][1] = info.sphere_locations[k].y();
-          collision_point_pos_eigen_[i][j][2] = info.sphere_locations[k].z();
+      const auto pos = collision_point_pos_eigen_.middleCols(getCollisionPointIndex(i + k, 0), num_collision_points_);
+      vel += (inv_time * DIFF_RULES[0][k + DIFF_RULE_LENGTH / 2]) * pos;
+      acc += (inv_time_sq * DIFF_RULES[1][k + DIFF_RULE_LENGTH / 2]) * pos;
+    }
 
-          collision_point_potential_[i][j] =
-              getPotential(info.distances[k], info.sphere_radii[k], parameters_->min_clearence_);
-          collision_point_potential_gradient_[i][j][0] = info.gradients[k].x();
-          collision_point_potential_gradient_[i][j][1] = info.gradients[k].y();
-          collision_point_potential_gradient_[i][j][2] = info.gradients[k].z();
+    // get the norm of the velocity:
+    collision_point_vel_mag_.segment(index, num_collision_points_) = vel.colwise().norm().transpose();
+  }
+}
 
-          point_is_in_collision_[i][j] = (info.distances[k] - info.sphere_radii[k] < info.sphere_radii[k]);
+void ChompOptimizer::computeCollisionPointBlock(int start, int num_points, int num_workers, int worker_index)
+{
+  for (int i = start + num_points * worker_index / num_workers;
+       i < start + num_points * (worker_index + 1) / num_workers; ++i)
+    computeCollisionPoints(i, collision_gradient_workers_[worker_index]);
+}
 
-          if (point_is_in_collision_[i][j])
-          {
-            state_is_in_collision_[i] = true;
-            // if(is_collision_free_ == true) {
-            //   ROS_INFO_STREAM("We know it's not collision free " << g);
-            //   ROS_INFO_STREAM("Sphere location " << info.sphere_locations[k].x() << " " <<
-            //   info.sphere_locations[k].y() << " " << info.sphere_locations[k].z());
-            //   ROS_INFO_STREAM("Gradient " << info.gradients[k].x() << " " << info.gradients[k].y() << " " <<
-            //   info.gradients[k].z() << " distance " << info.distances[k] << " radii " << info.sphere_radii[k]);
-            //   ROS_INFO_STREAM("Radius " << info.sphere_radii[k] << " potential " <<
-            //   collision_point_potential_[i][j]);
-            // }
-
-            is_collision_free_ = false;
-          }
-          j++;
-        }
-      }
-    }
+void ChompOptimizer::collisionGradientThread(int worker_index)
+{
+  unsigned int batch = 0;
+  std::unique_lock<std::mutex> lock(collision_gradient_mutex_);
+  while (true)
+  {
+    collision_gradient_start_condition_.wait(
+        lock, [this, batch] { return stop_collision_gradient_threads_ || collision_gradient_batch_ != batch; });
+    if (stop_collision_gradient_threads_)
+      return;
+    batch = collision_gradient_batch_;
+    if (worker_index >= collision_gradient_active_workers_)
+      continue;
+    const int start = collision_gradient_start_;
+    const int num_points = collision_gradient_points_;
+    const int num_workers = collision_gradient_active_workers_;
+    lock.unlock();
+    computeCollisionPointBlock(start, num_points, num_workers, worker_index);
+    lock.lock();
+    if (--collision_gradient_pending_workers_ == 0)
+      collision_gradient_done_condition_.notify_one();
   }
+}
+
+void ChompOptimizer::computeCollisionPoints(int trajectory_point, CollisionGradientWorker& worker)
+{
+  // Set Robot state from trajectory point...
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = planning_group_;
+  setRobotStateFromPoint(group_trajectory_, trajectory_point, worker.state);
 
-  // ROS_INFO_STREAM("Total dur " << total_dur << " total checks " << end-start+1);
+  hy_env_->getCollisionGradients(req, res, worker.state, nullptr, worker.gsr);
+  computeJointProperties(trajectory_point, worker.state);
 
-  // now, get the vel and acc for each collision point (using finite differencing)
-  for (int i = free_vars_start_; i <= free_vars_end_; i++)
+  bool in_collision = false;
+  int index = getCollisionPointIndex(trajectory_point, 0);
+  for (const collision_detection::GradientInfo& info : worker.gsr->gradients_)
   {
-    for (int j = 0; j < num_collision_points_; j++)
+    for (size_t k = 0; k < info.sphere_locations.size(); k++)
     {
-      collision_point_vel_eigen_[i][j] = Eigen::Vector3d(0, 0, 0);
-      collision_point_acc_eigen_[i][j] = Eigen::Vector3d(0, 0, 0);
-      for (int k = -DIFF_RULE_LENGTH / 2; k <= DIFF_RULE_LENGTH / 2; k++)
-      {
-        collision_point_vel_eigen_[i][j] +=
-            (inv_time * DIFF_RULES[0][k + DIFF_RULE_LENGTH / 2]) * collision_point_pos_eigen_[i + k][j];
-        collision_point_acc_eigen_[i][j] +=
-            (inv_time_sq * DIFF_RULES[1][k + DIFF_RULE_LENGTH / 2]) * collision_point_pos_eigen_[i + k][j];
-      }
-
-      // get the norm of the velocity:
-      collision_point_vel_mag_[i][j] = collision_point_vel_eigen_[i][j].norm();
+      collision_point_pos_eigen_.col(index) = info.sphere_locations[k];
+      collision_point_potential_[index] =
+          getPotential(info.distances[k], info.sphere_radii[k], parameters_->min_clearence_);
+      collision_point_potential_gradient_.col(index) = info.gradients[k];
+
+      point_is_in_collision_[index] = (info.distances[k] - info.sphere_radii[k] < info.sphere_radii[k]);
+      if (point_is_in_collision_[index])
+        in_collision = true;
+      index++;
     }
   }
+  state_is_in_collision_[trajectory_point] = in_collision;
 }
 
-void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i)
+void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i,
+                                            moveit::core::RobotState& state) const
 {
   const Eigen::MatrixXd::RowXpr& point = group_trajectory.getTrajectoryPoint(i);
 
@@ -1009,8 +1081,8 @@ void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, i
   for (size_t j = 0; j < group_trajectory.getNumJoints(); j++)
     joint_states.emplace_back(point(0, j));
 
-  state_.setJointGroupPositions(planning_group_, joint_states);
-  state_.update();
+  state.setJointGroupPositions(planning_group_, joint_states);
+  state.update();
 }
 
 void ChompOptimizer::perturbTrajectory()
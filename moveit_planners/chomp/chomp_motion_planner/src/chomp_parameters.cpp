@@ -68,6 +68,9 @@ ChompParameters::ChompParameters()
   trajectory_initialization_method_ = std::string("quintic-spline");
   enable_failure_recovery_ = false;
   max_recovery_attempts_ = 5;
+  max_threads_ = 1;
+  parallel_starts_ = 1;
+  parallel_start_cost_threshold_ = 0.0;
 }
 
 ChompParameters::~ChompParameters() = default;
@@ -39,9 +39,200 @@
 #include <chomp_motion_planner/chomp_trajectory.h>
 #include <chomp_motion_planner/chomp_optimizer.h>
 #include <moveit/robot_state/conversions.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
 
 namespace chomp
 {
+namespace
+{
+/// Outcome of optimizing one initial trajectory
+struct OptimizationResult
+{
+  bool initialized = false;
+  bool collision_free = false;
+  double cost = std::numeric_limits<double>::infinity();
+};
+
+// fill in the trajectory points between start and goal using one of the initialization methods
+bool initializeTrajectory(ChompTrajectory& trajectory, const std::string& method,
+                          const planning_interface::MotionPlanDetailedResponse& res)
+{
+  if (method == "quintic-spline")
+    trajectory.fillInMinJerk();
+  else if (method == "linear")
+    trajectory.fillInLinearInterpolation();
+  else if (method == "cubic")
+    trajectory.fillInCubicInterpolation();
+  else if (method == "fillTrajectory")
+  {
+    if (res.trajectory_.empty() || !res.trajectory_[0] || !trajectory.fillInFromTrajectory(*res.trajectory_[0]))
+    {
+      ROS_ERROR_STREAM_NAMED("chomp_planner", "Input trajectory has less than 2 points, "
+                                              "trajectory must contain at least start and goal state");
+      return false;
+    }
+  }
+  else
+  {
+    ROS_ERROR_STREAM_NAMED("chomp_planner", "invalid interpolation method specified in the chomp_planner file");
+    return false;
+  }
+  return true;
+}
+
+// add a smooth random offset to the joints of all points but start and goal
+void perturbTrajectory(ChompTrajectory& trajectory, unsigned int seed)
+{
+  static const double MAX_OFFSET = 0.3;  // [rad] or [m], at the middle of the trajectory
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> offset(-MAX_OFFSET, MAX_OFFSET);
+  const size_t last = trajectory.getNumPoints() - 1;
+  for (size_t j = 0; j < trajectory.getNumJoints(); ++j)
+  {
+    const double amplitude = offset(generator);
+    for (size_t i = 1; i < last; ++i)
+      trajectory(i, j) += amplitude * std::sin(M_PI * i / last);
+  }
+}
+
+// optimize the trajectory, retrying with modified parameters if failure recovery is enabled
+OptimizationResult optimizeWithRecovery(ChompTrajectory& trajectory,
+                                        const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                        const std::string& group_name, const robot_state::RobotState& start_state,
+                                        ChompParameters params, const std::atomic<bool>* terminate)
+{
+  OptimizationResult result;
+  int replan_count = 0;
+  bool replan_flag = false;
+  ros::WallTime create_time = ros::WallTime::now();
+
+  // while loop for replanning (recovery behaviour) if collision free optimized solution not found
+  while (true)
+  {
+    if (replan_flag)
+    {
+      // increase learning rate in hope to find a successful path; increase ridge factor to avoid obstacles; add 5
+      // additional secs in hope to find a solution; increase maximum iterations
+      params.setRecoveryParams(params.learning_rate_ + 0.02, params.ridge_factor_ + 0.002,
+                               params.planning_time_limit_ + 5, params.max_iterations_ + 50);
+    }
+
+    // initialize a ChompOptimizer object to load up the optimizer with default parameters or with updated parameters in
+    // case of a recovery behaviour
+    ChompOptimizer optimizer(&trajectory, planning_scene, group_name, &params, start_state);
+    if (!optimizer.isInitialized())
+      return result;
+    result.initialized = true;
+    optimizer.setTerminationFlag(terminate);
+
+    ROS_DEBUG_NAMED("chomp_planner", "Optimization took %f sec to create",
+                    (ros::WallTime::now() - create_time).toSec());
+
+    bool optimization_result = optimizer.optimize();
+    result.collision_free = optimizer.isCollisionFree();
+    result.cost = optimizer.getBestTrajectoryCost();
+
+    // replan with updated parameters if no solution is found
+    if (params.enable_failure_recovery_ && !(terminate && terminate->load()))
+    {
+      ROS_INFO_NAMED("chomp_planner", "Planned with Chomp Parameters (learning_rate, ridge_factor, "
+                                      "planning_time_limit, max_iterations), attempt: # %d ",
+                     (replan_count + 1));
+      ROS_INFO_NAMED("chomp_planner", "Learning rate: %f ridge factor: %f planning time limit: %f max_iterations %d ",
+                     params.learning_rate_, params.ridge_factor_, params.planning_time_limit_,
+                     params.max_iterations_);
+
+      if (!optimization_result && replan_count < params.max_recovery_attempts_)
+      {
+        replan_count++;
+        replan_flag = true;
+      }
+      else
+      {
+        break;
+      }
+    }
+    else
+      break;
+  }  // end of while loop
+
+  return result;
+}
+
+// optimize several differently initialized trajectories concurrently and keep the best result in trajectory, which
+// holds the trajectory initialized with the configured method on input
+OptimizationResult optimizeParallelStarts(ChompTrajectory& trajectory,
+                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const std::string& group_name, const robot_state::RobotState& start_state,
+                                          const ChompParameters& params,
+                                          const planning_interface::MotionPlanDetailedResponse& res)
+{
+  const size_t num_starts = params.parallel_starts_;
+
+  // the configured initialization comes first, followed by the other methods and random perturbations
+  std::vector<ChompTrajectory> starts(1, trajectory);
+  std::vector<std::string> methods = { "quintic-spline", "linear", "cubic" };
+  if (!res.trajectory_.empty() && res.trajectory_[0])
+    methods.push_back("fillTrajectory");
+  for (const std::string& method : methods)
+  {
+    if (starts.size() >= num_starts)
+      break;
+    if (method == params.trajectory_initialization_method_)
+      continue;
+    ChompTrajectory start(trajectory);
+    if (initializeTrajectory(start, method, res))
+      starts.push_back(start);
+  }
+  while (starts.size() < num_starts)
+  {
+    starts.push_back(trajectory);
+    perturbTrajectory(starts.back(), starts.size());
+  }
+
+  // share the threads available for collision gradients among the starts
+  ChompParameters start_params = params;
+  const int max_threads =
+      params.max_threads_ > 0 ? params.max_threads_ : std::max(1u, std::thread::hardware_concurrency());
+  start_params.max_threads_ = std::max<int>(1, max_threads / num_starts);
+
+  // all starts use the same planning scene, whose distance field is only read
+  std::atomic<bool> terminate(false);
+  std::vector<OptimizationResult> results(num_starts);
+  std::vector<std::thread> threads;
+  threads.reserve(num_starts);
+  for (size_t i = 0; i < num_starts; ++i)
+    threads.emplace_back([&, i] {
+      results[i] = optimizeWithRecovery(starts[i], planning_scene, group_name, start_state, start_params, &terminate);
+      if (results[i].collision_free && (params.parallel_start_cost_threshold_ <= 0.0 ||
+                                        results[i].cost < params.parallel_start_cost_threshold_))
+        terminate = true;
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // prefer collision free results, then lower cost
+  size_t best = 0;
+  for (size_t i = 1; i < num_starts; ++i)
+  {
+    if (!results[i].initialized)
+      continue;
+    if (!results[best].initialized || results[i].collision_free > results[best].collision_free ||
+        (results[i].collision_free == results[best].collision_free && results[i].cost < results[best].cost))
+      best = i;
+  }
+  ROS_INFO_NAMED("chomp_planner", "Using the result of start %zu of %zu (collision free: %d, cost: %f)", best + 1,
+                 num_starts, results[best].collision_free, results[best].cost);
+  trajectory = starts[best];
+  return results[best];
+}
+}  // namespace
+
 bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
                          const planning_interface::MotionPlanRequest& req, const ChompParameters& params,
                          planning_interface::MotionPlanDetailedResponse& res) const
@@ -117,23 +308,9 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
   }
 
   // fill in an initial trajectory based on user choice from the chomp_config.yaml file
-  if (params.trajectory_initialization_method_.compare("quintic-spline") == 0)
-    trajectory.fillInMinJerk();
-  else if (params.trajectory_initialization_method_.compare("linear") == 0)
-    trajectory.fillInLinearInterpolation();
-  else if (params.trajectory_initialization_method_.compare("cubic") == 0)
-    trajectory.fillInCubicInterpolation();
-  else if (params.trajectory_initialization_method_.compare("fillTrajectory") == 0)
-  {
-    if (!(trajectory.fillInFromTrajectory(*res.trajectory_[0])))
-    {
-      ROS_ERROR_STREAM_NAMED("chomp_planner", "Input trajectory has less than 2 points, "
-                                              "trajectory must contain at least start and goal state");
-      return false;
-    }
-  }
-  else
-    ROS_ERROR_STREAM_NAMED("chomp_planner", "invalid interpolation method specified in the chomp_planner file");
+  if (!initializeTrajectory(trajectory, params.trajectory_initialization_method_, res) &&
+      params.trajectory_initialization_method_ == "fillTrajectory")
+    return false;
 
   ROS_INFO_NAMED("chomp_planner", "CHOMP trajectory initialized using method: %s ",
                  (params.trajectory_initialization_method_).c_str());
@@ -141,74 +318,18 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
   // optimize!
   ros::WallTime create_time = ros::WallTime::now();
 
-  int replan_count = 0;
-  bool replan_flag = false;
-  double org_learning_rate = 0.04, org_ridge_factor = 0.0, org_planning_time_limit = 10;
-  int org_max_iterations = 200;
-
-  // storing the initial chomp parameters values
-  org_learning_rate = params.learning_rate_;
-  org_ridge_factor = params.ridge_factor_;
-  org_planning_time_limit = params.planning_time_limit_;
-  org_max_iterations = params.max_iterations_;
-
-  std::unique_ptr<ChompOptimizer> optimizer;
-
-  // create a non_const_params variable which stores the non constant version of the const params variable
-  ChompParameters params_nonconst = params;
+  OptimizationResult optimization;
+  if (params.parallel_starts_ > 1)
+    optimization = optimizeParallelStarts(trajectory, planning_scene, req.group_name, start_state, params, res);
+  else
+    optimization = optimizeWithRecovery(trajectory, planning_scene, req.group_name, start_state, params, nullptr);
 
-  // while loop for replanning (recovery behaviour) if collision free optimized solution not found
-  while (true)
+  if (!optimization.initialized)
   {
-    if (replan_flag)
-    {
-      // increase learning rate in hope to find a successful path; increase ridge factor to avoid obstacles; add 5
-      // additional secs in hope to find a solution; increase maximum iterations
-      params_nonconst.setRecoveryParams(params_nonconst.learning_rate_ + 0.02, params_nonconst.ridge_factor_ + 0.002,
-                                        params_nonconst.planning_time_limit_ + 5, params_nonconst.max_iterations_ + 50);
-    }
-
-    // initialize a ChompOptimizer object to load up the optimizer with default parameters or with updated parameters in
-    // case of a recovery behaviour
-    optimizer.reset(new ChompOptimizer(&trajectory, planning_scene, req.group_name, &params_nonconst, start_state));
-    if (!optimizer->isInitialized())
-    {
-      ROS_ERROR_STREAM_NAMED("chomp_planner", "Could not initialize optimizer");
-      res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::PLANNING_FAILED;
-      return false;
-    }
-
-    ROS_DEBUG_NAMED("chomp_planner", "Optimization took %f sec to create",
-                    (ros::WallTime::now() - create_time).toSec());
-
-    bool optimization_result = optimizer->optimize();
-
-    // replan with updated parameters if no solution is found
-    if (params_nonconst.enable_failure_recovery_)
-    {
-      ROS_INFO_NAMED("chomp_planner", "Planned with Chomp Parameters (learning_rate, ridge_factor, "
-                                      "planning_time_limit, max_iterations), attempt: # %d ",
-                     (replan_count + 1));
-      ROS_INFO_NAMED("chomp_planner", "Learning rate: %f ridge factor: %f planning time limit: %f max_iterations %d ",
-                     params_nonconst.learning_rate_, params_nonconst.ridge_factor_,
-                     params_nonconst.planning_time_limit_, params_nonconst.max_iterations_);
-
-      if (!optimization_result && replan_count < params_nonconst.max_recovery_attempts_)
-      {
-        replan_count++;
-        replan_flag = true;
-      }
-      else
-      {
-        break;
-      }
-    }
-    else
-      break;
-  }  // end of while loop
-
-  // resetting the CHOMP Parameters to the original values after a successful plan
-  params_nonconst.setRecoveryParams(org_learning_rate, org_ridge_factor, org_planning_time_limit, org_max_iterations);
+    ROS_ERROR_STREAM_NAMED("chomp_planner", "Could not initialize optimizer");
+    res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::PLANNING_FAILED;
+    return false;
+  }
 
   ROS_DEBUG_NAMED("chomp_planner", "Optimization actually took %f sec to run",
                   (ros::WallTime::now() - create_time).toSec());
@@ -244,7 +365,7 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
   res.processing_time_[0] = (ros::WallTime::now() - start_time).toSec();
 
   // report planning failure if path has collisions
-  if (not optimizer->isCollisionFree())
+  if (!optimization.collision_free)
   {
     ROS_ERROR_STREAM_NAMED("chomp_planner", "Motion plan is invalid.");
     res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::INVALID_MOTION_PLAN;
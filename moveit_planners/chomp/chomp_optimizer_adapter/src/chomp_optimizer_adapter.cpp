@@ -157,6 +157,22 @@ public:
       ROS_INFO_STREAM("Param trajectory_initialization_method was not set. Using New value as: "
                       << params_.trajectory_initialization_method_);
     }
+    if (!nh.getParam("max_threads", params_.max_threads_))
+    {
+      params_.max_threads_ = 1;
+      ROS_INFO_STREAM("Param max_threads was not set. Using default value: " << params_.max_threads_);
+    }
+    if (!nh.getParam("parallel_starts", params_.parallel_starts_))
+    {
+      params_.parallel_starts_ = 1;
+      ROS_INFO_STREAM("Param parallel_starts was not set. Using default value: " << params_.parallel_starts_);
+    }
+    if (!nh.getParam("parallel_start_cost_threshold", params_.parallel_start_cost_threshold_))
+    {
+      params_.parallel_start_cost_threshold_ = 0.0;
+      ROS_INFO_STREAM("Param parallel_start_cost_threshold was not set. Using default value: "
+                      << params_.parallel_start_cost_threshold_);
+    }
   }
 
   std::string getDescription() const override
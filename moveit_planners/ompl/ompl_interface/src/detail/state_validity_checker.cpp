@@ -37,6 +37,7 @@
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/instrumentation.h>
 #include <ros/ros.h>
 
 ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlanningContext* pc)
@@ -70,14 +71,14 @@ void ompl_interface::StateValidityChecker::setVerbose(bool flag)
 
 bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* state, bool verbose) const
 {
-  //  moveit::Profiler::ScopedBlock sblock("isValid");
+  MOVEIT_INSTRUMENT_SCOPE("ompl_interface/is_valid");
   return planning_context_->useStateValidityCache() ? isValidWithCache(state, verbose) :
                                                       isValidWithoutCache(state, verbose);
 }
 
 bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* state, double& dist, bool verbose) const
 {
-  //  moveit::Profiler::ScopedBlock sblock("isValid");
+  MOVEIT_INSTRUMENT_SCOPE("ompl_interface/is_valid");
   return planning_context_->useStateValidityCache() ? isValidWithCache(state, dist, verbose) :
                                                       isValidWithoutCache(state, dist, verbose);
 }
@@ -47,6 +47,7 @@
 
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/instrumentation.h>
 #include <moveit/utils/lexical_casts.h>
 
 #include <ompl/config.h>
@@ -383,12 +384,14 @@ void ompl_interface::ModelBasedPlanningContext::setPlanningVolume(const moveit_m
 
 void ompl_interface::ModelBasedPlanningContext::simplifySolution(double timeout)
 {
+  MOVEIT_INSTRUMENT_SCOPE("ompl_interface/simplify_solution");
   ompl_simple_setup_->simplifySolution(timeout);
   last_simplify_time_ = ompl_simple_setup_->getLastSimplificationTime();
 }
 
 void ompl_interface::ModelBasedPlanningContext::interpolateSolution()
 {
+  MOVEIT_INSTRUMENT_SCOPE("ompl_interface/interpolate_solution");
   if (ompl_simple_setup_->haveSolutionPath())
   {
     og::PathGeometric& pg = ompl_simple_setup_->getSolutionPath();
@@ -722,6 +725,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
 bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned int count)
 {
   moveit::tools::Profiler::ScopedBlock sblock("PlanningContext:Solve");
+  MOVEIT_INSTRUMENT_SCOPE("ompl_interface/solve");
   ompl::time::point start = ompl::time::now();
   preSolve();
 
@@ -53,6 +53,7 @@
 #include <collision_distance_field/collision_env_hybrid.h>
 #include <sbpl_interface/environment_chain3d_types.h>
 #include <moveit_msgs/GetMotionPlan.h>
+#include <boost/thread.hpp>
 
 #include <Eigen/Core>
 
@@ -63,7 +64,7 @@ namespace sbpl_interface
 {
 struct PlanningStatistics
 {
-  PlanningStatistics() : total_expansions_(0), coll_checks_(0)
+  PlanningStatistics() : total_expansions_(0), coll_checks_(0), pruned_successors_(0)
   {
   }
 
@@ -71,6 +72,7 @@ struct PlanningStatistics
   ros::WallDuration total_expansion_time_;
   ros::WallDuration total_coll_check_time_;
   unsigned int coll_checks_;
+  unsigned int pruned_successors_;
   ros::WallDuration total_planning_time_;
 };
 
@@ -82,6 +84,7 @@ struct PlanningParameters
     , attempt_full_shortcut_(true)
     , interpolation_distance_(DEFAULT_INTERPOLATION_DISTANCE)
     , joint_motion_primitive_distance_(DEFAULT_JOINT_MOTION_PRIMITIVE_DISTANCE)
+    , max_expansion_threads_(0)
   {
   }
 
@@ -90,6 +93,8 @@ struct PlanningParameters
   bool attempt_full_shortcut_;
   double interpolation_distance_;
   double joint_motion_primitive_distance_;
+  /** Number of threads used to collision check the successors of an expanded state; 0 uses all cores */
+  unsigned int max_expansion_threads_;
 };
 
 /** Environment to be used when planning for a Robotic Arm using the SBPL. */
@@ -261,14 +266,65 @@ protected:
   PlanningParameters planning_parameters_;
   int maximum_distance_for_motion_;
 
-  planning_models::RobotState* interpolation_state_1_;
-  planning_models::RobotState* interpolation_state_2_;
-  planning_models::RobotState* interpolation_state_temp_;
-  planning_models::RobotState* ::JointStateGroup* interpolation_joint_state_group_1_;
-  planning_models::RobotState* ::JointStateGroup* interpolation_joint_state_group_2_;
-  planning_models::RobotState* ::JointStateGroup* interpolation_joint_state_group_temp_;
+  /** Successor of the state being expanded, before it is added to the hash table */
+  struct SuccessorCandidate
+  {
+    unsigned int action;
+    std::vector<double> angles;
+    std::vector<int> coord;
+    int xyz[3];
+    int dist;
+    bool goal_candidate;
+    bool valid;
+    std::vector<std::vector<double> > interpolated_values;
+  };
+
+  /** States owned by a single thread while the successors of an expanded state are checked */
+  struct ExpansionWorker
+  {
+    planning_models::RobotState* state_;
+    planning_models::RobotState* ::JointStateGroup* joint_state_group_;
+    const planning_models::RobotState* ::LinkState* tip_link_state_;
+    boost::shared_ptr<collision_detection::GroupStateRepresentation> gsr_;
+    planning_models::RobotState* interpolation_state_1_;
+    planning_models::RobotState* interpolation_state_2_;
+    planning_models::RobotState* interpolation_state_temp_;
+    planning_models::RobotState* ::JointStateGroup* interpolation_joint_state_group_1_;
+    planning_models::RobotState* ::JointStateGroup* interpolation_joint_state_group_2_;
+    planning_models::RobotState* ::JointStateGroup* interpolation_joint_state_group_temp_;
+    unsigned int coll_checks_;
+    unsigned int pruned_successors_;
+    ros::WallDuration coll_check_time_;
+  };
+
+  /** The first worker is also used for the checks done outside of the batched expansion */
+  std::vector<boost::shared_ptr<ExpansionWorker> > expansion_workers_;
+  std::vector<SuccessorCandidate> successor_candidates_;
   std::map<int, std::map<int, std::vector<std::vector<double> > > > generated_interpolations_map_;
 
+  /** Threads of the workers after the first, started with the workers and kept until the next request; the expanding
+      thread hands them a batch by incrementing expansion_batch_ */
+  std::vector<boost::shared_ptr<boost::thread> > expansion_threads_;
+  boost::mutex expansion_mutex_;
+  boost::condition_variable expansion_start_condition_;
+  boost::condition_variable expansion_done_condition_;
+  unsigned int expansion_batch_;
+  const std::vector<double>* expansion_source_angles_;
+  std::size_t expansion_block_size_;
+  std::size_t expansion_active_workers_;
+  std::size_t expansion_pending_workers_;
+  bool stop_expansion_threads_;
+
+  void initializeExpansionWorkers();
+  void stopExpansionThreads();
+  void expansionThread(std::size_t worker_index);
+  void mergeWorkerStatistics(ExpansionWorker& worker);
+  void checkSuccessorCandidates(const std::vector<double>& source_angles, std::size_t begin, std::size_t end,
+                                ExpansionWorker& worker);
+  void checkSuccessorCandidate(const std::vector<double>& source_angles, SuccessorCandidate& candidate,
+                               ExpansionWorker& worker);
+  bool checkCollision(const planning_models::RobotState& state, ExpansionWorker& worker);
+
   void setMotionPrimitives(const std::string& group_name);
   void determineMaximumEndEffectorTravel();
 
@@ -293,6 +349,9 @@ protected:
   bool interpolateAndCollisionCheck(const std::vector<double> angles1, const std::vector<double> angles2,
                                     std::vector<std::vector<double> >& state_values);
 
+  bool interpolateAndCollisionCheck(const std::vector<double>& angles1, const std::vector<double>& angles2,
+                                    std::vector<std::vector<double> >& state_values, ExpansionWorker& worker);
+
   inline double getEuclideanDistance(double x1, double y1, double z1, double x2, double y2, double z2) const
   {
     return sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2) + (z1 - z2) * (z1 - z2));
@@ -38,6 +38,8 @@
 #include <collision_detection/collision_common.h>
 #include <planning_models/conversions.h>
 #include <boost/timer.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <planning_models/angle_utils.h>
 
 static const unsigned int DEBUG_OVER = 1;
@@ -54,15 +56,19 @@ EnvironmentChain3D::EnvironmentChain3D(const planning_scene::PlanningSceneConstP
   , planning_data_(StateID2IndexMapping)
   , goal_constraint_set_(planning_scene->getRobotModel(), planning_scene->getTransforms())
   , path_constraint_set_(planning_scene->getRobotModel(), planning_scene->getTransforms())
-  , interpolation_state_1_(planning_scene->getCurrentState())
-  , interpolation_state_2_(planning_scene->getCurrentState())
-  , interpolation_state_temp_(planning_scene->getCurrentState())
   , closest_to_goal_(DBL_MAX)
+  , expansion_batch_(0)
+  , expansion_source_angles_(NULL)
+  , expansion_block_size_(0)
+  , expansion_active_workers_(0)
+  , expansion_pending_workers_(0)
+  , stop_expansion_threads_(false)
 {
 }
 
 EnvironmentChain3D::~EnvironmentChain3D()
 {
+  stopExpansionThreads();
   if (bfs_ != NULL)
   {
     delete bfs_;
@@ -176,192 +182,98 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
   std::vector<double> source_joint_angles = hash_entry->angles;
   // convertCoordToJointAngles(hash_entry->coord, source_joint_angles);
 
-  std::vector<int> succ_coord;
-  std::vector<double> succ_joint_angles;
-
-  // for(unsigned int i = 0; i < source_joint_angles.size(); i++) {
-  //   std::cerr << "Source " << i << " " << source_joint_angles[i] << std::endl;
-  // }
-
   planning_statistics_.total_expansions_++;
 
+  if (expansion_workers_.empty())
+  {
+    ROS_WARN_STREAM("Environment has not been set up for planning");
+    return;
+  }
+
+  // Generate all the successors first, so forward kinematics, pruning and collision checking are done as a batch
+  successor_candidates_.clear();
+  successor_candidates_.reserve(possible_actions_.size());
   for (unsigned int i = 0; i < possible_actions_.size(); i++)
   {
-    if (!possible_actions_[i]->generateSuccessorState(source_joint_angles, succ_joint_angles))
+    SuccessorCandidate candidate;
+    if (!possible_actions_[i]->generateSuccessorState(source_joint_angles, candidate.angles))
     {
       continue;
     }
+    candidate.action = i;
+    convertJointAnglesToCoord(candidate.angles, candidate.coord);
+    successor_candidates_.push_back(candidate);
+  }
 
-    // for(unsigned int j = 0; j < planning_data_.goal_hash_entry_->angles.size(); j++) {
-    //   if(joint_is_continuous_[j]) {
-    //     if(source_joint_angles[j] < M_PI && succ_joint_angles[j] > M_PI) {
-    //       succ_joint_angles[j] -= 2*M_PI;
-    //     } else if(source_joint_angles[j] > -M_PI && succ_joint_angles[j] < -M_PI) {
-    //       succ_joint_angles[j] += 2*M_PI;
-    //     }
-    //   }
-    // }
-    // double dist = 0.0;
-    // for(unsigned int j = 0; j < planning_data_.goal_hash_entry_->angles.size(); j++) {
-    //   dist += fabs(planning_data_.goal_hash_entry_->angles[j]-succ_joint_angles[j]);
-    //   //std::cerr << "Succ " << i << " " << j << " " << succ_joint_angles[j] << std::endl;
-    // }
-    // if(dist < closest_to_goal_) {
-    //   //std::cerr << "Got dist " << dist << std::endl;
-    //   closest_to_goal_ = dist;
-    // }
-
-    // int max_dist = getJointDistanceIntegerMax(succ_joint_angles,
-    //                                           planning_data_.goal_hash_entry_->angles);
-    // if(max_dist*1.0 < closest_to_goal_) {
-    //   std::cerr << "Max integer distance is " << max_dist << std::endl;
-    //   closest_to_goal_ = max_dist*1.0;
-    //   // for(unsigned int j = 0; j < joint_motion_wrappers_.size(); j++) {
-    //   //   if(joint_motion_wrappers_[j]->canGetCloser(succ_joint_angles[j],
-    //   //                                              planning_data_.goal_hash_entry_->angles[j],
-    //   //                                              LONG_RANGE_JOINT_DIFF)) {
-    //   //     std::cerr << "Joint " << j << " succ " << succ_joint_angles[j] << " "
-    //   //               << planning_data_.goal_hash_entry_->angles[j] << " can get closer\n";
-    //   //     break;
-    //   //   }
-    //   // }
-    // }
-    convertJointAnglesToCoord(succ_joint_angles, succ_coord);
-
-    joint_state_group_->setStateValues(succ_joint_angles);
-
-    kinematic_constraints::ConstraintEvaluationResult con_res = path_constraint_set_.decide(state_);
-    if (!con_res.satisfied)
-    {
-      ROS_INFO_STREAM("State violates path constraints");
-    }
-
-    // if(!joint_state_group_->satisfiesBounds()) {
-    //   std::cerr << "ERROR - successor doesn't satisfy bounds" << std::endl;
-    //   //std::cerr << "Successor doesn't satisfy bounds" << std::endl;
-    //   continue;
-    // }
-    ros::WallTime before_coll = ros::WallTime::now();
-    collision_detection::CollisionRequest req;
-    collision_detection::CollisionResult res;
-    req.group_name = planning_group_;
-    if (!planning_parameters_.use_standard_collision_checking_)
-    {
-      hy_env_->checkCollisionDistanceField(req, res, *hy_env_->getCollisionRobotDistanceField().get(), state_, gsr_);
-    }
-    else
+  // Each worker checks a contiguous block of candidates with its own states; the first block is checked here while
+  // the expansion threads check the others
+  std::size_t num_candidates = successor_candidates_.size();
+  std::size_t num_workers = std::min(expansion_workers_.size(), num_candidates);
+  if (num_workers <= 1)
+  {
+    checkSuccessorCandidates(source_joint_angles, 0, num_candidates, *expansion_workers_.front());
+  }
+  else
+  {
+    std::size_t block_size = (num_candidates + num_workers - 1) / num_workers;
     {
-      planning_scene_->checkCollision(req, res, state_);
+      boost::lock_guard<boost::mutex> lock(expansion_mutex_);
+      expansion_source_angles_ = &source_joint_angles;
+      expansion_block_size_ = block_size;
+      expansion_active_workers_ = (num_candidates + block_size - 1) / block_size;
+      expansion_pending_workers_ = expansion_active_workers_ - 1;
+      expansion_batch_++;
     }
-    planning_statistics_.coll_checks_++;
-    // std::cerr << "Elapsed " << t.elapsed() << std::endl;
-    ros::WallDuration dur(ros::WallTime::now() - before_coll);
-    // std::cerr << dur.toSec() << std::endl;
-    // ROS_DEBUG_STREAM("Time " << ros::WallTime::now()-before_coll);
-    planning_statistics_.total_coll_check_time_ += dur;
-    if (res.collision)
+    expansion_start_condition_.notify_all();
+    checkSuccessorCandidates(source_joint_angles, 0, block_size, *expansion_workers_.front());
+    boost::unique_lock<boost::mutex> lock(expansion_mutex_);
+    while (expansion_pending_workers_ > 0)
     {
-      // std::cerr << "Successor in collision" << std::endl;
-      continue;
+      expansion_done_condition_.wait(lock);
     }
+  }
 
-    Eigen::Isometry3d pose = tip_link_state_->getGlobalLinkTransform();
+  for (boost::shared_ptr<ExpansionWorker>& worker : expansion_workers_)
+  {
+    mergeWorkerStatistics(*worker);
+  }
 
-    int xyz[3];
-    if (!planning_parameters_.use_standard_collision_checking_)
-    {
-      if (!getGridXYZInt(pose, xyz))
-      {
-        std::cerr << "Can't get successor x y z" << std::endl;
-        continue;
-      }
-    }
-    int dist;
-    if (planning_parameters_.use_bfs_)
-    {
-      dist = getBFSCostToGoal(xyz[0], xyz[1], xyz[2]);
-    }
-    else
+  // The hash table is only touched here, in the order of the motion primitives
+  for (SuccessorCandidate& candidate : successor_candidates_)
+  {
+    if (!candidate.valid)
     {
-      dist = getJointDistanceIntegerMax(succ_joint_angles, planning_data_.goal_hash_entry_->angles,
-                                        planning_parameters_.joint_motion_primitive_distance_);
+      continue;
     }
 
     EnvChain3DHashEntry* succ_hash_entry = NULL;
-    // bool can_get_closer = false;
-    // for(unsigned int j = 0; j < joint_motion_wrappers_.size(); j++) {
-    //   if(joint_motion_wrappers_[j]->canGetCloser(succ_joint_angles[j],
-    //                                              planning_data_.goal_hash_entry_->angles[j],
-    //                                              LONG_RANGE_JOINT_DIFF)) {
-    //     can_get_closer = true;
-    //     // std::cerr << "Joint " << j << " succ " << succ_joint_angles[j] << " "
-    //     //           << planning_data_.goal_hash_entry_->angles[j] << " can get closer\n";
-    //     break;
-    //   }
-    // }
-    // if(!can_get_closer) {
     bool succ_is_goal_state = false;
-    if ((planning_parameters_.use_bfs_ && dist == 0) || (!planning_parameters_.use_bfs_ && dist == 1))
+    bool needs_interpolation =
+        planning_parameters_.interpolation_distance_ < planning_parameters_.joint_motion_primitive_distance_;
+    if (candidate.goal_candidate)
     {
-      // std::cerr << "Joint distance for goal move " <<
-      // getJointDistanceDoubleSum(planning_data_.goal_hash_entry_->angles, succ_joint_angles) << std::endl;
       std::vector<std::vector<double> > interpolated_values;
       if (interpolateAndCollisionCheck(source_joint_angles, planning_data_.goal_hash_entry_->angles,
                                        interpolated_values))
       {
-        // std::cerr << "Interpolation generated from id " << source_state_ID << " is " << interpolated_values.size() <<
-        // " states\n";
         generated_interpolations_map_[source_state_ID][planning_data_.goal_hash_entry_->stateID] = interpolated_values;
         succ_hash_entry = planning_data_.goal_hash_entry_;
         succ_is_goal_state = true;
       }
-      else
+      // Goal candidates skip the interpolation in the workers, so it is only done here if the goal can't be reached
+      else if (needs_interpolation &&
+               !interpolateAndCollisionCheck(source_joint_angles, candidate.angles, candidate.interpolated_values))
       {
-        // std::cerr << "Interpolation in collision\n";
+        continue;
       }
     }
-    std::vector<std::vector<double> > interpolated_values;
     if (!succ_is_goal_state)
     {
-      if (planning_parameters_.interpolation_distance_ < planning_parameters_.joint_motion_primitive_distance_)
-      {
-        if (!interpolateAndCollisionCheck(source_joint_angles, succ_joint_angles, interpolated_values))
-        {
-          // std::cerr << "Interpolation failed" << std::endl;
-          continue;
-        }
-      }
-      succ_hash_entry = planning_data_.getHashEntry(succ_coord, i);
+      succ_hash_entry = planning_data_.getHashEntry(candidate.coord, candidate.action);
     }
-    // double max_dist = getJointDistanceMax(planning_data_.goal_hash_entry_->angles, succ_joint_angles);
-    // if(max_dist < closest_to_goal_) {
-    //   std::cerr << "State " << source_state_ID << " sum dist " <<
-    //   getJointDistanceSum(planning_data_.goal_hash_entry_->angles, succ_joint_angles) << " max "
-    //             << " " << getJointDistanceMax(planning_data_.goal_hash_entry_->angles, succ_joint_angles) <<
-    //             std::endl;
-    //   for(unsigned int i = 0; i < planning_data_.goal_hash_entry_->angles.size(); i++) {
-    //     std::cerr << "Joint " << i << " " << planning_data_.goal_hash_entry_->angles[i] << " " <<
-    //     succ_joint_angles[i] << std::endl;
-    //   }
-    //   closest_to_goal_ = max_dist;
-    // }
-    // std::cerr << "Dist " << dist << " source state id " << source_state_ID << std::endl;
-    // if(max_dist <= LONG_RANGE_JOINT_DIFF/2.0+.001) {
-    //   succ_hash_entry = planning_data_.goal_hash_entry_;
-    // } else {
-    //   succ_hash_entry = planning_data_.getHashEntry(succ_coord, i);
-    // }
-
-    // kinematic_constraints::ConstraintEvaluationResult con_res = goal_constraint_set_.decide(state_);
-    // if(con_res.satisfied) {
-    //   std::cerr << "Constraints satisfied, dist is " << dist << std::endl;
-    //   succ_hash_entry = planning_data_.goal_hash_entry_;
-    // } else {
-    //   succ_hash_entry = planning_data_.getHashEntry(succ_coord, i);
-    // }
     if (!succ_hash_entry)
     {
-      succ_hash_entry = planning_data_.addHashEntry(succ_coord, succ_joint_angles, xyz, i);
+      succ_hash_entry = planning_data_.addHashEntry(candidate.coord, candidate.angles, candidate.xyz, candidate.action);
     }
     else
     {
@@ -371,11 +283,10 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
       }
     }
 
-    if (planning_parameters_.interpolation_distance_ < planning_parameters_.joint_motion_primitive_distance_ &&
-        !succ_is_goal_state)
+    if (needs_interpolation && !succ_is_goal_state)
     {
       // std::cerr << "Adding segment from " << source_state_ID << " to " << succ_hash_entry->stateID << std::endl;
-      generated_interpolations_map_[source_state_ID][succ_hash_entry->stateID] = interpolated_values;
+      generated_interpolations_map_[source_state_ID][succ_hash_entry->stateID] = candidate.interpolated_values;
     }
 
     // std::cerr << "Adding hash entry" << std::endl;
@@ -385,7 +296,7 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
       std::cerr << "Adding " << succ_hash_entry->stateID << std::endl;
       for (unsigned int j = 0; j < planning_data_.goal_hash_entry_->angles.size(); j++)
       {
-        std::cerr << "Succ " << j << " " << succ_joint_angles[j] << std::endl;
+        std::cerr << "Succ " << j << " " << candidate.angles[j] << std::endl;
       }
     }
     succ_idv->push_back(succ_hash_entry->stateID);
@@ -394,6 +305,190 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
   planning_statistics_.total_expansion_time_ += ros::WallTime::now() - expansion_start_time;
 }
 
+void EnvironmentChain3D::checkSuccessorCandidates(const std::vector<double>& source_angles, std::size_t begin,
+                                                  std::size_t end, ExpansionWorker& worker)
+{
+  for (std::size_t i = begin; i < end; i++)
+  {
+    checkSuccessorCandidate(source_angles, successor_candidates_[i], worker);
+  }
+}
+
+void EnvironmentChain3D::checkSuccessorCandidate(const std::vector<double>& source_angles,
+                                                 SuccessorCandidate& candidate, ExpansionWorker& worker)
+{
+  candidate.valid = false;
+  candidate.xyz[0] = candidate.xyz[1] = candidate.xyz[2] = 0;
+  worker.joint_state_group_->setStateValues(candidate.angles);
+
+  kinematic_constraints::ConstraintEvaluationResult con_res = path_constraint_set_.decide(worker.state_);
+  if (!con_res.satisfied)
+  {
+    ROS_INFO_STREAM("State violates path constraints");
+  }
+
+  // Successors whose tip is outside of the distance field are dropped anyway, so they are pruned before the full
+  // collision check
+  if (!planning_parameters_.use_standard_collision_checking_)
+  {
+    Eigen::Isometry3d pose = worker.tip_link_state_->getGlobalLinkTransform();
+    if (!getGridXYZInt(pose, candidate.xyz))
+    {
+      worker.pruned_successors_++;
+      return;
+    }
+  }
+
+  if (checkCollision(worker.state_, worker))
+  {
+    return;
+  }
+
+  if (planning_parameters_.use_bfs_)
+  {
+    candidate.dist = getBFSCostToGoal(candidate.xyz[0], candidate.xyz[1], candidate.xyz[2]);
+  }
+  else
+  {
+    candidate.dist = getJointDistanceIntegerMax(candidate.angles, planning_data_.goal_hash_entry_->angles,
+                                                planning_parameters_.joint_motion_primitive_distance_);
+  }
+
+  candidate.goal_candidate =
+      (planning_parameters_.use_bfs_ && candidate.dist == 0) || (!planning_parameters_.use_bfs_ && candidate.dist == 1);
+  candidate.interpolated_values.clear();
+  if (!candidate.goal_candidate &&
+      planning_parameters_.interpolation_distance_ < planning_parameters_.joint_motion_primitive_distance_)
+  {
+    if (!interpolateAndCollisionCheck(source_angles, candidate.angles, candidate.interpolated_values, worker))
+    {
+      return;
+    }
+  }
+  candidate.valid = true;
+}
+
+bool EnvironmentChain3D::checkCollision(const planning_models::RobotState& state, ExpansionWorker& worker)
+{
+  ros::WallTime before_coll = ros::WallTime::now();
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = planning_group_;
+  if (!planning_parameters_.use_standard_collision_checking_)
+  {
+    hy_env_->checkCollisionDistanceField(req, res, *hy_env_->getCollisionRobotDistanceField().get(), state,
+                                         worker.gsr_);
+  }
+  else
+  {
+    planning_scene_->checkCollision(req, res, state);
+  }
+  worker.coll_checks_++;
+  worker.coll_check_time_ += ros::WallDuration(ros::WallTime::now() - before_coll);
+  return res.collision;
+}
+
+void EnvironmentChain3D::mergeWorkerStatistics(ExpansionWorker& worker)
+{
+  planning_statistics_.coll_checks_ += worker.coll_checks_;
+  planning_statistics_.pruned_successors_ += worker.pruned_successors_;
+  planning_statistics_.total_coll_check_time_ += worker.coll_check_time_;
+  worker.coll_checks_ = 0;
+  worker.pruned_successors_ = 0;
+  worker.coll_check_time_ = ros::WallDuration();
+}
+
+void EnvironmentChain3D::expansionThread(std::size_t worker_index)
+{
+  unsigned int batch = 0;
+  boost::unique_lock<boost::mutex> lock(expansion_mutex_);
+  while (true)
+  {
+    while (!stop_expansion_threads_ && expansion_batch_ == batch)
+    {
+      expansion_start_condition_.wait(lock);
+    }
+    if (stop_expansion_threads_)
+    {
+      return;
+    }
+    batch = expansion_batch_;
+    if (worker_index >= expansion_active_workers_)
+    {
+      continue;
+    }
+    std::size_t begin = worker_index * expansion_block_size_;
+    std::size_t end = std::min(successor_candidates_.size(), begin + expansion_block_size_);
+    const std::vector<double>& source_angles = *expansion_source_angles_;
+    lock.unlock();
+    checkSuccessorCandidates(source_angles, begin, end, *expansion_workers_[worker_index]);
+    lock.lock();
+    if (--expansion_pending_workers_ == 0)
+    {
+      expansion_done_condition_.notify_one();
+    }
+  }
+}
+
+void EnvironmentChain3D::stopExpansionThreads()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(expansion_mutex_);
+    stop_expansion_threads_ = true;
+  }
+  expansion_start_condition_.notify_all();
+  for (std::size_t i = 0; i < expansion_threads_.size(); i++)
+  {
+    expansion_threads_[i]->join();
+  }
+  expansion_threads_.clear();
+  // Threads started afterwards wait for the first batch after 0
+  expansion_batch_ = 0;
+  stop_expansion_threads_ = false;
+}
+
+void EnvironmentChain3D::initializeExpansionWorkers()
+{
+  stopExpansionThreads();
+  unsigned int num_workers = planning_parameters_.max_expansion_threads_;
+  if (num_workers == 0)
+  {
+    num_workers = std::max(1u, boost::thread::hardware_concurrency());
+  }
+
+  const std::string& tip_link_name = tip_link_state_->getName();
+  expansion_workers_.clear();
+  for (unsigned int i = 0; i < num_workers; i++)
+  {
+    boost::shared_ptr<ExpansionWorker> worker(new ExpansionWorker());
+    worker->state_ = state_;
+    worker->interpolation_state_1_ = state_;
+    worker->interpolation_state_2_ = state_;
+    worker->interpolation_state_temp_ = state_;
+    worker->joint_state_group_ = worker->state_.getJointStateGroup(planning_group_);
+    worker->tip_link_state_ = worker->state_.getLinkState(tip_link_name);
+    worker->interpolation_joint_state_group_1_ = worker->interpolation_state_1_.getJointStateGroup(planning_group_);
+    worker->interpolation_joint_state_group_2_ = worker->interpolation_state_2_.getJointStateGroup(planning_group_);
+    worker->interpolation_joint_state_group_temp_ =
+        worker->interpolation_state_temp_.getJointStateGroup(planning_group_);
+    // Each worker gets its own group state representation, the distance field cache entry itself is shared
+    if (gsr_)
+    {
+      worker->gsr_.reset(new collision_detection::GroupStateRepresentation(*gsr_));
+    }
+    worker->coll_checks_ = 0;
+    worker->pruned_successors_ = 0;
+    expansion_workers_.push_back(worker);
+  }
+
+  // The first worker runs in the expanding thread
+  for (std::size_t i = 1; i < expansion_workers_.size(); i++)
+  {
+    expansion_threads_.push_back(boost::shared_ptr<boost::thread>(
+        new boost::thread(boost::bind(&EnvironmentChain3D::expansionThread, this, i))));
+  }
+}
+
 void EnvironmentChain3D::GetPreds(int TargetStateID, vector<int>* PredIDV, vector<int>* cost_v)
 {
   std::cerr << ("ERROR in EnvChain... function: GetPreds is undefined\n");
@@ -453,16 +548,10 @@ bool EnvironmentChain3D::setupForMotionPlan(const planning_scene::PlanningSceneC
   }
 
   state_ = planning_scene->getCurrentState();
-  interpolation_state_1_ = planning_scene->getCurrentState();
-  interpolation_state_2_ = planning_scene->getCurrentState();
-  interpolation_state_temp_ = planning_scene->getCurrentState();
 
   planning_models::robotStateMsgToRobotState(*planning_scene->getTransforms(), mreq.motion_plan_request.start_state,
                                              state_);
   joint_state_group_ = state_.getJointStateGroup(planning_group_);
-  interpolation_joint_state_group_1_ = interpolation_state_1_.getJointStateGroup(planning_group_);
-  interpolation_joint_state_group_2_ = interpolation_state_2_.getJointStateGroup(planning_group_);
-  interpolation_joint_state_group_temp_ = interpolation_state_temp_.getJointStateGroup(planning_group_);
   tip_link_state_ = state_.getLinkState(joint_state_group_->getJointModelGroup()->getLinkModelNames().back());
 
   collision_detection::CollisionRequest req;
@@ -483,6 +572,7 @@ bool EnvironmentChain3D::setupForMotionPlan(const planning_scene::PlanningSceneC
     mres.error_code.val = moveit_msgs::msg::MoveItErrorCodes::START_STATE_IN_COLLISION;
     return false;
   }
+  initializeExpansionWorkers();
   if (!planning_parameters_.use_standard_collision_checking_)
   {
     angle_discretization_ = gsr_->dfce_->distance_field_->getResolution();
@@ -1066,16 +1156,24 @@ bool EnvironmentChain3D::getPlaneBFSMarker(visualization_msgs::Marker& plane_mar
 bool EnvironmentChain3D::interpolateAndCollisionCheck(const std::vector<double> angles1,
                                                       const std::vector<double> angles2,
                                                       std::vector<std::vector<double> >& state_values)
+{
+  ExpansionWorker& worker = *expansion_workers_.front();
+  bool result = interpolateAndCollisionCheck(angles1, angles2, state_values, worker);
+  mergeWorkerStatistics(worker);
+  return result;
+}
+
+bool EnvironmentChain3D::interpolateAndCollisionCheck(const std::vector<double>& angles1,
+                                                      const std::vector<double>& angles2,
+                                                      std::vector<std::vector<double> >& state_values,
+                                                      ExpansionWorker& worker)
 {
   static bool print_first = false;
   state_values.clear();
-  interpolation_joint_state_group_1_->setStateValues(angles1);
-  interpolation_joint_state_group_2_->setStateValues(angles2);
+  worker.interpolation_joint_state_group_1_->setStateValues(angles1);
+  worker.interpolation_joint_state_group_2_->setStateValues(angles2);
 
-  interpolation_joint_state_group_temp_->setStateValues(angles1);
-
-  collision_detection::CollisionRequest req;
-  req.group_name = planning_group_;
+  worker.interpolation_joint_state_group_temp_->setStateValues(angles1);
 
   int maximum_moves = getJointDistanceIntegerMax(angles1, angles2, planning_parameters_.interpolation_distance_);
   if (print_first)
@@ -1092,28 +1190,15 @@ bool EnvironmentChain3D::interpolateAndCollisionCheck(const std::vector<double>
   }
   for (int i = 1; i < maximum_moves; i++)
   {
-    interpolation_joint_state_group_1_->interpolate(
-        interpolation_joint_state_group_2_, (1.0 / (maximum_moves * 1.0)) * i, interpolation_joint_state_group_temp_);
-    ros::WallTime before_coll = ros::WallTime::now();
-    collision_detection::CollisionResult res;
-    if (!planning_parameters_.use_standard_collision_checking_)
-    {
-      hy_env_->checkCollisionDistanceField(req, res, *hy_env_->getCollisionRobotDistanceField().get(),
-                                           interpolation_state_temp_, gsr_);
-    }
-    else
-    {
-      planning_scene_->checkCollision(req, res, interpolation_state_temp_);
-    }
-    planning_statistics_.coll_checks_++;
-    ros::WallDuration dur(ros::WallTime::now() - before_coll);
-    planning_statistics_.total_coll_check_time_ += dur;
-    if (res.collision)
+    worker.interpolation_joint_state_group_1_->interpolate(worker.interpolation_joint_state_group_2_,
+                                                           (1.0 / (maximum_moves * 1.0)) * i,
+                                                           worker.interpolation_joint_state_group_temp_);
+    if (checkCollision(worker.interpolation_state_temp_, worker))
     {
       return false;
     }
     state_values.resize(state_values.size() + 1);
-    interpolation_joint_state_group_temp_->getGroupStateValues(state_values.back());
+    worker.interpolation_joint_state_group_temp_->getGroupStateValues(state_values.back());
     if (print_first)
     {
       for (unsigned int j = 0; j < state_values.back().size(); j++)
@@ -86,6 +86,8 @@ bool SBPLInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_
             << 1.0 / (env_chain->getPlanningStatistics().total_coll_check_time_.toSec() /
                       (env_chain->getPlanningStatistics().coll_checks_ * 1.0))
             << std::endl;
+  std::cerr << "Successors pruned before collision checking " << env_chain->getPlanningStatistics().pruned_successors_
+            << std::endl;
   std::cerr << "Path length is " << solution_state_ids.size() << std::endl;
   if (!b_ret)
   {
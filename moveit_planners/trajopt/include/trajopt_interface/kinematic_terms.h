@@ -42,24 +42,102 @@ inline std::vector<T> concatVector(const std::vector<T>& vector_a, const std::ve
 /**
  * @brief Used to calculate the error for StaticCartPoseTermInfo
  * This is converted to a cost or constraint using TrajOptCostFromErrFunc or TrajOptConstraintFromErrFunc
+ *
+ * The error is the vector part of the quaternion of the rotational error followed by the position error, both
+ * expressed in the target frame.
  */
 struct CartPoseErrCalculator : public sco::VectorOfVector
 {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   Eigen::Isometry3d target_pose_inv_;
   planning_scene::PlanningSceneConstPtr planning_scene_;
+  std::string group_;
   std::string link_;
   Eigen::Isometry3d tcp_;
 
   CartPoseErrCalculator(const Eigen::Isometry3d& pose, const planning_scene::PlanningSceneConstPtr planning_scene,
-                        const std::string& link, Eigen::Isometry3d tcp = Eigen::Isometry3d::Identity())
-    : target_pose_inv_(pose.inverse()), planning_scene_(planning_scene), link_(link), tcp_(tcp)
+                        const std::string& group, const std::string& link,
+                        Eigen::Isometry3d tcp = Eigen::Isometry3d::Identity())
+    : target_pose_inv_(pose.inverse()), planning_scene_(planning_scene), group_(group), link_(link), tcp_(tcp)
   {
   }
 
   Eigen::VectorXd operator()(const Eigen::VectorXd& dof_vals) const override;
 };
 
+/**
+ * @brief Analytic jacobian of CartPoseErrCalculator, computed from RobotState::getJacobian()
+ * Without it, sco falls back to numerical differentiation which needs one forward kinematics call per dof
+ */
+struct CartPoseJacCalculator : public sco::MatrixOfVector
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  Eigen::Isometry3d target_pose_inv_;
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+  std::string group_;
+  std::string link_;
+  Eigen::Isometry3d tcp_;
+
+  CartPoseJacCalculator(const Eigen::Isometry3d& pose, const planning_scene::PlanningSceneConstPtr planning_scene,
+                        const std::string& group, const std::string& link,
+                        Eigen::Isometry3d tcp = Eigen::Isometry3d::Identity())
+    : target_pose_inv_(pose.inverse()), planning_scene_(planning_scene), group_(group), link_(link), tcp_(tcp)
+  {
+  }
+
+  Eigen::MatrixXd operator()(const Eigen::VectorXd& dof_vals) const override;
+};
+
+/**
+ * @brief Used to calculate the error for CollisionTermInfo
+ * The error is safety_margin - d, where d is the signed distance between the robot and the world as reported by
+ * CollisionEnv::distanceRobot(). It is meant to be used with a HINGE cost or an INEQ constraint.
+ */
+struct CollisionErrCalculator : public sco::VectorOfVector
+{
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+  std::string group_;
+  /** @brief Distance below which the term becomes active */
+  double safety_margin_;
+  /** @brief Distances further than safety_margin_ + safety_margin_buffer_ are not computed */
+  double safety_margin_buffer_;
+
+  CollisionErrCalculator(const planning_scene::PlanningSceneConstPtr planning_scene, const std::string& group,
+                         double safety_margin, double safety_margin_buffer)
+    : planning_scene_(planning_scene)
+    , group_(group)
+    , safety_margin_(safety_margin)
+    , safety_margin_buffer_(safety_margin_buffer)
+  {
+  }
+
+  Eigen::VectorXd operator()(const Eigen::VectorXd& dof_vals) const override;
+};
+
+/**
+ * @brief Jacobian of CollisionErrCalculator
+ * The gradient of the distance is the contact normal projected through the jacobians of the links at the nearest
+ * points. Contacts with bodies that are not moved by the group contribute nothing.
+ */
+struct CollisionJacCalculator : public sco::MatrixOfVector
+{
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+  std::string group_;
+  double safety_margin_;
+  double safety_margin_buffer_;
+
+  CollisionJacCalculator(const planning_scene::PlanningSceneConstPtr planning_scene, const std::string& group,
+                         double safety_margin, double safety_margin_buffer)
+    : planning_scene_(planning_scene)
+    , group_(group)
+    , safety_margin_(safety_margin)
+    , safety_margin_buffer_(safety_margin_buffer)
+  {
+  }
+
+  Eigen::MatrixXd operator()(const Eigen::VectorXd& dof_vals) const override;
+};
+
 // TODO(omid): The following should be added and adjusted from trajopt
 // JointPosEqCost
 // JointPosIneqCost
@@ -85,6 +163,12 @@ struct JointVelErrCalculator : sco::VectorOfVector
   Eigen::VectorXd operator()(const Eigen::VectorXd& var_vals) const;
 };
 
+/**
+ * @brief Jacobian of JointVelErrCalculator
+ * Each velocity only depends on two joint values and one time value, so the jacobian is banded. Only those entries
+ * are written and JointVelTermInfo applies the term to short windows of the trajectory so the convex approximation
+ * built by sco stays linear in the number of timesteps.
+ */
 struct JointVelJacobianCalculator : sco::MatrixOfVector
 {
   Eigen::MatrixXd operator()(const Eigen::VectorXd& var_vals) const;
@@ -52,6 +52,9 @@ MOVEIT_CLASS_FORWARD(CartPoseTermInfo);
 struct JointVelTermInfo;
 MOVEIT_CLASS_FORWARD(JointVelTermInfo);
 
+struct CollisionTermInfo;
+MOVEIT_CLASS_FORWARD(CollisionTermInfo);
+
 struct ProblemInfo;
 TrajOptProblemPtr ConstructProblem(const ProblemInfo&);
 
@@ -224,6 +227,11 @@ public:
   {
     return planning_scene_;
   }
+  /** @brief Returns the name of the joint model group the problem is defined for */
+  const std::string& GetPlanningGroup() const
+  {
+    return planning_group_;
+  }
   void SetInitTraj(const trajopt::TrajArray& x)
   {
     matrix_init_traj = x;
@@ -361,6 +369,48 @@ struct JointVelTermInfo : public TermInfo
   }
 };
 
+/**
+  \brief Signed distance collision term between the robot and the world
+
+  For every timestep between first_step and last_step, the distance d between the planning group and the world is
+  computed with CollisionEnv::distanceRobot() and penalized as
+
+  \f{align*}{
+  coeff * max(0, safety_margin - d)
+  \f}
+
+  As a constraint, d >= safety_margin is enforced instead. Distances beyond safety_margin + safety_margin_buffer are
+  not computed by the collision checker.
+ */
+struct CollisionTermInfo : public TermInfo
+{
+  /** @brief Coefficient that scales the cost. Default: 20 */
+  double coeff = 20.0;
+  /** @brief Distance to obstacles below which the term is active. Default: 0.025 */
+  double safety_margin = 0.025;
+  /** @brief Additional distance over which contacts are still computed so the term has a gradient before it becomes
+      active. Default: 0.05 */
+  double safety_margin_buffer = 0.05;
+  /** @brief First time step to which the term is applied. Default: 0 */
+  int first_step = 0;
+  /** @brief Last time step to which the term is applied. Default: prob.GetNumSteps() - 1*/
+  int last_step = -1;
+
+  /** @brief Initialize term with it's supported types */
+  CollisionTermInfo() : TermInfo(TT_COST | TT_CNT)
+  {
+  }
+
+  /** @brief Converts term info into cost/constraint and adds it to trajopt problem */
+  void addObjectiveTerms(TrajOptProblem& prob) override;
+
+  static TermInfoPtr create()
+  {
+    TermInfoPtr out(new CollisionTermInfo());
+    return out;
+  }
+};
+
 void generateInitialTrajectory(const ProblemInfo& pci, const std::vector<double>& current_joint_values,
                                trajopt::TrajArray& init_traj);
 
@@ -63,6 +63,7 @@ protected:
   void setDefaultTrajOPtParams();
   void setProblemInfoParam(ProblemInfo& problem_info);
   void setJointPoseTermInfoParams(JointPoseTermInfoPtr& jp, std::string name);
+  void setCollisionTermInfoParams(CollisionTermInfoPtr& collision);
   trajopt::DblVec extractStartJointValues(const planning_interface::MotionPlanRequest& req,
                                           const std::vector<std::string>& group_joint_names);
 
@@ -1,6 +1,8 @@
 #include <Eigen/Geometry>
 #include <boost/format.hpp>
 
+#include <ros/console.h>
+
 #include <trajopt_sco/expr_ops.hpp>
 #include <trajopt_sco/modeling_utils.hpp>
 
@@ -12,13 +14,125 @@ using namespace Eigen;
 
 namespace trajopt_interface
 {
+namespace
+{
+/** @brief Returns a copy of the current state of the scene with the group set to dof_vals */
+robot_state::RobotState getGroupState(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                      const std::string& group, const VectorXd& dof_vals)
+{
+  robot_state::RobotState state = planning_scene->getCurrentState();
+  state.setJointGroupPositions(group, dof_vals);
+  state.update();
+  return state;
+}
+
+Matrix3d skewSymmetric(const Vector3d& vector)
+{
+  Matrix3d out;
+  out << 0.0, -vector.z(), vector.y(), vector.z(), 0.0, -vector.x(), -vector.y(), vector.x(), 0.0;
+  return out;
+}
+
+/** @brief Finds the closest contact between the group and the world, if one is within the distance threshold */
+bool computeNearestContact(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                           const robot_state::RobotState& state, const std::string& group, double distance_threshold,
+                           collision_detection::DistanceResultsData& contact)
+{
+  collision_detection::DistanceRequest req;
+  collision_detection::DistanceResult res;
+  req.group_name = group;
+  req.enableGroup(planning_scene->getRobotModel());
+  req.acm = &planning_scene->getAllowedCollisionMatrix();
+  req.type = collision_detection::DistanceRequestType::GLOBAL;
+  req.enable_nearest_points = true;
+  req.enable_signed_distance = true;
+  req.distance_threshold = distance_threshold;
+
+  planning_scene->getCollisionEnv()->distanceRobot(req, res, state);
+  if (res.minimum_distance.distance >= distance_threshold)
+    return false;
+  contact = res.minimum_distance;
+  return true;
+}
+}  // namespace
+
 VectorXd CartPoseErrCalculator::operator()(const VectorXd& dof_vals) const
 {
-  // TODO: create the actual error function from information in planning scene
-  VectorXd err;
+  robot_state::RobotState state = getGroupState(planning_scene_, group_, dof_vals);
+  Isometry3d pose_err = target_pose_inv_ * state.getGlobalLinkTransform(link_) * tcp_;
+  return concatVector(quaternionRotationVector(pose_err.linear()), pose_err.translation());
+}
+
+MatrixXd CartPoseJacCalculator::operator()(const VectorXd& dof_vals) const
+{
+  robot_state::RobotState state = getGroupState(planning_scene_, group_, dof_vals);
+  const robot_model::JointModelGroup* joint_model_group = state.getJointModelGroup(group_);
+  const robot_model::LinkModel* link_model = state.getLinkModel(link_);
+
+  MatrixXd jac = MatrixXd::Zero(6, dof_vals.size());
+  MatrixXd link_jac;
+  if (!state.getJacobian(joint_model_group, link_model, tcp_.translation(), link_jac))
+  {
+    ROS_ERROR("Unable to compute the jacobian of link %s for group %s", link_.c_str(), group_.c_str());
+    return jac;
+  }
+
+  // The rows of link_jac are the linear and angular velocities of the tcp in the model frame. Both are rotated into
+  // the target frame; the angular part is then mapped to the derivative of the vector part of the error quaternion,
+  // d(q.vec)/dt = 0.5 * (q.w * I - [q.vec]x) * omega
+  Isometry3d pose_err = target_pose_inv_ * state.getGlobalLinkTransform(link_model) * tcp_;
+  Quaterniond quaternion(pose_err.linear());
+  Matrix3d rotation_rate = 0.5 * (quaternion.w() * Matrix3d::Identity() - skewSymmetric(quaternion.vec()));
+  Matrix3d target_rotation_inv = target_pose_inv_.linear();
+
+  jac.topRows(3) = rotation_rate * target_rotation_inv * link_jac.bottomRows(3);
+  jac.bottomRows(3) = target_rotation_inv * link_jac.topRows(3);
+  return jac;
+}
+
+VectorXd CollisionErrCalculator::operator()(const VectorXd& dof_vals) const
+{
+  robot_state::RobotState state = getGroupState(planning_scene_, group_, dof_vals);
+  double distance_threshold = safety_margin_ + safety_margin_buffer_;
+  collision_detection::DistanceResultsData contact;
+
+  VectorXd err(1);
+  if (computeNearestContact(planning_scene_, state, group_, distance_threshold, contact))
+    err(0) = safety_margin_ - contact.distance;
+  else
+    err(0) = safety_margin_ - distance_threshold;
   return err;
 }
 
+MatrixXd CollisionJacCalculator::operator()(const VectorXd& dof_vals) const
+{
+  robot_state::RobotState state = getGroupState(planning_scene_, group_, dof_vals);
+  MatrixXd jac = MatrixXd::Zero(1, dof_vals.size());
+  collision_detection::DistanceResultsData contact;
+  if (!computeNearestContact(planning_scene_, state, group_, safety_margin_ + safety_margin_buffer_, contact))
+    return jac;
+
+  // d = normal . (p1 - p0), so d(err)/dq = normal . (J0 - J1) where Ji is the jacobian of the nearest point on body i
+  const robot_model::JointModelGroup* joint_model_group = state.getJointModelGroup(group_);
+  const std::set<const robot_model::LinkModel*>& group_links = joint_model_group->getUpdatedLinkModelsSet();
+  for (int body = 0; body < 2; ++body)
+  {
+    if (contact.body_types[body] != collision_detection::BodyTypes::ROBOT_LINK)
+      continue;
+    const robot_model::LinkModel* link_model = state.getLinkModel(contact.link_names[body]);
+    if (!link_model || group_links.find(link_model) == group_links.end())
+      continue;
+
+    Vector3d local_point = state.getGlobalLinkTransform(link_model).inverse() * contact.nearest_points[body];
+    MatrixXd link_jac;
+    if (!state.getJacobian(joint_model_group, link_model, local_point, link_jac))
+      continue;
+    double sign = (body == 0) ? 1.0 : -1.0;
+    jac.row(0) += sign * contact.normal.transpose() * link_jac.topRows(3);
+  }
+  return jac;
+}
+
 VectorXd JointVelErrCalculator::operator()(const VectorXd& var_vals) const
 {
   assert(var_vals.rows() % 2 == 0);
@@ -44,20 +158,21 @@ MatrixXd JointVelJacobianCalculator::operator()(const VectorXd& var_vals) const
   int num_vels = half - 1;
   MatrixXd jac = MatrixXd::Zero(num_vels * 2, num_vals);
 
+  // Only the three entries of each velocity row are nonzero. The bottom half is for the negative velocities
   for (int i = 0; i < num_vels; i++)
   {
     // v = (j_i+1 - j_i)*(1/dt)
     // We calculate v with the dt from the second pt
     int time_index = i + half + 1;
-    jac(i, i) = -1.0 * var_vals(time_index);
-    jac(i, i + 1) = 1.0 * var_vals(time_index);
-    jac(i, time_index) = var_vals(i + 1) - var_vals(i);
-    // All others are 0
+    double dv_dt = var_vals(i + 1) - var_vals(i);
+    jac(i, i) = -var_vals(time_index);
+    jac(i, i + 1) = var_vals(time_index);
+    jac(i, time_index) = dv_dt;
+    jac(num_vels + i, i) = var_vals(time_index);
+    jac(num_vels + i, i + 1) = -var_vals(time_index);
+    jac(num_vels + i, time_index) = -dv_dt;
   }
 
-  // bottom half is negative velocities
-  jac.bottomRows(num_vels) = -jac.topRows(num_vels);
-
   return jac;
 }
 
@@ -292,15 +292,21 @@ void CartPoseTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   }
   else if ((term_type & TT_COST) && ~(term_type | ~TT_USE_TIME))
   {
-    sco::VectorOfVectorPtr f(new CartPoseErrCalculator(input_pose, prob.GetPlanningScene(), link, tcp));
-    prob.addCost(sco::CostPtr(new sco::CostFromErrFunc(f, prob.GetVarRow(timestep, 0, n_dof),
+    sco::VectorOfVectorPtr f(
+        new CartPoseErrCalculator(input_pose, prob.GetPlanningScene(), prob.GetPlanningGroup(), link, tcp));
+    sco::MatrixOfVectorPtr dfdx(
+        new CartPoseJacCalculator(input_pose, prob.GetPlanningScene(), prob.GetPlanningGroup(), link, tcp));
+    prob.addCost(sco::CostPtr(new sco::CostFromErrFunc(f, dfdx, prob.GetVarRow(timestep, 0, n_dof),
                                                        concatVector(rot_coeffs, pos_coeffs), sco::ABS, name)));
   }
   else if ((term_type & TT_CNT) && ~(term_type | ~TT_USE_TIME))
   {
-    sco::VectorOfVectorPtr f(new CartPoseErrCalculator(input_pose, prob.GetPlanningScene(), link, tcp));
+    sco::VectorOfVectorPtr f(
+        new CartPoseErrCalculator(input_pose, prob.GetPlanningScene(), prob.GetPlanningGroup(), link, tcp));
+    sco::MatrixOfVectorPtr dfdx(
+        new CartPoseJacCalculator(input_pose, prob.GetPlanningScene(), prob.GetPlanningGroup(), link, tcp));
     prob.addConstraint(sco::ConstraintPtr(new sco::ConstraintFromErrFunc(
-        f, prob.GetVarRow(timestep, 0, n_dof), concatVector(rot_coeffs, pos_coeffs), sco::EQ, name)));
+        f, dfdx, prob.GetVarRow(timestep, 0, n_dof), concatVector(rot_coeffs, pos_coeffs), sco::EQ, name)));
   }
   else
   {
@@ -444,65 +450,38 @@ void JointVelTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   trajopt::VarArray vars = prob.GetVars();
   trajopt::VarArray joint_vars = vars.block(0, 0, vars.rows(), static_cast<int>(n_dof));
 
-  if (term_type == (TT_COST | TT_USE_TIME))
-  {
-    unsigned num_vels = last_step - first_step;
-
-    // Apply seperate cost to each joint b/c that is how the error function is currently written
-    for (size_t j = 0; j < n_dof; j++)
-    {
-      // Get a vector of a single column of vars
-      sco::VarVector joint_vars_vec = joint_vars.cblock(first_step, j, last_step - first_step + 1);
-      sco::VarVector time_vars_vec = vars.cblock(first_step, vars.cols() - 1, last_step - first_step + 1);
-
-      // If the tolerances are 0, an equality cost is set
-      if (is_upper_zeros && is_lower_zeros)
-      {
-        trajopt::DblVec single_jnt_coeffs = trajopt::DblVec(num_vels * 2, coeffs[j]);
-        prob.addCost(sco::CostPtr(new sco::CostFromErrFunc(
-            sco::VectorOfVectorPtr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVectorPtr(new JointVelJacobianCalculator()), concatVector(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs), sco::SQUARED, name + "_j" + std::to_string(j))));
-      }
-      // Otherwise it's a hinged "inequality" cost
-      else
-      {
-        trajopt::DblVec single_jnt_coeffs = trajopt::DblVec(num_vels * 2, coeffs[j]);
-        prob.addCost(sco::CostPtr(new sco::CostFromErrFunc(
-            sco::VectorOfVectorPtr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVectorPtr(new JointVelJacobianCalculator()), concatVector(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs), sco::HINGE, name + "_j" + std::to_string(j))));
-      }
-    }
-  }
-  else if (term_type == (TT_CNT | TT_USE_TIME))
+  if (term_type == (TT_COST | TT_USE_TIME) || term_type == (TT_CNT | TT_USE_TIME))
   {
-    unsigned num_vels = last_step - first_step;
-
-    // Apply seperate cnt to each joint b/c that is how the error function is currently written
+    // Apply seperate cost/cnt to each joint and each velocity. A term spanning the whole trajectory would have a
+    // jacobian with 2 * num_vels rows over all the variables of the joint, which sco expands into dense affine
+    // expressions. Each velocity only depends on two joint values and one time value, so windows of two steps keep the
+    // size of the convex approximation linear in the number of timesteps.
+    // If the tolerances are 0, an equality cost/cnt is set. Otherwise it's a hinged "inequality" cost/cnt
+    bool is_equality = is_upper_zeros && is_lower_zeros;
     for (size_t j = 0; j < n_dof; j++)
     {
-      // Get a vector of a single column of vars
-      sco::VarVector joint_vars_vec = joint_vars.cblock(first_step, j, last_step - first_step + 1);
-      sco::VarVector time_vars_vec = vars.cblock(first_step, vars.cols() - 1, last_step - first_step + 1);
-
-      // If the tolerances are 0, an equality cnt is set
-      if (is_upper_zeros && is_lower_zeros)
-      {
-        trajopt::DblVec single_jnt_coeffs = trajopt::DblVec(num_vels * 2, coeffs[j]);
-        prob.addConstraint(sco::ConstraintPtr(new sco::ConstraintFromErrFunc(
-            sco::VectorOfVectorPtr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVectorPtr(new JointVelJacobianCalculator()), concatVector(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs), sco::EQ, name + "_j" + std::to_string(j))));
-      }
-      // Otherwise it's a hinged "inequality" constraint
-      else
+      trajopt::DblVec single_vel_coeffs = trajopt::DblVec(2, coeffs[j]);
+      for (int i = first_step; i < last_step; ++i)
       {
-        trajopt::DblVec single_jnt_coeffs = trajopt::DblVec(num_vels * 2, coeffs[j]);
-        prob.addConstraint(sco::ConstraintPtr(new sco::ConstraintFromErrFunc(
-            sco::VectorOfVectorPtr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVectorPtr(new JointVelJacobianCalculator()), concatVector(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs), sco::INEQ, name + "_j" + std::to_string(j))));
+        // Get a window of two steps of a single column of vars
+        sco::VarVector joint_vars_vec = joint_vars.cblock(i, j, 2);
+        sco::VarVector time_vars_vec = vars.cblock(i, vars.cols() - 1, 2);
+        std::string term_name = name + "_j" + std::to_string(j) + "_" + std::to_string(i);
+
+        sco::VectorOfVectorPtr f(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j]));
+        sco::MatrixOfVectorPtr dfdx(new JointVelJacobianCalculator());
+        if (term_type & TT_COST)
+        {
+          prob.addCost(sco::CostPtr(new sco::CostFromErrFunc(f, dfdx, concatVector(joint_vars_vec, time_vars_vec),
+                                                             util::toVectorXd(single_vel_coeffs),
+                                                             is_equality ? sco::SQUARED : sco::HINGE, term_name)));
+        }
+        else
+        {
+          prob.addConstraint(sco::ConstraintPtr(new sco::ConstraintFromErrFunc(
+              f, dfdx, concatVector(joint_vars_vec, time_vars_vec), util::toVectorXd(single_vel_coeffs),
+              is_equality ? sco::EQ : sco::INEQ, term_name)));
+        }
       }
     }
   }
@@ -546,6 +525,45 @@ void JointVelTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   }
 }
 
+void CollisionTermInfo::addObjectiveTerms(TrajOptProblem& prob)
+{
+  unsigned int n_dof = prob.GetActiveGroupNumDOF();
+
+  if (last_step <= -1 || last_step > prob.GetNumSteps() - 1)
+    last_step = prob.GetNumSteps() - 1;
+  if (first_step < 0)
+    first_step = 0;
+  if (last_step < first_step)
+  {
+    std::swap(first_step, last_step);
+    ROS_WARN("Last time step for CollisionTerm comes before first step. Reversing them.");
+  }
+
+  for (int i = first_step; i <= last_step; ++i)
+  {
+    sco::VectorOfVectorPtr f(new CollisionErrCalculator(prob.GetPlanningScene(), prob.GetPlanningGroup(),
+                                                        safety_margin, safety_margin_buffer));
+    sco::MatrixOfVectorPtr dfdx(new CollisionJacCalculator(prob.GetPlanningScene(), prob.GetPlanningGroup(),
+                                                           safety_margin, safety_margin_buffer));
+    std::string term_name = name + "_" + std::to_string(i);
+    if (term_type & TT_COST)
+    {
+      prob.addCost(sco::CostPtr(new sco::CostFromErrFunc(f, dfdx, prob.GetVarRow(i, 0, n_dof),
+                                                         Eigen::VectorXd::Constant(1, coeff), sco::HINGE, term_name)));
+    }
+    else if (term_type & TT_CNT)
+    {
+      prob.addConstraint(sco::ConstraintPtr(new sco::ConstraintFromErrFunc(
+          f, dfdx, prob.GetVarRow(i, 0, n_dof), Eigen::VectorXd::Constant(1, coeff), sco::INEQ, term_name)));
+    }
+    else
+    {
+      ROS_WARN("CollisionTermInfo does not have a valid term_type defined. No cost/constraint applied");
+      return;
+    }
+  }
+}
+
 void generateInitialTrajectory(const ProblemInfo& pci, const std::vector<double>& current_joint_values,
                                trajopt::TrajArray& init_traj)
 {
@@ -35,6 +35,7 @@
 /* Author: Omid Heidari */
 
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/conversions.h>
 
 #include <moveit_msgs/MotionPlanRequest.h>
@@ -58,6 +59,24 @@
 
 namespace trajopt_interface
 {
+namespace
+{
+/// Get the transform of \e frame_id in the model frame of \e planning_scene. An empty frame id is the model frame.
+bool getGoalFrameTransform(const planning_scene::PlanningScene& planning_scene, const std::string& frame_id,
+                           Eigen::Isometry3d& transform)
+{
+  if (frame_id.empty())
+  {
+    transform.setIdentity();
+    return true;
+  }
+  if (!planning_scene.knowsFrameTransform(frame_id))
+    return false;
+  transform = planning_scene.getFrameTransform(frame_id);
+  return true;
+}
+}  // namespace
+
 TrajOptInterface::TrajOptInterface(const ros::NodeHandle& nh) : nh_(nh), name_("TrajOptInterface")
 {
   trajopt_problem_ = TrajOptProblemPtr(new TrajOptProblem);
@@ -153,8 +172,41 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   {
     CartPoseTermInfoPtr cart_goal_pos(new CartPoseTermInfo);
 
-    // TODO: Feed cart_goal_pos with request information and the needed param to the setup.yaml file
     // TODO: Multiple Cartesian constraints
+    const moveit_msgs::PositionConstraint& position_goal = req.goal_constraints[0].position_constraints[0];
+    const moveit_msgs::OrientationConstraint& orientation_goal = req.goal_constraints[0].orientation_constraints[0];
+    if (position_goal.constraint_region.primitive_poses.empty())
+    {
+      ROS_ERROR_STREAM_NAMED("trajopt_planner", "position constraint has no constraint region");
+      res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
+      return false;
+    }
+
+    // The goal is given in the header frames of the constraints, the cost term expects it in the model frame
+    Eigen::Isometry3d position_frame, orientation_frame;
+    if (!getGoalFrameTransform(*planning_scene, position_goal.header.frame_id, position_frame) ||
+        !getGoalFrameTransform(*planning_scene, orientation_goal.header.frame_id, orientation_frame))
+    {
+      ROS_ERROR_STREAM_NAMED("trajopt_planner", "Unknown frame '" << position_goal.header.frame_id << "' or '"
+                                                                  << orientation_goal.header.frame_id
+                                                                  << "' of the Cartesian goal");
+      res.error_code.val = moveit_msgs::MoveItErrorCodes::FRAME_TRANSFORM_FAILURE;
+      return false;
+    }
+    const geometry_msgs::Point& goal_position = position_goal.constraint_region.primitive_poses[0].position;
+    cart_goal_pos->xyz = position_frame * Eigen::Vector3d(goal_position.x, goal_position.y, goal_position.z);
+    const Eigen::Quaterniond goal_orientation =
+        Eigen::Quaterniond(orientation_frame.rotation()) *
+        Eigen::Quaterniond(orientation_goal.orientation.w, orientation_goal.orientation.x,
+                           orientation_goal.orientation.y, orientation_goal.orientation.z);
+    cart_goal_pos->wxyz =
+        Eigen::Vector4d(goal_orientation.w(), goal_orientation.x(), goal_orientation.y(), goal_orientation.z());
+    cart_goal_pos->link = position_goal.link_name;
+    cart_goal_pos->tcp.translation() = Eigen::Vector3d(
+        position_goal.target_point_offset.x, position_goal.target_point_offset.y, position_goal.target_point_offset.z);
+    cart_goal_pos->timestep = problem_info.basic_info.n_steps - 1;
+    cart_goal_pos->name = "cart_goal_pos";
+    cart_goal_pos->term_type = TT_CNT;
 
     // Add the constraint to problem_info
     problem_info.cnt_infos.push_back(cart_goal_pos);
@@ -210,6 +262,16 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   joint_vel->term_type = trajopt_interface::TT_COST;
   problem_info.cost_infos.push_back(joint_vel);
 
+  ROS_INFO(" ======================================= Collision Costs");
+  bool use_collision_cost;
+  nh_.param("collision_term_info/enabled", use_collision_cost, true);
+  if (use_collision_cost)
+  {
+    CollisionTermInfoPtr collision(new CollisionTermInfo);
+    setCollisionTermInfoParams(collision);
+    problem_info.cost_infos.push_back(collision);
+  }
+
   ROS_INFO(" ======================================= Visibility Constraints");
   if (!req.goal_constraints[0].visibility_constraints.empty())
   {
@@ -435,6 +497,17 @@ void TrajOptInterface::setJointPoseTermInfoParams(JointPoseTermInfoPtr& jp, std:
   nh_.getParam("joint_pos_term_info/" + name + "/name", jp->name);
 }
 
+void TrajOptInterface::setCollisionTermInfoParams(CollisionTermInfoPtr& collision)
+{
+  nh_.param("collision_term_info/coeff", collision->coeff, 20.0);
+  nh_.param("collision_term_info/safety_margin", collision->safety_margin, 0.025);
+  nh_.param("collision_term_info/safety_margin_buffer", collision->safety_margin_buffer, 0.05);
+  nh_.param("collision_term_info/first_timestep", collision->first_step, 0);
+  nh_.param("collision_term_info/last_timestep", collision->last_step, -1);
+  collision->name = "collision";
+  collision->term_type = TT_COST;
+}
+
 trajopt::DblVec TrajOptInterface::extractStartJointValues(const planning_interface::MotionPlanRequest& req,
                                                           const std::vector<std::string>& group_joint_names)
 {
@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 
 #include <trajopt/common.hpp>
+#include <trajopt/trajectory_costs.hpp>
 
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
@@ -37,6 +38,7 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit_msgs/MotionPlanResponse.h>
+#include <geometric_shapes/shapes.h>
 
 class TrajectoryTest : public ::testing::Test
 {
@@ -197,6 +199,175 @@ TEST_F(TrajectoryTest, goalTolerance)
   }
 }
 
+TEST_F(TrajectoryTest, cartPoseJacobianValidation)
+{
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model_));
+  const std::string link = "panda_link8";
+
+  Eigen::VectorXd joint_values(7);
+  joint_values << 0.4, 0.3, 0.5, -0.55, 0.88, 1.0, -0.075;
+  Eigen::Isometry3d target = Eigen::Isometry3d::Identity();
+  target.translation() = Eigen::Vector3d(0.4, 0.1, 0.5);
+  target.linear() = Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitX()).toRotationMatrix();
+  Eigen::Isometry3d tcp = Eigen::Isometry3d::Identity();
+  tcp.translation() = Eigen::Vector3d(0.0, 0.0, 0.1);
+
+  trajopt_interface::CartPoseErrCalculator err_calc(target, planning_scene, PLANNING_GROUP, link, tcp);
+  trajopt_interface::CartPoseJacCalculator jac_calc(target, planning_scene, PLANNING_GROUP, link, tcp);
+
+  // Compare the analytic jacobian against central differences
+  Eigen::MatrixXd jac = jac_calc(joint_values);
+  ASSERT_EQ(jac.rows(), 6);
+  ASSERT_EQ(jac.cols(), 7);
+  const double delta = 1e-6;
+  for (int j = 0; j < joint_values.size(); ++j)
+  {
+    Eigen::VectorXd plus = joint_values, minus = joint_values;
+    plus(j) += delta;
+    minus(j) -= delta;
+    Eigen::VectorXd numerical = (err_calc(plus) - err_calc(minus)) / (2 * delta);
+    for (int i = 0; i < 6; ++i)
+      EXPECT_NEAR(jac(i, j), numerical(i), 1e-5) << "row " << i << " col " << j;
+  }
+}
+
+TEST_F(TrajectoryTest, collisionJacobianValidation)
+{
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model_));
+  Eigen::VectorXd joint_values(7);
+  joint_values << 0.4, 0.3, 0.5, -0.55, 0.88, 1.0, -0.075;
+
+  // A sphere next to the flange, so the nearest contact is between the arm and a smooth surface
+  robot_state::RobotState state = planning_scene->getCurrentState();
+  state.setToDefaultValues();
+  state.setJointGroupPositions(PLANNING_GROUP, joint_values);
+  state.update();
+  Eigen::Isometry3d sphere_pose = Eigen::Isometry3d::Identity();
+  sphere_pose.translation() =
+      state.getGlobalLinkTransform("panda_link8").translation() + Eigen::Vector3d(0.0, 0.0, 0.12);
+  planning_scene->getWorldNonConst()->addToObject("sphere", shapes::ShapeConstPtr(new shapes::Sphere(0.05)),
+                                                  sphere_pose);
+
+  const double safety_margin = 0.1;
+  const double safety_margin_buffer = 0.2;
+  trajopt_interface::CollisionErrCalculator err_calc(planning_scene, PLANNING_GROUP, safety_margin,
+                                                     safety_margin_buffer);
+  trajopt_interface::CollisionJacCalculator jac_calc(planning_scene, PLANNING_GROUP, safety_margin,
+                                                     safety_margin_buffer);
+
+  // The sphere has to be within the distance threshold for the term to have a gradient
+  ASSERT_GT(err_calc(joint_values)(0), -safety_margin_buffer);
+  Eigen::MatrixXd jac = jac_calc(joint_values);
+  ASSERT_EQ(jac.rows(), 1);
+  ASSERT_EQ(jac.cols(), 7);
+  EXPECT_GT(jac.norm(), 0.0);
+
+  // Compare the analytic jacobian against central differences, the distance is only computed to the precision of the
+  // collision checker
+  const double delta = 1e-5;
+  for (int j = 0; j < joint_values.size(); ++j)
+  {
+    Eigen::VectorXd plus = joint_values, minus = joint_values;
+    plus(j) += delta;
+    minus(j) -= delta;
+    Eigen::VectorXd numerical = (err_calc(plus) - err_calc(minus)) / (2 * delta);
+    EXPECT_NEAR(jac(0, j), numerical(0), 1e-3) << "col " << j;
+  }
+}
+
+TEST_F(TrajectoryTest, jointVelJacobianValidation)
+{
+  // theta_0, theta_1, theta_2, 1/dt_0, 1/dt_1, 1/dt_2
+  Eigen::VectorXd var_vals(6);
+  var_vals << 0.1, 0.4, 0.2, 2.0, 3.0, 4.0;
+
+  trajopt_interface::JointVelErrCalculator err_calc(0.0, 0.5, -0.5);
+  trajopt_interface::JointVelJacobianCalculator jac_calc;
+  Eigen::MatrixXd jac = jac_calc(var_vals);
+  ASSERT_EQ(jac.rows(), 4);
+  ASSERT_EQ(jac.cols(), 6);
+
+  const double delta = 1e-6;
+  for (int j = 0; j < var_vals.size(); ++j)
+  {
+    Eigen::VectorXd plus = var_vals, minus = var_vals;
+    plus(j) += delta;
+    minus(j) -= delta;
+    Eigen::VectorXd numerical = (err_calc(plus) - err_calc(minus)) / (2 * delta);
+    for (int i = 0; i < jac.rows(); ++i)
+      EXPECT_NEAR(jac(i, j), numerical(i), 1e-6) << "row " << i << " col " << j;
+  }
+}
+
+TEST_F(TrajectoryTest, problemScaling)
+{
+  // Not a strict performance test; construction and convexification times are reported for comparison
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model_));
+  Eigen::Isometry3d box_pose = Eigen::Isometry3d::Identity();
+  box_pose.translation() = Eigen::Vector3d(0.5, 0.0, 0.3);
+  planning_scene->getWorldNonConst()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(0.1, 0.1, 0.1)),
+                                                  box_pose);
+
+  robot_state::RobotState start_state = planning_scene->getCurrentState();
+  start_state.setToDefaultValues();
+  std::vector<double> start_joint_values = { 0.4, 0.3, 0.5, -0.55, 0.88, 1.0, -0.075 };
+  start_state.setJointGroupPositions(PLANNING_GROUP, start_joint_values);
+  planning_scene->setCurrentState(start_state);
+
+  for (int n_steps : { 50, 100, 200 })
+  {
+    trajopt_interface::ProblemInfo problem_info(planning_scene, PLANNING_GROUP);
+    problem_info.basic_info.n_steps = n_steps;
+    problem_info.basic_info.start_fixed = true;
+    problem_info.basic_info.use_time = true;
+    problem_info.basic_info.dt_lower_lim = 1.0;
+    problem_info.basic_info.dt_upper_lim = 100.0;
+    problem_info.basic_info.convex_solver = sco::ModelType::AUTO_SOLVER;
+    problem_info.init_info.type = trajopt_interface::InitInfo::STATIONARY;
+    problem_info.init_info.dt = 10.0;
+
+    trajopt_interface::JointVelTermInfoPtr joint_vel(new trajopt_interface::JointVelTermInfo);
+    joint_vel->coeffs = std::vector<double>(7, 5.0);
+    joint_vel->targets = std::vector<double>(7, 0.0);
+    joint_vel->name = "joint_vel";
+    joint_vel->term_type = trajopt_interface::TT_COST | trajopt_interface::TT_USE_TIME;
+    problem_info.cost_infos.push_back(joint_vel);
+
+    trajopt_interface::CollisionTermInfoPtr collision(new trajopt_interface::CollisionTermInfo);
+    collision->name = "collision";
+    collision->term_type = trajopt_interface::TT_COST;
+    problem_info.cost_infos.push_back(collision);
+
+    trajopt_interface::CartPoseTermInfoPtr cart_goal(new trajopt_interface::CartPoseTermInfo);
+    cart_goal->name = "cart_goal";
+    cart_goal->term_type = trajopt_interface::TT_CNT;
+    cart_goal->timestep = n_steps - 1;
+    cart_goal->link = "panda_link8";
+    cart_goal->xyz = Eigen::Vector3d(0.4, -0.3, 0.5);
+    cart_goal->wxyz = Eigen::Vector4d(0.0, 1.0, 0.0, 0.0);
+    problem_info.cnt_infos.push_back(cart_goal);
+
+    ros::WallTime start_time = ros::WallTime::now();
+    trajopt_interface::TrajOptProblemPtr prob = trajopt_interface::ConstructProblem(problem_info);
+    double construct_time = (ros::WallTime::now() - start_time).toSec();
+    ASSERT_TRUE(static_cast<bool>(prob));
+
+    sco::DblVec x = trajopt::trajToDblVec(prob->GetInitTraj());
+    sco::Model* model = prob->getModel().get();
+    start_time = ros::WallTime::now();
+    for (const sco::CostPtr& cost : prob->getCosts())
+      cost->convex(x, model);
+    for (const sco::ConstraintPtr& cnt : prob->getConstraints())
+      cnt->convex(x, model);
+    double convexify_time = (ros::WallTime::now() - start_time).toSec();
+
+    ROS_INFO_STREAM_NAMED("trajectory_test", "n_steps: " << n_steps << " costs: " << prob->getNumCosts()
+                                                         << " constraints: " << prob->getNumConstraints()
+                                                         << " construct: " << construct_time
+                                                         << "s convexify: " << convexify_time << "s");
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -58,6 +58,7 @@ DIAGNOSTIC_PUSH
 #include <string>
 #include <boost/function.hpp>
 #include <memory>
+#include <mutex>
 
 namespace moveit_ros_benchmarks
 {
@@ -104,8 +105,9 @@ public:
   virtual ~BenchmarkExecutor();
 
   // Initialize the benchmark executor by loading planning pipelines from the
-  // given set of classes
-  void initialize(const std::vector<std::string>& plugin_classes);
+  // given set of classes. With num_threads > 1, every thread gets its own instance
+  // of each pipeline and the runs of a planner are executed in parallel.
+  void initialize(const std::vector<std::string>& plugin_classes, unsigned int num_threads = 1);
 
   void addPreRunEvent(const PreRunEventFunction& func);
   void addPostRunEvent(const PostRunEventFunction& func);
@@ -206,6 +208,13 @@ protected:
   void runBenchmark(moveit_msgs::msg::MotionPlanRequest request,
                     const std::map<std::string, std::vector<std::string>>& planners, int runs);
 
+  /// Solve a single run of a benchmark, using the given planning context if it is set or the pipeline otherwise
+  bool solveRun(const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                const planning_interface::PlanningContextPtr& planning_context,
+                const planning_scene::PlanningSceneConstPtr& scene,
+                const moveit_msgs::msg::MotionPlanRequest& request,
+                planning_interface::MotionPlanDetailedResponse& response);
+
   planning_scene_monitor::PlanningSceneMonitor* psm_;
   moveit_warehouse::PlanningSceneStorage* pss_;
   moveit_warehouse::PlanningSceneWorldStorage* psws_;
@@ -220,6 +229,12 @@ protected:
 
   std::map<std::string, planning_pipeline::PlanningPipelinePtr> planning_pipelines_;
 
+  /// Additional pipeline instances for the parallel runs; worker 0 uses planning_pipelines_
+  std::vector<std::map<std::string, planning_pipeline::PlanningPipelinePtr>> worker_pipelines_;
+
+  /// Serializes the pre/post-run events, the metrics collection and the progress output of parallel runs
+  std::mutex run_events_lock_;
+
   std::vector<PlannerBenchmarkData> benchmark_data_;
 
   std::vector<PreRunEventFunction> pre_event_fns_;
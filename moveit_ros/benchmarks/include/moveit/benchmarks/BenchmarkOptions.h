@@ -66,6 +66,8 @@ public:
 
   /** \brief Get the specified number of benchmark query runs */
   int getNumRuns() const;
+  /** \brief Get the number of benchmark runs executed in parallel */
+  int getNumThreads() const;
   /** \brief Get the maximum timeout per planning attempt */
   double getTimeout() const;
   /** \brief Get the reference name of the benchmark */
@@ -117,6 +119,7 @@ protected:
 
   /// benchmark parameters
   int runs_;
+  int threads_;
   double timeout_;
   std::string benchmark_name_;
   std::string group_name_;
@@ -44,6 +44,8 @@
 #include <boost/math/constants/constants.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <atomic>
+#include <thread>
 #ifndef _WIN32
 #include <unistd.h>
 #else
@@ -87,40 +89,76 @@ BenchmarkExecutor::~BenchmarkExecutor()
   delete psm_;
 }
 
-void BenchmarkExecutor::initialize(const std::vector<std::string>& planning_pipeline_names)
+static planning_pipeline::PlanningPipelinePtr loadPlanningPipeline(const moveit::core::RobotModelConstPtr& robot_model,
+                                                                   const std::string& planning_pipeline_name)
+{
+  // Initialize planning pipelines from configured child namespaces
+  ros::NodeHandle child_nh(ros::NodeHandle("~"), planning_pipeline_name);
+  planning_pipeline::PlanningPipelinePtr pipeline(
+      new planning_pipeline::PlanningPipeline(robot_model, child_nh, "planning_plugin", "request_adapters"));
+
+  // Verify the pipeline has successfully initialized a planner
+  if (!pipeline->getPlannerManager())
+    return planning_pipeline::PlanningPipelinePtr();
+
+  // Disable visualizations
+  pipeline->displayComputedMotionPlans(false);
+  pipeline->checkSolutionPaths(false);
+  return pipeline;
+}
+
+void BenchmarkExecutor::initialize(const std::vector<std::string>& planning_pipeline_names, unsigned int num_threads)
 {
   planning_pipelines_.clear();
+  worker_pipelines_.clear();
 
-  ros::NodeHandle pnh("~");
   for (const std::string& planning_pipeline_name : planning_pipeline_names)
   {
-    // Initialize planning pipelines from configured child namespaces
-    ros::NodeHandle child_nh(pnh, planning_pipeline_name);
-    planning_pipeline::PlanningPipelinePtr pipeline(new planning_pipeline::PlanningPipeline(
-        planning_scene_->getRobotModel(), child_nh, "planning_plugin", "request_adapters"));
-
-    // Verify the pipeline has successfully initialized a planner
-    if (!pipeline->getPlannerManager())
+    planning_pipeline::PlanningPipelinePtr pipeline =
+        loadPlanningPipeline(planning_scene_->getRobotModel(), planning_pipeline_name);
+    if (!pipeline)
     {
       ROS_ERROR("Failed to initialize planning pipeline '%s'", planning_pipeline_name.c_str());
       continue;
     }
-
-    // Disable visualizations and store pipeline
-    pipeline->displayComputedMotionPlans(false);
-    pipeline->checkSolutionPaths(false);
     planning_pipelines_[planning_pipeline_name] = pipeline;
   }
 
   // Error check
   if (planning_pipelines_.empty())
+  {
     ROS_ERROR("No planning pipelines have been loaded. Nothing to do for the benchmarking service.");
-  else
+    return;
+  }
+
+  ROS_INFO("Available planning pipelines:");
+  for (const std::pair<std::string, planning_pipeline::PlanningPipelinePtr>& entry : planning_pipelines_)
+    ROS_INFO_STREAM("Pipeline: " << entry.first << ", Planner: " << entry.second->getPlannerPluginName());
+
+  // Planner managers keep per-request state (e.g. cached planning contexts), so every thread running benchmarks in
+  // parallel gets its own instance of each pipeline
+  worker_pipelines_.push_back(planning_pipelines_);
+  for (unsigned int i = 1; i < num_threads; ++i)
   {
-    ROS_INFO("Available planning pipelines:");
-    for (const std::pair<std::string, planning_pipeline::PlanningPipelinePtr>& entry : planning_pipelines_)
-      ROS_INFO_STREAM("Pipeline: " << entry.first << ", Planner: " << entry.second->getPlannerPluginName());
+    std::map<std::string, planning_pipeline::PlanningPipelinePtr> pipelines;
+    for (const std::pair<const std::string, planning_pipeline::PlanningPipelinePtr>& entry : planning_pipelines_)
+    {
+      planning_pipeline::PlanningPipelinePtr pipeline =
+          loadPlanningPipeline(planning_scene_->getRobotModel(), entry.first);
+      if (!pipeline)
+        break;
+      pipelines[entry.first] = pipeline;
+    }
+    if (pipelines.size() != planning_pipelines_.size())
+    {
+      ROS_WARN("Failed to load planning pipelines for benchmark thread %u. Using %lu threads.", i + 1,
+               worker_pipelines_.size());
+      break;
+    }
+    worker_pipelines_.push_back(pipelines);
   }
+  if (worker_pipelines_.size() > 1)
+    ROS_INFO("Running up to %lu benchmark runs in parallel", worker_pipelines_.size());
 }
 
 void BenchmarkExecutor::clear()
@@ -753,12 +791,15 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
 
   boost::progress_display progress(num_planners * runs, std::cout);
 
+  // Runs are independent of each other, so they are distributed over all available pipeline instances.
+  // Planner and query events are still invoked in order from this thread.
+  const std::size_t num_workers = std::max<std::size_t>(1, std::min<std::size_t>(worker_pipelines_.size(), runs));
+
   // Iterate through all planning pipelines
   for (const std::pair<const std::string, std::vector<std::string>>& pipeline_entry : pipeline_map)
   {
-    planning_pipeline::PlanningPipelinePtr planning_pipeline = planning_pipelines_[pipeline_entry.first];
     // Use the planning context if the pipeline only contains the planner plugin
-    bool use_planning_context = planning_pipeline->getAdapterPluginNames().empty();
+    bool use_planning_context = planning_pipelines_[pipeline_entry.first]->getAdapterPluginNames().empty();
     // Iterate through all planners configured for the pipeline
     for (const std::string& planner_id : pipeline_entry.second)
     {
@@ -766,7 +807,8 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
       PlannerBenchmarkData planner_data(runs);
       // This vector stores all motion plan results for further evaluation
       std::vector<planning_interface::MotionPlanDetailedResponse> responses(runs);
-      std::vector<bool> solved(runs);
+      // not std::vector<bool>, whose elements share bytes and cannot be written from several threads
+      std::vector<char> solved(runs);
 
       request.planner_id = planner_id;
 
@@ -774,52 +816,63 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
       for (PlannerStartEventFunction& planner_start_fn : planner_start_fns_)
         planner_start_fn(request, planner_data);
 
-      planning_interface::PlanningContextPtr planning_context;
-      if (use_planning_context)
-        planning_context = planning_pipeline->getPlannerManager()->getPlanningContext(planning_scene_, request);
-
-      // Iterate runs
-      for (int j = 0; j < runs; ++j)
-      {
-        // Pre-run events
-        for (PreRunEventFunction& pre_event_fn : pre_event_fns_)
-          pre_event_fn(request);
-
-        // Solve problem
-        ros::WallTime start = ros::WallTime::now();
+      std::atomic<int> next_run(0);
+      auto run_worker = [&](std::size_t worker) {
+        // With a single worker, runs behave exactly as the sequential benchmark did: they share the request (which
+        // pre-run events may modify) and plan in the benchmark scene. Parallel workers plan with their own copy of
+        // the request, in their own diff of the scene.
+        moveit_msgs::msg::MotionPlanRequest worker_request;
+        if (num_workers > 1)
+          worker_request = request;
+        moveit_msgs::msg::MotionPlanRequest& run_request = num_workers > 1 ? worker_request : request;
+        planning_scene::PlanningScenePtr scene = num_workers > 1 ? planning_scene_->diff() : planning_scene_;
+
+        planning_pipeline::PlanningPipelinePtr planning_pipeline = num_workers > 1 ?
+                                                                       worker_pipelines_[worker][pipeline_entry.first] :
+                                                                       planning_pipelines_[pipeline_entry.first];
+        planning_interface::PlanningContextPtr planning_context;
         if (use_planning_context)
+          planning_context = planning_pipeline->getPlannerManager()->getPlanningContext(scene, run_request);
+
+        // Iterate runs
+        for (int j = next_run++; j < runs; j = next_run++)
         {
-          solved[j] = planning_context->solve(responses[j]);
-        }
-        else
-        {
-          // The planning pipeline does not support MotionPlanDetailedResponse
-          planning_interface::MotionPlanResponse response;
-          solved[j] = planning_pipeline->generatePlan(planning_scene_, request, response);
-          responses[j].error_code_ = response.error_code_;
-          if (response.trajectory_)
+          // Pre-run events
           {
-            responses[j].description_.push_back("plan");
-            responses[j].trajectory_.push_back(response.trajectory_);
-            responses[j].processing_time_.push_back(response.planning_time_);
+            std::lock_guard<std::mutex> lock(run_events_lock_);
+            for (PreRunEventFunction& pre_event_fn : pre_event_fns_)
+              pre_event_fn(run_request);
           }
-        }
-        double total_time = (ros::WallTime::now() - start).toSec();
 
-        // Collect data
-        start = ros::WallTime::now();
+          // Solve problem
+          ros::WallTime start = ros::WallTime::now();
+          solved[j] = solveRun(planning_pipeline, planning_context, scene, run_request, responses[j]);
+          double total_time = (ros::WallTime::now() - start).toSec();
 
-        // Post-run events
-        for (PostRunEventFunction& post_event_fn : post_event_fns_)
-          post_event_fn(request, responses[j], planner_data[j]);
-        collectMetrics(planner_data[j], responses[j], solved[j], total_time);
-        double metrics_time = (ros::WallTime::now() - start).toSec();
-        ROS_DEBUG("Spent %lf seconds collecting metrics", metrics_time);
+          // Collect data
+          start = ros::WallTime::now();
 
-        ++progress;
-      }
+          // Post-run events and metrics; collectMetrics() checks the trajectories in the benchmark scene itself,
+          // which is not safe to query from several threads at once
+          std::lock_guard<std::mutex> lock(run_events_lock_);
+          for (PostRunEventFunction& post_event_fn : post_event_fns_)
+            post_event_fn(run_request, responses[j], planner_data[j]);
+          collectMetrics(planner_data[j], responses[j], solved[j], total_time);
+          double metrics_time = (ros::WallTime::now() - start).toSec();
+          ROS_DEBUG("Spent %lf seconds collecting metrics", metrics_time);
 
-      computeAveragePathSimilarities(planner_data, responses, solved);
+          ++progress;
+        }
+      };
+
+      std::vector<std::thread> workers;
+      for (std::size_t worker = 1; worker < num_workers; ++worker)
+        workers.emplace_back(run_worker, worker);
+      run_worker(0);
+      for (std::thread& worker : workers)
+        worker.join();
+
+      computeAveragePathSimilarities(planner_data, responses, std::vector<bool>(solved.begin(), solved.end()));
 
       // Planner completion events
       for (PlannerCompletionEventFunction& planner_completion_fn : planner_completion_fns_)
@@ -830,6 +883,28 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
   }
 }
 
+bool BenchmarkExecutor::solveRun(const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                                 const planning_interface::PlanningContextPtr& planning_context,
+                                 const planning_scene::PlanningSceneConstPtr& scene,
+                                 const moveit_msgs::msg::MotionPlanRequest& request,
+                                 planning_interface::MotionPlanDetailedResponse& response)
+{
+  if (planning_context)
+    return planning_context->solve(response);
+
+  // The planning pipeline does not support MotionPlanDetailedResponse
+  planning_interface::MotionPlanResponse plan_response;
+  bool solved = planning_pipeline->generatePlan(scene, request, plan_response);
+  response.error_code_ = plan_response.error_code_;
+  if (plan_response.trajectory_)
+  {
+    response.description_.push_back("plan");
+    response.trajectory_.push_back(plan_response.trajectory_);
+    response.processing_time_.push_back(plan_response.planning_time_);
+  }
+  return solved;
+}
+
 void BenchmarkExecutor::collectMetrics(PlannerRunData& metrics,
                                        const planning_interface::MotionPlanDetailedResponse& mp_res, bool solved,
                                        double total_time)
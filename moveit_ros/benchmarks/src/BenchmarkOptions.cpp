@@ -91,6 +91,11 @@ int BenchmarkOptions::getNumRuns() const
   return runs_;
 }
 
+int BenchmarkOptions::getNumThreads() const
+{
+  return threads_;
+}
+
 double BenchmarkOptions::getTimeout() const
 {
   return timeout_;
@@ -191,6 +196,7 @@ void BenchmarkOptions::readBenchmarkParameters(ros::NodeHandle& nh)
 {
   nh.param(std::string("benchmark_config/parameters/name"), benchmark_name_, std::string(""));
   nh.param(std::string("benchmark_config/parameters/runs"), runs_, 10);
+  nh.param(std::string("benchmark_config/parameters/threads"), threads_, 1);
   nh.param(std::string("benchmark_config/parameters/timeout"), timeout_, 10.0);
   nh.param(std::string("benchmark_config/parameters/output_directory"), output_directory_, std::string(""));
   nh.param(std::string("benchmark_config/parameters/queries"), query_regex_, std::string(".*"));
@@ -218,6 +224,7 @@ void BenchmarkOptions::readBenchmarkParameters(ros::NodeHandle& nh)
 
   ROS_INFO("Benchmark name: '%s'", benchmark_name_.c_str());
   ROS_INFO("Benchmark #runs: %d", runs_);
+  ROS_INFO("Benchmark #threads: %d", threads_);
   ROS_INFO("Benchmark timeout: %f secs", timeout_);
   ROS_INFO("Benchmark group: %s", group_name_.c_str());
   ROS_INFO("Benchmark query regex: '%s'", query_regex_.c_str());
@@ -53,7 +53,7 @@ int main(int argc, char** argv)
 
   std::vector<std::string> planning_pipelines;
   opts.getPlanningPipelineNames(planning_pipelines);
-  server.initialize(planning_pipelines);
+  server.initialize(planning_pipelines, opts.getNumThreads());
 
   // Running benchmarks
   if (!server.runBenchmarks(opts))
@@ -57,7 +57,10 @@ public:
   KinematicsPluginLoader(const rclcpp::Node::SharedPtr& node,
                          const std::string& robot_description = "robot_description",
                          double default_search_resolution = 0.0)
-    : node_(node), robot_description_(robot_description), default_search_resolution_(default_search_resolution)
+    : node_(node)
+    , robot_description_(robot_description)
+    , default_search_resolution_(default_search_resolution)
+    , lazy_loading_(false)
   {
   }
 
@@ -74,11 +77,14 @@ public:
     : node_(node)
     , robot_description_(robot_description)
     , default_search_resolution_(default_search_resolution)
+    , lazy_loading_(false)
     , default_solver_plugin_(solver_plugin)
     , default_solver_timeout_(solve_timeout)
   {
   }
 
+  ~KinematicsPluginLoader();
+
   /** \brief Get a function pointer that allocates and initializes a kinematics solver. If not previously called, this
    * function reads the SRDF and calls the variant below. */
   robot_model::SolverAllocatorFn getLoaderFunction();
@@ -99,12 +105,27 @@ public:
     return ik_timeout_;
   }
 
+  /** \brief Defer allocating and initializing each group's kinematics solver until it is first queried. The allocated
+      solvers are stand-ins that report the group's revolute and prismatic joints, in order, as their joint names;
+      plugins that solve for different joints fail on the first query. Needs to be set before getLoaderFunction()
+      is first called. */
+  void setLazyLoading(bool lazy_loading)
+  {
+    lazy_loading_ = lazy_loading;
+  }
+
+  bool getLazyLoading() const
+  {
+    return lazy_loading_;
+  }
+
   void status() const;
 
 private:
   const rclcpp::Node::SharedPtr node_;
   std::string robot_description_;
   double default_search_resolution_;
+  bool lazy_loading_;
 
   MOVEIT_CLASS_FORWARD(KinematicsLoaderImpl)
   KinematicsLoaderImplPtr loader_;
@@ -38,6 +38,7 @@
 #include <moveit/rdf_loader/rdf_loader.h>
 #include <pluginlib/class_loader.hpp>
 #include <boost/thread/mutex.hpp>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <map>
@@ -49,7 +50,202 @@ namespace kinematics_plugin_loader
 {
 rclcpp::Logger LOGGER = rclcpp::get_logger("kinematics_plugin_loader");
 
+namespace
+{
+/** \brief Stand-in for a kinematics solver that allocates and initializes the actual solver on its first query.
+
+    Group name, frames and joint names are known without the solver, so the robot model can be set up without loading
+    any plugin. The joint names are those of the revolute and prismatic joints of the group, in group order, which is
+    what the chain solvers report; a solver reporting different joints is rejected when it is instantiated. */
+class LazyKinematicsSolver : public kinematics::KinematicsBase
+{
+public:
+  typedef boost::function<kinematics::KinematicsBasePtr()> SolverFactoryFn;
+
+  LazyKinematicsSolver(const robot_model::JointModelGroup* jmg, const std::string& base_frame,
+                       const std::vector<std::string>& tip_frames, double search_discretization,
+                       const SolverFactoryFn& factory)
+    : jmg_(jmg), factory_(factory)
+  {
+    storeValues(jmg->getParentModel(), jmg->getName(), base_frame, tip_frames, search_discretization);
+    for (const robot_model::JointModel* jm : jmg->getJointModels())
+      if (jm->getType() == robot_model::JointModel::REVOLUTE || jm->getType() == robot_model::JointModel::PRISMATIC)
+        joint_names_.push_back(jm->getName());
+  }
+
+  bool getPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                     std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                     const kinematics::KinematicsQueryOptions& options) const override
+  {
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->getPositionIK(ik_pose, ik_seed_state, solution, error_code, options);
+  }
+
+  bool getPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<double>& ik_seed_state,
+                     std::vector<std::vector<double>>& solutions, kinematics::KinematicsResult& result,
+                     const kinematics::KinematicsQueryOptions& options) const override
+  {
+    moveit_msgs::msg::MoveItErrorCodes error_code;
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    if (!solver)
+    {
+      result.kinematic_error = kinematics::KinematicErrors::SOLVER_NOT_ACTIVE;
+      return false;
+    }
+    return solver->getPositionIK(ik_poses, ik_seed_state, solutions, result, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->searchPositionIK(ik_pose, ik_seed_state, timeout, solution, error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution,
+                                              error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->searchPositionIK(ik_pose, ik_seed_state, timeout, solution, solution_callback,
+                                              error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution,
+                                              solution_callback, error_code, options);
+  }
+
+  bool searchPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                        const std::vector<double>& ik_seed_state, double timeout,
+                        const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options,
+                        const moveit::core::RobotState* context_state) const override
+  {
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->searchPositionIK(ik_poses, ik_seed_state, timeout, consistency_limits, solution,
+                                              solution_callback, error_code, options, context_state);
+  }
+
+  bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
+                     std::vector<geometry_msgs::msg::Pose>& poses) const override
+  {
+    moveit_msgs::msg::MoveItErrorCodes error_code;
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver && solver->getPositionFK(link_names, joint_angles, poses);
+  }
+
+  using KinematicsBase::setRedundantJoints;
+
+  bool setRedundantJoints(const std::vector<unsigned int>& redundant_joint_indices) override
+  {
+    // forwarded when the solver is instantiated, which may happen concurrently in another thread
+    std::lock_guard<std::mutex> lock(solver_lock_);
+    if (!solver_)
+      return KinematicsBase::setRedundantJoints(redundant_joint_indices);
+    return solver_->setRedundantJoints(redundant_joint_indices);
+  }
+
+  void getRedundantJoints(std::vector<unsigned int>& redundant_joint_indices) const override
+  {
+    std::lock_guard<std::mutex> lock(solver_lock_);
+    if (solver_)
+      solver_->getRedundantJoints(redundant_joint_indices);
+    else
+      KinematicsBase::getRedundantJoints(redundant_joint_indices);
+  }
+
+  const std::vector<std::string>& getJointNames() const override
+  {
+    return joint_names_;
+  }
+
+  const std::vector<std::string>& getLinkNames() const override
+  {
+    moveit_msgs::msg::MoveItErrorCodes error_code;
+    const kinematics::KinematicsBasePtr& solver = getSolver(error_code);
+    return solver ? solver->getLinkNames() : link_names_;
+  }
+
+  bool supportsGroup(const moveit::core::JointModelGroup* /*jmg*/, std::string* /*error_text_out*/) const override
+  {
+    // checked when the solver is instantiated
+    return true;
+  }
+
+private:
+  const kinematics::KinematicsBasePtr& getSolver(moveit_msgs::msg::MoveItErrorCodes& error_code) const
+  {
+    std::call_once(instantiated_, [this] { instantiate(); });
+    if (!solver_)
+      error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    return solver_;
+  }
+
+  void instantiate() const
+  {
+    RCLCPP_DEBUG(LOGGER, "Instantiating deferred kinematics solver for group '%s'", group_name_.c_str());
+    kinematics::KinematicsBasePtr solver = factory_();
+    if (!solver)
+    {
+      RCLCPP_ERROR(LOGGER, "Kinematics solver could not be instantiated for joint group %s.", group_name_.c_str());
+      return;
+    }
+
+    std::string error_msg;
+    if (!solver->supportsGroup(jmg_, &error_msg))
+    {
+      RCLCPP_ERROR(LOGGER, "Kinematics solver does not support joint group %s.  Error: %s", group_name_.c_str(),
+                   error_msg.c_str());
+      return;
+    }
+    if (solver->getJointNames() != joint_names_)
+    {
+      RCLCPP_ERROR(LOGGER, "Kinematics solver for group '%s' does not solve for the revolute and prismatic joints of "
+                           "the group in order and can't be loaded lazily.",
+                   group_name_.c_str());
+      return;
+    }
+
+    solver->setDefaultTimeout(default_timeout_);
+    std::lock_guard<std::mutex> lock(solver_lock_);
+    if (!redundant_joint_indices_.empty() && solver->setRedundantJoints(redundant_joint_indices_))
+      solver->setSearchDiscretization(redundant_joint_discretization_);
+    solver_ = solver;
+  }
+
+  const robot_model::JointModelGroup* jmg_;
+  SolverFactoryFn factory_;
+  std::vector<std::string> joint_names_;
+  std::vector<std::string> link_names_;
+  mutable std::once_flag instantiated_;
+  // guards solver_ and the redundant joints stored before it is instantiated; solver_ is only assigned once, within
+  // instantiated_, so getSolver() reads it without the lock
+  mutable std::mutex solver_lock_;
+  mutable kinematics::KinematicsBasePtr solver_;
+};
+}  // namespace
+
 class KinematicsPluginLoader::KinematicsLoaderImpl
+  : public std::enable_shared_from_this<KinematicsPluginLoader::KinematicsLoaderImpl>
 {
 public:
   /**
@@ -62,12 +258,14 @@ public:
   KinematicsLoaderImpl(const rclcpp::Node::SharedPtr& node, const std::string& robot_description,
                        const std::map<std::string, std::vector<std::string>>& possible_kinematics_solvers,
                        const std::map<std::string, std::vector<double>>& search_res,
-                       const std::map<std::string, std::vector<std::string>>& iksolver_to_tip_links)
+                       const std::map<std::string, std::vector<std::string>>& iksolver_to_tip_links,
+                       bool lazy_loading)
     : node_(node)
     , robot_description_(robot_description)
     , possible_kinematics_solvers_(possible_kinematics_solvers)
     , search_res_(search_res)
     , iksolver_to_tip_links_(iksolver_to_tip_links)
+    , lazy_loading_(lazy_loading)
   {
     try
     {
@@ -126,6 +324,25 @@ public:
   }
 
   kinematics::KinematicsBasePtr allocKinematicsSolver(const robot_model::JointModelGroup* jmg)
+  {
+    // only defer groups a solver is configured for; everything else fails right away as before
+    if (!lazy_loading_ || !kinematics_loader_ || !jmg || jmg->getLinkModels().empty())
+      return createKinematicsSolver(jmg);
+    std::map<std::string, std::vector<double>>::const_iterator res_it = search_res_.find(jmg->getName());
+    if (res_it == search_res_.end() || res_it->second.empty())
+      return createKinematicsSolver(jmg);
+
+    RCLCPP_DEBUG(LOGGER, "Deferring allocation of kinematics solver for group '%s'", jmg->getName().c_str());
+    // the stand-in may outlive the plugin loader, so it shares ownership of this loader and its class loader
+    KinematicsLoaderImplPtr loader = shared_from_this();
+    kinematics::KinematicsBasePtr result =
+        std::make_shared<LazyKinematicsSolver>(jmg, getBaseFrame(jmg), chooseTipFrames(jmg), res_it->second.front(),
+                                               [loader, jmg] { return loader->createKinematicsSolver(jmg); });
+    result->setDefaultTimeout(jmg->getDefaultIKTimeout());
+    return result;
+  }
+
+  kinematics::KinematicsBasePtr createKinematicsSolver(const robot_model::JointModelGroup* jmg)
   {
     kinematics::KinematicsBasePtr result;
     if (!kinematics_loader_)
@@ -156,17 +373,18 @@ public:
       return result;
     }
 
-    const std::string& base = links.front()->getParentJointModel()->getParentLinkModel() ?
-                                  links.front()->getParentJointModel()->getParentLinkModel()->getName() :
-                                  jmg->getParentModel().getModelFrame();
+    const std::string base = getBaseFrame(jmg);
 
-    // just to be sure, do not call the same pluginlib instance allocation function in parallel
-    boost::mutex::scoped_lock slock(lock_);
     for (std::size_t i = 0; !result && i < it->second.size(); ++i)
     {
       try
       {
-        result = kinematics_loader_->createUniqueInstance(it->second[i]);
+        {
+          // just to be sure, do not call the same pluginlib instance allocation function in parallel;
+          // initializing the solvers of different groups concurrently is fine
+          boost::mutex::scoped_lock slock(lock_);
+          result = kinematics_loader_->createUniqueInstance(it->second[i]);
+        }
         if (result)
         {
           // choose the tip of the IK solver
@@ -175,11 +393,9 @@ public:
           // choose search resolution
           double search_res = search_res_.find(jmg->getName())->second[i];  // we know this exists, by construction
 
-          if (!result->initialize(node_, jmg->getParentModel(), jmg->getName(),
-                                  (base.empty() || base[0] != '/') ? base : base.substr(1), tips, search_res) &&
+          if (!result->initialize(node_, jmg->getParentModel(), jmg->getName(), base, tips, search_res) &&
               // on failure: fallback to old method (TODO: remove in future)
-              !result->initialize(robot_description_, jmg->getName(),
-                                  (base.empty() || base[0] != '/') ? base : base.substr(1), tips, search_res))
+              !result->initialize(robot_description_, jmg->getName(), base, tips, search_res))
           {
             RCLCPP_ERROR(LOGGER, "Kinematics solver of type '%s' could not be initialized for group '%s'",
                          it->second[i].c_str(), jmg->getName().c_str());
@@ -213,14 +429,25 @@ public:
   // second call in JointModelGroup::setSolverAllocators() is to actually retrieve the instance for use
   kinematics::KinematicsBasePtr allocKinematicsSolverWithCache(const robot_model::JointModelGroup* jmg)
   {
+    {
+      boost::mutex::scoped_lock slock(cache_lock_);
+      kinematics::KinematicsBasePtr& cached = instances_[jmg];
+      if (cached.unique())
+        return std::move(cached);  // pass on unique instance
+    }
+
+    // create a new instance and store in instances_; the cache is not locked meanwhile so that solvers for different
+    // groups can be allocated concurrently
+    kinematics::KinematicsBasePtr solver = allocKinematicsSolver(jmg);
     boost::mutex::scoped_lock slock(cache_lock_);
-    kinematics::KinematicsBasePtr& cached = instances_[jmg];
-    if (cached.unique())
-      return std::move(cached);  // pass on unique instance
+    instances_[jmg] = solver;
+    return solver;
+  }
 
-    // create a new instance and store in instances_
-    cached = allocKinematicsSolver(jmg);
-    return cached;
+  void clearCache()
+  {
+    boost::mutex::scoped_lock slock(cache_lock_);
+    instances_.clear();
   }
 
   void status() const
@@ -237,18 +464,35 @@ public:
   }
 
 private:
+  std::string getBaseFrame(const robot_model::JointModelGroup* jmg) const
+  {
+    const robot_model::LinkModel* link = jmg->getLinkModels().front();
+    const std::string& base = link->getParentJointModel()->getParentLinkModel() ?
+                                  link->getParentJointModel()->getParentLinkModel()->getName() :
+                                  jmg->getParentModel().getModelFrame();
+    return (base.empty() || base[0] != '/') ? base : base.substr(1);
+  }
+
   const rclcpp::Node::SharedPtr node_;
   std::string robot_description_;
   std::map<std::string, std::vector<std::string>> possible_kinematics_solvers_;
   std::map<std::string, std::vector<double>> search_res_;
   std::map<std::string, std::vector<std::string>> iksolver_to_tip_links_;  // a map between each ik solver and a vector
                                                                            // of custom-specified tip link(s)
+  bool lazy_loading_;
   std::shared_ptr<pluginlib::ClassLoader<kinematics::KinematicsBase>> kinematics_loader_;
   std::map<const robot_model::JointModelGroup*, kinematics::KinematicsBasePtr> instances_;
   boost::mutex lock_;
   boost::mutex cache_lock_;
 };
 
+KinematicsPluginLoader::~KinematicsPluginLoader()
+{
+  // cached stand-in solvers share ownership of the loader, release them so that it is not kept alive
+  if (loader_)
+    loader_->clearCache();
+}
+
 void KinematicsPluginLoader::status() const
 {
   if (loader_)
@@ -418,7 +662,7 @@ robot_model::SolverAllocatorFn KinematicsPluginLoader::getLoaderFunction(const s
     }
 
     loader_.reset(new KinematicsLoaderImpl(node_, robot_description_, possible_kinematics_solvers, search_res,
-                                           iksolver_to_tip_links));
+                                           iksolver_to_tip_links, lazy_loading_));
   }
 
   return boost::bind(&KinematicsPluginLoader::KinematicsLoaderImpl::allocKinematicsSolverWithCache, loader_.get(), _1);
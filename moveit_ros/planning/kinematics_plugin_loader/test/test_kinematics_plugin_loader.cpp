@@ -0,0 +1,92 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/kinematics_plugin_loader/kinematics_plugin_loader.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <rclcpp/rclcpp.hpp>
+
+#include <gtest/gtest.h>
+
+class KinematicsPluginLoaderTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    moveit::core::RobotModelBuilder builder("lazy_robot", "base");
+    builder.addChain("base->a->b->c", "revolute");
+    builder.addGroupChain("base", "c", "arm");
+    ASSERT_TRUE(builder.isValid());
+    robot_model_ = builder.build();
+    node_ = std::make_shared<rclcpp::Node>("test_kinematics_plugin_loader");
+  }
+
+  // Allocates the stand-in solver of the arm from a loader that is destroyed right afterwards
+  kinematics::KinematicsBasePtr allocLazySolver()
+  {
+    kinematics_plugin_loader::KinematicsPluginLoader loader(node_, "missing_kinematics_plugin/Solver", 0.1,
+                                                            "robot_description");
+    loader.setLazyLoading(true);
+    robot_model::SolverAllocatorFn allocator =
+        loader.getLoaderFunction(std::const_pointer_cast<srdf::Model>(robot_model_->getSRDF()));
+    return allocator(robot_model_->getJointModelGroup("arm"));
+  }
+
+  robot_model::RobotModelPtr robot_model_;
+  rclcpp::Node::SharedPtr node_;
+};
+
+TEST_F(KinematicsPluginLoaderTest, LazySolverOutlivesLoader)
+{
+  kinematics::KinematicsBasePtr solver = allocLazySolver();
+  ASSERT_TRUE(solver);
+  EXPECT_EQ(solver->getGroupName(), "arm");
+  EXPECT_EQ(solver->getJointNames().size(), 3u);
+
+  // The actual plugin is only loaded now, after the loader is gone; it does not exist, so the query fails
+  geometry_msgs::msg::Pose pose;
+  pose.orientation.w = 1.0;
+  std::vector<double> solution;
+  moveit_msgs::msg::MoveItErrorCodes error_code;
+  EXPECT_FALSE(solver->getPositionIK(pose, std::vector<double>(3, 0.0), solution, error_code));
+  EXPECT_EQ(error_code.val, moveit_msgs::msg::MoveItErrorCodes::FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  testing::InitGoogleTest(&argc, argv);
+  int result = RUN_ALL_TESTS();
+  rclcpp::shutdown();
+  return result;
+}
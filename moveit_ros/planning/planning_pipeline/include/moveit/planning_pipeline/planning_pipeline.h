@@ -140,6 +140,14 @@ public:
                     const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                     std::vector<std::size_t>& adapter_added_state_index) const;
 
+  /** \brief Like generatePlan() above, but the planning contexts are allocated by \e planner instead of the loaded
+      planner manager. \e planner is expected to forward to getPlannerManager(), e.g. to keep track of the planning
+      context that solves this request. */
+  bool generatePlan(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                    std::vector<std::size_t>& adapter_added_state_index,
+                    const planning_interface::PlannerManagerPtr& planner) const;
+
   /** \brief Request termination, if a generatePlan() function is currently computing plans */
   void terminate() const;
 
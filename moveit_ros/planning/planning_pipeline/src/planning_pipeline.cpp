@@ -235,13 +235,22 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
                                                        const planning_interface::MotionPlanRequest& req,
                                                        planning_interface::MotionPlanResponse& res,
                                                        std::vector<std::size_t>& adapter_added_state_index) const
+{
+  return generatePlan(planning_scene, req, res, adapter_added_state_index, planner_instance_);
+}
+
+bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                       const planning_interface::MotionPlanRequest& req,
+                                                       planning_interface::MotionPlanResponse& res,
+                                                       std::vector<std::size_t>& adapter_added_state_index,
+                                                       const planning_interface::PlannerManagerPtr& planner) const
 {
   // broadcast the request we are about to work on, if needed
   if (publish_received_requests_)
     received_request_publisher_->publish(req);
   adapter_added_state_index.clear();
 
-  if (!planner_instance_)
+  if (!planner)
   {
     RCLCPP_ERROR(node_->get_logger(), "No planning plugin loaded. Cannot plan.");
     return false;
@@ -252,7 +261,7 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
   {
     if (adapter_chain_)
     {
-      solved = adapter_chain_->adaptAndPlan(planner_instance_, planning_scene, req, res, adapter_added_state_index);
+      solved = adapter_chain_->adaptAndPlan(planner, planning_scene, req, res, adapter_added_state_index);
       if (!adapter_added_state_index.empty())
       {
         std::stringstream ss;
@@ -265,7 +274,7 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     else
     {
       planning_interface::PlanningContextPtr context =
-          planner_instance_->getPlanningContext(planning_scene, req, res.error_code_);
+          planner->getPlanningContext(planning_scene, req, res.error_code_);
       solved = context ? context->solve(res) : false;
     }
   }
@@ -0,0 +1,456 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/collision_detection/world.h>
+#include <moveit/robot_state/conversions.h>
+#include <geometric_shapes/shape_operations.h>
+#include <class_loader/class_loader.hpp>
+#include <rclcpp/rclcpp.hpp>
+
+#include <boost/functional/hash.hpp>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace default_planner_request_adapters
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.cache_plans");
+
+/** @brief Return cached solutions of motion plan requests that were already solved in the same situation.
+
+    The situation is identified by a fingerprint of the request (group, planner, goal and path constraints), the
+    start state quantized to a given resolution, and the planning scene (world geometry and allowed collision matrix).
+    A cached trajectory is only returned after it has been validated again with PlanningScene::isPathValid() from the
+    exact start state, so a fingerprint collision can't produce an invalid plan. This adapter should be listed first, so
+    that the cached trajectories include the processing of all following adapters. Cached trajectories can optionally be
+    appended to a file, from which they are loaded again on startup. */
+class CachePlans : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  static const std::string FILE_PARAM_NAME;
+  static const std::string SIZE_PARAM_NAME;
+  static const std::string RESOLUTION_PARAM_NAME;
+
+  void initialize(const rclcpp::Node::SharedPtr& node) override
+  {
+    node_ = node;
+    if (!node_->get_parameter(FILE_PARAM_NAME, cache_file_))
+    {
+      cache_file_.clear();
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Cached plans are not stored", FILE_PARAM_NAME.c_str());
+    }
+    else
+    {
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %s", FILE_PARAM_NAME.c_str(), cache_file_.c_str());
+    }
+
+    if (!node_->get_parameter(SIZE_PARAM_NAME, cache_size_))
+    {
+      cache_size_ = 1000;
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Using default value: %d", SIZE_PARAM_NAME.c_str(), cache_size_);
+    }
+    else
+    {
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %d", SIZE_PARAM_NAME.c_str(), cache_size_);
+    }
+
+    if (!node_->get_parameter(RESOLUTION_PARAM_NAME, resolution_))
+    {
+      resolution_ = 0.001;
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Using default value: %f", RESOLUTION_PARAM_NAME.c_str(),
+                  resolution_);
+    }
+    else
+    {
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %f", RESOLUTION_PARAM_NAME.c_str(), resolution_);
+    }
+  }
+
+  std::string getDescription() const override
+  {
+    return "Cache Plans";
+  }
+
+  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                    std::vector<std::size_t>& /*added_path_index*/) const override
+  {
+    RCLCPP_DEBUG(LOGGER, "Running '%s'", getDescription().c_str());
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Trajectory constraints and visibility constraints are not part of the fingerprint
+    if (!req.trajectory_constraints.constraints.empty() || !req.path_constraints.visibility_constraints.empty())
+      return planner(planning_scene, req, res);
+    for (const moveit_msgs::msg::Constraints& goal_constraints : req.goal_constraints)
+      if (!goal_constraints.visibility_constraints.empty())
+        return planner(planning_scene, req, res);
+
+    robot_state::RobotState start_state = planning_scene->getCurrentState();
+    robot_state::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+    start_state.update();
+    const std::size_t key = computeFingerprint(*planning_scene, req, start_state);
+
+    std::unique_lock<std::mutex> lock(cache_lock_);
+    loadCacheFile(planning_scene->getRobotModel());
+    auto entry = cache_.find(key);
+    if (entry != cache_.end())
+    {
+      // Copy the cached trajectory, starting at the exact start state
+      robot_trajectory::RobotTrajectoryPtr trajectory = copyTrajectory(*entry->second, &start_state);
+      lock.unlock();
+
+      if (planning_scene->isPathValid(*trajectory, req.path_constraints, req.goal_constraints, req.group_name))
+      {
+        RCLCPP_DEBUG(LOGGER, "Returning cached plan");
+        res.trajectory_ = trajectory;
+        res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+        res.planning_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        return true;
+      }
+
+      RCLCPP_DEBUG(LOGGER, "Cached plan is not valid anymore");
+      lock.lock();
+      cache_.erase(key);
+    }
+    lock.unlock();
+
+    bool solved = planner(planning_scene, req, res);
+    // Trajectories with states added by other adapters (e.g. a prefix for fixing the start state) are only valid for
+    // this specific start state. The indices of such states are only reported to the adapter that added them, so they
+    // are detected directly: the start state must not need fixing and must be the first waypoint of the trajectory.
+    if (solved && res.trajectory_ && !res.trajectory_->empty() &&
+        isUnmodifiedStart(*planning_scene, req, start_state) &&
+        isSameState(res.trajectory_->getFirstWayPoint(), start_state))
+    {
+      // The cache keeps its own copy, the caller may modify the returned trajectory
+      robot_trajectory::RobotTrajectoryPtr trajectory = copyTrajectory(*res.trajectory_);
+      lock.lock();
+      insert(key, trajectory);
+      appendToCacheFile(key, *trajectory);
+    }
+    return solved;
+  }
+
+private:
+  /** \brief Check that none of the adapters fixing the start state (bounds, collision, path constraints) would change
+      \e start_state */
+  static bool isUnmodifiedStart(const planning_scene::PlanningScene& planning_scene,
+                                const planning_interface::MotionPlanRequest& req,
+                                const robot_state::RobotState& start_state)
+  {
+    const robot_model::JointModelGroup* jmg = start_state.getJointModelGroup(req.group_name);
+    return jmg && start_state.satisfiesBounds(jmg) &&
+           planning_scene.isStateValid(start_state, req.path_constraints, req.group_name);
+  }
+
+  static bool isSameState(const robot_state::RobotState& first, const robot_state::RobotState& second)
+  {
+    for (std::size_t i = 0; i < first.getVariableCount(); ++i)
+      if (std::fabs(first.getVariablePosition(i) - second.getVariablePosition(i)) > START_STATE_TOLERANCE)
+        return false;
+    return true;
+  }
+
+  /** \brief Copy \e trajectory with new waypoints, replacing the first one by \e start_state if given */
+  static robot_trajectory::RobotTrajectoryPtr copyTrajectory(const robot_trajectory::RobotTrajectory& trajectory,
+                                                             const robot_state::RobotState* start_state = nullptr)
+  {
+    robot_trajectory::RobotTrajectoryPtr copy(
+        new robot_trajectory::RobotTrajectory(trajectory.getRobotModel(), trajectory.getGroupName()));
+    for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+      copy->addSuffixWayPoint(i == 0 && start_state ? *start_state : trajectory.getWayPoint(i),
+                              trajectory.getWayPointDurationFromPrevious(i));
+    return copy;
+  }
+
+  std::int64_t quantize(double value) const
+  {
+    return std::llround(value / resolution_);
+  }
+
+  void hashPose(std::size_t& seed, const Eigen::Isometry3d& pose) const
+  {
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 4; ++j)
+        boost::hash_combine(seed, quantize(pose(i, j)));
+  }
+
+  void hashPose(std::size_t& seed, const geometry_msgs::msg::Pose& pose) const
+  {
+    boost::hash_combine(seed, quantize(pose.position.x));
+    boost::hash_combine(seed, quantize(pose.position.y));
+    boost::hash_combine(seed, quantize(pose.position.z));
+    boost::hash_combine(seed, quantize(pose.orientation.x));
+    boost::hash_combine(seed, quantize(pose.orientation.y));
+    boost::hash_combine(seed, quantize(pose.orientation.z));
+    boost::hash_combine(seed, quantize(pose.orientation.w));
+  }
+
+  void hashConstraints(std::size_t& seed, const moveit_msgs::msg::Constraints& constraints) const
+  {
+    for (const moveit_msgs::msg::JointConstraint& jc : constraints.joint_constraints)
+    {
+      boost::hash_combine(seed, jc.joint_name);
+      boost::hash_combine(seed, quantize(jc.position));
+      boost::hash_combine(seed, quantize(jc.tolerance_above));
+      boost::hash_combine(seed, quantize(jc.tolerance_below));
+    }
+    for (const moveit_msgs::msg::PositionConstraint& pc : constraints.position_constraints)
+    {
+      boost::hash_combine(seed, pc.header.frame_id);
+      boost::hash_combine(seed, pc.link_name);
+      boost::hash_combine(seed, quantize(pc.target_point_offset.x));
+      boost::hash_combine(seed, quantize(pc.target_point_offset.y));
+      boost::hash_combine(seed, quantize(pc.target_point_offset.z));
+      for (const shape_msgs::msg::SolidPrimitive& primitive : pc.constraint_region.primitives)
+      {
+        boost::hash_combine(seed, primitive.type);
+        for (double dimension : primitive.dimensions)
+          boost::hash_combine(seed, quantize(dimension));
+      }
+      for (const geometry_msgs::msg::Pose& pose : pc.constraint_region.primitive_poses)
+        hashPose(seed, pose);
+      for (const shape_msgs::msg::Mesh& mesh : pc.constraint_region.meshes)
+        boost::hash_combine(seed, mesh.vertices.size());
+      for (const geometry_msgs::msg::Pose& pose : pc.constraint_region.mesh_poses)
+        hashPose(seed, pose);
+    }
+    for (const moveit_msgs::msg::OrientationConstraint& oc : constraints.orientation_constraints)
+    {
+      boost::hash_combine(seed, oc.header.frame_id);
+      boost::hash_combine(seed, oc.link_name);
+      boost::hash_combine(seed, quantize(oc.orientation.x));
+      boost::hash_combine(seed, quantize(oc.orientation.y));
+      boost::hash_combine(seed, quantize(oc.orientation.z));
+      boost::hash_combine(seed, quantize(oc.orientation.w));
+      boost::hash_combine(seed, quantize(oc.absolute_x_axis_tolerance));
+      boost::hash_combine(seed, quantize(oc.absolute_y_axis_tolerance));
+      boost::hash_combine(seed, quantize(oc.absolute_z_axis_tolerance));
+    }
+  }
+
+  std::size_t computeFingerprint(const planning_scene::PlanningScene& planning_scene,
+                                 const planning_interface::MotionPlanRequest& req,
+                                 const robot_state::RobotState& start_state) const
+  {
+    std::size_t seed = 0;
+
+    // Request
+    boost::hash_combine(seed, req.group_name);
+    boost::hash_combine(seed, req.planner_id);
+    boost::hash_combine(seed, quantize(req.max_velocity_scaling_factor));
+    boost::hash_combine(seed, quantize(req.max_acceleration_scaling_factor));
+    for (const moveit_msgs::msg::Constraints& goal_constraints : req.goal_constraints)
+    {
+      boost::hash_combine(seed, goal_constraints.name);
+      hashConstraints(seed, goal_constraints);
+    }
+    hashConstraints(seed, req.path_constraints);
+
+    // Start state, including attached bodies
+    for (std::size_t i = 0; i < start_state.getVariableCount(); ++i)
+      boost::hash_combine(seed, quantize(start_state.getVariablePosition(i)));
+    std::vector<const robot_state::AttachedBody*> attached_bodies;
+    start_state.getAttachedBodies(attached_bodies);
+    for (const robot_state::AttachedBody* attached_body : attached_bodies)
+    {
+      boost::hash_combine(seed, attached_body->getName());
+      boost::hash_combine(seed, attached_body->getAttachedLinkName());
+    }
+
+    // World geometry
+    for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object :
+         *planning_scene.getWorld())
+    {
+      boost::hash_combine(seed, object.first);
+      for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+      {
+        boost::hash_combine(seed, static_cast<int>(object.second->shapes_[i]->type));
+        Eigen::Vector3d extents = shapes::computeShapeExtents(object.second->shapes_[i].get());
+        for (int j = 0; j < 3; ++j)
+          boost::hash_combine(seed, quantize(extents[j]));
+        hashPose(seed, object.second->shape_poses_[i]);
+      }
+    }
+
+    // Allowed collisions
+    moveit_msgs::msg::AllowedCollisionMatrix acm;
+    planning_scene.getAllowedCollisionMatrix().getMessage(acm);
+    for (const std::string& name : acm.entry_names)
+      boost::hash_combine(seed, name);
+    for (const moveit_msgs::msg::AllowedCollisionEntry& entry : acm.entry_values)
+      for (bool enabled : entry.enabled)
+        boost::hash_combine(seed, enabled);
+    for (std::size_t i = 0; i < acm.default_entry_names.size(); ++i)
+    {
+      boost::hash_combine(seed, acm.default_entry_names[i]);
+      boost::hash_combine(seed, static_cast<bool>(acm.default_entry_values[i]));
+    }
+
+    return seed;
+  }
+
+  void insert(std::size_t key, const robot_trajectory::RobotTrajectoryPtr& trajectory) const
+  {
+    if (cache_size_ <= 0)
+      return;
+    if (cache_.find(key) == cache_.end())
+      insertion_order_.push_back(key);
+    cache_[key] = trajectory;
+
+    // Drop the oldest entries; keys of entries removed when they became invalid are skipped
+    while (cache_.size() > static_cast<std::size_t>(cache_size_) && !insertion_order_.empty())
+    {
+      cache_.erase(insertion_order_.front());
+      insertion_order_.pop_front();
+    }
+    if (insertion_order_.size() > 2 * static_cast<std::size_t>(cache_size_))
+    {
+      std::deque<std::size_t> insertion_order;
+      for (std::size_t entry_key : insertion_order_)
+        if (cache_.count(entry_key))
+          insertion_order.push_back(entry_key);
+      insertion_order_.swap(insertion_order);
+    }
+  }
+
+  /** \brief The cache file contains a header line with the robot name and its variable count, followed by one line per
+      cached trajectory: the key, the group name, the number of waypoints and, for each waypoint, the duration from the
+      previous one followed by all variable positions. */
+  void loadCacheFile(const robot_model::RobotModelConstPtr& robot_model) const
+  {
+    if (cache_file_loaded_ || cache_file_.empty())
+      return;
+    cache_file_loaded_ = true;
+
+    std::ifstream in(cache_file_);
+    if (!in || in.peek() == std::ifstream::traits_type::eof())
+    {
+      writeCacheFileHeader(robot_model);
+      return;
+    }
+
+    // Never overwrite a file that is not ours: it may belong to another robot sharing the same path
+    std::string robot_name;
+    std::size_t variable_count = 0;
+    if (!(in >> robot_name >> variable_count) || robot_name != robot_model->getName() ||
+        variable_count != robot_model->getVariableCount())
+    {
+      RCLCPP_ERROR(LOGGER, "Plan cache file '%s' is not a plan cache of robot '%s'. Plans are only cached in memory. "
+                           "Remove the file or set '%s' to another file.",
+                   cache_file_.c_str(), robot_model->getName().c_str(), FILE_PARAM_NAME.c_str());
+      cache_file_rejected_ = true;
+      return;
+    }
+
+    std::size_t key;
+    std::string group_name;
+    std::size_t waypoint_count;
+    std::size_t loaded = 0;
+    while (in >> key >> group_name >> waypoint_count)
+    {
+      if (!robot_model->hasJointModelGroup(group_name))
+        break;
+      robot_trajectory::RobotTrajectoryPtr trajectory(new robot_trajectory::RobotTrajectory(robot_model, group_name));
+      robot_state::RobotState state(robot_model);
+      std::vector<double> positions(variable_count);
+      for (std::size_t i = 0; i < waypoint_count && in; ++i)
+      {
+        double duration;
+        in >> duration;
+        for (double& position : positions)
+          in >> position;
+        state.setVariablePositions(positions);
+        trajectory->addSuffixWayPoint(state, duration);
+      }
+      if (!in)
+        break;
+      insert(key, trajectory);
+      ++loaded;
+    }
+    RCLCPP_INFO(LOGGER, "Loaded %zu cached plans from '%s'", loaded, cache_file_.c_str());
+  }
+
+  void writeCacheFileHeader(const robot_model::RobotModelConstPtr& robot_model) const
+  {
+    std::ofstream out(cache_file_, std::ios::trunc);
+    out << robot_model->getName() << " " << robot_model->getVariableCount() << std::endl;
+    if (!out)
+      RCLCPP_ERROR(LOGGER, "Unable to write plan cache file '%s'", cache_file_.c_str());
+  }
+
+  void appendToCacheFile(std::size_t key, const robot_trajectory::RobotTrajectory& trajectory) const
+  {
+    if (cache_file_.empty() || cache_file_rejected_)
+      return;
+    std::stringstream line;
+    line.precision(17);
+    line << key << " " << trajectory.getGroupName() << " " << trajectory.getWayPointCount();
+    for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    {
+      line << " " << trajectory.getWayPointDurationFromPrevious(i);
+      const robot_state::RobotState& state = trajectory.getWayPoint(i);
+      for (std::size_t j = 0; j < state.getVariableCount(); ++j)
+        line << " " << state.getVariablePosition(j);
+    }
+    std::ofstream out(cache_file_, std::ios::app);
+    out << line.str() << std::endl;
+  }
+
+  rclcpp::Node::SharedPtr node_;
+  std::string cache_file_;
+  int cache_size_;
+  double resolution_;
+
+  mutable std::mutex cache_lock_;
+  mutable std::unordered_map<std::size_t, robot_trajectory::RobotTrajectoryPtr> cache_;
+  mutable std::deque<std::size_t> insertion_order_;
+  mutable bool cache_file_loaded_ = false;
+  mutable bool cache_file_rejected_ = false;
+
+  static constexpr double START_STATE_TOLERANCE = 1e-9;
+};
+
+const std::string CachePlans::FILE_PARAM_NAME = "plan_cache_file";
+const std::string CachePlans::SIZE_PARAM_NAME = "plan_cache_size";
+const std::string CachePlans::RESOLUTION_PARAM_NAME = "plan_cache_resolution";
+}  // namespace default_planner_request_adapters
+
+CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::CachePlans,
+                            planning_request_adapter::PlanningRequestAdapter)
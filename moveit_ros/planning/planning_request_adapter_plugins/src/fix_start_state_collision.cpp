@@ -35,10 +35,12 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/constraint_samplers/parallel_sampling.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <class_loader/class_loader.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <limits>
 
 namespace default_planner_request_adapters
 {
@@ -50,6 +52,7 @@ public:
   static const std::string DT_PARAM_NAME;
   static const std::string JIGGLE_PARAM_NAME;
   static const std::string ATTEMPTS_PARAM_NAME;
+  static const std::string THREADS_PARAM_NAME;
 
   void initialize(const rclcpp::Node::SharedPtr& node) override
   {
@@ -90,6 +93,23 @@ public:
       }
       RCLCPP_INFO(LOGGER, "Param '%s' was set to %f", ATTEMPTS_PARAM_NAME.c_str(), sampling_attempts_);
     }
+
+    // 1 keeps the sequential, cumulative jiggling of one joint at a time; any other value opts in to independent
+    // attempts jiggling all joints at once, evaluated on that many threads (0: one per core)
+    if (!node_->get_parameter(THREADS_PARAM_NAME, sampling_threads_))
+    {
+      sampling_threads_ = 1;
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Sampling sequentially.", THREADS_PARAM_NAME.c_str());
+    }
+    else
+    {
+      if (sampling_threads_ < 0)
+      {
+        sampling_threads_ = 0;
+        RCLCPP_WARN(LOGGER, "Param '%s' needs to be at least 0.", THREADS_PARAM_NAME.c_str());
+      }
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %d", THREADS_PARAM_NAME.c_str(), sampling_threads_);
+    }
   }
 
   std::string getDescription() const override
@@ -133,25 +153,62 @@ public:
               planning_scene->getRobotModel()->getJointModels();
 
       bool found = false;
-      for (int c = 0; !found && c < sampling_attempts_; ++c)
+      if (sampling_threads_ == 1)
       {
-        for (std::size_t i = 0; !found && i < jmodels.size(); ++i)
+        for (int c = 0; !found && c < sampling_attempts_; ++c)
         {
-          std::vector<double> sampled_variable_values(jmodels[i]->getVariableCount());
-          const double* original_values = prefix_state->getJointPositions(jmodels[i]);
-          jmodels[i]->getVariableRandomPositionsNearBy(rng, &sampled_variable_values[0], original_values,
-                                                       jmodels[i]->getMaximumExtent() * jiggle_fraction_);
-          start_state.setJointPositions(jmodels[i], sampled_variable_values);
-          collision_detection::CollisionResult cres;
-          planning_scene->checkCollision(creq, cres, start_state);
-          if (!cres.collision)
+          for (std::size_t i = 0; !found && i < jmodels.size(); ++i)
           {
-            found = true;
-            RCLCPP_INFO(LOGGER, "Found a valid state near the start state at distance %lf after %d attempts",
-                        prefix_state->distance(start_state), c);
+            std::vector<double> sampled_variable_values(jmodels[i]->getVariableCount());
+            const double* original_values = prefix_state->getJointPositions(jmodels[i]);
+            jmodels[i]->getVariableRandomPositionsNearBy(rng, &sampled_variable_values[0], original_values,
+                                                         jmodels[i]->getMaximumExtent() * jiggle_fraction_);
+            start_state.setJointPositions(jmodels[i], sampled_variable_values);
+            collision_detection::CollisionResult cres;
+            planning_scene->checkCollision(creq, cres, start_state);
+            if (!cres.collision)
+            {
+              found = true;
+              RCLCPP_INFO(LOGGER, "Found a valid state near the start state at distance %lf after %d attempts",
+                          prefix_state->distance(start_state), c);
+            }
           }
         }
       }
+      else
+      {
+        // jiggling one joint after the other depends on the previous attempts, so in parallel mode each attempt
+        // jiggles all joints of the group around their original values instead; attempts are then independent and
+        // are evaluated concurrently, each thread working on its own copy of the start state
+        const double jiggle_fraction = jiggle_fraction_;
+        auto jiggle_and_check = [&](robot_state::RobotState& state, random_numbers::RandomNumberGenerator& local_rng) {
+          std::vector<double> sampled_variable_values;
+          for (const robot_model::JointModel* jm : jmodels)
+          {
+            sampled_variable_values.resize(jm->getVariableCount());
+            jm->getVariableRandomPositionsNearBy(local_rng, &sampled_variable_values[0],
+                                                 prefix_state->getJointPositions(jm),
+                                                 jm->getMaximumExtent() * jiggle_fraction);
+            state.setJointPositions(jm, sampled_variable_values);
+          }
+          state.update();
+          collision_detection::CollisionResult cres;
+          planning_scene->checkCollision(creq, cres, state);
+          return !cres.collision;
+        };
+
+        std::vector<robot_state::RobotStatePtr> valid_states;
+        found = constraint_samplers::sampleValidStates(start_state, jiggle_and_check, sampling_attempts_, 1,
+                                                       valid_states,
+                                                       rng.uniformInteger(0, std::numeric_limits<int>::max()),
+                                                       sampling_threads_) > 0;
+        if (found)
+        {
+          start_state = *valid_states.front();
+          RCLCPP_INFO(LOGGER, "Found a valid state near the start state at distance %lf",
+                      prefix_state->distance(start_state));
+        }
+      }
 
       if (found)
       {
@@ -196,11 +253,13 @@ private:
   double max_dt_offset_;
   double jiggle_fraction_;
   int sampling_attempts_;
+  int sampling_threads_;
 };
 
 const std::string FixStartStateCollision::DT_PARAM_NAME = "start_state_max_dt";
 const std::string FixStartStateCollision::JIGGLE_PARAM_NAME = "jiggle_fraction";
 const std::string FixStartStateCollision::ATTEMPTS_PARAM_NAME = "max_sampling_attempts";
+const std::string FixStartStateCollision::THREADS_PARAM_NAME = "max_sampling_threads";
 }  // namespace default_planner_request_adapters
 
 CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::FixStartStateCollision,
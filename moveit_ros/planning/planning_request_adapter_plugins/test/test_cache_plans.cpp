@@ -0,0 +1,211 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <class_loader/class_loader.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+class CachePlansTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    moveit::core::RobotModelBuilder builder("cache_robot", "base");
+    builder.addChain("base->a->b->c", "revolute");
+    builder.addGroupChain("base", "c", "arm");
+    ASSERT_TRUE(builder.isValid());
+    robot_model_ = builder.build();
+
+    planning_scene_.reset(new planning_scene::PlanningScene(robot_model_));
+    planning_scene_->getCurrentStateNonConst().setToDefaultValues();
+    robot_state::robotStateToRobotStateMsg(planning_scene_->getCurrentState(), request_.start_state);
+    request_.group_name = "arm";
+    request_.planner_id = "test";
+
+    cache_file_ =
+        (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("test_cache_plans_%%%%%%%%.txt"))
+            .string();
+  }
+
+  void TearDown() override
+  {
+    std::remove(cache_file_.c_str());
+  }
+
+  planning_request_adapter::PlanningRequestAdapterPtr loadAdapter(const std::string& cache_file = "")
+  {
+    rclcpp::NodeOptions options;
+    options.allow_undeclared_parameters(true);
+    options.automatically_declare_parameters_from_overrides(true);
+    if (!cache_file.empty())
+      options.parameter_overrides({ rclcpp::Parameter("plan_cache_file", cache_file) });
+    node_ = std::make_shared<rclcpp::Node>("test_cache_plans", options);
+
+    planning_request_adapter::PlanningRequestAdapterPtr adapter =
+        loader_.createSharedInstance<planning_request_adapter::PlanningRequestAdapter>(
+            "default_planner_request_adapters::CachePlans");
+    adapter->initialize(node_);
+    return adapter;
+  }
+
+  // Plans from the start state to a fixed goal, optionally through an inserted first state
+  bool plan(const planning_request_adapter::PlanningRequestAdapterPtr& adapter,
+            planning_interface::MotionPlanResponse& res)
+  {
+    planning_request_adapter::PlanningRequestAdapter::PlannerFn planner =
+        [this](const planning_scene::PlanningSceneConstPtr& planning_scene,
+               const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& plan_res) {
+          ++planner_calls_;
+          robot_state::RobotState state = planning_scene->getCurrentState();
+          robot_state::robotStateMsgToRobotState(req.start_state, state);
+          plan_res.trajectory_.reset(new robot_trajectory::RobotTrajectory(robot_model_, req.group_name));
+          if (insert_start_state_)
+          {
+            robot_state::RobotState inserted(state);
+            inserted.setVariablePosition(0, 0.1);
+            plan_res.trajectory_->addSuffixWayPoint(inserted, 0.0);
+          }
+          plan_res.trajectory_->addSuffixWayPoint(state, insert_start_state_ ? 0.1 : 0.0);
+          state.setVariablePosition(0, 0.5);
+          plan_res.trajectory_->addSuffixWayPoint(state, 1.0);
+          plan_res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+          return true;
+        };
+    std::vector<std::size_t> added_path_index;
+    return adapter->adaptAndPlan(planner, planning_scene_, request_, res, added_path_index);
+  }
+
+  std::string readCacheFile() const
+  {
+    std::ifstream in(cache_file_);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  planning_scene::PlanningScenePtr planning_scene_;
+  planning_interface::MotionPlanRequest request_;
+  std::string cache_file_;
+  rclcpp::Node::SharedPtr node_;
+  class_loader::ClassLoader loader_{ CACHE_PLANS_PLUGIN_LIBRARY };
+  std::size_t planner_calls_ = 0;
+  bool insert_start_state_ = false;
+};
+
+TEST_F(CachePlansTest, ReturnsCopiesOfCachedPlans)
+{
+  planning_request_adapter::PlanningRequestAdapterPtr adapter = loadAdapter();
+
+  planning_interface::MotionPlanResponse first;
+  ASSERT_TRUE(plan(adapter, first));
+  EXPECT_EQ(planner_calls_, 1u);
+
+  // Modifying a returned trajectory must not modify the cache
+  first.trajectory_->getWayPointPtr(1)->setVariablePosition(0, 0.9);
+
+  planning_interface::MotionPlanResponse second;
+  ASSERT_TRUE(plan(adapter, second));
+  EXPECT_EQ(planner_calls_, 1u);
+  ASSERT_EQ(second.trajectory_->getWayPointCount(), 2u);
+  EXPECT_NE(first.trajectory_, second.trajectory_);
+  EXPECT_DOUBLE_EQ(second.trajectory_->getWayPoint(1).getVariablePosition(0), 0.5);
+
+  second.trajectory_->getWayPointPtr(1)->setVariablePosition(0, 0.9);
+
+  planning_interface::MotionPlanResponse third;
+  ASSERT_TRUE(plan(adapter, third));
+  EXPECT_EQ(planner_calls_, 1u);
+  EXPECT_DOUBLE_EQ(third.trajectory_->getWayPoint(1).getVariablePosition(0), 0.5);
+}
+
+TEST_F(CachePlansTest, DoesNotCachePlansWithInsertedStartStates)
+{
+  planning_request_adapter::PlanningRequestAdapterPtr adapter = loadAdapter();
+  insert_start_state_ = true;
+
+  planning_interface::MotionPlanResponse res;
+  ASSERT_TRUE(plan(adapter, res));
+  ASSERT_TRUE(plan(adapter, res));
+  EXPECT_EQ(planner_calls_, 2u);
+}
+
+TEST_F(CachePlansTest, LoadsPlansFromCacheFile)
+{
+  planning_interface::MotionPlanResponse res;
+  ASSERT_TRUE(plan(loadAdapter(cache_file_), res));
+  EXPECT_EQ(planner_calls_, 1u);
+
+  // A new adapter using the same file returns the stored plan
+  ASSERT_TRUE(plan(loadAdapter(cache_file_), res));
+  EXPECT_EQ(planner_calls_, 1u);
+  ASSERT_EQ(res.trajectory_->getWayPointCount(), 2u);
+  EXPECT_DOUBLE_EQ(res.trajectory_->getWayPoint(1).getVariablePosition(0), 0.5);
+}
+
+TEST_F(CachePlansTest, KeepsCacheFileOfOtherRobot)
+{
+  const std::string other_robot_cache = "other_robot 7\n1 arm 1 0 0 0 0 0 0 0 0\n";
+  {
+    std::ofstream out(cache_file_);
+    out << other_robot_cache;
+  }
+
+  planning_request_adapter::PlanningRequestAdapterPtr adapter = loadAdapter(cache_file_);
+  planning_interface::MotionPlanResponse res;
+  ASSERT_TRUE(plan(adapter, res));
+  ASSERT_TRUE(plan(adapter, res));
+
+  // Plans are still cached in memory, but the file is left untouched
+  EXPECT_EQ(planner_calls_, 1u);
+  EXPECT_EQ(readCacheFile(), other_robot_cache);
+}
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  testing::InitGoogleTest(&argc, argv);
+  int result = RUN_ALL_TESTS();
+  rclcpp::shutdown();
+  return result;
+}
@@ -136,6 +136,18 @@ public:
    *  @return Returns the map from joint names to joint state values*/
   std::map<std::string, double> getCurrentStateValues() const;
 
+  /** @brief Set the number of past states kept to answer getStateAtTime(). A capacity of 0 disables the history.
+   *  Changing the capacity discards the states recorded so far. */
+  void setStateHistoryCapacity(std::size_t capacity);
+
+  /** @brief Get the number of past states kept to answer getStateAtTime() */
+  std::size_t getStateHistoryCapacity() const;
+
+  /** @brief Set the joint positions of \e state to the ones the robot had at time \e t, interpolating between the
+   *  two closest recorded states. Velocities and efforts are not modified.
+   *  @return false if \e t is outside of the time span covered by the recorded states */
+  bool getStateAtTime(const ros::Time& t, robot_state::RobotState& state) const;
+
   /** @brief Wait for at most \e wait_time seconds (default 1s) for a robot state more recent than t
    *  @return true on success, false if up-to-date robot state wasn't received within \e wait_time
   */
@@ -188,14 +200,51 @@ public:
   }
 
 private:
+  /** @brief Copy of the monitored state handed out to readers, so they never wait for the writer */
+  struct StateSnapshot
+  {
+    std::vector<double> positions;
+    std::vector<double> velocities;
+    std::vector<double> accelerations;
+    std::vector<double> efforts;
+    ros::Time stamp;
+  };
+  typedef std::shared_ptr<StateSnapshot> StateSnapshotPtr;
+  typedef std::shared_ptr<const StateSnapshot> StateSnapshotConstPtr;
+
+  /** @brief The joints corresponding to the names of one joint state message layout */
+  struct JointStateLayout
+  {
+    std::vector<std::string> names;
+    std::vector<const moveit::core::JointModel*> joints;  // NULL for names that are not single-variable joints
+  };
+
   void jointStateCallback(const sensor_msgs::JointStateConstPtr& joint_state);
   void tfCallback();
 
+  /** @brief Get the joint models for the names in a joint state message, reusing the mapping of
+   *  previously seen message layouts. Must be called with state_update_lock_ held. */
+  const std::vector<const moveit::core::JointModel*>& getJointStateLayout(const std::vector<std::string>& names);
+
+  /** @brief Publish the values of robot_state_ to the readers. Must be called with state_update_lock_ held. */
+  void publishStateSnapshot();
+
+  /** @brief Append the positions of \e snapshot to the state history */
+  void recordStateHistory(const StateSnapshot& snapshot);
+
+  /** @brief Get the latest published snapshot of the state */
+  StateSnapshotConstPtr getStateSnapshot() const;
+
+  /** @brief Copy the values of a snapshot into \e upd, including the dynamics if copy_dynamics_ is set */
+  void copySnapshotToState(const StateSnapshot& snapshot, robot_state::RobotState& upd) const;
+
   ros::NodeHandle nh_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   robot_model::RobotModelConstPtr robot_model_;
   robot_state::RobotState robot_state_;
-  std::map<const moveit::core::JointModel*, ros::Time> joint_time_;
+  std::vector<ros::Time> joint_time_;  // indexed by JointModel::getJointIndex()
+  std::vector<bool> joint_received_;   // whether joint_time_ holds a value, indexed like joint_time_
+  std::vector<JointStateLayout> joint_state_layouts_;
   bool state_monitor_started_;
   bool copy_dynamics_;  // Copy velocity and effort from joint_state
   ros::Time monitor_start_time_;
@@ -205,6 +254,17 @@ private:
 
   mutable boost::mutex state_update_lock_;
   mutable boost::condition_variable state_update_condition_;
+
+  // the writer fills a new snapshot and only holds snapshot_lock_ to swap it in; published snapshots are immutable
+  mutable boost::mutex snapshot_lock_;
+  StateSnapshotPtr snapshot_;
+
+  // ring buffer of past joint positions, the oldest entry is at (history_head_ + capacity - history_size_) % capacity
+  mutable boost::mutex history_lock_;
+  std::vector<ros::Time> history_stamps_;
+  std::vector<double> history_positions_;  // capacity x variable count
+  std::size_t history_head_;
+  std::size_t history_size_;
   std::vector<JointStateUpdateCallback> update_callbacks_;
 
   std::shared_ptr<TFConnection> tf_connection_;
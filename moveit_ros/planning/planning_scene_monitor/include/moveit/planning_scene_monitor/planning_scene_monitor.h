@@ -38,6 +38,7 @@
 
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <std_msgs/Empty.h>
 #include <tf2_ros/buffer.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit/planning_scene/planning_scene.h>
@@ -98,6 +99,10 @@ public:
   /// The name of the service used by default for requesting full planning scene state
   static const std::string DEFAULT_PLANNING_SCENE_SERVICE;  // "/get_planning_scene"
 
+  /// Suffix appended to the published planning scene topic to form the topic on which complete planning scenes can be
+  /// requested (std_msgs/Empty), see requestPlanningSceneKeyframe()
+  static const std::string DEFAULT_PLANNING_SCENE_KEYFRAME_REQUEST_SUFFIX;  // "_keyframe_request"
+
   /// The name of the topic used by default for publishing the monitored planning scene (this is without "/" in the
   /// name, so the topic is prefixed by the node name)
   static const std::string MONITORED_PLANNING_SCENE_TOPIC;  // "monitored_planning_scene"
@@ -275,6 +280,32 @@ public:
     return publish_planning_scene_frequency_;
   }
 
+  /** \brief Set the maximum frequency at which the monitored octomap is included in published diffs. Octomap changes
+      arriving faster than this are held back and sent with the first diff published after the period elapsed.
+      A value <= 0 sends the octomap with every diff that changes it. */
+  void setOctomapPublishingFrequency(double hz);
+
+  /** \brief Get the maximum frequency at which the octomap is included in published diffs (Hz) */
+  double getOctomapPublishingFrequency() const
+  {
+    return publish_octomap_frequency_;
+  }
+
+  /** \brief Publish a complete planning scene instead of a diff after every \e count published diffs, so that
+      subscribers which missed a diff are resynchronized after a bounded number of messages. 0 disables keyframes. */
+  void setPlanningSceneKeyframeInterval(unsigned int count);
+
+  /** \brief Get the number of diffs published between two complete planning scenes (0 if disabled) */
+  unsigned int getPlanningSceneKeyframeInterval() const
+  {
+    return publish_keyframe_interval_;
+  }
+
+  /** \brief Request that the next message on the monitored planning scene topic is a complete planning scene,
+      e.g. because a subscriber detected that it lost a diff. Remote subscribers can do the same by publishing on the
+      published topic name followed by DEFAULT_PLANNING_SCENE_KEYFRAME_REQUEST_SUFFIX. */
+  void requestPlanningSceneKeyframe();
+
   /** @brief Get the stored instance of the stored current state monitor
    *  @return An instance of the stored current state monitor*/
   const CurrentStateMonitorPtr& getStateMonitor() const
@@ -416,6 +447,9 @@ protected:
   /** @brief Callback for a new collision object msg*/
   void collisionObjectCallback(const moveit_msgs::msg::CollisionObjectConstPtr& obj);
 
+  /** @brief Callback for requests of a complete planning scene on the keyframe request topic */
+  void keyframeRequestCallback(const std_msgs::EmptyConstPtr& msg);
+
   /** @brief Callback for a new planning scene world*/
   void newPlanningSceneWorldCallback(const moveit_msgs::msg::PlanningSceneWorldConstPtr& world);
 
@@ -482,8 +516,15 @@ protected:
 
   // variables for planning scene publishing
   ros::Publisher planning_scene_publisher_;
+  ros::Subscriber keyframe_request_subscriber_;
   std::unique_ptr<boost::thread> publish_planning_scene_;
   double publish_planning_scene_frequency_;
+  double publish_octomap_frequency_;
+  ros::WallTime last_octomap_publish_time_;
+  bool octomap_publish_pending_;
+  unsigned int publish_keyframe_interval_;
+  unsigned int diffs_since_keyframe_;
+  bool publish_keyframe_requested_;
   SceneUpdateType publish_update_types_;
   SceneUpdateType new_scene_update_;
   boost::condition_variable_any new_scene_update_condition_;
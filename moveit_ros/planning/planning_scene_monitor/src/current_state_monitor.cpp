@@ -39,8 +39,18 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
+#include <algorithm>
 #include <limits>
 
+namespace
+{
+// number of distinct joint state message layouts (e.g. one per publishing driver) whose mapping is remembered
+const std::size_t MAX_JOINT_STATE_LAYOUTS = 8;
+
+// number of past states kept by default, about one second of joint states from a 1 kHz driver
+const std::size_t DEFAULT_STATE_HISTORY_CAPACITY = 1000;
+}
+
 planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const robot_model::RobotModelConstPtr& robot_model,
                                                                  const std::shared_ptr<tf2_ros::Buffer>& tf_buffer)
   : CurrentStateMonitor(robot_model, tf_buffer, ros::NodeHandle())
@@ -57,8 +67,14 @@ planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const robot_mod
   , state_monitor_started_(false)
   , copy_dynamics_(false)
   , error_(std::numeric_limits<double>::epsilon())
+  , history_head_(0)
+  , history_size_(0)
 {
   robot_state_.setToDefaultValues();
+  joint_time_.resize(robot_model_->getJointModelCount());
+  joint_received_.resize(robot_model_->getJointModelCount(), false);
+  setStateHistoryCapacity(DEFAULT_STATE_HISTORY_CAPACITY);
+  publishStateSnapshot();
 }
 
 planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
@@ -68,61 +84,199 @@ planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
 
 robot_state::RobotStatePtr planning_scene_monitor::CurrentStateMonitor::getCurrentState() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  robot_state::RobotState* result = new robot_state::RobotState(robot_state_);
-  return robot_state::RobotStatePtr(result);
+  StateSnapshotConstPtr snapshot = getStateSnapshot();
+  robot_state::RobotStatePtr result(new robot_state::RobotState(robot_model_));
+  copySnapshotToState(*snapshot, *result);
+  return result;
 }
 
 ros::Time planning_scene_monitor::CurrentStateMonitor::getCurrentStateTime() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  return current_state_time_;
+  return getStateSnapshot()->stamp;
 }
 
 std::pair<robot_state::RobotStatePtr, ros::Time>
 planning_scene_monitor::CurrentStateMonitor::getCurrentStateAndTime() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  robot_state::RobotState* result = new robot_state::RobotState(robot_state_);
-  return std::make_pair(robot_state::RobotStatePtr(result), current_state_time_);
+  StateSnapshotConstPtr snapshot = getStateSnapshot();
+  robot_state::RobotStatePtr result(new robot_state::RobotState(robot_model_));
+  copySnapshotToState(*snapshot, *result);
+  return std::make_pair(result, snapshot->stamp);
 }
 
 std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCurrentStateValues() const
 {
   std::map<std::string, double> m;
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
-  const std::vector<std::string>& names = robot_state_.getVariableNames();
+  StateSnapshotConstPtr snapshot = getStateSnapshot();
+  const std::vector<std::string>& names = robot_model_->getVariableNames();
   for (std::size_t i = 0; i < names.size(); ++i)
-    m[names[i]] = pos[i];
+    m[names[i]] = snapshot->positions[i];
   return m;
 }
 
 void planning_scene_monitor::CurrentStateMonitor::setToCurrentState(robot_state::RobotState& upd) const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
-  upd.setVariablePositions(pos);
+  copySnapshotToState(*getStateSnapshot(), upd);
+}
+
+planning_scene_monitor::CurrentStateMonitor::StateSnapshotConstPtr
+planning_scene_monitor::CurrentStateMonitor::getStateSnapshot() const
+{
+  boost::mutex::scoped_lock slock(snapshot_lock_);
+  return snapshot_;
+}
+
+void planning_scene_monitor::CurrentStateMonitor::copySnapshotToState(const StateSnapshot& snapshot,
+                                                                      robot_state::RobotState& upd) const
+{
+  upd.setVariablePositions(snapshot.positions.data());
   if (copy_dynamics_)
   {
-    if (robot_state_.hasVelocities())
-    {
-      const double* vel = robot_state_.getVariableVelocities();
-      upd.setVariableVelocities(vel);
-    }
-    if (robot_state_.hasAccelerations())
-    {
-      const double* acc = robot_state_.getVariableAccelerations();
-      upd.setVariableAccelerations(acc);
-    }
-    if (robot_state_.hasEffort())
-    {
-      const double* eff = robot_state_.getVariableEffort();
-      upd.setVariableEffort(eff);
-    }
+    if (!snapshot.velocities.empty())
+      upd.setVariableVelocities(snapshot.velocities.data());
+    if (!snapshot.accelerations.empty())
+      upd.setVariableAccelerations(snapshot.accelerations.data());
+    if (!snapshot.efforts.empty())
+      upd.setVariableEffort(snapshot.efforts.data());
   }
 }
 
+void planning_scene_monitor::CurrentStateMonitor::publishStateSnapshot()
+{
+  // always fill a new snapshot: readers may still use the previous ones, which are therefore never modified
+  StateSnapshotPtr snapshot(new StateSnapshot());
+
+  const std::size_t n = robot_model_->getVariableCount();
+  const double* pos = robot_state_.getVariablePositions();
+  snapshot->positions.assign(pos, pos + n);
+  if (robot_state_.hasVelocities())
+    snapshot->velocities.assign(robot_state_.getVariableVelocities(), robot_state_.getVariableVelocities() + n);
+  if (robot_state_.hasAccelerations())
+    snapshot->accelerations.assign(robot_state_.getVariableAccelerations(),
+                                   robot_state_.getVariableAccelerations() + n);
+  if (robot_state_.hasEffort())
+    snapshot->efforts.assign(robot_state_.getVariableEffort(), robot_state_.getVariableEffort() + n);
+  snapshot->stamp = current_state_time_;
+
+  recordStateHistory(*snapshot);
+
+  boost::mutex::scoped_lock slock(snapshot_lock_);
+  snapshot_.swap(snapshot);
+}
+
+void planning_scene_monitor::CurrentStateMonitor::setStateHistoryCapacity(std::size_t capacity)
+{
+  boost::mutex::scoped_lock slock(history_lock_);
+  history_stamps_.assign(capacity, ros::Time());
+  history_positions_.assign(capacity * robot_model_->getVariableCount(), 0.0);
+  history_head_ = 0;
+  history_size_ = 0;
+}
+
+std::size_t planning_scene_monitor::CurrentStateMonitor::getStateHistoryCapacity() const
+{
+  boost::mutex::scoped_lock slock(history_lock_);
+  return history_stamps_.size();
+}
+
+void planning_scene_monitor::CurrentStateMonitor::recordStateHistory(const StateSnapshot& snapshot)
+{
+  boost::mutex::scoped_lock slock(history_lock_);
+  const std::size_t capacity = history_stamps_.size();
+  if (capacity == 0)
+    return;
+
+  std::size_t index = history_head_;
+  if (history_size_ > 0)
+  {
+    const std::size_t newest = (history_head_ + capacity - 1) % capacity;
+    // states are looked up by time, so out of order stamps cannot be recorded
+    if (snapshot.stamp < history_stamps_[newest])
+      return;
+    // updates that do not advance the stamp (e.g. from tf) replace the newest entry
+    if (snapshot.stamp == history_stamps_[newest])
+      index = newest;
+  }
+
+  const std::size_t n = snapshot.positions.size();
+  history_stamps_[index] = snapshot.stamp;
+  std::copy(snapshot.positions.begin(), snapshot.positions.end(), history_positions_.begin() + index * n);
+  if (index == history_head_)
+  {
+    history_head_ = (history_head_ + 1) % capacity;
+    history_size_ = std::min(history_size_ + 1, capacity);
+  }
+}
+
+bool planning_scene_monitor::CurrentStateMonitor::getStateAtTime(const ros::Time& t,
+                                                                 robot_state::RobotState& state) const
+{
+  boost::mutex::scoped_lock slock(history_lock_);
+  if (history_size_ == 0)
+    return false;
+
+  const std::size_t capacity = history_stamps_.size();
+  const std::size_t oldest = (history_head_ + capacity - history_size_) % capacity;
+  const std::size_t n = robot_model_->getVariableCount();
+
+  // binary search for the first recorded state that is not older than t
+  std::size_t lo = 0;
+  std::size_t hi = history_size_;
+  while (lo < hi)
+  {
+    std::size_t mid = (lo + hi) / 2;
+    if (history_stamps_[(oldest + mid) % capacity] < t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == history_size_)
+    return false;
+
+  const std::size_t after = (oldest + lo) % capacity;
+  if (history_stamps_[after] == t)
+  {
+    state.setVariablePositions(&history_positions_[after * n]);
+    return true;
+  }
+  if (lo == 0)
+    return false;
+
+  const std::size_t before = (oldest + lo - 1) % capacity;
+  const double fraction =
+      (t - history_stamps_[before]).toSec() / (history_stamps_[after] - history_stamps_[before]).toSec();
+  std::vector<double> positions(n);
+  robot_model_->interpolate(&history_positions_[before * n], &history_positions_[after * n], fraction,
+                            positions.data());
+  state.setVariablePositions(positions);
+  return true;
+}
+
+const std::vector<const moveit::core::JointModel*>&
+planning_scene_monitor::CurrentStateMonitor::getJointStateLayout(const std::vector<std::string>& names)
+{
+  // drivers keep publishing the same names in the same order, so the lookups only happen once per layout
+  for (const JointStateLayout& layout : joint_state_layouts_)
+    if (layout.names == names)
+      return layout.joints;
+
+  if (joint_state_layouts_.size() >= MAX_JOINT_STATE_LAYOUTS)
+    joint_state_layouts_.erase(joint_state_layouts_.begin());
+
+  JointStateLayout layout;
+  layout.names = names;
+  layout.joints.resize(names.size(), nullptr);
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    const moveit::core::JointModel* jm = robot_model_->getJointModel(names[i]);
+    // ignore fixed joints, multi-dof joints (they should not even be in the message)
+    if (jm && jm->getVariableCount() == 1)
+      layout.joints[i] = jm;
+  }
+  joint_state_layouts_.push_back(layout);
+  return joint_state_layouts_.back().joints;
+}
+
 void planning_scene_monitor::CurrentStateMonitor::addUpdateCallback(const JointStateUpdateCallback& fn)
 {
   if (fn)
@@ -138,7 +292,8 @@ void planning_scene_monitor::CurrentStateMonitor::startStateMonitor(const std::s
 {
   if (!state_monitor_started_ && robot_model_)
   {
-    joint_time_.clear();
+    std::fill(joint_received_.begin(), joint_received_.end(), false);
+    setStateHistoryCapacity(getStateHistoryCapacity());
     if (joint_states_topic.empty())
       ROS_ERROR("The joint states topic cannot be an empty string");
     else
@@ -188,7 +343,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState() const
   const std::vector<const moveit::core::JointModel*>& joints = robot_model_->getActiveJointModels();
   boost::mutex::scoped_lock slock(state_update_lock_);
   for (const moveit::core::JointModel* joint : joints)
-    if (joint_time_.find(joint) == joint_time_.end())
+    if (!joint_received_[joint->getJointIndex()])
     {
       if (!joint->isPassive() && !joint->getMimic())
       {
@@ -205,7 +360,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(std::vector<
   const std::vector<const moveit::core::JointModel*>& joints = robot_model_->getActiveJointModels();
   boost::mutex::scoped_lock slock(state_update_lock_);
   for (const moveit::core::JointModel* joint : joints)
-    if (joint_time_.find(joint) == joint_time_.end())
+    if (!joint_received_[joint->getJointIndex()])
       if (!joint->isPassive() && !joint->getMimic())
       {
         missing_states.push_back(joint->getName());
@@ -225,16 +380,15 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(const ros::D
   {
     if (joint->isPassive() || joint->getMimic())
       continue;
-    std::map<const moveit::core::JointModel*, ros::Time>::const_iterator it = joint_time_.find(joint);
-    if (it == joint_time_.end())
+    if (!joint_received_[joint->getJointIndex()])
     {
       ROS_DEBUG("Joint '%s' has never been updated", joint->getName().c_str());
       result = false;
     }
-    else if (it->second < old)
+    else if (joint_time_[joint->getJointIndex()] < old)
     {
       ROS_DEBUG("Joint '%s' was last updated %0.3lf seconds ago (older than the allowed %0.3lf seconds)",
-                joint->getName().c_str(), (now - it->second).toSec(), age.toSec());
+                joint->getName().c_str(), (now - joint_time_[joint->getJointIndex()]).toSec(), age.toSec());
       result = false;
     }
   }
@@ -253,17 +407,16 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(const ros::D
   {
     if (joint->isPassive() || joint->getMimic())
       continue;
-    std::map<const moveit::core::JointModel*, ros::Time>::const_iterator it = joint_time_.find(joint);
-    if (it == joint_time_.end())
+    if (!joint_received_[joint->getJointIndex()])
     {
       ROS_DEBUG("Joint '%s' has never been updated", joint->getName().c_str());
       missing_states.push_back(joint->getName());
       result = false;
     }
-    else if (it->second < old)
+    else if (joint_time_[joint->getJointIndex()] < old)
     {
       ROS_DEBUG("Joint '%s' was last updated %0.3lf seconds ago (older than the allowed %0.3lf seconds)",
-                joint->getName().c_str(), (now - it->second).toSec(), age.toSec());
+                joint->getName().c_str(), (now - joint_time_[joint->getJointIndex()]).toSec(), age.toSec());
       missing_states.push_back(joint->getName());
       result = false;
     }
@@ -346,18 +499,17 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
   {
     boost::mutex::scoped_lock _(state_update_lock_);
     // read the received values, and update their time stamps
+    const std::vector<const moveit::core::JointModel*>& joints = getJointStateLayout(joint_state->name);
     std::size_t n = joint_state->name.size();
     current_state_time_ = joint_state->header.stamp;
     for (std::size_t i = 0; i < n; ++i)
     {
-      const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_state->name[i]);
+      const moveit::core::JointModel* jm = joints[i];
       if (!jm)
         continue;
-      // ignore fixed joints, multi-dof joints (they should not even be in the message)
-      if (jm->getVariableCount() != 1)
-        continue;
 
-      joint_time_[jm] = joint_state->header.stamp;
+      joint_time_[jm->getJointIndex()] = joint_state->header.stamp;
+      joint_received_[jm->getJointIndex()] = true;
 
       if (robot_state_.getJointPositions(jm)[0] != joint_state->position[i])
       {
@@ -400,6 +552,8 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
         }
       }
     }
+
+    publishStateSnapshot();
   }
 
   // callbacks, if needed
@@ -443,9 +597,11 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       }
 
       // allow update if time is more recent or if it is a static transform (time = 0)
-      if (latest_common_time <= joint_time_[joint] && latest_common_time > ros::Time(0))
+      if (joint_received_[joint->getJointIndex()] && latest_common_time <= joint_time_[joint->getJointIndex()] &&
+          latest_common_time > ros::Time(0))
         continue;
-      joint_time_[joint] = latest_common_time;
+      joint_time_[joint->getJointIndex()] = latest_common_time;
+      joint_received_[joint->getJointIndex()] = true;
 
       std::vector<double> new_values(joint->getStateSpaceDimension());
       const robot_model::LinkModel* link = joint->getChildLinkModel();
@@ -463,6 +619,9 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       robot_state_.setJointPositions(joint, new_values.data());
       update = true;
     }
+
+    if (update)
+      publishStateSnapshot();
   }
 
   // callbacks, if needed
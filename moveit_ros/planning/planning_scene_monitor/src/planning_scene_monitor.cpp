@@ -96,6 +96,8 @@ private:
     if (config.publish_planning_scene)
     {
       owner_->setPlanningScenePublishingFrequency(config.publish_planning_scene_hz);
+      owner_->setOctomapPublishingFrequency(config.publish_octomap_hz);
+      owner_->setPlanningSceneKeyframeInterval(config.publish_keyframe_interval);
       owner_->startPublishingPlanningScene(event);
     }
     else
@@ -112,6 +114,7 @@ const std::string PlanningSceneMonitor::DEFAULT_COLLISION_OBJECT_TOPIC = "collis
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_WORLD_TOPIC = "planning_scene_world";
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_TOPIC = "planning_scene";
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_SERVICE = "get_planning_scene";
+const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_KEYFRAME_REQUEST_SUFFIX = "_keyframe_request";
 const std::string PlanningSceneMonitor::MONITORED_PLANNING_SCENE_TOPIC = "monitored_planning_scene";
 
 PlanningSceneMonitor::PlanningSceneMonitor(const std::string& robot_description,
@@ -236,6 +239,11 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
   }
 
   publish_planning_scene_frequency_ = 2.0;
+  publish_octomap_frequency_ = 0.0;
+  octomap_publish_pending_ = false;
+  publish_keyframe_interval_ = 0;
+  diffs_since_keyframe_ = 0;
+  publish_keyframe_requested_ = false;
   new_scene_update_ = UPDATE_NONE;
 
   last_update_time_ = last_robot_motion_time_ = ros::Time::now();
@@ -314,6 +322,7 @@ void PlanningSceneMonitor::stopPublishingPlanningScene()
     copy->join();
     monitorDiffs(false);
     planning_scene_publisher_.shutdown();
+    keyframe_request_subscriber_.shutdown();
     ROS_INFO_NAMED(LOGNAME, "Stopped publishing maintained planning scene.");
   }
 }
@@ -326,6 +335,8 @@ void PlanningSceneMonitor::startPublishingPlanningScene(SceneUpdateType update_t
   {
     planning_scene_publisher_ = nh_.advertise<moveit_msgs::msg::PlanningScene>(planning_scene_topic, 100, false);
     ROS_INFO_NAMED(LOGNAME, "Publishing maintained planning scene on '%s'", planning_scene_topic.c_str());
+    keyframe_request_subscriber_ = nh_.subscribe(planning_scene_topic + DEFAULT_PLANNING_SCENE_KEYFRAME_REQUEST_SUFFIX,
+                                                 10, &PlanningSceneMonitor::keyframeRequestCallback, this);
     monitorDiffs(true);
     publish_planning_scene_.reset(new boost::thread(boost::bind(&PlanningSceneMonitor::scenePublishingThread, this)));
   }
@@ -346,6 +357,7 @@ void PlanningSceneMonitor::scenePublishingThread()
     }
     planning_scene_publisher_.publish(msg);
     ROS_DEBUG_NAMED(LOGNAME, "Published the full planning scene: '%s'", msg.name.c_str());
+    last_octomap_publish_time_ = ros::WallTime::now();
   }
 
   do
@@ -356,13 +368,32 @@ void PlanningSceneMonitor::scenePublishingThread()
     ros::Rate rate(publish_planning_scene_frequency_);
     {
       boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
-      while (new_scene_update_ == UPDATE_NONE && publish_planning_scene_)
-        new_scene_update_condition_.wait(ulock);
-      if (new_scene_update_ != UPDATE_NONE)
+      bool octomap_due = false;
+      while (new_scene_update_ == UPDATE_NONE && !publish_keyframe_requested_ && publish_planning_scene_)
       {
-        if ((publish_update_types_ & new_scene_update_) || new_scene_update_ == UPDATE_SCENE)
+        // a held back octomap change must go out once its publishing period elapsed, even without further updates
+        if (octomap_publish_pending_ && publish_octomap_frequency_ > 0.0)
         {
-          if (new_scene_update_ == UPDATE_SCENE)
+          const double remaining =
+              (last_octomap_publish_time_ - ros::WallTime::now()).toSec() + 1.0 / publish_octomap_frequency_;
+          if (remaining <= 0.0)
+          {
+            octomap_due = true;
+            break;
+          }
+          new_scene_update_condition_.wait_for(ulock,
+                                               boost::chrono::nanoseconds(ros::WallDuration(remaining).toNSec()));
+        }
+        else
+          new_scene_update_condition_.wait(ulock);
+      }
+      if (new_scene_update_ != UPDATE_NONE || publish_keyframe_requested_ || octomap_due)
+      {
+        if ((publish_update_types_ & new_scene_update_) || new_scene_update_ == UPDATE_SCENE ||
+            publish_keyframe_requested_ || octomap_due)
+        {
+          if (new_scene_update_ == UPDATE_SCENE || publish_keyframe_requested_ ||
+              (publish_keyframe_interval_ > 0 && diffs_since_keyframe_ >= publish_keyframe_interval_))
             is_full = true;
           else
           {
@@ -370,6 +401,26 @@ void PlanningSceneMonitor::scenePublishingThread()
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneDiffMsg(msg);
+            if (octomap_monitor_ && (octomap_publish_pending_ || !msg.world.octomap.octomap.data.empty()))
+            {
+              // the octomap is always serialized in full; send it at most at publish_octomap_frequency_ and
+              // carry the change over to a later diff otherwise
+              const ros::WallTime now = ros::WallTime::now();
+              if (publish_octomap_frequency_ > 0.0 &&
+                  (now - last_octomap_publish_time_).toSec() < 1.0 / publish_octomap_frequency_)
+              {
+                msg.world.octomap = octomap_msgs::msg::OctomapWithPose();
+                octomap_publish_pending_ = true;
+              }
+              else
+              {
+                if (msg.world.octomap.octomap.data.empty())
+                  scene_->getOctomapMsg(msg.world.octomap);
+                octomap_publish_pending_ = false;
+                last_octomap_publish_time_ = now;
+              }
+            }
+            ++diffs_since_keyframe_;
           }
           boost::recursive_mutex::scoped_lock prevent_shape_cache_updates(shape_handles_lock_);  // we don't want the
                                                                                                  // transform cache to
@@ -395,12 +446,16 @@ void PlanningSceneMonitor::scenePublishingThread()
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneMsg(msg);
+            octomap_publish_pending_ = false;
+            last_octomap_publish_time_ = ros::WallTime::now();
+            diffs_since_keyframe_ = 0;
           }
           // also publish timestamp of this robot_state
           msg.robot_state.joint_state.header.stamp = last_robot_motion_time_;
           publish_msg = true;
         }
         new_scene_update_ = UPDATE_NONE;
+        publish_keyframe_requested_ = false;
       }
     }
     if (publish_msg)
@@ -1269,6 +1324,31 @@ void PlanningSceneMonitor::setPlanningScenePublishingFrequency(double hz)
                   publish_planning_scene_frequency_);
 }
 
+void PlanningSceneMonitor::setOctomapPublishingFrequency(double hz)
+{
+  publish_octomap_frequency_ = hz;
+  ROS_DEBUG_NAMED(LOGNAME, "Maximum frequency for publishing the octomap is now %lf Hz", publish_octomap_frequency_);
+}
+
+void PlanningSceneMonitor::setPlanningSceneKeyframeInterval(unsigned int count)
+{
+  publish_keyframe_interval_ = count;
+  ROS_DEBUG_NAMED(LOGNAME, "Publishing a full planning scene every %u diffs", publish_keyframe_interval_);
+}
+
+void PlanningSceneMonitor::requestPlanningSceneKeyframe()
+{
+  boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+  publish_keyframe_requested_ = true;
+  new_scene_update_condition_.notify_all();
+}
+
+void PlanningSceneMonitor::keyframeRequestCallback(const std_msgs::EmptyConstPtr& /*msg*/)
+{
+  ROS_DEBUG_NAMED(LOGNAME, "Received a request for a complete planning scene");
+  requestPlanningSceneKeyframe();
+}
+
 void PlanningSceneMonitor::getUpdatedFrameTransforms(std::vector<geometry_msgs::TransformStamped>& transforms)
 {
   const std::string& target = getRobotModel()->getModelFrame();
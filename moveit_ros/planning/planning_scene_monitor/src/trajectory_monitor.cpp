@@ -37,6 +37,7 @@
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <ros/rate.h>
+#include <cmath>
 #include <limits>
 #include <memory>
 
@@ -119,13 +120,35 @@ void planning_scene_monitor::TrajectoryMonitor::recordStates()
       trajectory_.addSuffixWayPoint(state.first, 0.0);
       trajectory_start_time_ = state.second;
       last_recorded_state_time_ = state.second;
+      if (state_add_callback_)
+        state_add_callback_(state.first, state.second);
     }
     else
     {
-      trajectory_.addSuffixWayPoint(state.first, (state.second - last_recorded_state_time_).toSec());
-      last_recorded_state_time_ = state.second;
+      // record the states at the nominal sampling times the state history covers, so the samples are not subject
+      // to the jitter of this loop
+      const ros::Duration period(1.0 / sampling_frequency_);
+      ros::Time t = last_recorded_state_time_ + period;
+      for (; t <= state.second; t += period)
+      {
+        robot_state::RobotStatePtr sample(new robot_state::RobotState(*state.first));
+        if (!current_state_monitor_->getStateAtTime(t, *sample))
+          break;
+        trajectory_.addSuffixWayPoint(sample, period.toSec());
+        last_recorded_state_time_ = t;
+        if (state_add_callback_)
+          state_add_callback_(sample, t);
+      }
+      if (t > state.second)
+        continue;
+
+      // the history does not cover the remaining sampling times; record the current state at the last of them,
+      // so the time base stays on the grid
+      t += period * std::floor((state.second - t).toSec() / period.toSec());
+      trajectory_.addSuffixWayPoint(state.first, (t - last_recorded_state_time_).toSec());
+      last_recorded_state_time_ = t;
+      if (state_add_callback_)
+        state_add_callback_(state.first, t);
     }
-    if (state_add_callback_)
-      state_add_callback_(state.first, state.second);
   }
 }
@@ -53,12 +53,19 @@ public:
   struct Options
   {
     Options(const std::string& robot_description = "robot_description")
-      : robot_description_(robot_description), load_kinematics_solvers_(true)
+      : robot_description_(robot_description)
+      , load_kinematics_solvers_(true)
+      , parallel_kinematics_solvers_(true)
+      , lazy_kinematics_solvers_(false)
     {
     }
 
     Options(const std::string& urdf_string, const std::string& srdf_string)
-      : urdf_string_(urdf_string), srdf_string_(srdf_string), load_kinematics_solvers_(true)
+      : urdf_string_(urdf_string)
+      , srdf_string_(srdf_string)
+      , load_kinematics_solvers_(true)
+      , parallel_kinematics_solvers_(true)
+      , lazy_kinematics_solvers_(false)
     {
     }
 
@@ -74,6 +81,15 @@ public:
     /** @brief Flag indicating whether the kinematics solvers should be loaded as well, using specified ROS parameters
      */
     bool load_kinematics_solvers_;
+
+    /** @brief Flag indicating whether the kinematics solvers of different groups are allocated and initialized
+        concurrently. Can be overridden by the ROS parameter <robot_description>_kinematics/parallel_loading */
+    bool parallel_kinematics_solvers_;
+
+    /** @brief Flag indicating whether allocating and initializing a group's kinematics solver is deferred until its
+        first query (see KinematicsPluginLoader::setLazyLoading()). Can be overridden by the ROS parameter
+        <robot_description>_kinematics/lazy_loading */
+    bool lazy_kinematics_solvers_;
   };
 
   /** @brief Default constructor */
@@ -133,5 +149,7 @@ private:
   rdf_loader::RDFLoaderPtr rdf_loader_;
   kinematics_plugin_loader::KinematicsPluginLoaderPtr kinematics_loader_;
   const rclcpp::Node::SharedPtr node_;
+  bool parallel_kinematics_solvers_;
+  bool lazy_kinematics_solvers_;
 };
 }
@@ -37,6 +37,7 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/profiler/profiler.h>
 #include "rclcpp/rclcpp.hpp"
+#include <future>
 #include <typeinfo>
 
 namespace robot_model_loader
@@ -45,14 +46,15 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.robot_model_
 
 RobotModelLoader::RobotModelLoader(const rclcpp::Node::SharedPtr& node, const std::string& robot_description,
                                    bool load_kinematics_solvers)
-  : node_(node)
+  : node_(node), parallel_kinematics_solvers_(true), lazy_kinematics_solvers_(false)
 {
   Options opt(robot_description);
   opt.load_kinematics_solvers_ = load_kinematics_solvers;
   configure(opt);
 }
 
-RobotModelLoader::RobotModelLoader(const rclcpp::Node::SharedPtr& node, const Options& opt) : node_(node)
+RobotModelLoader::RobotModelLoader(const rclcpp::Node::SharedPtr& node, const Options& opt)
+  : node_(node), parallel_kinematics_solvers_(true), lazy_kinematics_solvers_(false)
 {
   configure(opt);
 }
@@ -190,6 +192,15 @@ void RobotModelLoader::configure(const Options& opt)
     }
   }
 
+  parallel_kinematics_solvers_ = opt.parallel_kinematics_solvers_;
+  lazy_kinematics_solvers_ = opt.lazy_kinematics_solvers_;
+  if (!rdf_loader_->getRobotDescription().empty())
+  {
+    const std::string prefix = rdf_loader_->getRobotDescription() + "_kinematics/";
+    node_->get_parameter(prefix + "parallel_loading", parallel_kinematics_solvers_);
+    node_->get_parameter(prefix + "lazy_loading", lazy_kinematics_solvers_);
+  }
+
   if (model_ && opt.load_kinematics_solvers_)
     loadKinematicsSolvers();
 
@@ -207,8 +218,11 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     if (kloader)
       kinematics_loader_ = kloader;
     else
+    {
       kinematics_loader_.reset(
           new kinematics_plugin_loader::KinematicsPluginLoader(node_, rdf_loader_->getRobotDescription()));
+      kinematics_loader_->setLazyLoading(lazy_kinematics_solvers_);
+    }
     robot_model::SolverAllocatorFn kinematics_allocator = kinematics_loader_->getLoaderFunction(rdf_loader_->getSRDF());
     const std::vector<std::string>& groups = kinematics_loader_->getKnownGroups();
     std::stringstream ss;
@@ -217,7 +231,9 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     if (groups.empty() && !model_->getJointModelGroups().empty())
       RCLCPP_WARN(LOGGER, "No kinematics plugins defined. Fill and load kinematics.yaml!");
 
-    std::map<std::string, robot_model::SolverAllocatorFn> imap;
+    // allocate the solvers of all groups up front, concurrently unless disabled; the loader caches the instances
+    // until JointModelGroup::setSolverAllocators() retrieves them below
+    std::vector<std::pair<const robot_model::JointModelGroup*, std::future<kinematics::KinematicsBasePtr>>> solvers;
     for (const std::string& group : groups)
     {
       // Check if a group in kinematics.yaml exists in the srdf
@@ -225,8 +241,17 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
         continue;
 
       const robot_model::JointModelGroup* jmg = model_->getJointModelGroup(group);
+      solvers.emplace_back(jmg, std::async(parallel_kinematics_solvers_ ? std::launch::async : std::launch::deferred,
+                                           kinematics_allocator, jmg));
+    }
+
+    std::map<std::string, robot_model::SolverAllocatorFn> imap;
+    for (std::pair<const robot_model::JointModelGroup*, std::future<kinematics::KinematicsBasePtr>>& it : solvers)
+    {
+      const robot_model::JointModelGroup* jmg = it.first;
+      const std::string& group = jmg->getName();
 
-      kinematics::KinematicsBasePtr solver = kinematics_allocator(jmg);
+      kinematics::KinematicsBasePtr solver = it.second.get();
       if (solver)
       {
         std::string error_msg;
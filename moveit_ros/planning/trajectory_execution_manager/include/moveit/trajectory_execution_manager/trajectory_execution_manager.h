@@ -45,12 +45,19 @@
 #include <ros/ros.h>
 #include <moveit/controller_manager/controller_manager.h>
 #include <boost/thread.hpp>
+#include <boost/dynamic_bitset.hpp>
 #include <pluginlib/class_loader.hpp>
 
 #include <memory>
+#include <tuple>
 
 namespace trajectory_execution_manager
 {
+/// Decides whether the \e positions of the joints \e joint_names, e.g. of a blended streamed trajectory point, are
+/// valid, for instance collision free
+typedef boost::function<bool(const std::vector<std::string>& joint_names, const std::vector<double>& positions)>
+    StreamedStateValidityFn;
+
 MOVEIT_CLASS_FORWARD(TrajectoryExecutionManager)
 
 // Two modes:
@@ -78,6 +85,12 @@ public:
     // The trajectory to execute, split in different parts (by joints), each set of joints corresponding to one
     // controller
     std::vector<moveit_msgs::msg::RobotTrajectory> trajectory_parts_;
+
+    /// Whether the trajectory continues the previously streamed ones (see pushAndStream())
+    bool streamed_ = false;
+
+    /// For streamed trajectories, the time from which the previously streamed ones are replaced; zero to append
+    ros::Time replace_after_;
   };
 
   /// Load the controller manager plugin, start listening for events on a topic.
@@ -199,6 +212,29 @@ public:
   /// is given to the already loaded ones. If no controller is specified, a default is used. This call is non-blocking.
   bool pushAndExecute(const sensor_msgs::JointState& state, const std::vector<std::string>& controllers);
 
+  /// Add a trajectory for streamed execution. Unlike pushAndExecute(), which makes the controllers switch to the new
+  /// trajectory right away, the trajectory is timed to start when the previously streamed trajectory for the same
+  /// joints ends, and is sent to the controllers before that one finishes. The last setStreamingBlendDuration()
+  /// seconds of the previous trajectory are superposed with the start of the new one, so the robot does not halt at
+  /// the junction. The controllers need to support trajectory replacement at a future start time.
+  /// This call is non-blocking.
+  bool pushAndStream(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                     const std::vector<std::string>& controllers = std::vector<std::string>());
+
+  /// Replace the part of the previously streamed trajectories that would be executed after \e time by \e trajectory.
+  /// The trajectory should start at the state the robot is expected to be in at that time. This call is non-blocking.
+  bool replaceStreamedTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory, const ros::Time& time,
+                                 const std::vector<std::string>& controllers = std::vector<std::string>());
+
+  /// Set the duration over which consecutive streamed trajectories are superposed. By default this is 0, and
+  /// streamed trajectories are only aligned end to start.
+  void setStreamingBlendDuration(double duration);
+
+  /// Set the function that checks the blended points of streamed trajectories, e.g. for collisions. Blends with a
+  /// point the function rejects, or that exceeds the joint limits of the robot model, are not used; the trajectory is
+  /// then aligned end to start instead. Needs to be set before trajectories are streamed.
+  void setStreamingStateValidityCallback(const StreamedStateValidityFn& callback);
+
   /// Wait until the execution is complete. This only works for executions started by execute().  If you call this after
   /// pushAndExecute(), it will immediately stop execution.
   moveit_controller_manager::ExecutionStatus waitForExecution();
@@ -248,6 +284,8 @@ private:
     std::string name_;
     std::set<std::string> joints_;
     std::set<std::string> overlapping_controllers_;
+    std::size_t index_;                  // position of the controller in known_controllers_
+    boost::dynamic_bitset<> joint_mask_;  // joints_, as bits indexed by controller_joint_indices_
     moveit_controller_manager::MoveItControllerManager::ControllerState state_;
     ros::Time last_update_;
 
@@ -276,15 +314,21 @@ private:
                             const std::vector<std::string>& controllers,
                             std::vector<moveit_msgs::msg::RobotTrajectory>& parts);
 
+  /// Available controllers (by index), actuated joints (as mask) and number of controllers of a combination search
+  typedef std::tuple<std::vector<std::size_t>, boost::dynamic_bitset<>, std::size_t> ControllerCombinationKey;
+
+  /// Compute the mask of \e joints; returns false if some of them are not handled by any known controller
+  bool getJointMask(const std::set<std::string>& joints, boost::dynamic_bitset<>& mask) const;
+
   bool findControllers(const std::set<std::string>& actuated_joints, std::size_t controller_count,
                        const std::vector<std::string>& available_controllers,
                        std::vector<std::string>& selected_controllers);
-  bool checkControllerCombination(std::vector<std::string>& controllers, const std::set<std::string>& actuated_joints);
   void generateControllerCombination(std::size_t start_index, std::size_t controller_count,
-                                     const std::vector<std::string>& available_controllers,
+                                     const std::vector<const ControllerInformation*>& available_controllers,
+                                     const boost::dynamic_bitset<>& combined_joints,
                                      std::vector<std::string>& selected_controllers,
                                      std::vector<std::vector<std::string> >& selected_options,
-                                     const std::set<std::string>& actuated_joints);
+                                     const boost::dynamic_bitset<>& actuated_joints);
   bool selectControllers(const std::set<std::string>& actuated_joints,
                          const std::vector<std::string>& available_controllers,
                          std::vector<std::string>& selected_controllers);
@@ -295,6 +339,15 @@ private:
   bool waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time = 1.0);
   void continuousExecutionThread();
 
+  bool pushToContinuousExecution(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                 const std::vector<std::string>& controllers, bool streamed,
+                                 const ros::Time& replace_after);
+
+  /// Time a streamed trajectory part to follow (or replace the suffix of) the part previously streamed to the same
+  /// controller, blending the two where they overlap
+  void alignStreamedPart(const std::string& controller, moveit_msgs::msg::RobotTrajectory& part,
+                         const ros::Time& replace_after);
+
   void stopExecutionInternal();
 
   void receiveEvent(const std_msgs::StringConstPtr& event);
@@ -313,6 +366,13 @@ private:
   std::map<std::string, ControllerInformation> known_controllers_;
   bool manage_controllers_;
 
+  // bit index of every joint handled by a known controller
+  std::map<std::string, std::size_t> controller_joint_indices_;
+  // combinations of disjoint controllers covering a set of joints, cleared when the known controllers change
+  std::map<ControllerCombinationKey, std::vector<std::vector<std::string> > > controller_combinations_;
+  // protects the two members above, which are rebuilt on reloads while executions look up combinations
+  boost::mutex controller_combinations_mutex_;
+
   // thread used to execute trajectories using the execute() command
   std::unique_ptr<boost::thread> execution_thread_;
 
@@ -340,6 +400,11 @@ private:
   std::vector<TrajectoryExecutionContext*> trajectories_;
   std::deque<TrajectoryExecutionContext*> continuous_execution_queue_;
 
+  // last trajectory streamed to each controller, stamped with its absolute start time
+  std::map<std::string, trajectory_msgs::JointTrajectory> streamed_trajectories_;
+  double streaming_blend_duration_;
+  StreamedStateValidityFn streaming_state_validity_callback_;
+
   std::unique_ptr<pluginlib::ClassLoader<moveit_controller_manager::MoveItControllerManager> >
       controller_manager_loader_;
   moveit_controller_manager::MoveItControllerManagerPtr controller_manager_;
@@ -362,4 +427,24 @@ private:
   double execution_velocity_scaling_;
   bool wait_for_trajectory_completion_;
 };
+
+/// Linearly interpolate the positions, velocities and accelerations of a trajectory stamped with its absolute start
+/// time at time \e t. Velocities and accelerations the trajectory does not specify are 0. Returns false if the
+/// trajectory is empty or the points around \e t do not have a position for every joint.
+bool interpolateJointTrajectory(const trajectory_msgs::JointTrajectory& trajectory, const ros::Time& t,
+                                std::vector<double>& positions, std::vector<double>& velocities,
+                                std::vector<double>& accelerations);
+
+/// Compute the start time of \e trajectory when it is streamed after \e previous, the trajectory previously streamed
+/// to the same controller (stamped with its absolute start time, nullptr if there is none). If \e replace_after is not
+/// zero, \e trajectory replaces the part of \e previous after that time. Otherwise it starts \e blend_duration before
+/// \e previous ends, and its points in that window are superposed with the remaining motion of \e previous. Points
+/// are inserted at the waypoints of \e previous inside the window and at its end, so the blend does not depend on the
+/// waypoints of \e trajectory. If a blended point exceeds \e bounds (one per joint, or empty to not check limits) or
+/// is rejected by \e validity_callback, \e trajectory is left unchanged and starts when \e previous ends.
+ros::Time alignStreamedTrajectory(
+    const trajectory_msgs::JointTrajectory* previous, trajectory_msgs::JointTrajectory& trajectory,
+    const ros::Time& replace_after, const ros::Time& now, double blend_duration,
+    const std::vector<robot_model::VariableBounds>& bounds = std::vector<robot_model::VariableBounds>(),
+    const StreamedStateValidityFn& validity_callback = StreamedStateValidityFn());
 }
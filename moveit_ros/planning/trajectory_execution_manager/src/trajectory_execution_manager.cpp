@@ -39,6 +39,7 @@
 #include <moveit_ros_planning/TrajectoryExecutionDynamicReconfigureConfig.h>
 #include <dynamic_reconfigure/server.h>
 #include <tf2_eigen/tf2_eigen.h>
+#include <limits>
 
 namespace trajectory_execution_manager
 {
@@ -115,6 +116,7 @@ void TrajectoryExecutionManager::initialize()
   execution_duration_monitoring_ = true;
   execution_velocity_scaling_ = 1.0;
   allowed_start_tolerance_ = 0.01;
+  streaming_blend_duration_ = 0.0;
 
   allowed_execution_duration_scaling_ = DEFAULT_CONTROLLER_GOAL_DURATION_SCALING;
   allowed_goal_duration_margin_ = DEFAULT_CONTROLLER_GOAL_DURATION_MARGIN;
@@ -209,6 +211,16 @@ void TrajectoryExecutionManager::setWaitForTrajectoryCompletion(bool flag)
   wait_for_trajectory_completion_ = flag;
 }
 
+void TrajectoryExecutionManager::setStreamingBlendDuration(double duration)
+{
+  streaming_blend_duration_ = std::max(0.0, duration);
+}
+
+void TrajectoryExecutionManager::setStreamingStateValidityCallback(const StreamedStateValidityFn& callback)
+{
+  streaming_state_validity_callback_ = callback;
+}
+
 bool TrajectoryExecutionManager::isManagingControllers() const
 {
   return manage_controllers_;
@@ -343,6 +355,31 @@ bool TrajectoryExecutionManager::pushAndExecute(const sensor_msgs::JointState& s
 
 bool TrajectoryExecutionManager::pushAndExecute(const moveit_msgs::msg::RobotTrajectory& trajectory,
                                                 const std::vector<std::string>& controllers)
+{
+  return pushToContinuousExecution(trajectory, controllers, false, ros::Time());
+}
+
+bool TrajectoryExecutionManager::pushAndStream(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                               const std::vector<std::string>& controllers)
+{
+  return pushToContinuousExecution(trajectory, controllers, true, ros::Time());
+}
+
+bool TrajectoryExecutionManager::replaceStreamedTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                           const ros::Time& time,
+                                                           const std::vector<std::string>& controllers)
+{
+  if (time.isZero())
+  {
+    ROS_ERROR_NAMED(name_, "The time from which to replace the streamed trajectory must be specified");
+    return false;
+  }
+  return pushToContinuousExecution(trajectory, controllers, true, time);
+}
+
+bool TrajectoryExecutionManager::pushToContinuousExecution(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                           const std::vector<std::string>& controllers,
+                                                           bool streamed, const ros::Time& replace_after)
 {
   if (!execution_complete_)
   {
@@ -351,6 +388,8 @@ bool TrajectoryExecutionManager::pushAndExecute(const moveit_msgs::msg::RobotTra
   }
 
   TrajectoryExecutionContext* context = new TrajectoryExecutionContext();
+  context->streamed_ = streamed;
+  context->replace_after_ = replace_after;
   if (configure(*context, trajectory, controllers))
   {
     {
@@ -390,6 +429,7 @@ void TrajectoryExecutionManager::continuousExecutionThread()
         if (used_handle->getLastExecutionStatus() == moveit_controller_manager::ExecutionStatus::RUNNING)
           used_handle->cancelExecution();
       used_handles.clear();
+      streamed_trajectories_.clear();
       while (!continuous_execution_queue_.empty())
       {
         TrajectoryExecutionContext* context = continuous_execution_queue_.front();
@@ -460,6 +500,23 @@ void TrajectoryExecutionManager::continuousExecutionThread()
           break;
         }
 
+        // time the trajectories with respect to what the controllers are already executing
+        if (!handles.empty())
+          for (std::size_t i = 0; i < context->trajectory_parts_.size(); ++i)
+          {
+            moveit_msgs::msg::RobotTrajectory& part = context->trajectory_parts_[i];
+            if (context->streamed_)
+              alignStreamedPart(context->controllers_[i], part, context->replace_after_);
+            else
+            {
+              // remember the trajectory, so that streamed trajectories can follow it
+              trajectory_msgs::JointTrajectory& sent = streamed_trajectories_[context->controllers_[i]];
+              sent = part.joint_trajectory;
+              if (sent.header.stamp.isZero())
+                sent.header.stamp = ros::Time::now();
+            }
+          }
+
         // push all trajectories to all controllers simultaneously
         if (!handles.empty())
           for (std::size_t i = 0; i < context->trajectory_parts_.size(); ++i)
@@ -512,7 +569,10 @@ void TrajectoryExecutionManager::continuousExecutionThread()
 
 void TrajectoryExecutionManager::reloadControllerInformation()
 {
-  known_controllers_.clear();
+  boost::mutex::scoped_lock slock(controller_combinations_mutex_);
+  std::map<std::string, ControllerInformation> previous_controllers;
+  previous_controllers.swap(known_controllers_);
+  controller_joint_indices_.clear();
   if (controller_manager_)
   {
     std::vector<std::string> names;
@@ -527,6 +587,21 @@ void TrajectoryExecutionManager::reloadControllerInformation()
       known_controllers_[ci.name_] = ci;
     }
 
+    // number the controllers and their joints, so that sets of them can be handled as bit masks
+    std::size_t controller_index = 0;
+    for (std::pair<const std::string, ControllerInformation>& known_controller : known_controllers_)
+    {
+      known_controller.second.index_ = controller_index++;
+      for (const std::string& joint : known_controller.second.joints_)
+        controller_joint_indices_.insert(std::make_pair(joint, controller_joint_indices_.size()));
+    }
+    for (std::pair<const std::string, ControllerInformation>& known_controller : known_controllers_)
+    {
+      known_controller.second.joint_mask_.resize(controller_joint_indices_.size());
+      for (const std::string& joint : known_controller.second.joints_)
+        known_controller.second.joint_mask_.set(controller_joint_indices_[joint]);
+    }
+
     for (std::map<std::string, ControllerInformation>::iterator it = known_controllers_.begin();
          it != known_controllers_.end(); ++it)
       for (std::map<std::string, ControllerInformation>::iterator jt = known_controllers_.begin();
@@ -543,6 +618,18 @@ void TrajectoryExecutionManager::reloadControllerInformation()
           }
         }
   }
+
+  // the combinations found so far remain valid as long as the controllers and their joints stay the same
+  bool changed = previous_controllers.size() != known_controllers_.size();
+  for (std::map<std::string, ControllerInformation>::const_iterator it = known_controllers_.begin(),
+                                                                     jt = previous_controllers.begin();
+       !changed && it != known_controllers_.end(); ++it, ++jt)
+    changed = it->first != jt->first || it->second.joints_ != jt->second.joints_;
+  if (changed)
+  {
+    ROS_DEBUG_NAMED(name_, "Controller information changed, discarding cached controller combinations");
+    controller_combinations_.clear();
+  }
 }
 
 void TrajectoryExecutionManager::updateControllerState(const std::string& controller, const ros::Duration& age)
@@ -576,59 +663,59 @@ void TrajectoryExecutionManager::updateControllersState(const ros::Duration& age
     updateControllerState(known_controller.second, age);
 }
 
-bool TrajectoryExecutionManager::checkControllerCombination(std::vector<std::string>& selected,
-                                                            const std::set<std::string>& actuated_joints)
+bool TrajectoryExecutionManager::getJointMask(const std::set<std::string>& joints,
+                                              boost::dynamic_bitset<>& mask) const
 {
-  std::set<std::string> combined_joints;
-  for (const std::string& controller : selected)
-  {
-    const ControllerInformation& ci = known_controllers_[controller];
-    combined_joints.insert(ci.joints_.begin(), ci.joints_.end());
-  }
-
-  if (verbose_)
+  mask.clear();
+  mask.resize(controller_joint_indices_.size());
+  for (const std::string& joint : joints)
   {
-    std::stringstream ss, saj, sac;
-    for (const std::string& controller : selected)
-      ss << controller << " ";
-    for (const std::string& actuated_joint : actuated_joints)
-      saj << actuated_joint << " ";
-    for (const std::string& combined_joint : combined_joints)
-      sac << combined_joint << " ";
-    ROS_INFO_NAMED(name_, "Checking if controllers [ %s] operating on joints [ %s] cover joints [ %s]",
-                   ss.str().c_str(), sac.str().c_str(), saj.str().c_str());
+    std::map<std::string, std::size_t>::const_iterator it = controller_joint_indices_.find(joint);
+    if (it == controller_joint_indices_.end())
+      return false;
+    mask.set(it->second);
   }
-
-  return std::includes(combined_joints.begin(), combined_joints.end(), actuated_joints.begin(), actuated_joints.end());
+  return true;
 }
 
-void TrajectoryExecutionManager::generateControllerCombination(std::size_t start_index, std::size_t controller_count,
-                                                               const std::vector<std::string>& available_controllers,
-                                                               std::vector<std::string>& selected_controllers,
-                                                               std::vector<std::vector<std::string> >& selected_options,
-                                                               const std::set<std::string>& actuated_joints)
+void TrajectoryExecutionManager::generateControllerCombination(
+    std::size_t start_index, std::size_t controller_count,
+    const std::vector<const ControllerInformation*>& available_controllers,
+    const boost::dynamic_bitset<>& combined_joints, std::vector<std::string>& selected_controllers,
+    std::vector<std::vector<std::string> >& selected_options, const boost::dynamic_bitset<>& actuated_joints)
 {
   if (selected_controllers.size() == controller_count)
   {
-    if (checkControllerCombination(selected_controllers, actuated_joints))
+    if (verbose_)
+    {
+      std::stringstream ss, saj, sac;
+      for (const std::string& controller : selected_controllers)
+        ss << controller << " ";
+      for (const std::pair<const std::string, std::size_t>& joint : controller_joint_indices_)
+      {
+        if (actuated_joints.test(joint.second))
+          saj << joint.first << " ";
+        if (combined_joints.test(joint.second))
+          sac << joint.first << " ";
+      }
+      ROS_INFO_NAMED(name_, "Checking if controllers [ %s] operating on joints [ %s] cover joints [ %s]",
+                     ss.str().c_str(), sac.str().c_str(), saj.str().c_str());
+    }
+
+    if (actuated_joints.is_subset_of(combined_joints))
       selected_options.push_back(selected_controllers);
     return;
   }
 
   for (std::size_t i = start_index; i < available_controllers.size(); ++i)
   {
-    bool overlap = false;
-    const ControllerInformation& ci = known_controllers_[available_controllers[i]];
-    for (std::size_t j = 0; j < selected_controllers.size() && !overlap; ++j)
-    {
-      if (ci.overlapping_controllers_.find(selected_controllers[j]) != ci.overlapping_controllers_.end())
-        overlap = true;
-    }
-    if (overlap)
+    // the controllers in a combination operate on disjoint sets of joints
+    const ControllerInformation& ci = *available_controllers[i];
+    if (ci.joint_mask_.intersects(combined_joints))
       continue;
-    selected_controllers.push_back(available_controllers[i]);
-    generateControllerCombination(i + 1, controller_count, available_controllers, selected_controllers,
-                                  selected_options, actuated_joints);
+    selected_controllers.push_back(ci.name_);
+    generateControllerCombination(i + 1, controller_count, available_controllers, combined_joints | ci.joint_mask_,
+                                  selected_controllers, selected_options, actuated_joints);
     selected_controllers.pop_back();
   }
 }
@@ -672,12 +759,41 @@ bool TrajectoryExecutionManager::findControllers(const std::set<std::string>& ac
                                                  const std::vector<std::string>& available_controllers,
                                                  std::vector<std::string>& selected_controllers)
 {
-  // generate all combinations of controller_count controllers that operate on disjoint sets of joints
-  std::vector<std::string> work_area;
   OrderPotentialControllerCombination order;
   std::vector<std::vector<std::string> >& selected_options = order.selected_options;
-  generateControllerCombination(0, controller_count, available_controllers, work_area, selected_options,
-                                actuated_joints);
+
+  // joints no known controller handles cannot be covered by any combination
+  boost::mutex::scoped_lock slock(controller_combinations_mutex_);
+  boost::dynamic_bitset<> actuated_mask;
+  if (getJointMask(actuated_joints, actuated_mask))
+  {
+    std::vector<const ControllerInformation*> available;
+    std::vector<std::size_t> available_indices;
+    for (const std::string& controller : available_controllers)
+    {
+      std::map<std::string, ControllerInformation>::const_iterator it = known_controllers_.find(controller);
+      if (it == known_controllers_.end())
+        continue;
+      available.push_back(&it->second);
+      available_indices.push_back(it->second.index_);
+    }
+
+    // generate all combinations of controller_count controllers that operate on disjoint sets of joints, unless the
+    // same search was already done for the current set of known controllers
+    ControllerCombinationKey key(available_indices, actuated_mask, controller_count);
+    std::map<ControllerCombinationKey, std::vector<std::vector<std::string> > >::iterator cached =
+        controller_combinations_.find(key);
+    if (cached == controller_combinations_.end())
+    {
+      std::vector<std::string> work_area;
+      std::vector<std::vector<std::string> > options;
+      generateControllerCombination(0, controller_count, available, boost::dynamic_bitset<>(actuated_mask.size()),
+                                    work_area, options, actuated_mask);
+      cached = controller_combinations_.insert(std::make_pair(key, options)).first;
+    }
+    selected_options = cached->second;
+  }
+  slock.unlock();
 
   if (verbose_)
   {
@@ -794,6 +910,209 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
   return false;
 }
 
+bool interpolateJointTrajectory(const trajectory_msgs::JointTrajectory& trajectory, const ros::Time& t,
+                                std::vector<double>& positions, std::vector<double>& velocities,
+                                std::vector<double>& accelerations)
+{
+  const std::vector<trajectory_msgs::JointTrajectoryPoint>& points = trajectory.points;
+  if (points.empty())
+    return false;
+  std::size_t after = 0;
+  while (after < points.size() && trajectory.header.stamp + points[after].time_from_start < t)
+    ++after;
+  std::size_t before = after > 0 ? after - 1 : 0;
+  after = std::min(after, points.size() - 1);
+
+  const std::size_t n = trajectory.joint_names.size();
+  const trajectory_msgs::JointTrajectoryPoint& p0 = points[before];
+  const trajectory_msgs::JointTrajectoryPoint& p1 = points[after];
+  if (p0.positions.size() != n || p1.positions.size() != n)
+    return false;
+
+  double fraction = 0.0;
+  const double span = (p1.time_from_start - p0.time_from_start).toSec();
+  if (span > 0.0)
+    fraction = (t - trajectory.header.stamp - p0.time_from_start).toSec() / span;
+
+  positions.resize(n);
+  for (std::size_t k = 0; k < n; ++k)
+    positions[k] = p0.positions[k] + fraction * (p1.positions[k] - p0.positions[k]);
+  velocities.assign(n, 0.0);
+  if (p0.velocities.size() == n && p1.velocities.size() == n)
+    for (std::size_t k = 0; k < n; ++k)
+      velocities[k] = p0.velocities[k] + fraction * (p1.velocities[k] - p0.velocities[k]);
+  accelerations.assign(n, 0.0);
+  if (p0.accelerations.size() == n && p1.accelerations.size() == n)
+    for (std::size_t k = 0; k < n; ++k)
+      accelerations[k] = p0.accelerations[k] + fraction * (p1.accelerations[k] - p0.accelerations[k]);
+  return true;
+}
+
+namespace
+{
+bool withinBounds(double value, double min, double max)
+{
+  return value >= min - std::numeric_limits<double>::epsilon() && value <= max + std::numeric_limits<double>::epsilon();
+}
+
+// Check a blended point against the joint limits and the validity callback
+bool isValidBlendedPoint(const trajectory_msgs::JointTrajectory& trajectory,
+                         const trajectory_msgs::JointTrajectoryPoint& point,
+                         const std::vector<robot_model::VariableBounds>& bounds,
+                         const StreamedStateValidityFn& validity_callback)
+{
+  for (std::size_t k = 0; k < bounds.size() && k < point.positions.size(); ++k)
+  {
+    const robot_model::VariableBounds& b = bounds[k];
+    if ((b.position_bounded_ && !withinBounds(point.positions[k], b.min_position_, b.max_position_)) ||
+        (b.velocity_bounded_ && k < point.velocities.size() &&
+         !withinBounds(point.velocities[k], b.min_velocity_, b.max_velocity_)) ||
+        (b.acceleration_bounded_ && k < point.accelerations.size() &&
+         !withinBounds(point.accelerations[k], b.min_acceleration_, b.max_acceleration_)))
+    {
+      ROS_WARN_NAMED("trajectory_execution_manager",
+                     "Blending streamed trajectories exceeds the limits of joint '%s' at %lf seconds",
+                     trajectory.joint_names[k].c_str(), point.time_from_start.toSec());
+      return false;
+    }
+  }
+  if (validity_callback && !validity_callback(trajectory.joint_names, point.positions))
+  {
+    ROS_WARN_NAMED("trajectory_execution_manager", "Blending streamed trajectories yields an invalid state at %lf "
+                                                   "seconds",
+                   point.time_from_start.toSec());
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+ros::Time alignStreamedTrajectory(const trajectory_msgs::JointTrajectory* previous,
+                                  trajectory_msgs::JointTrajectory& trajectory, const ros::Time& replace_after,
+                                  const ros::Time& now, double blend_duration,
+                                  const std::vector<robot_model::VariableBounds>& bounds,
+                                  const StreamedStateValidityFn& validity_callback)
+{
+  // only a previous trajectory for the same joints that is still being executed needs to be taken into account
+  if (!previous || previous->points.empty() || previous->joint_names != trajectory.joint_names)
+    return now;
+
+  const ros::Time previous_end = previous->header.stamp + previous->points.back().time_from_start;
+  if (!replace_after.isZero())
+    return std::max(now, std::min(replace_after, previous_end));
+  if (previous_end <= now)
+    return now;
+
+  // a previous trajectory without positions for all joints cannot be followed
+  const std::size_t n = trajectory.joint_names.size();
+  for (const trajectory_msgs::JointTrajectoryPoint& point : previous->points)
+    if (point.positions.size() != n)
+      return now;
+
+  const ros::Time start = std::max(now, previous_end - ros::Duration(blend_duration));
+  if (start >= previous_end)
+    return start;
+
+  // both trajectories are interpolated linearly, so their sum is exactly represented once the blended trajectory has
+  // a point at every waypoint of either one inside the window; add points of the new trajectory at the waypoints of
+  // the previous one and at the end of the window where it has none
+  trajectory_msgs::JointTrajectory blended = trajectory;
+  blended.header.stamp = start;
+  std::vector<ros::Duration> sample_times;
+  for (const trajectory_msgs::JointTrajectoryPoint& point : previous->points)
+  {
+    const ros::Time t = previous->header.stamp + point.time_from_start;
+    if (t > start && t < previous_end)
+      sample_times.push_back(t - start);
+  }
+  sample_times.push_back(previous_end - start);
+
+  std::vector<double> positions, velocities, accelerations;
+  if (!blended.points.empty())
+  {
+    const bool has_velocities = blended.points.front().velocities.size() == n;
+    const bool has_accelerations = blended.points.front().accelerations.size() == n;
+    std::vector<trajectory_msgs::JointTrajectoryPoint>::iterator it = blended.points.begin();
+    for (const ros::Duration& sample_time : sample_times)
+    {
+      while (it != blended.points.end() && it->time_from_start < sample_time)
+        ++it;
+      if (it == blended.points.end() || it == blended.points.begin() || it->time_from_start == sample_time)
+        continue;
+      // without positions for all joints around the sample, the new trajectory is not blended
+      if (!interpolateJointTrajectory(blended, start + sample_time, positions, velocities, accelerations))
+        return previous_end;
+      trajectory_msgs::JointTrajectoryPoint sample;
+      sample.time_from_start = sample_time;
+      sample.positions = positions;
+      if (has_velocities)
+        sample.velocities = velocities;
+      if (has_accelerations)
+        sample.accelerations = accelerations;
+      it = blended.points.insert(it, sample) + 1;
+    }
+  }
+
+  // over the blend window, superpose the remaining motion of the previous trajectory with the start of the new
+  // one; both are at the junction state at the ends of the window, so positions, velocities and accelerations stay
+  // continuous
+  const std::vector<double>& junction = previous->points.back().positions;
+  for (trajectory_msgs::JointTrajectoryPoint& point : blended.points)
+  {
+    const ros::Time t = start + point.time_from_start;
+    if (t >= previous_end)
+      break;
+    if (point.positions.size() != n || !interpolateJointTrajectory(*previous, t, positions, velocities, accelerations))
+      continue;
+    for (std::size_t k = 0; k < n; ++k)
+      point.positions[k] += positions[k] - junction[k];
+    if (point.velocities.size() == n)
+      for (std::size_t k = 0; k < n; ++k)
+        point.velocities[k] += velocities[k];
+    if (point.accelerations.size() == n)
+      for (std::size_t k = 0; k < n; ++k)
+        point.accelerations[k] += accelerations[k];
+    if (!isValidBlendedPoint(blended, point, bounds, validity_callback))
+      return previous_end;
+  }
+
+  blended.header.stamp = trajectory.header.stamp;
+  trajectory.points.swap(blended.points);
+  return start;
+}
+
+void TrajectoryExecutionManager::alignStreamedPart(const std::string& controller,
+                                                   moveit_msgs::msg::RobotTrajectory& part,
+                                                   const ros::Time& replace_after)
+{
+  const ros::Time now = ros::Time::now();
+  trajectory_msgs::JointTrajectory& trajectory = part.joint_trajectory;
+
+  std::map<std::string, trajectory_msgs::JointTrajectory>::const_iterator previous =
+      streamed_trajectories_.find(controller);
+  // limits of the joints in the order of the trajectory, unbounded for joints with several variables
+  std::vector<robot_model::VariableBounds> bounds(trajectory.joint_names.size());
+  for (std::size_t k = 0; k < trajectory.joint_names.size(); ++k)
+    if (robot_model_->hasJointModel(trajectory.joint_names[k]))
+    {
+      const robot_model::JointModel* jm = robot_model_->getJointModel(trajectory.joint_names[k]);
+      if (jm->getVariableCount() == 1)
+        bounds[k] = jm->getVariableBounds()[0];
+    }
+
+  const ros::Time start =
+      alignStreamedTrajectory(previous != streamed_trajectories_.end() ? &previous->second : nullptr, trajectory,
+                              replace_after, now, streaming_blend_duration_, bounds,
+                              streaming_state_validity_callback_);
+
+  trajectory.header.stamp = start;
+  part.multi_dof_joint_trajectory.header.stamp = start;
+  if (!trajectory.points.empty())
+    streamed_trajectories_[controller] = trajectory;
+  ROS_DEBUG_NAMED(name_, "Streaming trajectory to controller '%s' starting %lf seconds from now", controller.c_str(),
+                  (start - now).toSec());
+}
+
 bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory,
                                                       const std::vector<std::string>& controllers,
                                                       std::vector<moveit_msgs::msg::RobotTrajectory>& parts)
@@ -801,18 +1120,19 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::Ro
   parts.clear();
   parts.resize(controllers.size());
 
-  std::set<std::string> actuated_joints_mdof;
-  actuated_joints_mdof.insert(trajectory.multi_dof_joint_trajectory.joint_names.begin(),
-                              trajectory.multi_dof_joint_trajectory.joint_names.end());
-  std::set<std::string> actuated_joints_single;
-  for (const std::string& joint_name : trajectory.joint_trajectory.joint_names)
+  // position of each actuated joint in the trajectory, so the parts can be filled by index
+  std::map<std::string, std::size_t> index_mdof;
+  for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.joint_names.size(); ++j)
+    index_mdof[trajectory.multi_dof_joint_trajectory.joint_names[j]] = j;
+  std::map<std::string, std::size_t> index_single;
+  for (std::size_t j = 0; j < trajectory.joint_trajectory.joint_names.size(); ++j)
   {
-    const robot_model::JointModel* jm = robot_model_->getJointModel(joint_name);
+    const robot_model::JointModel* jm = robot_model_->getJointModel(trajectory.joint_trajectory.joint_names[j]);
     if (jm)
     {
       if (jm->isPassive() || jm->getMimic() != nullptr || jm->getType() == robot_model::JointModel::FIXED)
         continue;
-      actuated_joints_single.insert(jm->getName());
+      index_single[jm->getName()] = j;
     }
   }
 
@@ -824,12 +1144,27 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::Ro
       ROS_ERROR_STREAM_NAMED(name_, "Controller " << controllers[i] << " not found.");
       return false;
     }
+
+    // the joints of the controller are sorted, so each part lists its joints in alphabetical order
     std::vector<std::string> intersect_mdof;
-    std::set_intersection(it->second.joints_.begin(), it->second.joints_.end(), actuated_joints_mdof.begin(),
-                          actuated_joints_mdof.end(), std::back_inserter(intersect_mdof));
+    std::vector<std::size_t> bijection_mdof;
     std::vector<std::string> intersect_single;
-    std::set_intersection(it->second.joints_.begin(), it->second.joints_.end(), actuated_joints_single.begin(),
-                          actuated_joints_single.end(), std::back_inserter(intersect_single));
+    std::vector<std::size_t> bijection_single;
+    for (const std::string& joint : it->second.joints_)
+    {
+      std::map<std::string, std::size_t>::const_iterator jt = index_mdof.find(joint);
+      if (jt != index_mdof.end())
+      {
+        intersect_mdof.push_back(joint);
+        bijection_mdof.push_back(jt->second);
+      }
+      jt = index_single.find(joint);
+      if (jt != index_single.end())
+      {
+        intersect_single.push_back(joint);
+        bijection_single.push_back(jt->second);
+      }
+    }
     if (intersect_mdof.empty() && intersect_single.empty())
       ROS_WARN_STREAM_NAMED(name_, "No joints to be distributed for controller " << controllers[i]);
     {
@@ -837,12 +1172,7 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::Ro
       {
         std::vector<std::string>& jnames = parts[i].multi_dof_joint_trajectory.joint_names;
         jnames.insert(jnames.end(), intersect_mdof.begin(), intersect_mdof.end());
-        std::map<std::string, std::size_t> index;
-        for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.joint_names.size(); ++j)
-          index[trajectory.multi_dof_joint_trajectory.joint_names[j]] = j;
-        std::vector<std::size_t> bijection(jnames.size());
-        for (std::size_t j = 0; j < jnames.size(); ++j)
-          bijection[j] = index[jnames[j]];
+        const std::vector<std::size_t>& bijection = bijection_mdof;
 
         parts[i].multi_dof_joint_trajectory.points.resize(trajectory.multi_dof_joint_trajectory.points.size());
         for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.points.size(); ++j)
@@ -885,12 +1215,7 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::msg::Ro
         std::vector<std::string>& jnames = parts[i].joint_trajectory.joint_names;
         jnames.insert(jnames.end(), intersect_single.begin(), intersect_single.end());
         parts[i].joint_trajectory.header = trajectory.joint_trajectory.header;
-        std::map<std::string, std::size_t> index;
-        for (std::size_t j = 0; j < trajectory.joint_trajectory.joint_names.size(); ++j)
-          index[trajectory.joint_trajectory.joint_names[j]] = j;
-        std::vector<std::size_t> bijection(jnames.size());
-        for (std::size_t j = 0; j < jnames.size(); ++j)
-          bijection[j] = index[jnames[j]];
+        const std::vector<std::size_t>& bijection = bijection_single;
         parts[i].joint_trajectory.points.resize(trajectory.joint_trajectory.points.size());
         for (std::size_t j = 0; j < trajectory.joint_trajectory.points.size(); ++j)
         {
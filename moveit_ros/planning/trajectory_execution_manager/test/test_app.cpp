@@ -77,6 +77,28 @@ int main(int argc, char** argv)
   if (!tem.waitForExecution())
     ROS_ERROR("Fail!");
 
+  // micro-benchmark of controller selection and trajectory splitting, which every push() goes through
+  {
+    moveit_msgs::msg::RobotTrajectory traj;
+    traj.joint_trajectory.joint_names = { "rj1", "rj2", "lj1", "lj2", "lj3", "headj" };
+    traj.joint_trajectory.points.resize(100);
+    for (trajectory_msgs::JointTrajectoryPoint& point : traj.joint_trajectory.points)
+      point.positions.resize(traj.joint_trajectory.joint_names.size(), 0.0);
+    traj.multi_dof_joint_trajectory.joint_names.push_back("basej");
+    traj.multi_dof_joint_trajectory.points.resize(100);
+    for (trajectory_msgs::MultiDOFJointTrajectoryPoint& point : traj.multi_dof_joint_trajectory.points)
+      point.transforms.resize(1);
+
+    const std::size_t iterations = 1000;
+    ros::WallTime start = ros::WallTime::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+      if (!tem.push(traj))
+        ROS_ERROR("Fail!");
+    double elapsed = (ros::WallTime::now() - start).toSec();
+    std::cout << "push: " << elapsed * 1e6 / iterations << " us per trajectory\n";
+    tem.clear();
+  }
+
   moveit_msgs::msg::RobotTrajectory traj1;
   traj1.joint_trajectory.joint_names.push_back("rj1");
   traj1.joint_trajectory.points.resize(1);
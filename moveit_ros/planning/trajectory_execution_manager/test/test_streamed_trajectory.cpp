@@ -0,0 +1,240 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
+
+namespace
+{
+trajectory_msgs::JointTrajectory makeTrajectory(const ros::Time& stamp, const std::vector<double>& times,
+                                                const std::vector<double>& positions,
+                                                const std::vector<double>& velocities,
+                                                const std::vector<double>& accelerations)
+{
+  trajectory_msgs::JointTrajectory trajectory;
+  trajectory.header.stamp = stamp;
+  trajectory.joint_names.push_back("j1");
+  trajectory.points.resize(times.size());
+  for (std::size_t i = 0; i < times.size(); ++i)
+  {
+    trajectory.points[i].time_from_start = ros::Duration(times[i]);
+    trajectory.points[i].positions.push_back(positions[i]);
+    trajectory.points[i].velocities.push_back(velocities[i]);
+    trajectory.points[i].accelerations.push_back(accelerations[i]);
+  }
+  return trajectory;
+}
+
+const ros::Time NOW(100.0);
+}  // namespace
+
+TEST(StreamedTrajectory, Interpolate)
+{
+  trajectory_msgs::JointTrajectory trajectory =
+      makeTrajectory(NOW, { 0.0, 1.0 }, { 0.0, 1.0 }, { 2.0, 0.0 }, { -1.0, -3.0 });
+  std::vector<double> positions, velocities, accelerations;
+  ASSERT_TRUE(trajectory_execution_manager::interpolateJointTrajectory(trajectory, NOW + ros::Duration(0.25), positions,
+                                                                       velocities, accelerations));
+  EXPECT_NEAR(positions[0], 0.25, 1e-9);
+  EXPECT_NEAR(velocities[0], 1.5, 1e-9);
+  EXPECT_NEAR(accelerations[0], -1.5, 1e-9);
+
+  // past the end, the last point is held
+  ASSERT_TRUE(trajectory_execution_manager::interpolateJointTrajectory(trajectory, NOW + ros::Duration(5.0), positions,
+                                                                       velocities, accelerations));
+  EXPECT_NEAR(positions[0], 1.0, 1e-9);
+
+  // points without a position for every joint are rejected instead of being read out of bounds
+  trajectory.points[1].positions.clear();
+  EXPECT_FALSE(trajectory_execution_manager::interpolateJointTrajectory(trajectory, NOW + ros::Duration(0.5), positions,
+                                                                        velocities, accelerations));
+  trajectory.points.clear();
+  EXPECT_FALSE(trajectory_execution_manager::interpolateJointTrajectory(trajectory, NOW, positions, velocities,
+                                                                        accelerations));
+}
+
+TEST(StreamedTrajectory, AppendAndBlend)
+{
+  const trajectory_msgs::JointTrajectory previous =
+      makeTrajectory(NOW, { 0.0, 1.0, 2.0 }, { 0.0, 0.9, 1.0 }, { 1.0, 0.5, 0.0 }, { 0.5, 0.5, 0.0 });
+  const trajectory_msgs::JointTrajectory next =
+      makeTrajectory(ros::Time(), { 0.0, 0.5, 1.0, 1.5 }, { 1.0, 1.1, 1.3, 1.4 }, { 0.0, 0.3, 0.3, 0.0 },
+                     { 0.0, 0.6, 0.0, -0.6 });
+
+  // without blending, the new trajectory starts where the previous one ends and is not modified
+  trajectory_msgs::JointTrajectory appended = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, appended, ros::Time(), NOW, 0.0),
+            NOW + ros::Duration(2.0));
+  EXPECT_EQ(appended, next);
+
+  // with blending, the start of the new trajectory continues the state of the previous one at the splice point
+  trajectory_msgs::JointTrajectory blended = next;
+  const ros::Time start =
+      trajectory_execution_manager::alignStreamedTrajectory(&previous, blended, ros::Time(), NOW, 1.0);
+  EXPECT_EQ(start, NOW + ros::Duration(1.0));
+  EXPECT_NEAR(blended.points[0].positions[0], 0.9, 1e-9);
+  EXPECT_NEAR(blended.points[0].velocities[0], 0.5, 1e-9);
+  EXPECT_NEAR(blended.points[0].accelerations[0], 0.5, 1e-9);
+  EXPECT_NEAR(blended.points[1].positions[0], 1.1 + 0.95 - 1.0, 1e-9);
+  EXPECT_NEAR(blended.points[1].velocities[0], 0.3 + 0.25, 1e-9);
+  EXPECT_NEAR(blended.points[1].accelerations[0], 0.6 + 0.25, 1e-9);
+  // from the end of the previous trajectory on, the new one is used as is
+  EXPECT_EQ(blended.points[2], next.points[2]);
+  EXPECT_EQ(blended.points[3], next.points[3]);
+
+  // a previous trajectory that already ended or is for other joints is not taken into account
+  trajectory_msgs::JointTrajectory other = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, other, ros::Time(),
+                                                                  NOW + ros::Duration(3.0), 1.0),
+            NOW + ros::Duration(3.0));
+  other.joint_names[0] = "j2";
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, other, ros::Time(), NOW, 1.0), NOW);
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(nullptr, other, ros::Time(), NOW, 1.0), NOW);
+
+  // malformed previous points make the new trajectory start right away
+  trajectory_msgs::JointTrajectory malformed = previous;
+  malformed.points[1].positions.clear();
+  trajectory_msgs::JointTrajectory unblended = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&malformed, unblended, ros::Time(), NOW, 1.0), NOW);
+  EXPECT_EQ(unblended, next);
+}
+
+TEST(StreamedTrajectory, BlendSparseWaypoints)
+{
+  const trajectory_msgs::JointTrajectory previous =
+      makeTrajectory(NOW, { 0.0, 1.0, 2.0 }, { 0.0, 0.9, 1.0 }, { 1.0, 0.5, 0.0 }, { 0.5, 0.5, 0.0 });
+  const trajectory_msgs::JointTrajectory next =
+      makeTrajectory(ros::Time(), { 0.0, 2.0 }, { 1.0, 1.4 }, { 0.2, 0.2 }, { 0.0, 0.0 });
+
+  // the new trajectory has no waypoints inside the window, so points are added at the waypoint of the previous one
+  // and at the end of the window
+  trajectory_msgs::JointTrajectory blended = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, blended, ros::Time(), NOW, 1.5),
+            NOW + ros::Duration(0.5));
+  ASSERT_EQ(blended.points.size(), 4u);
+  EXPECT_EQ(blended.points[1].time_from_start, ros::Duration(0.5));
+  EXPECT_EQ(blended.points[2].time_from_start, ros::Duration(1.5));
+  EXPECT_EQ(blended.points[3], next.points[1]);
+
+  // the first point continues the previous trajectory, the added ones hold the sum of both trajectories
+  EXPECT_NEAR(blended.points[0].positions[0], 0.45, 1e-9);
+  EXPECT_NEAR(blended.points[0].velocities[0], 0.95, 1e-9);
+  EXPECT_NEAR(blended.points[1].positions[0], 0.9 + 1.1 - 1.0, 1e-9);
+  EXPECT_NEAR(blended.points[1].velocities[0], 0.5 + 0.2, 1e-9);
+  EXPECT_NEAR(blended.points[1].accelerations[0], 0.5, 1e-9);
+  EXPECT_NEAR(blended.points[2].positions[0], 1.3, 1e-9);
+  EXPECT_NEAR(blended.points[2].velocities[0], 0.2, 1e-9);
+}
+
+TEST(StreamedTrajectory, RejectInvalidBlend)
+{
+  const trajectory_msgs::JointTrajectory previous =
+      makeTrajectory(NOW, { 0.0, 1.0, 2.0 }, { 0.0, 0.9, 1.0 }, { 1.0, 0.5, 0.0 }, { 0.5, 0.5, 0.0 });
+  const trajectory_msgs::JointTrajectory next =
+      makeTrajectory(ros::Time(), { 0.0, 0.5, 1.0, 1.5 }, { 1.0, 1.1, 1.3, 1.4 }, { 0.0, 0.3, 0.3, 0.0 },
+                     { 0.0, 0.6, 0.0, -0.6 });
+
+  // the blended velocity of 0.55 at 0.5 seconds exceeds the limit, so the trajectories are appended instead
+  std::vector<robot_model::VariableBounds> bounds(1);
+  bounds[0].velocity_bounded_ = true;
+  bounds[0].min_velocity_ = -0.5;
+  bounds[0].max_velocity_ = 0.5;
+  trajectory_msgs::JointTrajectory too_fast = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, too_fast, ros::Time(), NOW, 1.0, bounds),
+            NOW + ros::Duration(2.0));
+  EXPECT_EQ(too_fast, next);
+
+  // within the limits, the blend is used
+  bounds[0].min_velocity_ = -0.6;
+  bounds[0].max_velocity_ = 0.6;
+  trajectory_msgs::JointTrajectory within_limits = next;
+  EXPECT_EQ(
+      trajectory_execution_manager::alignStreamedTrajectory(&previous, within_limits, ros::Time(), NOW, 1.0, bounds),
+      NOW + ros::Duration(1.0));
+  EXPECT_NEAR(within_limits.points[1].velocities[0], 0.55, 1e-9);
+
+  // so is the position limit
+  bounds[0].position_bounded_ = true;
+  bounds[0].min_position_ = 0.0;
+  bounds[0].max_position_ = 1.0;
+  trajectory_msgs::JointTrajectory out_of_bounds = next;
+  EXPECT_EQ(
+      trajectory_execution_manager::alignStreamedTrajectory(&previous, out_of_bounds, ros::Time(), NOW, 1.0, bounds),
+      NOW + ros::Duration(2.0));
+  EXPECT_EQ(out_of_bounds, next);
+
+  // blended states rejected by the validity callback, e.g. for being in collision, are not used either
+  std::size_t checked = 0;
+  trajectory_execution_manager::StreamedStateValidityFn in_collision =
+      [&checked](const std::vector<std::string>& joint_names, const std::vector<double>& positions) {
+        ++checked;
+        return joint_names.size() == 1 && positions[0] < 1.0;
+      };
+  trajectory_msgs::JointTrajectory colliding = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, colliding, ros::Time(), NOW, 1.0,
+                                                                  std::vector<robot_model::VariableBounds>(),
+                                                                  in_collision),
+            NOW + ros::Duration(2.0));
+  EXPECT_EQ(colliding, next);
+  EXPECT_EQ(checked, 2u);
+}
+
+TEST(StreamedTrajectory, Replace)
+{
+  const trajectory_msgs::JointTrajectory previous =
+      makeTrajectory(NOW, { 0.0, 1.0, 2.0 }, { 0.0, 0.9, 1.0 }, { 1.0, 0.5, 0.0 }, { 0.5, 0.5, 0.0 });
+  const trajectory_msgs::JointTrajectory next =
+      makeTrajectory(ros::Time(), { 0.0, 1.0 }, { 0.9, 0.5 }, { 0.0, 0.0 }, { 0.0, 0.0 });
+
+  // the suffix after the replacement time is dropped; the replacement is not blended
+  trajectory_msgs::JointTrajectory replacement = next;
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, replacement, NOW + ros::Duration(1.0),
+                                                                  NOW, 1.0),
+            NOW + ros::Duration(1.0));
+  EXPECT_EQ(replacement, next);
+
+  // replacement times are clamped to the remaining execution of the previous trajectory
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, replacement, NOW + ros::Duration(5.0),
+                                                                  NOW, 1.0),
+            NOW + ros::Duration(2.0));
+  EXPECT_EQ(trajectory_execution_manager::alignStreamedTrajectory(&previous, replacement, NOW - ros::Duration(5.0),
+                                                                  NOW, 1.0),
+            NOW);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -46,6 +46,12 @@
 #include <tf2_ros/buffer.h>
 #include <tf2_ros/transform_listener.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 namespace moveit
 {
 namespace planning_interface
@@ -90,9 +96,13 @@ public:
       std::string ns = "planning_pipelines/";
       nh.getParam(ns + "pipeline_names", pipeline_names);
       nh.getParam(ns + "namespace", parent_namespace);
+      nh.param(ns + "planning_threads", planning_threads, 1);
     }
     std::vector<std::string> pipeline_names;
     std::string parent_namespace;
+    /// Maximum number of plans computed concurrently by asynchronous planning requests. Every planning thread loads
+    /// its own instances of the planning pipelines it uses.
+    int planning_threads;
   };
 
   /// Parameter container for initializing MoveItCpp
@@ -114,14 +124,14 @@ public:
 
   /**
    * @brief This class owns unique resources (e.g. action clients, threads) and its not very
-   * meaningful to copy. Pass by references, move it, or simply create multiple instances where
-   * required.
+   * meaningful to copy. The planning threads refer to this instance, so it can't be moved either.
+   * Pass by references, share a MoveItCppPtr, or simply create multiple instances where required.
    */
   MoveItCpp(const MoveItCpp&) = delete;
   MoveItCpp& operator=(const MoveItCpp&) = delete;
 
-  MoveItCpp(MoveItCpp&& other);
-  MoveItCpp& operator=(MoveItCpp&& other);
+  MoveItCpp(MoveItCpp&& other) = delete;
+  MoveItCpp& operator=(MoveItCpp&& other) = delete;
 
   /** \brief Destructor */
   ~MoveItCpp();
@@ -162,6 +172,21 @@ public:
   bool execute(const std::string& group_name, const robot_trajectory::RobotTrajectoryPtr& robot_trajectory,
                bool blocking = true);
 
+  /// Returns the instance of the planning pipeline with the given name owned by the calling planning thread, or
+  /// nullptr if there is no such pipeline
+  typedef std::function<planning_pipeline::PlanningPipelinePtr(const std::string& pipeline_name)>
+      PlanningPipelineLookupFn;
+
+  /// Task run by a planning thread. It is called with an empty PlanningPipelineLookupFn if it is dropped without
+  /// being run.
+  typedef std::function<void(const PlanningPipelineLookupFn& get_pipeline)> PlanningTask;
+
+  /** \brief Run a planning task in the background. Tasks are run in submission order by a bounded pool of
+   * planning_threads threads, which are started with the first task. Each thread plans with its own planning
+   * pipeline instances, so pipelines are never used by two tasks at the same time. Tasks still queued
+   * when this instance is destroyed are called with an empty lookup function. */
+  void submitPlanningTask(const PlanningTask& task);
+
 protected:
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
@@ -177,12 +202,31 @@ private:
   std::map<std::string, std::set<std::string>> groups_pipelines_map_;
   std::map<std::string, std::set<std::string>> groups_algorithms_map_;
 
+  // Background planning
+  unsigned int planning_thread_count_ = 1;
+  std::string planning_pipelines_namespace_;
+  std::vector<std::thread> planning_threads_;
+  std::deque<PlanningTask> planning_tasks_;
+  std::mutex planning_tasks_lock_;
+  std::condition_variable planning_tasks_condition_;
+  std::size_t idle_planning_threads_ = 0;
+  bool stop_planning_threads_ = false;
+
   // Execution
   trajectory_execution_manager::TrajectoryExecutionManagerPtr trajectory_execution_manager_;
 
   /** \brief Reset all member variables */
   void clearContents();
 
+  /** \brief Run queued planning tasks until the planning threads are stopped */
+  void planningThread();
+
+  /** \brief Drop all queued planning tasks and join the planning threads */
+  void stopPlanningThreads();
+
+  /** \brief Load a new instance of the planning pipeline with the given name, nullptr on failure */
+  planning_pipeline::PlanningPipelinePtr loadPlanningPipeline(const std::string& planning_pipeline_name) const;
+
   /** \brief Initialize and setup the planning scene monitor */
   bool loadPlanningSceneMonitor(const PlanningSceneMonitorOptions& options);
 
@@ -45,6 +45,9 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit_msgs/MoveItErrorCodes.h>
 
+#include <future>
+#include <mutex>
+
 namespace moveit
 {
 namespace planning_interface
@@ -114,6 +117,27 @@ public:
     double max_acceleration_scaling_factor;
   };
 
+  MOVEIT_CLASS_FORWARD(PlanningCancellationToken);
+
+  /// Allows cancelling a plan requested with planAsync()
+  class PlanningCancellationToken
+  {
+  public:
+    /** \brief Cancel the plan. A queued plan is not started, a running plan is terminated through the planning
+     * context that solves it. Cancelled plans report the error code PREEMPTED. */
+    void cancel();
+
+    /** \brief Check if cancel() has been called */
+    bool isCancelled() const;
+
+  private:
+    friend class PlanningComponent;
+
+    mutable std::mutex lock_;
+    bool cancelled_ = false;
+    ::planning_interface::PlanningContextPtr active_context_;
+  };
+
   /** \brief Constructor */
   PlanningComponent(const std::string& group_name, const ros::NodeHandle& nh);
   PlanningComponent(const std::string& group_name, const MoveItCppPtr& moveit_cpp);
@@ -177,10 +201,21 @@ public:
    * provided PlanRequestParameters. */
   PlanSolution plan(const PlanRequestParameters& parameters);
 
+  /** \brief Like plan(), but the plan is computed in the planning thread pool of MoveItCpp. The start state, goal and
+   * planning scene are captured before this function returns, so the next request can be set up while planning.
+   * The solution is not stored as last plan solution, pass it to execute(const PlanSolution&, bool) instead.
+   * Cancelling \e cancellation_token terminates only the planning context of this request. Plans that have not
+   * started when MoveItCpp is destroyed report PREEMPTED. */
+  std::future<PlanSolution> planAsync(const PlanRequestParameters& parameters,
+                                      const PlanningCancellationTokenPtr& cancellation_token = nullptr);
+
   /** \brief Execute the latest computed solution trajectory computed by plan(). By default this function terminates
    * after the execution is complete. The execution can be run in background by setting blocking to false. */
   bool execute(bool blocking = true);
 
+  /** \brief Execute the given solution, e.g. returned by planAsync() */
+  bool execute(const PlanSolution& solution, bool blocking = true);
+
   /** \brief Return the last plan solution*/
   const PlanSolutionPtr getLastPlanSolution();
 
@@ -213,6 +248,20 @@ private:
 
   /** \brief Reset all member variables */
   void clearContents();
+
+  /** \brief Capture the planning scene and fill the motion plan request for the current start state and goal.
+   * Returns SUCCESS or the reason the request can't be planned. */
+  MoveItErrorCode createPlanRequest(const PlanRequestParameters& parameters,
+                                    planning_scene::PlanningScenePtr& planning_scene,
+                                    ::planning_interface::MotionPlanRequest& req,
+                                    planning_pipeline::PlanningPipelinePtr& pipeline);
+
+  /** \brief Run a motion plan request created by createPlanRequest(). If \e planner is given, it allocates the
+   * planning contexts instead of the planner manager of \e pipeline. */
+  static PlanSolution solvePlanRequest(const planning_pipeline::PlanningPipelinePtr& pipeline,
+                                       const planning_scene::PlanningScenePtr& planning_scene,
+                                       const ::planning_interface::MotionPlanRequest& req,
+                                       const ::planning_interface::PlannerManagerPtr& planner = nullptr);
 };
 }  // namespace planning_interface
 }  // namespace moveit
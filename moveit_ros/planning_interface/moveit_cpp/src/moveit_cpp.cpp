@@ -34,6 +34,7 @@
 
 /* Author: Henning Kayser */
 
+#include <algorithm>
 #include <stdexcept>
 #include <moveit/moveit_cpp/moveit_cpp.h>
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
@@ -89,6 +90,7 @@ MoveItCpp::MoveItCpp(const Options& options, const ros::NodeHandle& /*unused*/,
     ROS_FATAL_STREAM_NAMED(LOGNAME, error);
     throw std::runtime_error(error);
   }
+  planning_thread_count_ = std::max(1, options.planning_pipeline_options.planning_threads);
 
   // TODO(henningkayser): configure trajectory execution manager
   trajectory_execution_manager_.reset(new trajectory_execution_manager::TrajectoryExecutionManager(
@@ -97,31 +99,13 @@ MoveItCpp::MoveItCpp(const Options& options, const ros::NodeHandle& /*unused*/,
   ROS_INFO_NAMED(LOGNAME, "MoveItCpp running");
 }
 
-MoveItCpp::MoveItCpp(MoveItCpp&& other)
-{
-  other.clearContents();
-}
-
 MoveItCpp::~MoveItCpp()
 {
   ROS_INFO_NAMED(LOGNAME, "Deleting MoveItCpp");
+  stopPlanningThreads();
   clearContents();
 }
 
-MoveItCpp& MoveItCpp::operator=(MoveItCpp&& other)
-{
-  if (this != &other)
-  {
-    this->node_handle_ = other.node_handle_;
-    this->tf_buffer_ = other.tf_buffer_;
-    this->robot_model_ = other.robot_model_;
-    this->planning_scene_monitor_ = other.planning_scene_monitor_;
-    other.clearContents();
-  }
-
-  return *this;
-}
-
 bool MoveItCpp::loadPlanningSceneMonitor(const PlanningSceneMonitorOptions& options)
 {
   planning_scene_monitor_.reset(
@@ -155,7 +139,7 @@ bool MoveItCpp::loadPlanningSceneMonitor(const PlanningSceneMonitorOptions& opti
 
 bool MoveItCpp::loadPlanningPipelines(const PlanningPipelineOptions& options)
 {
-  ros::NodeHandle node_handle(options.parent_namespace.empty() ? "~" : options.parent_namespace);
+  planning_pipelines_namespace_ = options.parent_namespace;
   for (const auto& planning_pipeline_name : options.pipeline_names)
   {
     if (planning_pipelines_.count(planning_pipeline_name) > 0)
@@ -163,17 +147,9 @@ bool MoveItCpp::loadPlanningPipelines(const PlanningPipelineOptions& options)
       ROS_WARN_NAMED(LOGNAME, "Skipping duplicate entry for planning pipeline '%s'.", planning_pipeline_name.c_str());
       continue;
     }
-    ROS_INFO_NAMED(LOGNAME, "Loading planning pipeline '%s'", planning_pipeline_name.c_str());
-    ros::NodeHandle child_nh(node_handle, planning_pipeline_name);
-    planning_pipeline::PlanningPipelinePtr pipeline;
-    pipeline.reset(new planning_pipeline::PlanningPipeline(robot_model_, child_nh, PLANNING_PLUGIN_PARAM));
-
-    if (!pipeline->getPlannerManager())
-    {
-      ROS_ERROR_NAMED(LOGNAME, "Failed to initialize planning pipeline '%s'.", planning_pipeline_name.c_str());
-      continue;
-    }
-    planning_pipelines_[planning_pipeline_name] = pipeline;
+    planning_pipeline::PlanningPipelinePtr pipeline = loadPlanningPipeline(planning_pipeline_name);
+    if (pipeline)
+      planning_pipelines_[planning_pipeline_name] = pipeline;
   }
 
   if (planning_pipelines_.empty())
@@ -312,6 +288,87 @@ bool MoveItCpp::execute(const std::string& group_name, const robot_trajectory::R
   return true;
 }
 
+planning_pipeline::PlanningPipelinePtr MoveItCpp::loadPlanningPipeline(const std::string& planning_pipeline_name) const
+{
+  ROS_INFO_NAMED(LOGNAME, "Loading planning pipeline '%s'", planning_pipeline_name.c_str());
+  ros::NodeHandle node_handle(planning_pipelines_namespace_.empty() ? "~" : planning_pipelines_namespace_);
+  ros::NodeHandle child_nh(node_handle, planning_pipeline_name);
+  planning_pipeline::PlanningPipelinePtr pipeline;
+  pipeline.reset(new planning_pipeline::PlanningPipeline(robot_model_, child_nh, PLANNING_PLUGIN_PARAM));
+
+  if (!pipeline->getPlannerManager())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Failed to initialize planning pipeline '%s'.", planning_pipeline_name.c_str());
+    return planning_pipeline::PlanningPipelinePtr();
+  }
+  return pipeline;
+}
+
+void MoveItCpp::submitPlanningTask(const PlanningTask& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(planning_tasks_lock_);
+    if (!stop_planning_threads_)
+    {
+      planning_tasks_.push_back(task);
+      // Start another thread if all running ones are busy
+      if (idle_planning_threads_ < planning_tasks_.size() && planning_threads_.size() < planning_thread_count_)
+        planning_threads_.emplace_back(&MoveItCpp::planningThread, this);
+      planning_tasks_condition_.notify_one();
+      return;
+    }
+  }
+  // This instance is shutting down, the task is dropped
+  task(PlanningPipelineLookupFn());
+}
+
+void MoveItCpp::planningThread()
+{
+  // Pipelines of this thread, loaded on first use. Terminating one of them only affects the plan of this thread.
+  std::map<std::string, planning_pipeline::PlanningPipelinePtr> pipelines;
+  PlanningPipelineLookupFn get_pipeline = [this, &pipelines](const std::string& pipeline_name) {
+    if (planning_pipelines_.count(pipeline_name) == 0)
+      return planning_pipeline::PlanningPipelinePtr();
+    planning_pipeline::PlanningPipelinePtr& pipeline = pipelines[pipeline_name];
+    if (!pipeline)
+      pipeline = loadPlanningPipeline(pipeline_name);
+    return pipeline;
+  };
+
+  std::unique_lock<std::mutex> lock(planning_tasks_lock_);
+  while (true)
+  {
+    ++idle_planning_threads_;
+    planning_tasks_condition_.wait(lock, [this] { return stop_planning_threads_ || !planning_tasks_.empty(); });
+    --idle_planning_threads_;
+    if (stop_planning_threads_)
+      return;
+    PlanningTask task = std::move(planning_tasks_.front());
+    planning_tasks_.pop_front();
+    lock.unlock();
+    task(get_pipeline);
+    lock.lock();
+  }
+}
+
+void MoveItCpp::stopPlanningThreads()
+{
+  std::deque<PlanningTask> dropped_tasks;
+  {
+    std::lock_guard<std::mutex> lock(planning_tasks_lock_);
+    stop_planning_threads_ = true;
+    dropped_tasks.swap(planning_tasks_);
+  }
+  planning_tasks_condition_.notify_all();
+  for (std::thread& planning_thread : planning_threads_)
+    planning_thread.join();
+  planning_threads_.clear();
+
+  // Let the dropped tasks report that they never ran
+  for (const PlanningTask& task : dropped_tasks)
+    task(PlanningPipelineLookupFn());
+}
+
 const std::shared_ptr<tf2_ros::Buffer>& MoveItCpp::getTFBuffer() const
 {
   return tf_buffer_;
@@ -70,6 +70,52 @@ namespace planning_interface
 {
 constexpr char LOGNAME[] = "planning_component";
 
+namespace
+{
+/// Planner manager that forwards to another planner manager and reports every planning context it allocates
+class PlanningContextObserver : public ::planning_interface::PlannerManager
+{
+public:
+  typedef std::function<void(const ::planning_interface::PlanningContextPtr& context)> ContextFn;
+
+  PlanningContextObserver(const ::planning_interface::PlannerManagerPtr& planner, const ContextFn& on_context)
+    : planner_(planner), on_context_(on_context)
+  {
+    config_settings_ = planner_->getPlannerConfigurations();
+  }
+
+  std::string getDescription() const override
+  {
+    return planner_->getDescription();
+  }
+
+  void getPlanningAlgorithms(std::vector<std::string>& algs) const override
+  {
+    planner_->getPlanningAlgorithms(algs);
+  }
+
+  ::planning_interface::PlanningContextPtr
+  getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                     const ::planning_interface::MotionPlanRequest& req,
+                     moveit_msgs::msg::MoveItErrorCodes& error_code) const override
+  {
+    ::planning_interface::PlanningContextPtr context = planner_->getPlanningContext(planning_scene, req, error_code);
+    if (context)
+      on_context_(context);
+    return context;
+  }
+
+  bool canServiceRequest(const ::planning_interface::MotionPlanRequest& req) const override
+  {
+    return planner_->canServiceRequest(req);
+  }
+
+private:
+  ::planning_interface::PlannerManagerPtr planner_;
+  ContextFn on_context_;
+};
+}  // namespace
+
 PlanningComponent::PlanningComponent(const std::string& group_name, const MoveItCppPtr& moveit_cpp)
   : nh_(moveit_cpp->getNodeHandle()), moveit_cpp_(moveit_cpp), group_name_(group_name)
 {
@@ -126,14 +172,14 @@ const std::string& PlanningComponent::getPlanningGroupName() const
   return group_name_;
 }
 
-PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParameters& parameters)
+PlanningComponent::MoveItErrorCode PlanningComponent::createPlanRequest(
+    const PlanRequestParameters& parameters, planning_scene::PlanningScenePtr& planning_scene,
+    ::planning_interface::MotionPlanRequest& req, planning_pipeline::PlanningPipelinePtr& pipeline)
 {
-  last_plan_solution_.reset(new PlanSolution());
   if (!joint_model_group_)
   {
     ROS_ERROR_NAMED(LOGNAME, "Failed to retrieve joint model group for name '%s'.", group_name_.c_str());
-    last_plan_solution_->error_code = MoveItErrorCode(moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME);
-    return *last_plan_solution_;
+    return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME);
   }
 
   // Clone current planning scene
@@ -141,13 +187,11 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
       moveit_cpp_->getPlanningSceneMonitorNonConst();
   planning_scene_monitor->updateFrameTransforms();
   planning_scene_monitor->lockSceneRead();  // LOCK planning scene
-  planning_scene::PlanningScenePtr planning_scene =
-      planning_scene::PlanningScene::clone(planning_scene_monitor->getPlanningScene());
+  planning_scene = planning_scene::PlanningScene::clone(planning_scene_monitor->getPlanningScene());
   planning_scene_monitor->unlockSceneRead();  // UNLOCK planning scene
   planning_scene_monitor.reset();             // release this pointer
 
   // Init MotionPlanRequest
-  ::planning_interface::MotionPlanRequest req;
   req.group_name = group_name_;
   req.planner_id = parameters.planner_id;
   req.allowed_planning_time = parameters.planning_time;
@@ -168,30 +212,58 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
   if (current_goal_constraints_.empty())
   {
     ROS_ERROR_NAMED(LOGNAME, "No goal constraints set for planning request");
-    last_plan_solution_->error_code = MoveItErrorCode(moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS);
-    return *last_plan_solution_;
+    return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS);
   }
   req.goal_constraints = current_goal_constraints_;
 
-  // Run planning attempt
-  ::planning_interface::MotionPlanResponse res;
   if (planning_pipeline_names_.find(parameters.planning_pipeline) == planning_pipeline_names_.end())
   {
     ROS_ERROR_NAMED(LOGNAME, "No planning pipeline available for name '%s'", parameters.planning_pipeline.c_str());
-    last_plan_solution_->error_code = MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
-    return *last_plan_solution_;
+    return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
+  }
+  pipeline = moveit_cpp_->getPlanningPipelines().at(parameters.planning_pipeline);
+  return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::SUCCESS);
+}
+
+PlanningComponent::PlanSolution
+PlanningComponent::solvePlanRequest(const planning_pipeline::PlanningPipelinePtr& pipeline,
+                                    const planning_scene::PlanningScenePtr& planning_scene,
+                                    const ::planning_interface::MotionPlanRequest& req,
+                                    const ::planning_interface::PlannerManagerPtr& planner)
+{
+  // Run planning attempt
+  PlanSolution solution;
+  ::planning_interface::MotionPlanResponse res;
+  if (planner)
+  {
+    std::vector<std::size_t> adapter_added_state_index;
+    pipeline->generatePlan(planning_scene, req, res, adapter_added_state_index, planner);
   }
-  const planning_pipeline::PlanningPipelinePtr pipeline =
-      moveit_cpp_->getPlanningPipelines().at(parameters.planning_pipeline);
-  pipeline->generatePlan(planning_scene, req, res);
-  last_plan_solution_->error_code = res.error_code_.val;
+  else
+    pipeline->generatePlan(planning_scene, req, res);
+  solution.error_code = res.error_code_.val;
   if (res.error_code_.val != res.error_code_.SUCCESS)
   {
     ROS_ERROR("Could not compute plan successfully");
-    return *last_plan_solution_;
+    return solution;
   }
-  last_plan_solution_->start_state = req.start_state;
-  last_plan_solution_->trajectory = res.trajectory_;
+  solution.start_state = req.start_state;
+  solution.trajectory = res.trajectory_;
+  return solution;
+}
+
+PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParameters& parameters)
+{
+  last_plan_solution_.reset(new PlanSolution());
+
+  planning_scene::PlanningScenePtr planning_scene;
+  ::planning_interface::MotionPlanRequest req;
+  planning_pipeline::PlanningPipelinePtr pipeline;
+  last_plan_solution_->error_code = createPlanRequest(parameters, planning_scene, req, pipeline);
+  if (!last_plan_solution_->error_code)
+    return *last_plan_solution_;
+
+  *last_plan_solution_ = solvePlanRequest(pipeline, planning_scene, req);
   // TODO(henningkayser): Visualize trajectory
   // std::vector<const moveit::core::LinkModel*> eef_links;
   // if (joint_model_group->getEndEffectorTips(eef_links))
@@ -207,6 +279,96 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
   return *last_plan_solution_;
 }
 
+std::future<PlanningComponent::PlanSolution>
+PlanningComponent::planAsync(const PlanRequestParameters& parameters,
+                             const PlanningCancellationTokenPtr& cancellation_token)
+{
+  auto promise = std::make_shared<std::promise<PlanSolution>>();
+  std::future<PlanSolution> future = promise->get_future();
+
+  auto planning_scene = std::make_shared<planning_scene::PlanningScenePtr>();
+  auto req = std::make_shared<::planning_interface::MotionPlanRequest>();
+  planning_pipeline::PlanningPipelinePtr pipeline;
+  PlanSolution solution;
+  solution.error_code = createPlanRequest(parameters, *planning_scene, *req, pipeline);
+  if (!solution.error_code)
+  {
+    promise->set_value(solution);
+    return future;
+  }
+
+  // The plan is computed with the pipeline instance of the planning thread, which computes no other plan meanwhile
+  const std::string pipeline_name = parameters.planning_pipeline;
+  moveit_cpp_->submitPlanningTask([promise, planning_scene, req, pipeline_name, cancellation_token](
+                                      const MoveItCpp::PlanningPipelineLookupFn& get_pipeline) {
+    PlanSolution preempted;
+    preempted.error_code = MoveItErrorCode(moveit_msgs::MoveItErrorCodes::PREEMPTED);
+    // Dropped without being run
+    if (!get_pipeline)
+    {
+      promise->set_value(preempted);
+      return;
+    }
+    planning_pipeline::PlanningPipelinePtr pipeline = get_pipeline(pipeline_name);
+    if (!pipeline)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Failed to load planning pipeline '%s' for asynchronous planning",
+                      pipeline_name.c_str());
+      PlanSolution failure;
+      failure.error_code = MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
+      promise->set_value(failure);
+      return;
+    }
+    ::planning_interface::PlannerManagerPtr planner;
+    if (cancellation_token)
+    {
+      {
+        std::lock_guard<std::mutex> lock(cancellation_token->lock_);
+        if (cancellation_token->cancelled_)
+        {
+          promise->set_value(preempted);
+          return;
+        }
+      }
+      // Only the context solving this request is terminated on cancel(), other contexts of the same planner keep
+      // running
+      planner = std::make_shared<PlanningContextObserver>(
+          pipeline->getPlannerManager(), [cancellation_token](const ::planning_interface::PlanningContextPtr& context) {
+            std::lock_guard<std::mutex> lock(cancellation_token->lock_);
+            cancellation_token->active_context_ = context;
+            if (cancellation_token->cancelled_)
+              context->terminate();
+          });
+    }
+
+    PlanSolution solution = solvePlanRequest(pipeline, *planning_scene, *req, planner);
+
+    if (cancellation_token)
+    {
+      std::lock_guard<std::mutex> lock(cancellation_token->lock_);
+      cancellation_token->active_context_.reset();
+      if (cancellation_token->cancelled_)
+        solution = preempted;
+    }
+    promise->set_value(solution);
+  });
+  return future;
+}
+
+void PlanningComponent::PlanningCancellationToken::cancel()
+{
+  std::lock_guard<std::mutex> lock(lock_);
+  cancelled_ = true;
+  if (active_context_)
+    active_context_->terminate();
+}
+
+bool PlanningComponent::PlanningCancellationToken::isCancelled() const
+{
+  std::lock_guard<std::mutex> lock(lock_);
+  return cancelled_;
+}
+
 PlanningComponent::PlanSolution PlanningComponent::plan()
 {
   PlanRequestParameters default_parameters;
@@ -331,6 +493,16 @@ bool PlanningComponent::execute(bool blocking)
   return moveit_cpp_->execute(group_name_, last_plan_solution_->trajectory, blocking);
 }
 
+bool PlanningComponent::execute(const PlanSolution& solution, bool blocking)
+{
+  if (!solution || !solution.trajectory)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "There is no successfull plan to execute");
+    return false;
+  }
+  return moveit_cpp_->execute(group_name_, solution.trajectory, blocking);
+}
+
 const PlanningComponent::PlanSolutionPtr PlanningComponent::getLastPlanSolution()
 {
   return last_plan_solution_;
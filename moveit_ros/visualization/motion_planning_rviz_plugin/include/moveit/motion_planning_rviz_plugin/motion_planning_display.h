@@ -208,6 +208,7 @@ protected:
 
   void executeMainLoopJobs();
   void publishInteractiveMarkers(bool pose_update);
+  void scheduleInteractiveMarkersUpdate(bool error_state_changed);
 
   void recomputeQueryStartStateMetrics();
   void recomputeQueryGoalStateMetrics();
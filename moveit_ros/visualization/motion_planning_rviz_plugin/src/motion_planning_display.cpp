@@ -903,13 +903,23 @@ void MotionPlanningDisplay::changedAttachedBodyColor()
   trajectory_visual_->setDefaultAttachedObjectColor(color);
 }
 
+void MotionPlanningDisplay::scheduleInteractiveMarkersUpdate(bool error_state_changed)
+{
+  // while dragging a marker, each pose update supersedes the ones still queued
+  if (error_state_changed)
+    addBackgroundJob(boost::bind(&MotionPlanningDisplay::publishInteractiveMarkers, this, false),
+                     "publishInteractiveMarkers");
+  else
+    addBackgroundJob(boost::bind(&MotionPlanningDisplay::publishInteractiveMarkers, this, true),
+                     "updateInteractiveMarkers", true);
+}
+
 void MotionPlanningDisplay::scheduleDrawQueryStartState(robot_interaction::InteractionHandler* /*unused*/,
                                                         bool error_state_changed)
 {
   if (!planning_scene_monitor_)
     return;
-  addBackgroundJob(boost::bind(&MotionPlanningDisplay::publishInteractiveMarkers, this, !error_state_changed),
-                   "publishInteractiveMarkers");
+  scheduleInteractiveMarkersUpdate(error_state_changed);
   updateQueryStartState();
 }
 
@@ -918,8 +928,7 @@ void MotionPlanningDisplay::scheduleDrawQueryGoalState(robot_interaction::Intera
 {
   if (!planning_scene_monitor_)
     return;
-  addBackgroundJob(boost::bind(&MotionPlanningDisplay::publishInteractiveMarkers, this, !error_state_changed),
-                   "publishInteractiveMarkers");
+  scheduleInteractiveMarkersUpdate(error_state_changed);
   updateQueryGoalState();
 }
 
@@ -84,8 +84,9 @@ public:
   void queueRenderSceneGeometry();
 
   /** Queue this function call for execution within the background thread
-      All jobs are queued and processed in order by a single background thread. */
-  void addBackgroundJob(const boost::function<void()>& job, const std::string& name);
+      All jobs are queued and processed in order by a single background thread.
+      If \e coalesce is true, queued jobs of the same name that did not start yet are dropped as superseded. */
+  void addBackgroundJob(const boost::function<void()>& job, const std::string& name, bool coalesce = false);
 
   /** Directly spawn a (detached) background thread for execution of this function call
       Should be used, when order of processing is not relevant / job can run in parallel.
@@ -213,9 +213,10 @@ void PlanningSceneDisplay::reset()
   }
 }
 
-void PlanningSceneDisplay::addBackgroundJob(const boost::function<void()>& job, const std::string& name)
+void PlanningSceneDisplay::addBackgroundJob(const boost::function<void()>& job, const std::string& name,
+                                            bool coalesce)
 {
-  background_process_.addJob(job, name);
+  background_process_.addJob(job, name, moveit::tools::BackgroundProcessing::DEFAULT_PRIORITY, coalesce);
 }
 
 void PlanningSceneDisplay::spawnBackgroundJob(const boost::function<void()>& job)
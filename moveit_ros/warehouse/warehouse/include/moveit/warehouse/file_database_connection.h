@@ -0,0 +1,80 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <warehouse_ros/database_connection.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace moveit_warehouse
+{
+class FileCollection;
+
+/** \brief An embedded warehouse_ros backend that keeps every collection in a single file, without a database server.
+
+    The warehouse_host parameter is used as the directory the databases are stored in; the port is ignored. Each
+    collection is an append-only file of serialized messages and their metadata. The metadata is loaded and indexed in
+    memory when the collection is opened, so lookups by name (or listing all names for a regex match) never touch the
+    messages, which are read from a memory mapping of the file on demand. Removed and modified messages stay in the
+    file as dead records. */
+class FileDatabaseConnection : public warehouse_ros::DatabaseConnection
+{
+public:
+  FileDatabaseConnection();
+  ~FileDatabaseConnection() override;
+
+  bool setParams(const std::string& host, unsigned port, float timeout) override;
+  bool setTimeout(float timeout) override;
+  bool connect() override;
+  bool isConnected() override;
+  void dropDatabase(const std::string& db_name) override;
+  std::string messageType(const std::string& db_name, const std::string& collection_name) override;
+
+protected:
+  warehouse_ros::MessageCollectionHelper::Ptr openCollectionHelper(const std::string& db_name,
+                                                                   const std::string& collection_name) override;
+
+private:
+  std::shared_ptr<FileCollection> getCollection(const std::string& db_name, const std::string& collection_name);
+
+  std::string root_directory_;
+  bool connected_;
+
+  // Collections are shared by all helpers opened for them, so that they see each other's changes
+  std::mutex collections_lock_;
+  std::map<std::string, std::shared_ptr<FileCollection>> collections_;
+};
+}  // namespace moveit_warehouse
@@ -0,0 +1,1067 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/warehouse/file_database_connection.h>
+#include <pluginlib/class_list_macros.hpp>
+#include <ros/console.h>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace moveit_warehouse
+{
+namespace
+{
+constexpr char LOGNAME[] = "file_database_connection";
+constexpr char FILE_MAGIC[] = "MOVEIT_WAREHOUSE_1";
+constexpr std::uint32_t RECORD_MAGIC = 0x4d565752;
+constexpr char FILE_EXTENSION[] = ".collection";
+
+/// A single metadata or query value
+struct Value
+{
+  enum Type : std::uint8_t
+  {
+    STRING,
+    DOUBLE,
+    INT,
+    BOOL
+  };
+  Type type = STRING;
+  std::string s;
+  double d = 0.0;
+
+  static Value fromString(const std::string& v)
+  {
+    Value value;
+    value.s = v;
+    return value;
+  }
+  static Value fromNumber(Type type, double v)
+  {
+    Value value;
+    value.type = type;
+    value.d = v;
+    return value;
+  }
+
+  /// Strings only compare to strings, numbers (including bools) to numbers
+  bool comparable(const Value& other) const
+  {
+    return (type == STRING) == (other.type == STRING);
+  }
+  int compare(const Value& other) const
+  {
+    if (type == STRING)
+      return s.compare(other.s);
+    return d < other.d ? -1 : (d > other.d ? 1 : 0);
+  }
+};
+
+class FileMetadata : public warehouse_ros::Metadata
+{
+public:
+  void append(const std::string& name, const std::string& val) override
+  {
+    fields_[name] = Value::fromString(val);
+  }
+  void append(const std::string& name, const double val) override
+  {
+    fields_[name] = Value::fromNumber(Value::DOUBLE, val);
+  }
+  void append(const std::string& name, const int val) override
+  {
+    fields_[name] = Value::fromNumber(Value::INT, val);
+  }
+  void append(const std::string& name, const bool val) override
+  {
+    fields_[name] = Value::fromNumber(Value::BOOL, val);
+  }
+
+  std::string lookupString(const std::string& name) const override
+  {
+    const Value* value = find(name);
+    return value && value->type == Value::STRING ? value->s : std::string();
+  }
+  double lookupDouble(const std::string& name) const override
+  {
+    const Value* value = find(name);
+    return value && value->type != Value::STRING ? value->d : 0.0;
+  }
+  int lookupInt(const std::string& name) const override
+  {
+    return static_cast<int>(lookupDouble(name));
+  }
+  bool lookupBool(const std::string& name) const override
+  {
+    return lookupDouble(name) != 0.0;
+  }
+  bool lookupField(const std::string& name) const override
+  {
+    return fields_.count(name) > 0;
+  }
+  std::set<std::string> lookupFieldNames() const override
+  {
+    std::set<std::string> names;
+    for (const std::pair<const std::string, Value>& field : fields_)
+      names.insert(field.first);
+    return names;
+  }
+
+  const Value* find(const std::string& name) const
+  {
+    auto it = fields_.find(name);
+    return it == fields_.end() ? nullptr : &it->second;
+  }
+
+  std::map<std::string, Value> fields_;
+};
+
+class FileQuery : public warehouse_ros::Query
+{
+public:
+  enum Operator
+  {
+    EQ,
+    LT,
+    LTE,
+    GT,
+    GTE
+  };
+
+  struct Condition
+  {
+    std::string field;
+    Operator op;
+    Value value;
+  };
+
+  void append(const std::string& name, const std::string& val) override
+  {
+    conditions_.push_back({ name, EQ, Value::fromString(val) });
+  }
+  void append(const std::string& name, const double val) override
+  {
+    conditions_.push_back({ name, EQ, Value::fromNumber(Value::DOUBLE, val) });
+  }
+  void append(const std::string& name, const int val) override
+  {
+    conditions_.push_back({ name, EQ, Value::fromNumber(Value::INT, val) });
+  }
+  void append(const std::string& name, const bool val) override
+  {
+    conditions_.push_back({ name, EQ, Value::fromNumber(Value::BOOL, val) });
+  }
+  void appendLT(const std::string& name, const double val) override
+  {
+    conditions_.push_back({ name, LT, Value::fromNumber(Value::DOUBLE, val) });
+  }
+  void appendLT(const std::string& name, const int val) override
+  {
+    conditions_.push_back({ name, LT, Value::fromNumber(Value::INT, val) });
+  }
+  void appendLTE(const std::string& name, const double val) override
+  {
+    conditions_.push_back({ name, LTE, Value::fromNumber(Value::DOUBLE, val) });
+  }
+  void appendLTE(const std::string& name, const int val) override
+  {
+    conditions_.push_back({ name, LTE, Value::fromNumber(Value::INT, val) });
+  }
+  void appendGT(const std::string& name, const double val) override
+  {
+    conditions_.push_back({ name, GT, Value::fromNumber(Value::DOUBLE, val) });
+  }
+  void appendGT(const std::string& name, const int val) override
+  {
+    conditions_.push_back({ name, GT, Value::fromNumber(Value::INT, val) });
+  }
+  void appendGTE(const std::string& name, const double val) override
+  {
+    conditions_.push_back({ name, GTE, Value::fromNumber(Value::DOUBLE, val) });
+  }
+  void appendGTE(const std::string& name, const int val) override
+  {
+    conditions_.push_back({ name, GTE, Value::fromNumber(Value::INT, val) });
+  }
+  void appendRange(const std::string& name, const double lower, const double upper) override
+  {
+    appendGT(name, lower);
+    appendLT(name, upper);
+  }
+  void appendRange(const std::string& name, const int lower, const int upper) override
+  {
+    appendGT(name, lower);
+    appendLT(name, upper);
+  }
+  void appendRangeInclusive(const std::string& name, const double lower, const double upper) override
+  {
+    appendGTE(name, lower);
+    appendLTE(name, upper);
+  }
+  void appendRangeInclusive(const std::string& name, const int lower, const int upper) override
+  {
+    appendGTE(name, lower);
+    appendLTE(name, upper);
+  }
+
+  bool matches(const FileMetadata& metadata) const
+  {
+    for (const Condition& condition : conditions_)
+    {
+      const Value* value = metadata.find(condition.field);
+      if (!value || !value->comparable(condition.value))
+        return false;
+      int c = value->compare(condition.value);
+      bool ok = false;
+      switch (condition.op)
+      {
+        case EQ:
+          ok = c == 0;
+          break;
+        case LT:
+          ok = c < 0;
+          break;
+        case LTE:
+          ok = c <= 0;
+          break;
+        case GT:
+          ok = c > 0;
+          break;
+        case GTE:
+          ok = c >= 0;
+          break;
+      }
+      if (!ok)
+        return false;
+    }
+    return true;
+  }
+
+  std::vector<Condition> conditions_;
+};
+
+std::string indexKey(const std::string& field, const std::string& value)
+{
+  std::string key = field;
+  key.push_back('\0');
+  key += value;
+  return key;
+}
+
+void writeString(std::string& out, const std::string& s)
+{
+  std::uint32_t size = s.size();
+  out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  out += s;
+}
+
+template <typename T>
+bool read(const char*& data, const char* end, T& value)
+{
+  if (end - data < static_cast<std::ptrdiff_t>(sizeof(T)))
+    return false;
+  std::memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return true;
+}
+
+bool readString(const char*& data, const char* end, std::string& s)
+{
+  std::uint32_t size;
+  if (!read(data, end, size) || end - data < static_cast<std::ptrdiff_t>(size))
+    return false;
+  s.assign(data, size);
+  data += size;
+  return true;
+}
+
+std::string serializeMetadata(const FileMetadata& metadata)
+{
+  std::string out;
+  std::uint32_t count = metadata.fields_.size();
+  out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (const std::pair<const std::string, Value>& field : metadata.fields_)
+  {
+    writeString(out, field.first);
+    out.push_back(static_cast<char>(field.second.type));
+    if (field.second.type == Value::STRING)
+      writeString(out, field.second.s);
+    else
+      out.append(reinterpret_cast<const char*>(&field.second.d), sizeof(double));
+  }
+  return out;
+}
+
+bool deserializeMetadata(const char* data, const char* end, FileMetadata& metadata)
+{
+  std::uint32_t count;
+  if (!read(data, end, count))
+    return false;
+  for (std::uint32_t i = 0; i < count; ++i)
+  {
+    std::string name;
+    std::uint8_t type;
+    if (!readString(data, end, name) || !read(data, end, type) || type > Value::BOOL)
+      return false;
+    Value& value = metadata.fields_[name];
+    value.type = static_cast<Value::Type>(type);
+    if (value.type == Value::STRING ? !readString(data, end, value.s) : !read(data, end, value.d))
+      return false;
+  }
+  return true;
+}
+
+/// Fixed size part of a record, followed by the serialized metadata and the message
+struct RecordHeader
+{
+  std::uint32_t magic;
+  std::uint32_t deleted;
+  std::uint32_t metadata_size;
+  std::uint32_t message_size;
+};
+
+/// Advisory lock of a whole collection file. It serializes the writers of all processes using the file: they hold it
+/// exclusively while appending or modifying records, readers hold it shared while loading.
+class FileLock
+{
+public:
+  FileLock(int fd, int operation) : fd_(fd)
+  {
+    int result;
+    while ((result = flock(fd_, operation)) != 0 && errno == EINTR)
+      ;
+    if (result != 0)
+    {
+      ROS_WARN_NAMED(LOGNAME, "Unable to lock collection file: %s", strerror(errno));
+      fd_ = -1;
+    }
+  }
+
+  ~FileLock()
+  {
+    if (fd_ >= 0)
+      flock(fd_, LOCK_UN);
+  }
+
+private:
+  int fd_;
+};
+}  // namespace
+
+/** \brief The records of one collection file. All access is serialized by the collection's lock, writes to the file
+    are serialized with other processes by a FileLock. Records appended or deleted by other processes are loaded
+    before each query and write. */
+class FileCollection
+{
+public:
+  struct Record
+  {
+    std::uint64_t offset;  // of the RecordHeader
+    std::uint64_t message_offset;
+    std::uint32_t message_size;
+    std::shared_ptr<FileMetadata> metadata;
+    bool live;
+  };
+
+  FileCollection(std::string path) : path_(std::move(path))
+  {
+  }
+
+  ~FileCollection()
+  {
+    close();
+  }
+
+  /// Open the collection file, creating it for \e datatype if it does not exist yet. An empty \e datatype opens the
+  /// file for reading only, e.g. to look up its message type.
+  bool open(const std::string& datatype, const std::string& md5)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (fd_ >= 0)
+    {
+      if (datatype.empty())
+        return true;
+      if (datatype != datatype_ || md5 != md5_)
+        return false;
+      if (!incomplete_tail_)
+        return true;
+      // A reader left an incomplete record at the end of the file, load it again as writer to remove it
+      close();
+    }
+
+    const bool writer = !datatype.empty();
+    if (!writer && !boost::filesystem::exists(path_))
+      return false;
+    fd_ = ::open(path_.c_str(), O_RDWR | (writer ? O_CREAT : 0), 0644);
+    if (fd_ < 0)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unable to open collection file '%s': %s", path_.c_str(), strerror(errno));
+      return false;
+    }
+
+    FileLock file_lock(fd_, writer ? LOCK_EX : LOCK_SH);
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+    {
+      close();
+      return false;
+    }
+    if (st.st_size == 0)
+    {
+      // A new file, or one whose creator did not write the header yet
+      if (!writer)
+      {
+        close();
+        return false;
+      }
+      datatype_ = datatype;
+      md5_ = md5;
+      std::string header(FILE_MAGIC);
+      writeString(header, datatype_);
+      writeString(header, md5_);
+      std::uint64_t offset;
+      if (!append(header, offset))
+        return false;
+      loaded_size_ = file_size_;
+      rememberModificationTime();
+      return true;
+    }
+
+    if (!load(writer))
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Collection file '%s' is corrupted", path_.c_str());
+      close();
+      return false;
+    }
+    if (!datatype.empty() && (datatype != datatype_ || md5 != md5_))
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Collection file '%s' stores messages of type %s (md5 %s), not %s (md5 %s)",
+                      path_.c_str(), datatype_.c_str(), md5_.c_str(), datatype.c_str(), md5.c_str());
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close()
+  {
+    if (mapping_)
+      munmap(mapping_, mapped_size_);
+    mapping_ = nullptr;
+    mapped_size_ = 0;
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+    file_size_ = 0;
+    loaded_size_ = 0;
+    modification_time_ = timespec();
+    modification_time_settled_ = false;
+    records_.clear();
+    index_.clear();
+    live_count_ = 0;
+    incomplete_tail_ = false;
+  }
+
+  std::string datatype()
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    return datatype_;
+  }
+
+  bool insert(const char* msg, std::size_t msg_size, const FileMetadata& metadata)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    return insertRecord(msg, msg_size, metadata);
+  }
+
+  /// Indices of the live records matching \e query, sorted by the field \e sort_by if not empty
+  std::vector<std::size_t> query(const FileQuery& query, const std::string& sort_by, bool ascending)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    refresh();
+    std::vector<std::size_t> result;
+
+    // Use the index of the first string equality condition to limit the candidates
+    auto condition =
+        std::find_if(query.conditions_.begin(), query.conditions_.end(), [](const FileQuery::Condition& c) {
+          return c.op == FileQuery::EQ && c.value.type == Value::STRING;
+        });
+    if (condition != query.conditions_.end())
+    {
+      auto range = index_.equal_range(indexKey(condition->field, condition->value.s));
+      for (auto it = range.first; it != range.second; ++it)
+        if (records_[it->second].live && query.matches(*records_[it->second].metadata))
+          result.push_back(it->second);
+      std::sort(result.begin(), result.end());
+    }
+    else
+    {
+      for (std::size_t i = 0; i < records_.size(); ++i)
+        if (records_[i].live && query.matches(*records_[i].metadata))
+          result.push_back(i);
+    }
+
+    if (!sort_by.empty())
+      std::stable_sort(result.begin(), result.end(), [&](std::size_t a, std::size_t b) {
+        const Value* va = records_[a].metadata->find(sort_by);
+        const Value* vb = records_[b].metadata->find(sort_by);
+        if (!va || !vb || !va->comparable(*vb))
+          return ascending ? (!va && vb) : (va && !vb);
+        return ascending ? va->compare(*vb) < 0 : va->compare(*vb) > 0;
+      });
+    return result;
+  }
+
+  std::shared_ptr<FileMetadata> metadata(std::size_t index)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    return index < records_.size() ? records_[index].metadata : std::shared_ptr<FileMetadata>();
+  }
+
+  std::string message(std::size_t index)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (index >= records_.size() || !map())
+      return std::string();
+    return std::string(mapping_ + records_[index].message_offset, records_[index].message_size);
+  }
+
+  unsigned remove(const std::vector<std::size_t>& indices)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    unsigned removed = 0;
+    for (std::size_t index : indices)
+      if (markDeleted(index))
+        ++removed;
+    return removed;
+  }
+
+  /// Replace the records with copies that have the fields of \e update set in their metadata
+  void modify(const std::vector<std::size_t>& indices, const FileMetadata& update)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!map())
+      return;
+    for (std::size_t index : indices)
+    {
+      if (index >= records_.size() || !records_[index].live)
+        continue;
+      FileMetadata metadata = *records_[index].metadata;
+      for (const std::pair<const std::string, Value>& field : update.fields_)
+        metadata.fields_[field.first] = field.second;
+      // insertRecord() may remap the file, so copy the message first
+      std::string message(mapping_ + records_[index].message_offset, records_[index].message_size);
+      if (insertRecord(message.data(), message.size(), metadata))
+        markDeleted(index);
+    }
+  }
+
+  unsigned count()
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    refresh();
+    return live_count_;
+  }
+
+private:
+  /// Append \e data at the end of the file, returning where it was written in \e offset. Other processes may have
+  /// appended records since the file was loaded, so the caller needs to hold the exclusive file lock.
+  bool append(const std::string& data, std::uint64_t& offset)
+  {
+    off_t end = lseek(fd_, 0, SEEK_END);
+    if (end < 0 || ::write(fd_, data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unable to write to collection file '%s': %s", path_.c_str(), strerror(errno));
+      return false;
+    }
+    offset = end;
+    file_size_ = offset + data.size();
+    return true;
+  }
+
+  /// Map the whole file, if it grew since it was mapped
+  bool map()
+  {
+    if (mapping_ && mapped_size_ == file_size_)
+      return true;
+    if (mapping_)
+      munmap(mapping_, mapped_size_);
+    mapping_ = nullptr;
+    mapped_size_ = 0;
+    if (fd_ < 0 || file_size_ == 0)
+      return false;
+    void* mapping = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unable to map collection file '%s': %s", path_.c_str(), strerror(errno));
+      return false;
+    }
+    mapping_ = static_cast<char*>(mapping);
+    mapped_size_ = file_size_;
+    return true;
+  }
+
+  /// Load and index the records of the file. The caller holds the file lock, exclusively if \e writer.
+  bool load(bool writer)
+  {
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+      return false;
+    file_size_ = st.st_size;
+    if (!map())
+      return false;
+
+    const char* data = mapping_;
+    const char* end = mapping_ + mapped_size_;
+    std::size_t magic_size = std::strlen(FILE_MAGIC);
+    if (end - data < static_cast<std::ptrdiff_t>(magic_size) || std::memcmp(data, FILE_MAGIC, magic_size) != 0)
+      return false;
+    data += magic_size;
+    if (!readString(data, end, datatype_) || !readString(data, end, md5_))
+      return false;
+    loaded_size_ = data - mapping_;
+    rememberModificationTime();
+    return loadRecords(writer);
+  }
+
+  /// Load the changes other processes made to the file since it was loaded, holding the shared file lock
+  void refresh()
+  {
+    if (fd_ < 0)
+      return;
+    FileLock file_lock(fd_, LOCK_SH);
+    if (!sync(false))
+      ROS_ERROR_NAMED(LOGNAME, "Unable to reload collection file '%s'", path_.c_str());
+  }
+
+  /// Load the records appended and the deletions made by other processes, if the size or modification time of the
+  /// file changed since it was loaded. The caller holds the file lock, exclusively if \e writer.
+  bool sync(bool writer)
+  {
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+      return false;
+    if (static_cast<std::uint64_t>(st.st_size) == file_size_ && modification_time_settled_ &&
+        st.st_mtim.tv_sec == modification_time_.tv_sec && st.st_mtim.tv_nsec == modification_time_.tv_nsec &&
+        !(writer && incomplete_tail_))
+      return true;
+    if (static_cast<std::uint64_t>(st.st_size) < loaded_size_)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Collection file '%s' was truncated", path_.c_str());
+      return false;
+    }
+    file_size_ = st.st_size;
+    if (!map())
+      return false;
+    // Records are never modified except for their deleted flag, so their indices stay valid
+    for (std::size_t i = 0; i < records_.size(); ++i)
+    {
+      if (!records_[i].live)
+        continue;
+      RecordHeader header;
+      std::memcpy(&header, mapping_ + records_[i].offset, sizeof(header));
+      if (header.deleted != 0)
+        forget(i);
+    }
+    rememberModificationTime();
+    return loadRecords(writer);
+  }
+
+  /// Load the records following the ones loaded already. The caller holds the file lock, exclusively if \e writer.
+  bool loadRecords(bool writer)
+  {
+    const char* data = mapping_ + loaded_size_;
+    const char* end = mapping_ + mapped_size_;
+    while (data < end)
+    {
+      const char* record_begin = data;
+      RecordHeader header;
+      bool complete = read(data, end, header);
+      if (complete && header.magic != RECORD_MAGIC)
+      {
+        ROS_ERROR_NAMED(LOGNAME, "Invalid record at offset %zu of '%s'",
+                        static_cast<std::size_t>(record_begin - mapping_), path_.c_str());
+        return false;
+      }
+      if (!complete || end - data < static_cast<std::ptrdiff_t>(header.metadata_size) + header.message_size)
+        return dropIncompleteRecord(record_begin - mapping_, writer);
+      Record record;
+      record.offset = record_begin - mapping_;
+      record.metadata = std::make_shared<FileMetadata>();
+      if (!deserializeMetadata(data, data + header.metadata_size, *record.metadata))
+      {
+        ROS_ERROR_NAMED(LOGNAME, "Invalid metadata in the record at offset %zu of '%s'",
+                        static_cast<std::size_t>(record.offset), path_.c_str());
+        return false;
+      }
+      record.message_offset = (data - mapping_) + header.metadata_size;
+      record.message_size = header.message_size;
+      record.live = header.deleted == 0;
+      data += header.metadata_size + header.message_size;
+      addRecord(record);
+      loaded_size_ = data - mapping_;
+    }
+    return true;
+  }
+
+  void rememberModificationTime()
+  {
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+      return;
+    modification_time_ = st.st_mtim;
+    // File systems update the modification time with a coarse granularity, so a record deleted shortly after this
+    // call may leave it unchanged. Only rely on times that are older than that.
+    modification_time_settled_ = st.st_mtim.tv_sec + 1 < time(nullptr);
+  }
+
+  /// Handle the record at \e offset, which runs past the end of the file. Writers complete their records while
+  /// holding the exclusive file lock, so it was left by a writer that died. Only a writer, which holds that lock
+  /// itself, removes it; readers ignore it.
+  bool dropIncompleteRecord(std::uint64_t offset, bool writer)
+  {
+    if (!writer)
+    {
+      ROS_WARN_NAMED(LOGNAME, "Ignoring incomplete record at the end of '%s'", path_.c_str());
+      incomplete_tail_ = true;
+      return true;
+    }
+    ROS_WARN_NAMED(LOGNAME, "Removing incomplete record at the end of '%s'", path_.c_str());
+    file_size_ = offset;
+    if (ftruncate(fd_, file_size_) != 0)
+      return false;
+    incomplete_tail_ = false;
+    rememberModificationTime();
+    return map();
+  }
+
+  void addRecord(const Record& record)
+  {
+    records_.push_back(record);
+    if (!record.live)
+      return;
+    ++live_count_;
+    for (const std::pair<const std::string, Value>& field : record.metadata->fields_)
+      if (field.second.type == Value::STRING)
+        index_.emplace(indexKey(field.first, field.second.s), records_.size() - 1);
+  }
+
+  bool insertRecord(const char* msg, std::size_t msg_size, const FileMetadata& metadata)
+  {
+    if (fd_ < 0)
+      return false;
+    std::string serialized_metadata = serializeMetadata(metadata);
+    RecordHeader header{ RECORD_MAGIC, 0, static_cast<std::uint32_t>(serialized_metadata.size()),
+                         static_cast<std::uint32_t>(msg_size) };
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data += serialized_metadata;
+    data.append(msg, msg_size);
+
+    // Load the records of other processes first, so records_ stays in file order
+    FileLock file_lock(fd_, LOCK_EX);
+    std::uint64_t offset;
+    if (!sync(true) || !append(data, offset))
+      return false;
+    loaded_size_ = file_size_;
+    rememberModificationTime();
+    Record record;
+    record.offset = offset;
+    record.message_offset = offset + sizeof(header) + serialized_metadata.size();
+    record.message_size = msg_size;
+    record.metadata = std::make_shared<FileMetadata>(metadata);
+    record.live = true;
+    addRecord(record);
+    return true;
+  }
+
+  bool markDeleted(std::size_t index)
+  {
+    if (index >= records_.size() || !records_[index].live || fd_ < 0)
+      return false;
+    const std::uint32_t deleted = 1;
+    FileLock file_lock(fd_, LOCK_EX);
+    // Another process may have deleted the record already
+    if (!sync(true) || !records_[index].live)
+      return false;
+    if (pwrite(fd_, &deleted, sizeof(deleted), records_[index].offset + offsetof(RecordHeader, deleted)) !=
+        sizeof(deleted))
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unable to write to collection file '%s': %s", path_.c_str(), strerror(errno));
+      return false;
+    }
+    rememberModificationTime();
+    forget(index);
+    return true;
+  }
+
+  /// Remove the deleted record \e index from the index of live records
+  void forget(std::size_t index)
+  {
+    records_[index].live = false;
+    --live_count_;
+    for (const std::pair<const std::string, Value>& field : records_[index].metadata->fields_)
+      if (field.second.type == Value::STRING)
+      {
+        auto range = index_.equal_range(indexKey(field.first, field.second.s));
+        for (auto it = range.first; it != range.second; ++it)
+          if (it->second == index)
+          {
+            index_.erase(it);
+            break;
+          }
+      }
+  }
+
+  std::string path_;
+  std::mutex lock_;
+  int fd_ = -1;
+  std::uint64_t file_size_ = 0;
+  // end of the last record loaded, and the modification time of the file when it was loaded
+  std::uint64_t loaded_size_ = 0;
+  timespec modification_time_ = timespec();
+  bool modification_time_settled_ = false;
+  bool incomplete_tail_ = false;
+  char* mapping_ = nullptr;
+  std::size_t mapped_size_ = 0;
+
+  std::string datatype_;
+  std::string md5_;
+  std::vector<Record> records_;
+  unsigned live_count_ = 0;
+  // field name and string value -> record index
+  std::unordered_multimap<std::string, std::size_t> index_;
+};
+
+namespace
+{
+class FileResultIterator : public warehouse_ros::ResultIteratorHelper
+{
+public:
+  FileResultIterator(std::shared_ptr<FileCollection> collection, std::vector<std::size_t> records)
+    : collection_(std::move(collection)), records_(std::move(records))
+  {
+  }
+
+  bool next() override
+  {
+    if (position_ < records_.size())
+      ++position_;
+    return hasData();
+  }
+
+  bool hasData() const override
+  {
+    return position_ < records_.size();
+  }
+
+  warehouse_ros::Metadata::ConstPtr metadata() const override
+  {
+    // warehouse_ros expects its own (boost) pointer type, so the shared metadata is copied
+    std::shared_ptr<FileMetadata> metadata = collection_->metadata(records_[position_]);
+    return warehouse_ros::Metadata::ConstPtr(metadata ? new FileMetadata(*metadata) : new FileMetadata());
+  }
+
+  std::string message() const override
+  {
+    return collection_->message(records_[position_]);
+  }
+
+private:
+  std::shared_ptr<FileCollection> collection_;
+  std::vector<std::size_t> records_;
+  std::size_t position_ = 0;
+};
+
+class FileMessageCollectionHelper : public warehouse_ros::MessageCollectionHelper
+{
+public:
+  FileMessageCollectionHelper(std::shared_ptr<FileCollection> collection, std::string name)
+    : collection_(std::move(collection)), name_(std::move(name))
+  {
+  }
+
+  bool initialize(const std::string& datatype, const std::string& md5) override
+  {
+    return collection_->open(datatype, md5);
+  }
+
+  void insert(char* msg, size_t msg_size, warehouse_ros::Metadata::ConstPtr metadata) override
+  {
+    const FileMetadata* file_metadata = dynamic_cast<const FileMetadata*>(metadata.get());
+    if (!file_metadata || !collection_->insert(msg, msg_size, *file_metadata))
+      ROS_ERROR_NAMED(LOGNAME, "Failed to insert message into collection '%s'", name_.c_str());
+  }
+
+  warehouse_ros::ResultIteratorHelper::Ptr query(warehouse_ros::Query::ConstPtr query, const std::string& sort_by,
+                                                 bool ascending) const override
+  {
+    return warehouse_ros::ResultIteratorHelper::Ptr(
+        new FileResultIterator(collection_, collection_->query(toFileQuery(query), sort_by, ascending)));
+  }
+
+  unsigned removeMessages(warehouse_ros::Query::ConstPtr query) override
+  {
+    return collection_->remove(collection_->query(toFileQuery(query), "", true));
+  }
+
+  void modifyMetadata(warehouse_ros::Query::ConstPtr query, warehouse_ros::Metadata::ConstPtr metadata) override
+  {
+    const FileMetadata* file_metadata = dynamic_cast<const FileMetadata*>(metadata.get());
+    if (file_metadata)
+      collection_->modify(collection_->query(toFileQuery(query), "", true), *file_metadata);
+  }
+
+  unsigned count() override
+  {
+    return collection_->count();
+  }
+
+  warehouse_ros::Query::Ptr createQuery() const override
+  {
+    return warehouse_ros::Query::Ptr(new FileQuery());
+  }
+
+  warehouse_ros::Metadata::Ptr createMetadata() const override
+  {
+    return warehouse_ros::Metadata::Ptr(new FileMetadata());
+  }
+
+  std::string collectionName() const override
+  {
+    return name_;
+  }
+
+private:
+  static const FileQuery& toFileQuery(const warehouse_ros::Query::ConstPtr& query)
+  {
+    static const FileQuery MATCH_ALL;
+    const FileQuery* file_query = dynamic_cast<const FileQuery*>(query.get());
+    return file_query ? *file_query : MATCH_ALL;
+  }
+
+  std::shared_ptr<FileCollection> collection_;
+  std::string name_;
+};
+}  // namespace
+
+FileDatabaseConnection::FileDatabaseConnection() : connected_(false)
+{
+}
+
+FileDatabaseConnection::~FileDatabaseConnection() = default;
+
+bool FileDatabaseConnection::setParams(const std::string& host, unsigned /*port*/, float /*timeout*/)
+{
+  root_directory_ = host;
+  return true;
+}
+
+bool FileDatabaseConnection::setTimeout(float /*timeout*/)
+{
+  return true;
+}
+
+bool FileDatabaseConnection::connect()
+{
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(root_directory_, ec);
+  connected_ = !ec && boost::filesystem::is_directory(root_directory_);
+  if (!connected_)
+    ROS_ERROR_NAMED(LOGNAME, "Unable to use '%s' as warehouse directory", root_directory_.c_str());
+  return connected_;
+}
+
+bool FileDatabaseConnection::isConnected()
+{
+  return connected_;
+}
+
+void FileDatabaseConnection::dropDatabase(const std::string& db_name)
+{
+  {
+    std::lock_guard<std::mutex> lock(collections_lock_);
+    const std::string prefix = db_name + "/";
+    for (auto it = collections_.begin(); it != collections_.end();)
+    {
+      if (it->first.compare(0, prefix.size(), prefix) == 0)
+        it = collections_.erase(it);
+      else
+        ++it;
+    }
+  }
+  boost::system::error_code ec;
+  boost::filesystem::remove_all(boost::filesystem::path(root_directory_) / db_name, ec);
+}
+
+std::string FileDatabaseConnection::messageType(const std::string& db_name, const std::string& collection_name)
+{
+  std::shared_ptr<FileCollection> collection = getCollection(db_name, collection_name);
+  return collection->open("", "") ? collection->datatype() : std::string();
+}
+
+warehouse_ros::MessageCollectionHelper::Ptr
+FileDatabaseConnection::openCollectionHelper(const std::string& db_name, const std::string& collection_name)
+{
+  return warehouse_ros::MessageCollectionHelper::Ptr(
+      new FileMessageCollectionHelper(getCollection(db_name, collection_name), collection_name));
+}
+
+std::shared_ptr<FileCollection> FileDatabaseConnection::getCollection(const std::string& db_name,
+                                                                      const std::string& collection_name)
+{
+  std::lock_guard<std::mutex> lock(collections_lock_);
+  std::shared_ptr<FileCollection>& collection = collections_[db_name + "/" + collection_name];
+  if (!collection)
+  {
+    boost::filesystem::path directory = boost::filesystem::path(root_directory_) / db_name;
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(directory, ec);
+    collection = std::make_shared<FileCollection>((directory / (collection_name + FILE_EXTENSION)).string());
+  }
+  return collection;
+}
+}  // namespace moveit_warehouse
+
+PLUGINLIB_EXPORT_CLASS(moveit_warehouse::FileDatabaseConnection, warehouse_ros::DatabaseConnection)
@@ -0,0 +1,197 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Open Robotics
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/warehouse/file_database_connection.h>
+#include <moveit/warehouse/constraints_storage.h>
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+#include <fstream>
+
+using moveit_warehouse::ConstraintsCollection;
+using moveit_warehouse::ConstraintsWithMetadata;
+
+static const std::string DATABASE = "test_db";
+static const std::string COLLECTION = "constraints";
+
+class FileDatabaseConnectionTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    directory_ = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+  }
+
+  void TearDown() override
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(directory_, ec);
+  }
+
+  warehouse_ros::DatabaseConnection::Ptr connect() const
+  {
+    warehouse_ros::DatabaseConnection::Ptr conn(new moveit_warehouse::FileDatabaseConnection());
+    conn->setParams(directory_, 0, 0.0);
+    EXPECT_TRUE(conn->connect());
+    return conn;
+  }
+
+  static ConstraintsCollection open(const warehouse_ros::DatabaseConnection::Ptr& conn)
+  {
+    return conn->openCollectionPtr<moveit_msgs::msg::Constraints>(DATABASE, COLLECTION);
+  }
+
+  static void insert(const ConstraintsCollection& collection, const std::string& name)
+  {
+    moveit_msgs::msg::Constraints msg;
+    msg.name = name;
+    warehouse_ros::Metadata::Ptr metadata = collection->createMetadata();
+    metadata->append("name", name);
+    collection->insert(msg, metadata);
+  }
+
+  /// Names stored in the messages whose metadata has the given name
+  static std::vector<std::string> find(const ConstraintsCollection& collection, const std::string& name)
+  {
+    warehouse_ros::Query::Ptr query = collection->createQuery();
+    query->append("name", name);
+    std::vector<std::string> names;
+    for (const ConstraintsWithMetadata& msg : collection->queryList(query, false))
+      names.push_back(msg->name);
+    return names;
+  }
+
+  std::string path() const
+  {
+    return (boost::filesystem::path(directory_) / DATABASE / (COLLECTION + ".collection")).string();
+  }
+
+  std::uintmax_t fileSize() const
+  {
+    return boost::filesystem::file_size(path());
+  }
+
+  void appendToFile(const std::string& bytes) const
+  {
+    std::ofstream out(path(), std::ios::binary | std::ios::app);
+    out << bytes;
+  }
+
+  std::string directory_;
+};
+
+TEST_F(FileDatabaseConnectionTest, WritersAppendAtTheEndOfTheFile)
+{
+  // Two connections have their own view of the same file, like two processes
+  warehouse_ros::DatabaseConnection::Ptr first_conn = connect();
+  ConstraintsCollection first = open(first_conn);
+  insert(first, "a1");
+
+  warehouse_ros::DatabaseConnection::Ptr second_conn = connect();
+  ConstraintsCollection second = open(second_conn);
+  insert(first, "a2");
+  insert(second, "b1");
+
+  EXPECT_EQ(find(second, "b1"), std::vector<std::string>({ "b1" }));
+  EXPECT_EQ(find(first, "a2"), std::vector<std::string>({ "a2" }));
+
+  ConstraintsCollection reloaded = open(connect());
+  EXPECT_EQ(reloaded->count(), 3u);
+  EXPECT_EQ(find(reloaded, "a1"), std::vector<std::string>({ "a1" }));
+  EXPECT_EQ(find(reloaded, "a2"), std::vector<std::string>({ "a2" }));
+  EXPECT_EQ(find(reloaded, "b1"), std::vector<std::string>({ "b1" }));
+}
+
+TEST_F(FileDatabaseConnectionTest, QueriesSeeChangesOfOtherWriters)
+{
+  warehouse_ros::DatabaseConnection::Ptr first_conn = connect();
+  ConstraintsCollection first = open(first_conn);
+  insert(first, "a1");
+
+  warehouse_ros::DatabaseConnection::Ptr second_conn = connect();
+  ConstraintsCollection second = open(second_conn);
+  EXPECT_EQ(second->count(), 1u);
+
+  insert(first, "a2");
+  warehouse_ros::Query::Ptr query = first->createQuery();
+  query->append("name", std::string("a1"));
+  EXPECT_EQ(first->removeMessages(query), 1u);
+
+  EXPECT_EQ(second->count(), 1u);
+  EXPECT_TRUE(find(second, "a1").empty());
+  EXPECT_EQ(find(second, "a2"), std::vector<std::string>({ "a2" }));
+
+  // Inserting loads the records of the other writer first
+  insert(second, "b1");
+  EXPECT_EQ(find(first, "b1"), std::vector<std::string>({ "b1" }));
+  EXPECT_EQ(first->count(), 2u);
+}
+
+TEST_F(FileDatabaseConnectionTest, OnlyWritersRemoveIncompleteRecords)
+{
+  insert(open(connect()), "a");
+  const std::uintmax_t complete_size = fileSize();
+  // Less than a record header, as left by a writer that died
+  appendToFile(std::string(6, 'x'));
+
+  warehouse_ros::DatabaseConnection::Ptr conn = connect();
+  EXPECT_FALSE(conn->messageType(DATABASE, COLLECTION).empty());
+  EXPECT_EQ(fileSize(), complete_size + 6);
+
+  ConstraintsCollection collection = open(conn);
+  EXPECT_EQ(fileSize(), complete_size);
+  EXPECT_EQ(collection->count(), 1u);
+  insert(collection, "b");
+
+  ConstraintsCollection reloaded = open(connect());
+  EXPECT_EQ(reloaded->count(), 2u);
+  EXPECT_EQ(find(reloaded, "b"), std::vector<std::string>({ "b" }));
+}
+
+TEST_F(FileDatabaseConnectionTest, InvalidRecordsAreKept)
+{
+  insert(open(connect()), "a");
+  // A complete record header without the record magic
+  appendToFile(std::string(32, '\0'));
+  const std::uintmax_t size = fileSize();
+
+  EXPECT_TRUE(connect()->messageType(DATABASE, COLLECTION).empty());
+  EXPECT_EQ(fileSize(), size);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
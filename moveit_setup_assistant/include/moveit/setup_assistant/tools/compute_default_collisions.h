@@ -82,11 +82,17 @@ typedef std::map<std::pair<std::string, std::string>, LinkPairData> LinkPairMap;
  * \param trials Set the number random collision checks that are made. Increase the probability of correctness
  * \param min_collision_fraction If collisions are found between a pair of links >= this fraction, the are assumed
  * "always" in collision
+ * \param never_collision_confidence If in (0, 1), the search for never colliding pairs stops before \e trials once it
+ * is this confident that no pair colliding in at least \e min_collision_probability of the random states is left
+ * undiscovered
+ * \param min_collision_probability Smallest fraction of colliding random states a pair needs to be found reliably
  * \return Adj List of unique set of pairs of links in string-based form
  */
 LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene, unsigned int* progress,
                                      const bool include_never_colliding, const unsigned int trials,
-                                     const double min_collision_faction, const bool verbose);
+                                     const double min_collision_faction, const bool verbose,
+                                     const double never_collision_confidence = 0.0,
+                                     const double min_collision_probability = 1e-4);
 
 /**
  * \brief Generate a list of unique link pairs for all links with geometry. Order pairs alphabetically. n choose 2 pairs
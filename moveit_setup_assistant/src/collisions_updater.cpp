@@ -104,12 +104,14 @@ bool setup(moveit_setup_assistant::MoveItConfigData& config_data, bool keep_old,
 }
 
 moveit_setup_assistant::LinkPairMap compute(moveit_setup_assistant::MoveItConfigData& config_data, uint32_t trials,
-                                            double min_collision_fraction, bool verbose)
+                                            double min_collision_fraction, bool verbose, double confidence,
+                                            double min_collision_probability)
 {
   // TODO: spin thread and print progess if verbose
   unsigned int collision_progress;
   return moveit_setup_assistant::computeDefaultCollisions(config_data.getPlanningScene(), &collision_progress,
-                                                          trials > 0, trials, min_collision_fraction, verbose);
+                                                          trials > 0, trials, min_collision_fraction, verbose,
+                                                          confidence, min_collision_probability);
 }
 
 int main(int argc, char* argv[])
@@ -123,6 +125,8 @@ int main(int argc, char* argv[])
   bool include_default = false, include_always = false, keep_old = false, verbose = false;
 
   double min_collision_fraction = 1.0;
+  double confidence = 0.0;
+  double min_collision_probability = 1e-4;
 
   uint32_t never_trials = 0;
 
@@ -142,7 +146,11 @@ int main(int argc, char* argv[])
 
                   ("trials", po::value(&never_trials), "number of trials for searching never colliding pairs")(
                       "min-collision-fraction", po::value(&min_collision_fraction),
-                      "fraction of small sample size to determine links that are alwas colliding");
+                      "fraction of small sample size to determine links that are alwas colliding")(
+                      "confidence", po::value(&confidence),
+                      "stop searching never colliding pairs early once this confident (0-1) that none is missed")(
+                      "min-collision-probability", po::value(&min_collision_probability),
+                      "smallest fraction of random states in collision for a pair to count with --confidence");
 
   po::positional_options_description pos_desc;
   pos_desc.add("xacro-args", -1);
@@ -194,7 +202,8 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  moveit_setup_assistant::LinkPairMap link_pairs = compute(config_data, never_trials, min_collision_fraction, verbose);
+  moveit_setup_assistant::LinkPairMap link_pairs =
+      compute(config_data, never_trials, min_collision_fraction, verbose, confidence, min_collision_probability);
 
   size_t skip_mask = 0;
   if (!include_default)
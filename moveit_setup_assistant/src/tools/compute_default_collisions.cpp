@@ -41,6 +41,10 @@
 #include <boost/unordered_map.hpp>
 #include <boost/assign.hpp>
 #include <ros/console.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 
 namespace moveit_setup_assistant
 {
@@ -59,30 +63,57 @@ const boost::unordered_map<std::string, DisabledReason> REASONS_FROM_STRING =
 // Unique set of pairs of links in string-based form
 typedef std::set<std::pair<std::string, std::string> > StringPairSet;
 
+// State shared by the threads sampling for never colliding link pairs. Threads collect pairs locally and merge them
+// in batches, which is also when the stopping rule is evaluated.
+struct NeverCollisionSampling
+{
+  NeverCollisionSampling(const StringPairSet& links_seen_colliding, unsigned long required_trials)
+    : links_seen_colliding_(links_seen_colliding)
+    , required_trials_without_new_pair_(required_trials)
+    , trials_without_new_pair_(0)
+    , trials_performed_(0)
+    , converged_(false)
+  {
+  }
+  boost::mutex lock_;
+  StringPairSet links_seen_colliding_;  // protected by lock_
+  unsigned long required_trials_without_new_pair_;  // 0 disables early stopping
+  unsigned long trials_without_new_pair_;           // protected by lock_
+  unsigned long trials_performed_;                  // protected by lock_
+  std::atomic<bool> converged_;
+};
+
+// Number of trials a thread performs between merges with the shared state
+static const unsigned int NEVER_COLLISION_BATCH_SIZE = 100;
+
 // Struct for passing parameters to threads, for cleaner code
 struct ThreadComputation
 {
   ThreadComputation(planning_scene::PlanningScene& scene, const collision_detection::CollisionRequest& req,
-                    int thread_id, int num_trials, StringPairSet* links_seen_colliding, boost::mutex* lock,
-                    unsigned int* progress)
-    : scene_(scene)
-    , req_(req)
-    , thread_id_(thread_id)
-    , num_trials_(num_trials)
-    , links_seen_colliding_(links_seen_colliding)
-    , lock_(lock)
-    , progress_(progress)
+                    int thread_id, int num_trials, NeverCollisionSampling* sampling, unsigned int* progress)
+    : scene_(scene), req_(req), thread_id_(thread_id), num_trials_(num_trials), sampling_(sampling), progress_(progress)
   {
   }
   planning_scene::PlanningScene& scene_;
   const collision_detection::CollisionRequest& req_;
   int thread_id_;
   unsigned int num_trials_;
-  StringPairSet* links_seen_colliding_;
-  boost::mutex* lock_;
+  NeverCollisionSampling* sampling_;
   unsigned int* progress_;  // only to be updated by thread 0
 };
 
+// Summary of the sampling for never colliding link pairs, reported in the statistics
+struct NeverCollisionStatistics
+{
+  NeverCollisionStatistics() : trials_requested(0), trials_performed(0), required_trials_without_new_pair(0), seconds(0)
+  {
+  }
+  unsigned long trials_requested;
+  unsigned long trials_performed;
+  unsigned long required_trials_without_new_pair;
+  double seconds;
+};
+
 // LinkGraph defines a Link's model and a set of unique links it connects
 typedef std::map<const robot_model::LinkModel*, std::set<const robot_model::LinkModel*> > LinkGraph;
 
@@ -155,11 +186,21 @@ static unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scen
  * \param link_pairs List of all unique link pairs and each pair's properties
  * \param req A reference to a collision request that is already initialized
  * \param links_seen_colliding Set of links that have at some point been seen in collision
+ * \param required_trials_without_new_pair Stop sampling once this many trials found no new colliding pair (0: never)
+ * \param statistics Filled with the number of trials performed and the time spent
  * \return number of never in collision links found and disabled
  */
 static unsigned int disableNeverInCollision(const unsigned int num_trials, planning_scene::PlanningScene& scene,
                                             LinkPairMap& link_pairs, const collision_detection::CollisionRequest& req,
-                                            StringPairSet& links_seen_colliding, unsigned int* progress);
+                                            StringPairSet& links_seen_colliding, unsigned int* progress,
+                                            unsigned long required_trials_without_new_pair,
+                                            NeverCollisionStatistics& statistics);
+
+/**
+ * \brief Number of consecutive trials without a new colliding pair needed to conclude, with the given confidence, that
+ * no remaining pair collides in more than min_collision_probability of the random states
+ */
+static unsigned long computeRequiredTrialsWithoutNewPair(double confidence, double min_collision_probability);
 
 /**
  * \brief Thread for getting the pairs of links that are never in collision
@@ -172,7 +213,8 @@ static void disableNeverInCollisionThread(ThreadComputation tc);
 // ******************************************************************************************
 LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene, unsigned int* progress,
                                      const bool include_never_colliding, const unsigned int num_trials,
-                                     const double min_collision_fraction, const bool verbose)
+                                     const double min_collision_fraction, const bool verbose,
+                                     const double never_collision_confidence, const double min_collision_probability)
 {
   // Create new instance of planning scene using pointer
   planning_scene::PlanningScenePtr scene = parent_scene->diff();
@@ -235,9 +277,12 @@ LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr
   // 6. NEVER IN COLLISION -------------------------------------------------------------------
   // Get the pairs of links that are never in collision
   unsigned int num_never = 0;
+  NeverCollisionStatistics never_statistics;
   if (include_never_colliding)  // option of function
   {
-    num_never = disableNeverInCollision(num_trials, *scene, link_pairs, req, links_seen_colliding, progress);
+    num_never = disableNeverInCollision(
+        num_trials, *scene, link_pairs, req, links_seen_colliding, progress,
+        computeRequiredTrialsWithoutNewPair(never_collision_confidence, min_collision_probability), never_statistics);
   }
 
   // ROS_INFO("Link pairs seen colliding ever: %d", int(links_seen_colliding.size()));
@@ -267,6 +312,23 @@ LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr
     ROS_INFO("%6d : %s", num_sometimes, "Sometimes in collision");
     ROS_INFO("%6d : %s", num_disabled, "TOTAL DISABLED");
 
+    if (include_never_colliding)
+    {
+      ROS_INFO("Never in collision sampling:");
+      ROS_INFO("%6lu : %s", never_statistics.trials_requested, "Trials requested");
+      ROS_INFO("%6lu : %s", never_statistics.trials_performed, "Trials performed");
+      if (never_statistics.required_trials_without_new_pair)
+        ROS_INFO("%6lu : %s", never_statistics.required_trials_without_new_pair,
+                 "Trials without new colliding pair required to stop");
+      ROS_INFO("%6.2f : %s", never_statistics.seconds, "Seconds");
+      if (never_statistics.seconds > 0.0)
+        ROS_INFO("%6.0f : %s", never_statistics.trials_performed / never_statistics.seconds, "Trials per second");
+      if (never_statistics.trials_performed > 0)
+        ROS_INFO("%6.2f : %s",
+                 double(never_statistics.trials_requested) / double(never_statistics.trials_performed),
+                 "Speedup from early stopping");
+    }
+
     /*ROS_INFO("Copy to Spreadsheet:");
     ROS_INFO_STREAM(num_links << "\t" << num_possible << "\t" << num_always << "\t" << num_never
                     << "\t" << num_default << "\t" << num_adjacent << "\t" << num_sometimes
@@ -545,25 +607,40 @@ unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scene, Link
   return num_disabled;
 }
 
+// ******************************************************************************************
+// Number of trials without new colliding pair after which sampling for never colliding pairs can stop
+// ******************************************************************************************
+unsigned long computeRequiredTrialsWithoutNewPair(double confidence, double min_collision_probability)
+{
+  if (confidence <= 0.0 || confidence >= 1.0 || min_collision_probability <= 0.0 || min_collision_probability >= 1.0)
+    return 0;
+
+  // A pair colliding in a fraction p of the states is missed by n trials with probability (1 - p)^n
+  return static_cast<unsigned long>(std::ceil(std::log(1.0 - confidence) / std::log(1.0 - min_collision_probability)));
+}
+
 // ******************************************************************************************
 // Get the pairs of links that are never in collision
 // ******************************************************************************************
 unsigned int disableNeverInCollision(const unsigned int num_trials, planning_scene::PlanningScene& scene,
                                      LinkPairMap& link_pairs, const collision_detection::CollisionRequest& req,
-                                     StringPairSet& links_seen_colliding, unsigned int* progress)
+                                     StringPairSet& links_seen_colliding, unsigned int* progress,
+                                     unsigned long required_trials_without_new_pair,
+                                     NeverCollisionStatistics& statistics)
 {
   unsigned int num_disabled = 0;
 
   boost::thread_group bgroup;  // create a group of threads
-  boost::mutex lock;           // used for sharing the same data structures
+  NeverCollisionSampling sampling(links_seen_colliding, required_trials_without_new_pair);
 
   int num_threads = boost::thread::hardware_concurrency();  // how many cores does this computer have?
   // ROS_INFO_STREAM("Performing " << num_trials << " trials for 'always in collision' checking on " <<
   //   num_threads << " threads...");
 
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   for (int i = 0; i < num_threads; ++i)
   {
-    ThreadComputation tc(scene, req, i, num_trials / num_threads, &links_seen_colliding, &lock, progress);
+    ThreadComputation tc(scene, req, i, num_trials / num_threads, &sampling, progress);
     bgroup.create_thread(boost::bind(&disableNeverInCollisionThread, tc));
   }
 
@@ -579,6 +656,12 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
     throw;
   }
 
+  statistics.trials_requested = (num_trials / num_threads) * num_threads;
+  statistics.trials_performed = sampling.trials_performed_;
+  statistics.required_trials_without_new_pair = required_trials_without_new_pair;
+  statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  links_seen_colliding.swap(sampling.links_seen_colliding_);
+
   // Loop through every possible link pair and check if it has ever been seen in collision
   for (std::pair<const std::pair<std::string, std::string>, LinkPairData>& link_pair : link_pairs)
   {
@@ -610,13 +693,46 @@ void disableNeverInCollisionThread(ThreadComputation tc)
   // ROS_INFO_STREAM("Thread " << tc.thread_id_ << " running " << tc.num_trials_ << " trials");
 
   // User feedback vars
-  const unsigned int progress_interval = tc.num_trials_ / 20;  // show progress update every 5%
+  const unsigned int progress_interval = std::max(tc.num_trials_ / 20, 1u);  // show progress update every 5%
 
   // Create a new kinematic state for this thread to work on
   robot_state::RobotState robot_state(tc.scene_.getRobotModel());
 
+  // Pairs seen colliding are allowed in a local copy of the collision matrix, so that their contacts are not computed
+  // again. Pairs found by this thread since the last merge are kept in new_pairs.
+  collision_detection::AllowedCollisionMatrix acm = tc.scene_.getAllowedCollisionMatrix();
+  StringPairSet local_seen_colliding;
+  {
+    boost::mutex::scoped_lock slock(tc.sampling_->lock_);
+    local_seen_colliding = tc.sampling_->links_seen_colliding_;
+  }
+  for (const std::pair<std::string, std::string>& link_pair : local_seen_colliding)
+    acm.setEntry(link_pair.first, link_pair.second, true);
+  std::vector<std::pair<std::string, std::string> > new_pairs;
+  unsigned int batch_trials = 0;
+
+  // Merge with the pairs found by the other threads and evaluate the stopping rule
+  auto merge = [&] {
+    boost::mutex::scoped_lock slock(tc.sampling_->lock_);
+    bool found_new_pair = false;
+    for (const std::pair<std::string, std::string>& link_pair : new_pairs)
+      found_new_pair |= tc.sampling_->links_seen_colliding_.insert(link_pair).second;
+    new_pairs.clear();
+    if (local_seen_colliding.size() != tc.sampling_->links_seen_colliding_.size())
+      for (const std::pair<std::string, std::string>& link_pair : tc.sampling_->links_seen_colliding_)
+        if (local_seen_colliding.insert(link_pair).second)
+          acm.setEntry(link_pair.first, link_pair.second, true);
+
+    tc.sampling_->trials_performed_ += batch_trials;
+    tc.sampling_->trials_without_new_pair_ = found_new_pair ? 0 : tc.sampling_->trials_without_new_pair_ + batch_trials;
+    if (tc.sampling_->required_trials_without_new_pair_ &&
+        tc.sampling_->trials_without_new_pair_ >= tc.sampling_->required_trials_without_new_pair_)
+      tc.sampling_->converged_ = true;
+    batch_trials = 0;
+  };
+
   // Do a large number of tests
-  for (unsigned int i = 0; i < tc.num_trials_; ++i)
+  for (unsigned int i = 0; i < tc.num_trials_ && !tc.sampling_->converged_; ++i)
   {
     boost::this_thread::interruption_point();
 
@@ -628,25 +744,23 @@ void disableNeverInCollisionThread(ThreadComputation tc)
 
     collision_detection::CollisionResult res;
     robot_state.setToRandomPositions();
-    tc.scene_.checkSelfCollision(tc.req_, res, robot_state);
+    tc.scene_.checkSelfCollision(tc.req_, res, robot_state, acm);
 
-    // Check all contacts
+    // Record the pairs not seen before
     for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
          it != res.contacts.end(); ++it)
     {
-      // Check if this collision pair is unique before doing a thread lock
-      if (tc.links_seen_colliding_->find(it->first) == tc.links_seen_colliding_->end())
+      if (local_seen_colliding.insert(it->first).second)
       {
-        // Collision Matrix and links_seen_colliding is modified only if needed, based on above if statement
-
-        boost::mutex::scoped_lock slock(*tc.lock_);
-        tc.links_seen_colliding_->insert(it->first);
-
-        tc.scene_.getAllowedCollisionMatrixNonConst().setEntry(it->first.first, it->first.second,
-                                                               true);  // disable link checking in the collision matrix
+        new_pairs.push_back(it->first);
+        acm.setEntry(it->first.first, it->first.second, true);
       }
     }
+
+    if (++batch_trials == NEVER_COLLISION_BATCH_SIZE)
+      merge();
   }
+  merge();
 }
 
 // ******************************************************************************************